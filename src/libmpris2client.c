@@ -30,66 +30,194 @@
 #include <gio/gio.h>
 
 #include "libmpris2client.h"
+#include "libmpris2client-private.h"
 #include "mpris2-metadata.h"
+#include "mpris2-metadata-private.h"
+#include "mpris2-playlist-private.h"
+#include "mpris2-tracklist-private.h"
+#include "mpris2-transport.h"
 
 /**
  * Libmpri2client:
  * It is a generic library for controlling any mpris2 compatible player
  */
 
-struct _Mpris2Client
+/* Players kept watched after switching away from them. */
+#define MPRIS2_CLIENT_STANDBY_SIZE 2
+
+/* Seconds to gather changes before saving the state cache. */
+#define MPRIS2_CLIENT_STATE_SAVE_DELAY 5
+
+/* OpenUri calls of mpris2_client_open_uris() waiting for a reply at once. */
+#define MPRIS2_CLIENT_OPEN_URIS_WINDOW 32
+
+/* Tracks asked in each GetTracksMetadata call, and calls in flight by default. */
+#define MPRIS2_CLIENT_TRACKS_CHUNK 64
+#define MPRIS2_CLIENT_TRACKS_FETCH_WINDOW 4
+
+/* Interfaces of a player, as flags of the ones to fetch again. */
+enum {
+	MPRIS2_INTERFACE_MEDIA_PLAYER = 1 << 0,
+	MPRIS2_INTERFACE_PLAYER       = 1 << 1,
+	MPRIS2_INTERFACE_TRACKLIST    = 1 << 2,
+	MPRIS2_INTERFACE_PLAYLISTS    = 1 << 3
+};
+
+/* AfterTrack of TrackAdded and AddTrack for the start of the list. */
+#define MPRIS2_TRACKLIST_NO_TRACK "/org/mpris/MediaPlayer2/TrackList/NoTrack"
+
+/* All the flags of the changed signal, as when switching to another player. */
+#define MPRIS2_CHANGED_ALL ((MPRIS2_CHANGED_PLAYLISTS << 1) - 1)
+
+#define MPRIS2_PLAYER_CAN(player, capability) (((player)->capabilities & (capability)) != 0)
+
+/* Methods without arguments of org.mpris.MediaPlayer2.Player, built once per owner. */
+static const gchar *player_commands[] = {
+	"Play",
+	"Pause",
+	"PlayPause",
+	"Next",
+	"Previous",
+	"Stop",
+	NULL
+};
+
+/* Playlist_Ordering values of the Playlists interface, by Mpris2PlaylistOrdering. */
+static const gchar *playlist_orderings[] = {
+	"Alphabetical",
+	"Created",
+	"Modified",
+	"Played",
+	"User"
+};
+
+/* A listing for each ordering, in both directions. */
+#define MPRIS2_N_PLAYLIST_LISTINGS (2 * G_N_ELEMENTS (playlist_orderings))
+
+/* The playlists in one ordering, filled as the pages are listed. */
+
+typedef struct {
+	GPtrArray      *playlists;   /* Mpris2Playlist, NULL where not listed yet. */
+	gint            length;      /* Known once a page comes short, else -1. */
+} Mpris2PlaylistListing;
+
+/* State of one player, the current one or one kept on standby. */
+
+typedef struct _Mpris2Player Mpris2Player;
+
+struct _Mpris2Player
 {
-	GObject parent_instance;
+	Mpris2Client    *client;
 
 	/* Priv */
-	GDBusConnection *gconnection;
-	GDBusProxy      *props_proxy;
-	GDBusProxy      *player_proxy;
+	gchar           *player;
 	gchar			*dbus_name;
 	guint            watch_id;
-	guint            playback_timer_id;
+	guint            props_changed_id;
+	guint            seeked_id;
+	guint            tracklist_signals_id;
+	guint            playlists_signal_id;
+	GCancellable    *cancellable;
 
-	/* Settings. */
-	gchar           *player;
-	gboolean         strict_mode;
+	/* Templates of player_commands, sent to the current owner. */
+	Mpris2TransportMessage **commands;
+
+	/* Interfaces with invalidated properties, fetched in an idle. */
+	guint            invalidated;
+	guint            refetch_id;
 
 	/* Status */
 	gboolean         connected;
+	gboolean         provisional;
+
+	/* Capabilities of both interfaces, as Mpris2Capabilities flags. */
+	guint            capabilities;
 
 	/* Interface MediaPlayer2 */
-	gboolean         can_quit;
-	gboolean         can_raise;
-	gboolean         has_tracklist;
 	gchar           *identity;
 	gchar          **supported_uri_schemes;
 	gchar          **supported_mime_types;
 
+	/* Lowercase sets of the above, built on the first lookup. */
+	GHashTable      *uri_schemes_index;
+	GHashTable      *mime_types_index;
+
 	/* Optionals Interface MediaPlayer2 */
 	gboolean         fullscreen;
-	gboolean         can_set_fullscreen;
 	gchar           *desktop_entry;
 
 	/* Interface MediaPlayer2.Player */
 	PlaybackStatus   playback_status;
 	gdouble          rate;
+	GVariant        *metadata_variant;
 	Mpris2Metadata  *metadata;
 	gdouble          volume;
 	gint             position;
+	gint64           position_time;
 	gdouble          minimum_rate;
 	gdouble          maximum_rate;
-	gboolean         can_go_next;
-	gboolean         can_go_previous;
-	gboolean         can_play;
-	gboolean         can_pause;
-	gboolean         can_seek;
-	gboolean         can_control;
 
 	/* Optionals Interface MediaPlayer2.Player */
-	gboolean         has_loop_status;
 	LoopStatus       loop_status;
-
-	gboolean         has_shuffle;
 	gboolean         shuffle;
+
+	/* Interface MediaPlayer2.TrackList, NULL until fetched, and kept up
+	 * to date by its signals. */
+	Mpris2TrackList *tracklist;
+	gboolean         tracklist_fetching;
+
+	/* GetTracksMetadata calls in flight, of this generation of the tracklist. */
+	guint            tracks_requests;
+	guint            tracks_generation;
+	gboolean         tracks_failed;
+
+	/* Optional interface MediaPlayer2.Playlists */
+	guint            playlist_count;
+	guint            playlist_orderings;   /* 1 << Mpris2PlaylistOrdering */
+	Mpris2Playlist  *active_playlist;
+
+	/* Pages of GetPlaylists listed so far, and the generation of the replies to keep. */
+	Mpris2PlaylistListing *playlist_listings[MPRIS2_N_PLAYLIST_LISTINGS];
+	guint            playlists_generation;
+};
+
+struct _Mpris2Client
+{
+	GObject parent_instance;
+
+	/* Priv */
+	Mpris2Transport *transport;
+	guint            playback_timer_id;
+	gboolean         auto_connect_pending;
+	guint            interest;
+
+	/* Players discovery */
+	gboolean         watch_players;
+	guint            name_owner_changed_id;
+	guint            properties_changed_id;
+	GHashTable      *running_players;
+	GHashTable      *player_owners;
+	gboolean         players_listed;
+
+	/* Settings. */
+	gboolean         strict_mode;
+	guint            standby_size;
+	gboolean         use_state_cache;
+	gboolean         auto_switch;
+	gchar          **allowed_players;
+	gchar          **denied_players;
+	guint            tracks_fetch_window;
+
+	/* Tracks shown by the user of the client, fetched first. */
+	guint            visible_position;
+	guint            n_visible_tracks;
+
+	/* Last generation given to the playlists of a player, unique across them. */
+	guint            playlists_generation;
+
+	/* Players, the current one and the recently used ones, still watched. */
+	Mpris2Player    *current;
+	GList           *standby;
 };
 
 enum
@@ -101,10 +229,50 @@ enum
 	VOLUME,
 	LOOP_STATUS,
 	SHUFFLE,
+	PLAYER_APPEARED,
+	PLAYER_VANISHED,
+	CHANGED,
+	TRACKLIST_CHANGED,
+	PLAYLIST_CHANGED,
 	LAST_SIGNAL
 };
 static int signals[LAST_SIGNAL] = { 0 };
 
+enum {
+	PROP_0,
+	PROP_PLAYER,
+	PROP_STANDBY_SIZE,
+	PROP_STRICT_MODE,
+	PROP_AUTO_SWITCH,
+	PROP_ALLOWED_PLAYERS,
+	PROP_DENIED_PLAYERS,
+	PROP_STATE_CACHE,
+	PROP_INTEREST,
+	PROP_TRACKS_FETCH_WINDOW,
+	PROP_CONNECTED,
+	PROP_PROVISIONAL,
+	/* In the order of the Mpris2Changed flags. */
+	PROP_PLAYBACK_STATUS,
+	PROP_LOOP_STATUS,
+	PROP_RATE,
+	PROP_SHUFFLE,
+	PROP_METADATA,
+	PROP_VOLUME,
+	PROP_POSITION,
+	PROP_MINIMUM_RATE,
+	PROP_MAXIMUM_RATE,
+	PROP_CAPABILITIES,
+	PROP_FULLSCREEN,
+	PROP_IDENTITY,
+	PROP_DESKTOP_ENTRY,
+	PROP_SUPPORTED_URI_SCHEMES,
+	PROP_SUPPORTED_MIME_TYPES,
+	PROP_ACTIVE_PLAYLIST,
+	PROP_PLAYLIST_COUNT,
+	N_PROPERTIES
+};
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
 G_DEFINE_TYPE (Mpris2Client, mpris2_client, G_TYPE_OBJECT)
 
 /*
@@ -113,25 +281,215 @@ G_DEFINE_TYPE (Mpris2Client, mpris2_client, G_TYPE_OBJECT)
 static void      mpris2_client_call_player_method              (Mpris2Client *mpris2, const char *method);
 static void      mpris2_client_call_media_player_method        (Mpris2Client *mpris2, const char *method);
 
-static void      mpris2_client_connect_dbus                    (Mpris2Client *mpris2);
+static void      mpris2_client_bus_ready                       (Mpris2Transport *transport, const GError *error, gpointer user_data);
+static void      mpris2_client_set_transport                   (Mpris2Client *mpris2, Mpris2Transport *transport);
+static gboolean  mpris2_client_ensure_transport                (Mpris2Client *mpris2);
+static void      mpris2_client_connect_dbus                    (Mpris2Player *player);
+static void      mpris2_client_watch_players_dbus              (Mpris2Client *mpris2);
+static void      mpris2_client_disconnect_dbus                 (Mpris2Player *player);
+static void      mpris2_client_update_playback_timer           (Mpris2Client *mpris2);
+static void      mpris2_client_emit_connection                 (Mpris2Client *mpris2, gboolean connected);
+static void      mpris2_client_revalidate_media_player_ready   (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data);
+static void      mpris2_client_get_all_player_ready            (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data);
+static void      mpris2_client_get_all_tracklist_ready         (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data);
+static void      mpris2_client_parse_tracklist_properties      (Mpris2Player *player, GVariant *properties);
+static void      mpris2_client_parse_playlists_properties      (Mpris2Player *player, GVariant *properties);
+static void      mpris2_client_get_all_playlists_ready         (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data);
+static void      mpris2_client_get_playlists_ready             (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data);
+static void      mpris2_client_resume_player                   (Mpris2Client *mpris2, gboolean was_connected);
+static void      mpris2_client_trim_standby                    (Mpris2Client *mpris2);
+static void      mpris2_client_note_command                    (Mpris2Client *mpris2);
+static void      mpris2_client_update_tracklist                (Mpris2Player *player);
+static void      mpris2_client_fetch_tracks_metadata           (Mpris2Player *player);
+static void      mpris2_client_emit_tracklist_changed          (Mpris2Player *player, guint position, guint removed, guint added);
+static const gchar *mpris2_client_choose_player                (Mpris2Client *mpris2, gchar **candidates);
+static gboolean  mpris2_client_player_is_allowed               (Mpris2Client *mpris2, const gchar *player, guint *rank);
+
+static Mpris2Player *mpris2_player_new                         (Mpris2Client *mpris2, const gchar *name);
+static void      mpris2_player_reset                           (Mpris2Player *player);
+static void      mpris2_player_drop_indexes                    (Mpris2Player *player);
+static guint     mpris2_player_drop_tracklist                  (Mpris2Player *player);
+static guint     mpris2_player_get_n_tracks                    (Mpris2Player *player);
+static void      mpris2_player_drop_playlists                  (Mpris2Player *player);
+static void      mpris2_player_set_active_playlist             (Mpris2Player *player, Mpris2Playlist *playlist);
+static GPtrArray *mpris2_playlist_listing_get_page             (Mpris2PlaylistListing *listing, guint index, guint max_count);
+static Mpris2Metadata *mpris2_player_get_metadata              (Mpris2Player *player);
+static gint      mpris2_player_get_position                    (Mpris2Player *player);
+static void      mpris2_player_free                            (Mpris2Player *player);
+static void      mpris2_player_store_state                     (Mpris2Player *player);
+static void      mpris2_player_restore_state                   (Mpris2Player *player);
 
-static GVariant *mpris2_client_get_all_player_properties       (Mpris2Client *mpris2);
 static GVariant *mpris2_client_get_player_properties           (Mpris2Client *mpris2, const gchar *prop);
 static void      mpris2_client_set_player_properties           (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop);
+static void      mpris2_client_fetch_position                  (Mpris2Player *player);
 
-static GVariant *mpris2_client_get_all_media_player_properties (Mpris2Client *mpris2);
 static void      mpris2_client_set_media_player_properties     (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop);
 
 /**
  * mpris2_client_new:
  *
+ * The session bus is got without blocking, players can be set meanwhile.
+ * The blocking functions, as mpris2_client_auto_connect(), get it at once
+ * the first time they are used before it is ready.
+ *
  * Returns: (transfer full): a new instance of mpris2client.
  */
 
 Mpris2Client *
 mpris2_client_new (void)
 {
-	return g_object_new(MPRIS2_TYPE_CLIENT, NULL);
+	Mpris2Client *mpris2;
+
+	mpris2 = g_object_new(MPRIS2_TYPE_CLIENT, NULL);
+
+	mpris2_transport_new_session (NULL, mpris2_client_bus_ready, g_object_ref (mpris2));
+
+	return mpris2;
+}
+
+/**
+ * mpris2_client_new_for_connection:
+ * @connection: a #GDBusConnection to a message bus.
+ *
+ * Use a connection the application already has, instead of the session bus.
+ * It always talks through GDBus, whatever the configured transport.
+ *
+ * Returns: (transfer full): a new instance of mpris2client.
+ */
+
+Mpris2Client *
+mpris2_client_new_for_connection (GDBusConnection *connection)
+{
+	Mpris2Transport *transport;
+	Mpris2Client *mpris2;
+
+	g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), NULL);
+
+	mpris2 = g_object_new(MPRIS2_TYPE_CLIENT, NULL);
+
+	transport = mpris2_transport_gdbus_new (connection);
+	mpris2_client_set_transport (mpris2, transport);
+	mpris2_transport_unref (transport);
+
+	return mpris2;
+}
+
+/* As above with any transport, as the loopback one to measure the client alone. */
+
+Mpris2Client *
+mpris2_client_new_for_transport (Mpris2Transport *transport)
+{
+	Mpris2Client *mpris2;
+
+	mpris2 = g_object_new(MPRIS2_TYPE_CLIENT, NULL);
+	mpris2_client_set_transport (mpris2, transport);
+
+	return mpris2;
+}
+
+static void
+mpris2_client_address_ready (Mpris2Transport *transport,
+                             const GError    *error,
+                             gpointer         user_data)
+{
+	GSimpleAsyncResult *simple = user_data;
+	Mpris2Client *mpris2;
+
+	if (transport == NULL) {
+		g_simple_async_result_set_from_error (simple, error);
+	}
+	else {
+		mpris2 = g_object_new(MPRIS2_TYPE_CLIENT, NULL);
+		mpris2_client_set_transport (mpris2, transport);
+		g_simple_async_result_set_op_res_gpointer (simple, mpris2, g_object_unref);
+	}
+
+	g_simple_async_result_complete (simple);
+	g_object_unref (simple);
+}
+
+/**
+ * mpris2_client_new_for_address:
+ * @address: a D-Bus address of a message bus, as a private one.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when the client is ready.
+ * @user_data: data to pass to @callback.
+ *
+ * Connect to the bus at @address without blocking, and call @callback.
+ * Get the client with mpris2_client_new_for_address_finish().
+ */
+void
+mpris2_client_new_for_address (const gchar         *address,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+	GSimpleAsyncResult *simple;
+
+	simple = g_simple_async_result_new (NULL, callback, user_data,
+	                                    mpris2_client_new_for_address);
+
+	mpris2_transport_new_for_address (address, cancellable,
+	                                  mpris2_client_address_ready, simple);
+}
+
+/**
+ * mpris2_client_new_for_address_finish:
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * Returns: (transfer full): a new instance of mpris2client, or NULL on error.
+ */
+Mpris2Client *
+mpris2_client_new_for_address_finish (GAsyncResult  *res,
+                                      GError       **error)
+{
+	GSimpleAsyncResult *simple;
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, NULL, mpris2_client_new_for_address), NULL);
+
+	simple = G_SIMPLE_ASYNC_RESULT (res);
+	if (g_simple_async_result_propagate_error (simple, error))
+		return NULL;
+
+	return g_object_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+/**
+ * mpris2_client_new_sharing:
+ * @mpris2: a #Mpris2Client whose bus is ready.
+ *
+ * Make another client on the same bus connection as @mpris2, as to follow
+ * several players at once, whatever the configured transport.
+ *
+ * Returns: (transfer full): a new instance of mpris2client, or NULL while
+ * the bus of @mpris2 is not ready.
+ */
+Mpris2Client *
+mpris2_client_new_sharing (Mpris2Client *mpris2)
+{
+	g_return_val_if_fail (MPRIS2_IS_CLIENT (mpris2), NULL);
+
+	if (mpris2->transport == NULL)
+		return NULL;
+
+	return mpris2_client_new_for_transport (mpris2->transport);
+}
+
+/**
+ * mpris2_client_get_connection:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: (transfer none): the connection used, or NULL while the
+ * session bus is not ready or if it is not a GDBus one.
+ */
+GDBusConnection *
+mpris2_client_get_connection (Mpris2Client *mpris2)
+{
+	if (mpris2->transport == NULL)
+		return NULL;
+
+	return mpris2_transport_get_connection (mpris2->transport);
 }
 
 gboolean
@@ -143,7 +501,11 @@ mpris2_client_get_strict_mode (Mpris2Client *mpris2)
 void
 mpris2_client_set_strict_mode (Mpris2Client *mpris2, gboolean strict_mode)
 {
+	if (mpris2->strict_mode == strict_mode)
+		return;
+
 	mpris2->strict_mode = strict_mode;
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_STRICT_MODE]);
 }
 
 /*
@@ -153,13 +515,13 @@ mpris2_client_set_strict_mode (Mpris2Client *mpris2, gboolean strict_mode)
 void
 mpris2_client_prev (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_go_previous)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_GO_PREVIOUS))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "Previous");
@@ -168,13 +530,13 @@ mpris2_client_prev (Mpris2Client *mpris2)
 void
 mpris2_client_next (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_go_next)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_GO_NEXT))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "Next");
@@ -183,13 +545,13 @@ mpris2_client_next (Mpris2Client *mpris2)
 void
 mpris2_client_pause (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_pause)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_PAUSE))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "Pause");
@@ -198,13 +560,13 @@ mpris2_client_pause (Mpris2Client *mpris2)
 void
 mpris2_client_play_pause (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_pause)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_PAUSE))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "PlayPause");
@@ -213,13 +575,13 @@ mpris2_client_play_pause (Mpris2Client *mpris2)
 void
 mpris2_client_stop (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_control)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "Stop");
@@ -228,13 +590,13 @@ mpris2_client_stop (Mpris2Client *mpris2)
 void
 mpris2_client_play (Mpris2Client *mpris2)
 {
-	if (!mpris2->connected)
+	if (!mpris2->current->connected)
 		return;
 
-	if (!mpris2->can_control)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL))
 		return;
 
-	if (mpris2->strict_mode && !mpris2->can_play)
+	if (mpris2->strict_mode && !MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_PLAY))
 		return;
 
 	mpris2_client_call_player_method (mpris2, "Play");
@@ -243,97 +605,258 @@ mpris2_client_play (Mpris2Client *mpris2)
 void
 mpris2_client_seek (Mpris2Client *mpris2, gint offset)
 {
-	GDBusMessage *message;
-	GError       *error = NULL;
-
-	message = g_dbus_message_new_method_call (mpris2->dbus_name,
-	                                          "/org/mpris/MediaPlayer2",
-	                                          "org.mpris.MediaPlayer2.Player",
-	                                          "Seek");
-	g_dbus_message_set_body (message, g_variant_new ("(x)", offset));
-
-	g_dbus_connection_send_message (mpris2->gconnection,
-	                                message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL,
-	                                &error);
-	if (error != NULL) {
-		g_warning ("unable to send message: %s", error->message);
-		g_clear_error (&error);
-		error = NULL;
-	}
+	if (!mpris2->current->connected)
+		return;
 
-	g_dbus_connection_flush_sync (mpris2->gconnection, NULL, &error);
-	if (error != NULL) {
-		g_warning ("unable to flush message queue: %s", error->message);
-		g_clear_error (&error);
-	}
+	mpris2_client_note_command (mpris2);
 
-	g_object_unref (message);
+	mpris2_transport_send (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2.Player",
+	                       "Seek",
+	                       g_variant_new ("(x)", offset));
 }
 
 void
 mpris2_client_set_position (Mpris2Client *mpris2, const gchar *track_id, gint position)
 {
-	GDBusMessage *message;
-	GError       *error = NULL;
-
-	message = g_dbus_message_new_method_call (mpris2->dbus_name,
-	                                          "/org/mpris/MediaPlayer2",
-	                                          "org.mpris.MediaPlayer2.Player",
-	                                          "SetPosition");
-	g_dbus_message_set_body (message, g_variant_new ("(ox)", track_id, position));
-
-	g_dbus_connection_send_message (mpris2->gconnection,
-	                                message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL,
-	                                &error);
-	if (error != NULL) {
-		g_warning ("unable to send message: %s", error->message);
-		g_clear_error (&error);
-		error = NULL;
-	}
+	if (!mpris2->current->connected)
+		return;
 
-	g_dbus_connection_flush_sync (mpris2->gconnection, NULL, &error);
-	if (error != NULL) {
-		g_warning ("unable to flush message queue: %s", error->message);
-		g_clear_error (&error);
-	}
+	mpris2_client_note_command (mpris2);
 
-	g_object_unref (message);
+	mpris2_transport_send (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2.Player",
+	                       "SetPosition",
+	                       g_variant_new ("(ox)", track_id, position));
 }
 
 void
 mpris2_client_open_uri (Mpris2Client *mpris2, const gchar *uri)
 {
-	GDBusMessage *message;
-	GError       *error = NULL;
-
-	message = g_dbus_message_new_method_call (mpris2->dbus_name,
-	                                          "/org/mpris/MediaPlayer2",
-	                                          "org.mpris.MediaPlayer2.Player",
-	                                          "OpenUri");
-	g_dbus_message_set_body (message, g_variant_new ("(s)", uri));
-
-	g_dbus_connection_send_message (mpris2->gconnection,
-	                                message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL,
-	                                &error);
-	if (error != NULL) {
-		g_warning ("unable to send message: %s", error->message);
-		g_clear_error (&error);
-		error = NULL;
+	if (!mpris2->current->connected)
+		return;
+
+	mpris2_client_note_command (mpris2);
+
+	mpris2_transport_send (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2.Player",
+	                       "OpenUri",
+	                       g_variant_new ("(s)", uri));
+}
+
+/* A batch of OpenUri calls, answered in the order they are sent. */
+
+typedef struct {
+	GSimpleAsyncResult  *simple;
+	Mpris2Transport     *transport;
+	gchar               *dbus_name;
+	gchar              **uris;
+	GPtrArray           *errors;
+	GCancellable        *cancellable;
+	guint                next;
+	guint                pending;
+	gboolean             sending;
+} Mpris2OpenUris;
+
+typedef struct {
+	Mpris2OpenUris *data;
+	guint           index;
+} Mpris2OpenUri;
+
+static void mpris2_client_open_uris_next (Mpris2OpenUris *data);
+
+static void
+mpris2_open_uris_error_free (gpointer error)
+{
+	if (error != NULL)
+		g_error_free (error);
+}
+
+static void
+mpris2_open_uris_free (Mpris2OpenUris *data)
+{
+	mpris2_transport_unref (data->transport);
+	g_free (data->dbus_name);
+	g_strfreev (data->uris);
+	if (data->errors != NULL)
+		g_ptr_array_free (data->errors, TRUE);
+	if (data->cancellable != NULL)
+		g_object_unref (data->cancellable);
+	g_slice_free (Mpris2OpenUris, data);
+}
+
+static void
+mpris2_client_open_uri_ready (GVariant     *reply,
+                              const gchar  *sender,
+                              const GError *error,
+                              gpointer      user_data)
+{
+	Mpris2OpenUri *item = user_data;
+	Mpris2OpenUris *data = item->data;
+
+	if (error != NULL)
+		g_ptr_array_index (data->errors, item->index) = g_error_copy (error);
+
+	g_slice_free (Mpris2OpenUri, item);
+
+	data->pending--;
+	mpris2_client_open_uris_next (data);
+}
+
+/* Keep a window of calls in flight, and complete once all are answered. */
+
+static void
+mpris2_client_open_uris_next (Mpris2OpenUris *data)
+{
+	Mpris2OpenUri *item;
+	guint len = data->errors->len;
+
+	/* A reply given while sending is left to the loop below. */
+	if (data->sending)
+		return;
+
+	data->sending = TRUE;
+	while (data->next < len && data->pending < MPRIS2_CLIENT_OPEN_URIS_WINDOW) {
+		/* Refused before sending, as not supported. */
+		if (g_ptr_array_index (data->errors, data->next) != NULL) {
+			data->next++;
+			continue;
+		}
+
+		item = g_slice_new (Mpris2OpenUri);
+		item->data = data;
+		item->index = data->next++;
+
+		data->pending++;
+		mpris2_transport_call (data->transport,
+		                       data->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.mpris.MediaPlayer2.Player",
+		                       "OpenUri",
+		                       g_variant_new ("(s)", data->uris[item->index]),
+		                       G_VARIANT_TYPE ("()"),
+		                       data->cancellable,
+		                       mpris2_client_open_uri_ready,
+		                       item);
 	}
+	data->sending = FALSE;
 
-	g_dbus_connection_flush_sync (mpris2->gconnection, NULL, &error);
-	if (error != NULL) {
-		g_warning ("unable to flush message queue: %s", error->message);
-		g_clear_error (&error);
+	if (data->next < len || data->pending > 0)
+		return;
+
+	g_simple_async_result_set_op_res_gpointer (data->simple, data->errors,
+	                                           (GDestroyNotify) g_ptr_array_unref);
+	data->errors = NULL;
+
+	g_simple_async_result_complete_in_idle (data->simple);
+	g_object_unref (data->simple);
+
+	mpris2_open_uris_free (data);
+}
+
+/**
+ * mpris2_client_open_uris:
+ * @mpris2: a #Mpris2Client
+ * @uris: (array zero-terminated=1): the uris to open, in order.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when all the uris are answered.
+ * @user_data: data to pass to @callback.
+ *
+ * Open many uris in the current player without waiting each reply.
+ * The uris which scheme is not supported are not sent at all.
+ * Get the result of each uri with mpris2_client_open_uris_finish().
+ */
+void
+mpris2_client_open_uris (Mpris2Client        *mpris2,
+                         const gchar * const *uris,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+	Mpris2OpenUris *data;
+	GSimpleAsyncResult *simple;
+	guint i;
+
+	simple = g_simple_async_result_new (G_OBJECT (mpris2), callback, user_data,
+	                                    mpris2_client_open_uris);
+
+	if (!mpris2->current->connected) {
+		g_simple_async_result_set_error (simple, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+		                                 "No player connected");
+		g_simple_async_result_complete_in_idle (simple);
+		g_object_unref (simple);
+		return;
+	}
+
+	mpris2_client_note_command (mpris2);
+
+	data = g_slice_new0 (Mpris2OpenUris);
+	data->simple = simple;
+	data->transport = mpris2_transport_ref (mpris2->transport);
+	data->dbus_name = g_strdup (mpris2->current->dbus_name);
+	data->uris = g_strdupv ((gchar **) uris);
+	if (cancellable != NULL)
+		data->cancellable = g_object_ref (cancellable);
+
+	data->errors = g_ptr_array_new_with_free_func (mpris2_open_uris_error_free);
+	for (i = 0; uris[i] != NULL; i++) {
+		if (mpris2_client_supports_uri (mpris2, uris[i]))
+			g_ptr_array_add (data->errors, NULL);
+		else
+			g_ptr_array_add (data->errors,
+			                 g_error_new (G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			                              "Uri scheme not supported by the player: %s", uris[i]));
+	}
+
+	mpris2_client_open_uris_next (data);
+}
+
+/**
+ * mpris2_client_open_uris_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @errors: (out) (allow-none) (transfer full) (element-type GError):
+ *   the error of each uri in the order given, NULL where it was opened.
+ * @error: return location for error or NULL.
+ *
+ * Returns: TRUE if every uri was opened.
+ */
+gboolean
+mpris2_client_open_uris_finish (Mpris2Client  *mpris2,
+                                GAsyncResult  *res,
+                                GPtrArray    **errors,
+                                GError       **error)
+{
+	GSimpleAsyncResult *simple;
+	GPtrArray *results;
+	gboolean opened = TRUE;
+	guint i;
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (mpris2), mpris2_client_open_uris), FALSE);
+
+	if (errors != NULL)
+		*errors = NULL;
+
+	simple = G_SIMPLE_ASYNC_RESULT (res);
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	results = g_simple_async_result_get_op_res_gpointer (simple);
+	for (i = 0; i < results->len; i++) {
+		if (g_ptr_array_index (results, i) != NULL)
+			opened = FALSE;
 	}
 
-	g_object_unref (message);
+	if (errors != NULL)
+		*errors = g_ptr_array_ref (results);
+
+	return opened;
 }
 
 /*
@@ -343,7 +866,7 @@ mpris2_client_open_uri (Mpris2Client *mpris2, const gchar *uri)
 void
 mpris2_client_raise_player (Mpris2Client *mpris2)
 {
-	if (!mpris2->can_raise)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_RAISE))
 		return;
 
 	mpris2_client_call_media_player_method (mpris2, "Raise");
@@ -352,7 +875,7 @@ mpris2_client_raise_player (Mpris2Client *mpris2)
 void
 mpris2_client_quit_player (Mpris2Client *mpris2)
 {
-	if (!mpris2->can_quit)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_QUIT))
 		return;
 
 	mpris2_client_call_media_player_method (mpris2, "Quit");
@@ -361,107 +884,658 @@ mpris2_client_quit_player (Mpris2Client *mpris2)
 void
 mpris2_client_set_fullscreen_player (Mpris2Client *mpris2, gboolean fullscreen)
 {
-	if (!mpris2->can_set_fullscreen)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_SET_FULLSCREEN))
 		return;
 
 	mpris2_client_set_media_player_properties (mpris2, "Fullscreen", g_variant_new_boolean(fullscreen));
 }
 
 /*
- * Interface MediaPlayer2.Player properties.
+ * Interface MediaPlayer2.TrackList.
  */
 
-PlaybackStatus
-mpris2_client_get_playback_status (Mpris2Client *mpris2)
+/**
+ * mpris2_client_get_n_tracks:
+ * @mpris2: a #Mpris2Client
+ *
+ * The tracklist is only kept while a #Mpris2Client::tracklist-changed
+ * handler is connected, see mpris2_client_update_interest().
+ *
+ * Returns: the number of tracks in the tracklist of the player.
+ */
+guint
+mpris2_client_get_n_tracks (Mpris2Client *mpris2)
 {
-	return mpris2->playback_status;
+	return mpris2_player_get_n_tracks (mpris2->current);
 }
 
-gdouble
-mpris2_client_get_playback_rate (Mpris2Client *mpris2)
+/**
+ * mpris2_client_get_track_id:
+ * @mpris2: a #Mpris2Client
+ * @index: the position of the track in the tracklist.
+ *
+ * The id is copied out of the tracklist, so it can be kept while the
+ * tracklist changes, as the metadata.
+ *
+ * Returns: (transfer full): the track id at @index, to free with
+ * g_free(), or NULL if out of the tracklist.
+ */
+gchar *
+mpris2_client_get_track_id (Mpris2Client *mpris2, guint index)
 {
-	return mpris2->rate;
+	if (index >= mpris2_player_get_n_tracks (mpris2->current))
+		return NULL;
+
+	return g_strdup (mpris2_tracklist_get_id (mpris2->current->tracklist, index));
 }
 
+/**
+ * mpris2_client_get_track_metadata:
+ * @mpris2: a #Mpris2Client
+ * @track_id: a track id of the tracklist.
+ *
+ * The metadata is built from the tracklist at each call, so it can be
+ * kept while the tracklist changes.
+ *
+ * Returns: (transfer full): the metadata of the track, to free with
+ * mpris2_metadata_free(), or NULL if unknown or not received yet.
+ */
 Mpris2Metadata *
-mpris2_client_get_metadata (Mpris2Client *mpris2)
+mpris2_client_get_track_metadata (Mpris2Client *mpris2, const gchar *track_id)
 {
-	return mpris2->metadata;
+	if (mpris2->current->tracklist == NULL)
+		return NULL;
+
+	return mpris2_tracklist_get_metadata (mpris2->current->tracklist, track_id);
 }
 
-gdouble
-mpris2_client_get_volume (Mpris2Client *mpris2)
+gboolean
+mpris2_client_get_can_edit_tracks (Mpris2Client *mpris2)
 {
-	return mpris2->volume;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_EDIT_TRACKS);
 }
 
+/**
+ * mpris2_client_set_visible_tracks:
+ * @mpris2: a #Mpris2Client
+ * @position: the first track shown.
+ * @n_tracks: the number of tracks shown, or zero if none.
+ *
+ * The metadata of the tracks shown is asked before the rest, so the
+ * first screen of a large tracklist is filled at once.
+ */
 void
-mpris2_client_set_volume (Mpris2Client *mpris2, gdouble volume)
+mpris2_client_set_visible_tracks (Mpris2Client *mpris2, guint position, guint n_tracks)
 {
-	mpris2_client_set_player_properties (mpris2, "Volume", g_variant_new_double(volume));
+	mpris2->visible_position = position;
+	mpris2->n_visible_tracks = n_tracks;
+
+	mpris2_client_fetch_tracks_metadata (mpris2->current);
 }
 
-gint
-mpris2_client_get_position (Mpris2Client *mpris2)
+/**
+ * mpris2_client_get_tracks_fetch_window:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: the number of calls for the metadata of the tracks in flight.
+ */
+guint
+mpris2_client_get_tracks_fetch_window (Mpris2Client *mpris2)
 {
-	return mpris2->position;
+	return mpris2->tracks_fetch_window;
 }
 
-gint
-mpris2_client_get_accurate_position (Mpris2Client *mpris2)
+/**
+ * mpris2_client_set_tracks_fetch_window:
+ * @mpris2: a #Mpris2Client
+ * @tracks_fetch_window: the number of calls in flight, at least one.
+ *
+ * The metadata of the tracks is asked in chunks of a bounded size, with
+ * up to @tracks_fetch_window calls waiting a reply at once.
+ */
+void
+mpris2_client_set_tracks_fetch_window (Mpris2Client *mpris2, guint tracks_fetch_window)
 {
-	GVariant *value;
-	value = mpris2_client_get_player_properties (mpris2, "Position");
+	g_return_if_fail (tracks_fetch_window > 0);
 
-	return (gint) g_variant_get_int64 (value);
-}
+	if (mpris2->tracks_fetch_window == tracks_fetch_window)
+		return;
 
-gdouble
-mpris2_client_get_minimum_rate (Mpris2Client *mpris2)
-{
-	return mpris2->minimum_rate;
-}
+	mpris2->tracks_fetch_window = tracks_fetch_window;
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_TRACKS_FETCH_WINDOW]);
 
-gdouble
-mpris2_client_get_maximum_rate (Mpris2Client *mpris2)
-{
-	return mpris2->maximum_rate;
+	mpris2_client_fetch_tracks_metadata (mpris2->current);
 }
 
-gboolean
-mpris2_client_get_can_go_next (Mpris2Client *mpris2)
+static void
+mpris2_client_optional_method_ready (GVariant     *reply,
+                                     const gchar  *sender,
+                                     const GError *error,
+                                     gpointer      user_data)
 {
-	return mpris2->can_go_next;
+	GSimpleAsyncResult *simple = user_data;
+
+	if (reply == NULL)
+		g_simple_async_result_set_from_error (simple, error);
+
+	g_simple_async_result_complete (simple);
+	g_object_unref (simple);
+}
+
+/* Methods of the optional interfaces, refused if the player has not
+ * @capability. @parameters is consumed if floating, also when the call
+ * is not made. */
+
+static void
+mpris2_client_call_optional_method (Mpris2Client        *mpris2,
+                                    const gchar         *interface_name,
+                                    guint                capability,
+                                    const gchar         *method,
+                                    GVariant            *parameters,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data,
+                                    gpointer             source_tag)
+{
+	GSimpleAsyncResult *simple;
+
+	simple = g_simple_async_result_new (G_OBJECT (mpris2), callback, user_data, source_tag);
+
+	if (!mpris2->current->connected ||
+	    !MPRIS2_PLAYER_CAN (mpris2->current, capability)) {
+		g_variant_unref (g_variant_ref_sink (parameters));
+		if (!mpris2->current->connected)
+			g_simple_async_result_set_error (simple, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+			                                 "No player connected");
+		else
+			g_simple_async_result_set_error (simple, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			                                 "The player has no %s interface", interface_name);
+		g_simple_async_result_complete_in_idle (simple);
+		g_object_unref (simple);
+		return;
+	}
+
+	mpris2_client_note_command (mpris2);
+
+	mpris2_transport_call (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       interface_name,
+	                       method,
+	                       parameters,
+	                       G_VARIANT_TYPE ("()"),
+	                       cancellable,
+	                       mpris2_client_optional_method_ready,
+	                       simple);
+}
+
+static gboolean
+mpris2_client_optional_method_finish (Mpris2Client  *mpris2,
+                                      GAsyncResult  *res,
+                                      gpointer       source_tag,
+                                      GError       **error)
+{
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (mpris2), source_tag), FALSE);
+
+	return !g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), error);
+}
+
+/**
+ * mpris2_client_go_to_track:
+ * @mpris2: a #Mpris2Client
+ * @track_id: a track id of the tracklist.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when the player replies.
+ * @user_data: data to pass to @callback.
+ *
+ * Skip to @track_id, without waiting the reply of the player.
+ */
+void
+mpris2_client_go_to_track (Mpris2Client        *mpris2,
+                           const gchar         *track_id,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+	mpris2_client_call_optional_method (mpris2, "org.mpris.MediaPlayer2.TrackList",
+	                                    MPRIS2_HAS_TRACKLIST, "GoTo",
+	                                    g_variant_new ("(o)", track_id),
+	                                    cancellable, callback, user_data,
+	                                    mpris2_client_go_to_track);
+}
+
+/**
+ * mpris2_client_go_to_track_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * Returns: TRUE if the player went to the track.
+ */
+gboolean
+mpris2_client_go_to_track_finish (Mpris2Client *mpris2, GAsyncResult *res, GError **error)
+{
+	return mpris2_client_optional_method_finish (mpris2, res, mpris2_client_go_to_track, error);
+}
+
+/**
+ * mpris2_client_add_track:
+ * @mpris2: a #Mpris2Client
+ * @uri: the uri of the track to add.
+ * @after_track: (allow-none): the track id to add it after, or NULL to add it first.
+ * @set_as_current: whether to play the new track at once.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when the player replies.
+ * @user_data: data to pass to @callback.
+ *
+ * Needs mpris2_client_get_can_edit_tracks().
+ */
+void
+mpris2_client_add_track (Mpris2Client        *mpris2,
+                         const gchar         *uri,
+                         const gchar         *after_track,
+                         gboolean             set_as_current,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+	if (after_track == NULL)
+		after_track = MPRIS2_TRACKLIST_NO_TRACK;
+
+	mpris2_client_call_optional_method (mpris2, "org.mpris.MediaPlayer2.TrackList",
+	                                    MPRIS2_HAS_TRACKLIST, "AddTrack",
+	                                    g_variant_new ("(sob)", uri, after_track, set_as_current),
+	                                    cancellable, callback, user_data,
+	                                    mpris2_client_add_track);
+}
+
+/**
+ * mpris2_client_add_track_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * The track itself is told by #Mpris2Client::tracklist-changed.
+ *
+ * Returns: TRUE if the player accepted the track.
+ */
+gboolean
+mpris2_client_add_track_finish (Mpris2Client *mpris2, GAsyncResult *res, GError **error)
+{
+	return mpris2_client_optional_method_finish (mpris2, res, mpris2_client_add_track, error);
+}
+
+/**
+ * mpris2_client_remove_track:
+ * @mpris2: a #Mpris2Client
+ * @track_id: a track id of the tracklist.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when the player replies.
+ * @user_data: data to pass to @callback.
+ *
+ * Needs mpris2_client_get_can_edit_tracks().
+ */
+void
+mpris2_client_remove_track (Mpris2Client        *mpris2,
+                            const gchar         *track_id,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+	mpris2_client_call_optional_method (mpris2, "org.mpris.MediaPlayer2.TrackList",
+	                                    MPRIS2_HAS_TRACKLIST, "RemoveTrack",
+	                                    g_variant_new ("(o)", track_id),
+	                                    cancellable, callback, user_data,
+	                                    mpris2_client_remove_track);
+}
+
+/**
+ * mpris2_client_remove_track_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * Returns: TRUE if the player removed the track.
+ */
+gboolean
+mpris2_client_remove_track_finish (Mpris2Client *mpris2, GAsyncResult *res, GError **error)
+{
+	return mpris2_client_optional_method_finish (mpris2, res, mpris2_client_remove_track, error);
+}
+
+/*
+ * Interface MediaPlayer2.Playlists.
+ */
+
+/**
+ * mpris2_client_has_playlists_support:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: TRUE if the player has the optional Playlists interface.
+ */
+gboolean
+mpris2_client_has_playlists_support (Mpris2Client *mpris2)
+{
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_PLAYLISTS);
+}
+
+/**
+ * mpris2_client_get_playlist_count:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: the number of playlists of the player.
+ */
+guint
+mpris2_client_get_playlist_count (Mpris2Client *mpris2)
+{
+	return mpris2->current->playlist_count;
+}
+
+/**
+ * mpris2_client_supports_playlist_ordering:
+ * @mpris2: a #Mpris2Client
+ * @ordering: a #Mpris2PlaylistOrdering
+ *
+ * Returns: TRUE if the player can list its playlists in @ordering.
+ */
+gboolean
+mpris2_client_supports_playlist_ordering (Mpris2Client *mpris2, Mpris2PlaylistOrdering ordering)
+{
+	g_return_val_if_fail (ordering < G_N_ELEMENTS (playlist_orderings), FALSE);
+
+	return (mpris2->current->playlist_orderings & (1 << ordering)) != 0;
+}
+
+/**
+ * mpris2_client_get_active_playlist:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: (transfer none): the playlist being played, or NULL if none.
+ */
+Mpris2Playlist *
+mpris2_client_get_active_playlist (Mpris2Client *mpris2)
+{
+	return mpris2->current->active_playlist;
+}
+
+/* A GetPlaylists call. The player is only compared until found again,
+ * as it may be gone before the reply. */
+
+typedef struct {
+	GSimpleAsyncResult *simple;
+	Mpris2Client       *client;
+	Mpris2Player       *player;
+	guint               generation;
+	guint               listing;
+	guint               index;
+	guint               max_count;
+} Mpris2PlaylistsRequest;
+
+/**
+ * mpris2_client_get_playlists:
+ * @mpris2: a #Mpris2Client
+ * @index: the position of the first playlist of the page.
+ * @max_count: the most playlists in the page.
+ * @ordering: how to sort the playlists, see mpris2_client_supports_playlist_ordering().
+ * @reverse_order: whether to list them in the reverse order.
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called with the page.
+ * @user_data: data to pass to @callback.
+ *
+ * Lists a page of the playlists of the player. The pages listed before
+ * are given again without asking the player, until it tells the number
+ * of playlists changed, so only the pages shown are waited.
+ */
+void
+mpris2_client_get_playlists (Mpris2Client           *mpris2,
+                             guint                   index,
+                             guint                   max_count,
+                             Mpris2PlaylistOrdering  ordering,
+                             gboolean                reverse_order,
+                             GCancellable           *cancellable,
+                             GAsyncReadyCallback     callback,
+                             gpointer                user_data)
+{
+	Mpris2Player *player = mpris2->current;
+	Mpris2PlaylistsRequest *request;
+	GSimpleAsyncResult *simple;
+	GPtrArray *page;
+	guint listing;
+
+	g_return_if_fail (ordering < G_N_ELEMENTS (playlist_orderings));
+
+	simple = g_simple_async_result_new (G_OBJECT (mpris2), callback, user_data,
+	                                    mpris2_client_get_playlists);
+
+	if (!player->connected || !MPRIS2_PLAYER_CAN (player, MPRIS2_HAS_PLAYLISTS)) {
+		if (!player->connected)
+			g_simple_async_result_set_error (simple, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+			                                 "No player connected");
+		else
+			g_simple_async_result_set_error (simple, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			                                 "The player has no org.mpris.MediaPlayer2.Playlists interface");
+		g_simple_async_result_complete_in_idle (simple);
+		g_object_unref (simple);
+		return;
+	}
+
+	listing = 2 * ordering + (reverse_order ? 1 : 0);
+
+	page = mpris2_playlist_listing_get_page (player->playlist_listings[listing], index, max_count);
+	if (page != NULL) {
+		g_simple_async_result_set_op_res_gpointer (simple, page, (GDestroyNotify) g_ptr_array_unref);
+		g_simple_async_result_complete_in_idle (simple);
+		g_object_unref (simple);
+		return;
+	}
+
+	request = g_slice_new (Mpris2PlaylistsRequest);
+	request->simple = simple;
+	request->client = mpris2;
+	request->player = player;
+	request->generation = player->playlists_generation;
+	request->listing = listing;
+	request->index = index;
+	request->max_count = max_count;
+
+	mpris2_transport_call (mpris2->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2.Playlists",
+	                       "GetPlaylists",
+	                       g_variant_new ("(uusb)", index, max_count,
+	                                      playlist_orderings[ordering], reverse_order),
+	                       G_VARIANT_TYPE ("(a(oss))"),
+	                       cancellable,
+	                       mpris2_client_get_playlists_ready,
+	                       request);
+}
+
+/**
+ * mpris2_client_get_playlists_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * Returns: (transfer full) (element-type Mpris2Playlist): the playlists of
+ * the page, fewer than asked at the end of the list, or NULL on error.
+ * Free with g_ptr_array_unref().
+ */
+GPtrArray *
+mpris2_client_get_playlists_finish (Mpris2Client *mpris2, GAsyncResult *res, GError **error)
+{
+	GSimpleAsyncResult *simple;
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (mpris2), mpris2_client_get_playlists), NULL);
+
+	simple = G_SIMPLE_ASYNC_RESULT (res);
+	if (g_simple_async_result_propagate_error (simple, error))
+		return NULL;
+
+	return g_ptr_array_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+/**
+ * mpris2_client_activate_playlist:
+ * @mpris2: a #Mpris2Client
+ * @playlist_id: the id of a playlist, see mpris2_playlist_get_id().
+ * @cancellable: (allow-none): a #GCancellable or NULL.
+ * @callback: called when the player replies.
+ * @user_data: data to pass to @callback.
+ *
+ * Starts playing the playlist. It is told back as the active playlist.
+ */
+void
+mpris2_client_activate_playlist (Mpris2Client        *mpris2,
+                                 const gchar         *playlist_id,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+	mpris2_client_call_optional_method (mpris2, "org.mpris.MediaPlayer2.Playlists",
+	                                    MPRIS2_HAS_PLAYLISTS, "ActivatePlaylist",
+	                                    g_variant_new ("(o)", playlist_id),
+	                                    cancellable, callback, user_data,
+	                                    mpris2_client_activate_playlist);
+}
+
+/**
+ * mpris2_client_activate_playlist_finish:
+ * @mpris2: a #Mpris2Client
+ * @res: the #GAsyncResult given to the callback.
+ * @error: return location for error or NULL.
+ *
+ * Returns: TRUE if the player started the playlist.
+ */
+gboolean
+mpris2_client_activate_playlist_finish (Mpris2Client *mpris2, GAsyncResult *res, GError **error)
+{
+	return mpris2_client_optional_method_finish (mpris2, res, mpris2_client_activate_playlist, error);
+}
+
+/*
+ * Interface MediaPlayer2.Player properties.
+ */
+
+PlaybackStatus
+mpris2_client_get_playback_status (Mpris2Client *mpris2)
+{
+	return mpris2->current->playback_status;
+}
+
+gdouble
+mpris2_client_get_playback_rate (Mpris2Client *mpris2)
+{
+	return mpris2->current->rate;
+}
+
+Mpris2Metadata *
+mpris2_client_get_metadata (Mpris2Client *mpris2)
+{
+	return mpris2_player_get_metadata (mpris2->current);
+}
+
+gdouble
+mpris2_client_get_volume (Mpris2Client *mpris2)
+{
+	return mpris2->current->volume;
+}
+
+void
+mpris2_client_set_volume (Mpris2Client *mpris2, gdouble volume)
+{
+	mpris2_client_set_player_properties (mpris2, "Volume", g_variant_new_double(volume));
+}
+
+gint
+mpris2_client_get_position (Mpris2Client *mpris2)
+{
+	return mpris2_player_get_position (mpris2->current);
+}
+
+/**
+ * mpris2_client_get_accurate_position:
+ * @mpris2: a #Mpris2Client
+ *
+ * Asks the position to the player, blocking until it replies.
+ * mpris2_client_get_position() gives the estimate without blocking.
+ *
+ * Returns: the position of the player, in microseconds.
+ */
+gint
+mpris2_client_get_accurate_position (Mpris2Client *mpris2)
+{
+	GVariant *value;
+	gint position;
+
+	value = mpris2_client_get_player_properties (mpris2, "Position");
+	if (value == NULL)
+		return mpris2_player_get_position (mpris2->current);
+
+	position = (gint) g_variant_get_int64 (value);
+	g_variant_unref (value);
+
+	return position;
+}
+
+gdouble
+mpris2_client_get_minimum_rate (Mpris2Client *mpris2)
+{
+	return mpris2->current->minimum_rate;
+}
+
+gdouble
+mpris2_client_get_maximum_rate (Mpris2Client *mpris2)
+{
+	return mpris2->current->maximum_rate;
+}
+
+gboolean
+mpris2_client_get_can_go_next (Mpris2Client *mpris2)
+{
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_GO_NEXT);
 }
 
 gboolean
 mpris2_client_get_can_go_previous (Mpris2Client *mpris2)
 {
-	return mpris2->can_go_previous;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_GO_PREVIOUS);
 }
 
 gboolean
 mpris2_client_get_can_play (Mpris2Client *mpris2)
 {
-	return mpris2->can_play;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_PLAY);
 }
 
 gboolean
 mpris2_client_get_can_pause (Mpris2Client *mpris2)
 {
-	return mpris2->can_pause;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_PAUSE);
 }
 
 gboolean
 mpris2_client_get_can_seek (Mpris2Client *mpris2)
 {
-	return mpris2->can_seek;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_SEEK);
 }
 
 gboolean
 mpris2_client_get_can_control (Mpris2Client *mpris2)
 {
-	return mpris2->can_control;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_CONTROL);
+}
+
+/**
+ * mpris2_client_get_capabilities:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: all the capabilities of the player at once, as #Mpris2Capabilities flags.
+ */
+guint
+mpris2_client_get_capabilities (Mpris2Client *mpris2)
+{
+	return mpris2->current->capabilities;
 }
 
 /*
@@ -471,19 +1545,19 @@ mpris2_client_get_can_control (Mpris2Client *mpris2)
 gboolean
 mpris2_client_player_has_loop_status (Mpris2Client *mpris2)
 {
-	return mpris2->has_loop_status;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_LOOP_STATUS);
 }
 
 LoopStatus
 mpris2_client_get_loop_status (Mpris2Client *mpris2)
 {
-	return mpris2->loop_status;
+	return mpris2->current->loop_status;
 }
 
 void
 mpris2_client_set_loop_status (Mpris2Client *mpris2, LoopStatus loop_status)
 {
-	if (!mpris2->has_loop_status)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_LOOP_STATUS))
 		return;
 
 	switch (loop_status) {
@@ -503,19 +1577,19 @@ mpris2_client_set_loop_status (Mpris2Client *mpris2, LoopStatus loop_status)
 gboolean
 mpris2_client_player_has_shuffle (Mpris2Client *mpris2)
 {
-	return mpris2->has_shuffle;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_SHUFFLE);
 }
 
 gboolean
 mpris2_client_get_shuffle (Mpris2Client *mpris2)
 {
-	return mpris2->shuffle;
+	return mpris2->current->shuffle;
 }
 
 void
 mpris2_client_set_shuffle (Mpris2Client *mpris2, gboolean shuffle)
 {
-	if (!mpris2->has_shuffle)
+	if (!MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_SHUFFLE))
 		return;
 
 	mpris2_client_set_player_properties (mpris2, "Shuffle", g_variant_new_boolean(shuffle));
@@ -528,508 +1602,638 @@ mpris2_client_set_shuffle (Mpris2Client *mpris2, gboolean shuffle)
 gboolean
 mpris2_client_can_quit (Mpris2Client *mpris2)
 {
-	return mpris2->can_quit;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_QUIT);
 }
 
 gboolean
 mpris2_client_can_set_fullscreen (Mpris2Client *mpris2)
 {
-	return mpris2->can_set_fullscreen;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_SET_FULLSCREEN);
 }
 
 gboolean
 mpris2_client_can_raise (Mpris2Client *mpris2)
 {
-	return mpris2->can_raise;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_CAN_RAISE);
 }
 
 gboolean
 mpris2_client_has_tracklist_support (Mpris2Client *mpris2)
 {
-	return mpris2->has_tracklist;
+	return MPRIS2_PLAYER_CAN (mpris2->current, MPRIS2_HAS_TRACKLIST);
 }
 
 const gchar *
 mpris2_client_get_player_identity (Mpris2Client *mpris2)
 {
-	return mpris2->identity;
+	return mpris2->current->identity;
 }
 
 const gchar *
 mpris2_client_get_player_desktop_entry (Mpris2Client *mpris2)
 {
-	return mpris2->desktop_entry;
+	return mpris2->current->desktop_entry;
 }
 
 gchar **
 mpris2_client_get_supported_uri_schemes (Mpris2Client *mpris2)
 {
-	return mpris2->supported_uri_schemes;
+	return mpris2->current->supported_uri_schemes;
 }
 
 gchar **
 mpris2_client_get_supported_mime_types (Mpris2Client *mpris2)
 {
-	return mpris2->supported_mime_types;
+	return mpris2->current->supported_mime_types;
 }
 
-const gchar *
-mpris2_client_get_player (Mpris2Client *mpris2)
+static GHashTable *
+mpris2_player_index_strv (gchar **strv)
 {
-	return mpris2->player;
+	GHashTable *index;
+	guint i;
+
+	index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; strv[i] != NULL; i++)
+		g_hash_table_replace (index, g_ascii_strdown (strv[i], -1), GINT_TO_POINTER (TRUE));
+
+	return index;
 }
 
-void
-mpris2_client_set_player (Mpris2Client *mpris2, const gchar *player)
+static void
+mpris2_player_drop_indexes (Mpris2Player *player)
 {
-	/* Disconnect dbus */
-	if (mpris2->watch_id) {
-		g_bus_unwatch_name (mpris2->watch_id);
-		mpris2->watch_id = 0;
-	}
-	if (mpris2->props_proxy != NULL) {
-		g_object_unref (mpris2->props_proxy);
-		mpris2->props_proxy = NULL;
-	}
-	if (mpris2->player_proxy != NULL) {
-		g_object_unref (mpris2->player_proxy);
-		mpris2->player_proxy = NULL;
+	if (player->uri_schemes_index != NULL) {
+		g_hash_table_destroy (player->uri_schemes_index);
+		player->uri_schemes_index = NULL;
 	}
-
-	/* Clean player */
-	if (mpris2->player != NULL) {
-		g_free (mpris2->player);
-		mpris2->player = NULL;
-	}
-
-	/* Set new player and connect again */
-	if (player != NULL) {
-		mpris2->player = g_strdup(player);
-
-		mpris2_client_connect_dbus (mpris2);
+	if (player->mime_types_index != NULL) {
+		g_hash_table_destroy (player->mime_types_index);
+		player->mime_types_index = NULL;
 	}
 }
 
+/**
+ * mpris2_client_supports_uri:
+ * @mpris2: a #Mpris2Client
+ * @uri: a full uri, as file:///home/user/song.ogg
+ *
+ * Returns: TRUE if the scheme of @uri is supported by the player, or the
+ * player did not tell its schemes yet.
+ */
 gboolean
-mpris2_client_auto_connect (Mpris2Client *mpris2)
+mpris2_client_supports_uri (Mpris2Client *mpris2, const gchar *uri)
 {
-	gboolean ret = FALSE;
-	gchar **players = mpris2_client_get_available_players (mpris2);
+	Mpris2Player *player = mpris2->current;
+	gchar *scheme, *p;
+	gboolean supported;
 
-	if (players != NULL) {
-		mpris2_client_set_player (mpris2, players[0]);
-		g_strfreev (players);
-		ret = TRUE;
-	}
+	if (player->supported_uri_schemes == NULL)
+		return TRUE;
 
-	return ret;
-}
+	scheme = g_uri_parse_scheme (uri);
+	if (scheme == NULL)
+		return FALSE;
 
-gboolean
-mpris2_client_is_connected (Mpris2Client *mpris2)
-{
-	return mpris2->connected;
-}
+	for (p = scheme; *p != '\0'; p++)
+		*p = g_ascii_tolower (*p);
 
-/*
- * Position handlers.
- */
-static gboolean
-playback_tick_emit_cb (gpointer user_data)
-{
-	Mpris2Client *mpris2 = user_data;
+	if (player->uri_schemes_index == NULL)
+		player->uri_schemes_index = mpris2_player_index_strv (player->supported_uri_schemes);
 
-	mpris2->position += (mpris2->rate)*1000000;
+	supported = g_hash_table_lookup (player->uri_schemes_index, scheme) != NULL;
 
-	g_signal_emit (mpris2, signals[PLAYBACK_TICK], 0, mpris2->position);
+	g_free (scheme);
 
-	return TRUE;
+	return supported;
 }
 
-/*
- * SoundmenuDbus.
+/**
+ * mpris2_client_supports_mime:
+ * @mpris2: a #Mpris2Client
+ * @mime_type: a mime type, as audio/ogg
+ *
+ * Returns: TRUE if @mime_type is supported by the player, or the player
+ * did not tell its mime types yet.
  */
+gboolean
+mpris2_client_supports_mime (Mpris2Client *mpris2, const gchar *mime_type)
+{
+	Mpris2Player *player = mpris2->current;
+	gchar *key;
+	gboolean supported;
 
-/* Send mesages to use methods of org.mpris.MediaPlayer2.Player interfase. */
+	if (player->supported_mime_types == NULL)
+		return TRUE;
 
-static void
-mpris2_client_call_player_method (Mpris2Client *mpris2, const char *method)
-{
-	GDBusMessage *message;
-	GError       *error = NULL;
-
-	message = g_dbus_message_new_method_call (mpris2->dbus_name,
-	                                          "/org/mpris/MediaPlayer2",
-	                                          "org.mpris.MediaPlayer2.Player",
-	                                          method);
-
-	g_dbus_connection_send_message (mpris2->gconnection,
-	                                message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL,
-	                                &error);
-	if (error != NULL) {
-		g_warning ("unable to send message: %s", error->message);
-		g_clear_error (&error);
-		error = NULL;
-	}
+	if (player->mime_types_index == NULL)
+		player->mime_types_index = mpris2_player_index_strv (player->supported_mime_types);
 
-	g_dbus_connection_flush_sync (mpris2->gconnection, NULL, &error);
-	if (error != NULL) {
-		g_warning ("unable to flush message queue: %s", error->message);
-		g_clear_error (&error);
-	}
+	key = g_ascii_strdown (mime_type, -1);
+	supported = g_hash_table_lookup (player->mime_types_index, key) != NULL;
+	g_free (key);
 
-	g_object_unref (message);
+	return supported;
 }
 
-/* Send mesages to use methods of org.mpris.MediaPlayer2 interfase. */
+const gchar *
+mpris2_client_get_player (Mpris2Client *mpris2)
+{
+	return mpris2->current->player;
+}
 
-static void
-mpris2_client_call_media_player_method (Mpris2Client *mpris2, const char *method)
+/**
+ * mpris2_client_set_player:
+ * @mpris2: a #Mpris2Client
+ * @player: the name of the player, without the mpris2 prefix, or NULL.
+ *
+ * Follow another player. The previous one is kept on standby, still
+ * watched, so switching back to it emits its state at once without
+ * connecting again. See mpris2_client_set_standby_size().
+ */
+void
+mpris2_client_set_player (Mpris2Client *mpris2, const gchar *player)
 {
-	GDBusMessage *message;
-	GError       *error = NULL;
-
-	message = g_dbus_message_new_method_call (mpris2->dbus_name,
-	                                          "/org/mpris/MediaPlayer2",
-	                                          "org.mpris.MediaPlayer2",
-	                                          method);
-
-	g_dbus_connection_send_message (mpris2->gconnection,
-	                                message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL,
-	                                &error);
-	if (error != NULL) {
-		g_warning ("unable to send message: %s", error->message);
-		g_clear_error (&error);
-		error = NULL;
-	}
+	Mpris2Player *previous, *next = NULL;
+	gboolean was_connected;
+	guint previous_tracks;
+	GList *l;
 
-	g_dbus_connection_flush_sync (mpris2->gconnection, NULL, &error);
-	if (error != NULL) {
-		g_warning ("unable to flush message queue: %s", error->message);
-		g_clear_error (&error);
+	previous = mpris2->current;
+	if (g_strcmp0 (previous->player, player) == 0)
+		return;
+
+	was_connected = previous->connected;
+	previous_tracks = mpris2_player_get_n_tracks (previous);
+
+	g_object_freeze_notify (G_OBJECT (mpris2));
+
+	for (l = mpris2->standby; l != NULL && player != NULL; l = l->next) {
+		if (g_strcmp0 (((Mpris2Player *) l->data)->player, player) == 0) {
+			next = l->data;
+			mpris2->standby = g_list_delete_link (mpris2->standby, l);
+			break;
+		}
 	}
+	if (next == NULL)
+		next = mpris2_player_new (mpris2, player);
 
-	g_object_unref (message);
-}
+	mpris2->current = next;
 
-/* Returns the first player name that compliant to mpris2 on dbus.  */
+	/* Most recently used first. */
+	if (previous->player != NULL && mpris2->standby_size > 0)
+		mpris2->standby = g_list_prepend (mpris2->standby, previous);
+	else
+		mpris2_player_free (previous);
+	mpris2_client_trim_standby (mpris2);
 
-gchar **
-mpris2_client_get_available_players (Mpris2Client *mpris2)
-{
-	GError *error = NULL;
-	GVariant *v;
-	GVariantIter *iter;
-	const gchar *str = NULL;
-	gchar **res = NULL;
-	guint items = 0;
+	mpris2_client_update_playback_timer (mpris2);
 
-	v = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                 "org.freedesktop.DBus",
-	                                 "/org/freedesktop/DBus",
-	                                 "org.freedesktop.DBus",
-	                                 "ListNames",
-	                                 NULL,
-	                                 G_VARIANT_TYPE ("(as)"),
-	                                 G_DBUS_CALL_FLAGS_NONE,
-	                                 -1,
-	                                 NULL,
-	                                 &error);
-	if (error) {
-		g_critical ("Could not get a list of names registered on the session bus, %s",
-		            error ? error->message : "no error given");
-		g_clear_error (&error);
-		return NULL;
-	}
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_PLAYER]);
 
-	g_variant_get (v, "(as)", &iter);
-	while (g_variant_iter_loop (iter, "&s", &str)) {
-		if (g_str_has_prefix(str, "org.mpris.MediaPlayer2.")) {
-			res = (gchar**)g_realloc(res, (items + 1) * sizeof(gchar*));
-			res[items] = g_strdup(str + 23);
-			items++;
-		}
+	if (next->watch_id != 0) {
+		mpris2_client_resume_player (mpris2, was_connected);
 	}
-
-	/* Add NULL termination to the res vector */
-	if (items > 0) {
-		res = g_realloc(res, (items + 1) * sizeof(gchar*));
-		res[items] = NULL;
+	else {
+		if (was_connected)
+			mpris2_client_emit_connection (mpris2, FALSE);
+		mpris2_player_restore_state (next);
+		mpris2_client_connect_dbus (next);
 	}
 
-	g_variant_iter_free (iter);
-	g_variant_unref (v);
+	mpris2_client_emit_tracklist_changed (next, 0, previous_tracks, mpris2_player_get_n_tracks (next));
 
-	return res;
+	g_object_thaw_notify (G_OBJECT (mpris2));
 }
 
-/* Get all properties using org.freedesktop.DBus.Properties interface.  */
-
-static GVariant *
-mpris2_client_get_all_player_properties (Mpris2Client *mpris2)
+/**
+ * mpris2_client_get_standby_size:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: the number of recently used players kept on standby.
+ */
+guint
+mpris2_client_get_standby_size (Mpris2Client *mpris2)
 {
-	GVariantIter iter;
-	GVariant *result, *child = NULL;
+	return mpris2->standby_size;
+}
 
-	result = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                      mpris2->dbus_name,
-	                                      "/org/mpris/MediaPlayer2",
-	                                      "org.freedesktop.DBus.Properties",
-	                                      "GetAll",
-	                                      g_variant_new ("(s)", "org.mpris.MediaPlayer2.Player"),
-	                                      G_VARIANT_TYPE ("(a{sv})"),
-	                                      G_DBUS_CALL_FLAGS_NONE,
-	                                      -1,
-	                                      NULL,
-	                                      NULL);
+/**
+ * mpris2_client_set_standby_size:
+ * @mpris2: a #Mpris2Client
+ * @standby_size: the number of recently used players to keep on standby.
+ *
+ * Players on standby stay watched and their state is kept up to date,
+ * so mpris2_client_set_player() can switch back to them immediately.
+ * Zero disconnects from a player as soon as another one is set.
+ */
+void
+mpris2_client_set_standby_size (Mpris2Client *mpris2, guint standby_size)
+{
+	if (mpris2->standby_size == standby_size)
+		return;
 
-	if(result) {
-		g_variant_iter_init (&iter, result);
-		child = g_variant_iter_next_value (&iter);
-	}
+	mpris2->standby_size = standby_size;
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_STANDBY_SIZE]);
 
-	return child;
+	mpris2_client_trim_standby (mpris2);
 }
 
-/* Change any player propertie using org.freedesktop.DBus.Properties interfase. */
+/**
+ * mpris2_client_get_auto_switch:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: TRUE if @mpris2 follows the player that starts playing.
+ */
+gboolean
+mpris2_client_get_auto_switch (Mpris2Client *mpris2)
+{
+	return mpris2->auto_switch;
+}
 
-static void
-mpris2_client_set_media_player_properties (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop)
+/**
+ * mpris2_client_set_auto_switch:
+ * @mpris2: a #Mpris2Client
+ * @auto_switch: TRUE to switch to any allowed player that starts playing.
+ *
+ * It needs to watch the players on the bus, as with
+ * mpris2_client_watch_players().
+ */
+void
+mpris2_client_set_auto_switch (Mpris2Client *mpris2, gboolean auto_switch)
 {
-	GVariant *reply;
-	GError   *error = NULL;
-
-	reply = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                     mpris2->dbus_name,
-	                                     "/org/mpris/MediaPlayer2",
-	                                     "org.freedesktop.DBus.Properties",
-	                                     "Set",
-	                                     g_variant_new ("(ssv)",
-	                                                    "org.mpris.MediaPlayer2",
-	                                                    prop,
-	                                                    vprop),
-	                                     NULL,
-	                                     G_DBUS_CALL_FLAGS_NONE,
-	                                     -1,
-	                                     NULL,
-	                                     NULL);
-	if (reply == NULL) {
-		g_warning ("Unable to set session: %s", error->message);
-		g_error_free (error);
-		return;
+	if (mpris2->auto_switch != auto_switch) {
+		mpris2->auto_switch = auto_switch;
+		g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_AUTO_SWITCH]);
 	}
-	g_variant_unref(reply);
+
+	if (auto_switch)
+		mpris2_client_watch_players (mpris2);
 }
 
-/* Get all properties using org.freedesktop.DBus.Properties interface.  */
+/* With auto switch, leave a player no longer allowed for the preferred one. */
 
-static GVariant *
-mpris2_client_get_all_media_player_properties (Mpris2Client *mpris2)
+static void
+mpris2_client_recheck_player (Mpris2Client *mpris2)
 {
-	GVariantIter iter;
-	GVariant *result, *child = NULL;
+	gchar *player;
 
-	result = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                      mpris2->dbus_name,
-	                                      "/org/mpris/MediaPlayer2",
-	                                      "org.freedesktop.DBus.Properties",
-	                                      "GetAll",
-	                                      g_variant_new ("(s)", "org.mpris.MediaPlayer2"),
-	                                      G_VARIANT_TYPE ("(a{sv})"),
-	                                      G_DBUS_CALL_FLAGS_NONE,
-	                                      -1,
-	                                      NULL,
-	                                      NULL);
+	if (!mpris2->auto_switch || !mpris2->players_listed)
+		return;
 
-	if(result) {
-		g_variant_iter_init (&iter, result);
-		child = g_variant_iter_next_value (&iter);
-	}
+	if (mpris2->current->player != NULL &&
+	    mpris2_client_player_is_allowed (mpris2, mpris2->current->player, NULL))
+		return;
 
-	return child;
+	player = mpris2_client_get_preferred_player (mpris2);
+	if (player != NULL && g_strcmp0 (mpris2->current->player, player) != 0)
+		mpris2_client_set_player (mpris2, player);
+	g_free (player);
 }
 
+/* Both NULL, or the same patterns in the same order. */
 
-/* Get any player propertie using org.freedesktop.DBus.Properties interfase. */
-
-static GVariant *
-mpris2_client_get_player_properties (Mpris2Client *mpris2, const gchar *prop)
+static gboolean
+mpris2_client_patterns_equal (gchar **a, gchar **b)
 {
-	GVariant *v, *iter;
-	GError *error = NULL;
+	guint i;
 
-	v = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                 mpris2->dbus_name,
-	                                 "/org/mpris/MediaPlayer2",
-	                                 "org.freedesktop.DBus.Properties",
-	                                 "Get",
-	                                  g_variant_new ("(ss)",
-                                                     "org.mpris.MediaPlayer2.Player",
-                                                     prop),
-	                                 G_VARIANT_TYPE ("(v)"),
-	                                 G_DBUS_CALL_FLAGS_NONE,
-	                                 -1,
-	                                 NULL,
-	                                 &error);
-	if (error) {
-		g_critical ("Could not get properties on org.mpris.MediaPlayer2, %s",
-		            error ? error->message : "no error given");
-		g_clear_error (&error);
-		return NULL;
-	}
+	if (a == NULL || b == NULL)
+		return a == b;
 
-	g_variant_get (v, "(v)", &iter);
+	for (i = 0; a[i] != NULL && b[i] != NULL; i++)
+		if (g_strcmp0 (a[i], b[i]) != 0)
+			return FALSE;
 
-	return iter;
+	return a[i] == b[i];
 }
 
-/* Change any player propertie using org.freedesktop.DBus.Properties interfase. */
+/**
+ * mpris2_client_get_allowed_players:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: (transfer none): the patterns of the players allowed, or NULL
+ *   if all of them are.
+ */
+gchar **
+mpris2_client_get_allowed_players (Mpris2Client *mpris2)
+{
+	return mpris2->allowed_players;
+}
 
-static void
-mpris2_client_set_player_properties (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop)
+/**
+ * mpris2_client_set_allowed_players:
+ * @mpris2: a #Mpris2Client
+ * @players: (allow-none): patterns of the players to connect automatically,
+ *   in order of preference, or NULL to allow all of them.
+ *
+ * Patterns are matched with g_pattern_match_simple(), as "vlc*". With
+ * auto switch, a current player no longer allowed is left for the
+ * preferred one.
+ */
+void
+mpris2_client_set_allowed_players (Mpris2Client *mpris2, gchar **players)
 {
-	GVariant *reply;
-	GError   *error = NULL;
-
-	reply = g_dbus_connection_call_sync (mpris2->gconnection,
-	                                     mpris2->dbus_name,
-	                                     "/org/mpris/MediaPlayer2",
-	                                     "org.freedesktop.DBus.Properties",
-	                                     "Set",
-	                                     g_variant_new ("(ssv)",
-	                                                    "org.mpris.MediaPlayer2.Player",
-	                                                    prop,
-	                                                    vprop),
-	                                     NULL,
-	                                     G_DBUS_CALL_FLAGS_NONE,
-	                                     -1,
-	                                     NULL,
-	                                     NULL);
-	if (reply == NULL) {
-		g_warning ("Unable to set session: %s", error->message);
-		g_error_free (error);
+	if (mpris2_client_patterns_equal (mpris2->allowed_players, players))
 		return;
-	}
-	g_variant_unref(reply);
+
+	g_strfreev (mpris2->allowed_players);
+	mpris2->allowed_players = g_strdupv (players);
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_ALLOWED_PLAYERS]);
+
+	mpris2_client_recheck_player (mpris2);
 }
 
-/* These function intercepts the messages from the player. */
+/**
+ * mpris2_client_get_denied_players:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: (transfer none): the patterns of the players denied, or NULL.
+ */
+gchar **
+mpris2_client_get_denied_players (Mpris2Client *mpris2)
+{
+	return mpris2->denied_players;
+}
 
-static const gchar *
-g_avariant_get_string(GVariant * variant)
+/**
+ * mpris2_client_set_denied_players:
+ * @mpris2: a #Mpris2Client
+ * @players: (allow-none): patterns of the players never connected
+ *   automatically, or NULL.
+ *
+ * As with mpris2_client_set_allowed_players(), the current player is
+ * checked again.
+ */
+void
+mpris2_client_set_denied_players (Mpris2Client *mpris2, gchar **players)
 {
-	const gchar **strv = NULL;
-	const gchar *string = NULL;
-	gsize len;
+	if (mpris2_client_patterns_equal (mpris2->denied_players, players))
+		return;
 
-	strv = g_variant_get_strv (variant, &len);
-	if (len > 0) {
-		string = strv[0];
-		g_free (strv);
-	}
-	else {
-		string = "";
-	}
+	g_strfreev (mpris2->denied_players);
+	mpris2->denied_players = g_strdupv (players);
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_DENIED_PLAYERS]);
 
-	return string;
+	mpris2_client_recheck_player (mpris2);
 }
 
-static Mpris2Metadata *
-mpris2_metadata_new_from_variant (GVariant *dictionary)
+/**
+ * mpris2_client_get_preferred_player:
+ * @mpris2: a #Mpris2Client
+ *
+ * The allowed player that is playing, or else the one that played or
+ * was commanded most recently. Activity is only known for the players
+ * watched with mpris2_client_watch_players().
+ *
+ * Returns: the preferred player, or NULL. Free with g_free().
+ */
+gchar *
+mpris2_client_get_preferred_player (Mpris2Client *mpris2)
 {
-	GVariantIter iter;
-	GVariant *value;
-	gchar *key;
+	GHashTableIter iter;
+	GPtrArray *players;
+	gpointer name;
+	gchar *player;
 
-	gint64 length = 0;
+	players = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, mpris2->running_players);
+	while (g_hash_table_iter_next (&iter, &name, NULL))
+		g_ptr_array_add (players, name);
+	g_ptr_array_add (players, NULL);
 
-	Mpris2Metadata *metadata;
+	player = g_strdup (mpris2_client_choose_player (mpris2, (gchar **) players->pdata));
+	g_ptr_array_free (players, TRUE);
 
-	metadata = mpris2_metadata_new ();
+	return player;
+}
 
-	g_variant_iter_init (&iter, dictionary);
-	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
-		if (0 == g_ascii_strcasecmp (key, "mpris:trackid"))
-			mpris2_metadata_set_trackid (metadata, g_variant_get_string(value, NULL));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:url"))
-			mpris2_metadata_set_url (metadata, g_variant_get_string(value, NULL));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:title"))
-			mpris2_metadata_set_title (metadata, g_variant_get_string(value, NULL));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:artist"))
-			mpris2_metadata_set_artist(metadata, g_avariant_get_string(value));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:album"))
-			mpris2_metadata_set_album (metadata, g_variant_get_string(value, NULL));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:genre"));
-			/* (List of Strings.) Not use genre */
-		else if (0 == g_ascii_strcasecmp (key, "xesam:albumArtist"));
-			// List of Strings.
-		else if (0 == g_ascii_strcasecmp (key, "xesam:comment"));
-			/* (List of Strings) Not use comment */
-		else if (0 == g_ascii_strcasecmp (key, "xesam:audioBitrate"));
-			/* (uint32) Not use audioBitrate */
-		else if (0 == g_ascii_strcasecmp (key, "mpris:length"))
-			length = g_variant_get_int64 (value);
-		else if (0 == g_ascii_strcasecmp (key, "xesam:trackNumber"))
-			mpris2_metadata_set_track_no(metadata, g_variant_get_int32 (value));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:useCount"));
-			/* (Integer) Not use useCount */
-		else if (0 == g_ascii_strcasecmp (key, "xesam:userRating"));
-			/* (Float) Not use userRating */
-		else if (0 == g_ascii_strcasecmp (key, "mpris:artUrl"))
-			mpris2_metadata_set_arturl (metadata, g_variant_get_string(value, NULL));
-		else if (0 == g_ascii_strcasecmp (key, "xesam:contentCreated"));
-			/* has type 's' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-bitrate"));
-			/* has type 'i' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-channels"));
-			/* has type 'i' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-samplerate"));
-			/* has type 'i' */
-		else if (0 == g_ascii_strcasecmp (key, "xesam:contentCreated"));
-			/* has type 's' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-bitrate"));
-			/* has type 'i' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-channels"));
-			/* has type 'i' */
-		else if (0 == g_ascii_strcasecmp (key, "audio-samplerate"));
-			/* has type 'i'*/
-		else
-			g_print ("Variant '%s' has type '%s'\n", key,
-				     g_variant_get_type_string (value));
-	}
+/**
+ * mpris2_client_auto_connect:
+ * @mpris2: a #Mpris2Client
+ *
+ * Connect to the preferred player, listing the names on the bus and
+ * blocking until they are replied. See mpris2_client_auto_connect_async().
+ *
+ * Returns: %TRUE if a player was found.
+ */
+gboolean
+mpris2_client_auto_connect (Mpris2Client *mpris2)
+{
+	const gchar *player;
+	gboolean ret = FALSE;
+	gchar **players = mpris2_client_get_available_players (mpris2);
 
-	mpris2_metadata_set_length (metadata, length / 1000000l);
+	player = mpris2_client_choose_player (mpris2, players);
+	if (player != NULL) {
+		mpris2_client_set_player (mpris2, player);
+		ret = TRUE;
+	}
+	g_strfreev (players);
 
-	return metadata;
+	return ret;
 }
 
+static gchar **mpris2_client_parse_player_names (GVariant *names);
+
 static void
-mpris2_client_parse_playback_status (Mpris2Client *mpris2, const gchar *playback_status)
+mpris2_client_list_names_ready (GVariant     *reply,
+                                const gchar  *sender,
+                                const GError *error,
+                                gpointer      user_data)
 {
-	GVariant *value;
+	gchar **players;
+	const gchar *player;
 
-	if (0 == g_ascii_strcasecmp(playback_status, "Playing")) {
-		mpris2->playback_status = PLAYING;
-	}
-	else if (0 == g_ascii_strcasecmp(playback_status, "Paused")) {
-		mpris2->playback_status = PAUSED;
+	Mpris2Client *mpris2 = user_data;
+
+	if (reply == NULL) {
+		g_warning ("Could not get a list of names registered on the session bus, %s",
+		           error->message);
 	}
 	else {
-		mpris2->playback_status = STOPPED;
-	}
+		players = mpris2_client_parse_player_names (reply);
+		player = mpris2_client_choose_player (mpris2, players);
 
-	if (mpris2->playback_status == PLAYING) {
-		value = mpris2_client_get_player_properties (mpris2, "Position");
-		mpris2->position = (gint) g_variant_get_int64 (value);
+		/* Don't override a player set meanwhile. */
+		if (player != NULL && mpris2->current->player == NULL)
+			mpris2_client_set_player (mpris2, player);
 
-		if (mpris2->playback_timer_id == 0)
-			mpris2->playback_timer_id = g_timeout_add_seconds (1, playback_tick_emit_cb, mpris2);
+		g_strfreev (players);
 	}
-	else {
+
+	g_object_unref (mpris2);
+}
+
+/**
+ * mpris2_client_auto_connect_async:
+ * @mpris2: a #Mpris2Client
+ *
+ * Connect to the preferred player, see mpris2_client_get_preferred_player(),
+ * listing the names on the bus without blocking. If the players are
+ * already watched no call is needed at all. If the session bus is not
+ * ready yet, it is done as soon as it is.
+ */
+void
+mpris2_client_auto_connect_async (Mpris2Client *mpris2)
+{
+	gchar *player;
+
+	if (mpris2->transport == NULL) {
+		mpris2->auto_connect_pending = TRUE;
+		return;
+	}
+
+	if (mpris2->players_listed) {
+		player = mpris2_client_get_preferred_player (mpris2);
+		if (player != NULL)
+			mpris2_client_set_player (mpris2, player);
+		g_free (player);
+		return;
+	}
+
+	mpris2_transport_call (mpris2->transport,
+	                       "org.freedesktop.DBus",
+	                       "/org/freedesktop/DBus",
+	                       "org.freedesktop.DBus",
+	                       "ListNames",
+	                       NULL,
+	                       G_VARIANT_TYPE ("(as)"),
+	                       NULL,
+	                       mpris2_client_list_names_ready,
+	                       g_object_ref (mpris2));
+}
+
+gboolean
+mpris2_client_is_connected (Mpris2Client *mpris2)
+{
+	return mpris2->current->connected;
+}
+
+/**
+ * mpris2_client_watch_players:
+ * @mpris2: a #Mpris2Client
+ *
+ * Start emitting #Mpris2Client::player-appeared and
+ * #Mpris2Client::player-vanished for every mpris2 player on the bus,
+ * starting with the ones already running. It does not change the
+ * player of @mpris2.
+ */
+void
+mpris2_client_watch_players (Mpris2Client *mpris2)
+{
+	if (mpris2->watch_players)
+		return;
+
+	mpris2->watch_players = TRUE;
+
+	/* Otherwise started when the session bus is ready. */
+	if (mpris2->transport != NULL)
+		mpris2_client_watch_players_dbus (mpris2);
+}
+
+/**
+ * mpris2_client_get_interest:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: the #Mpris2Interest flags of the optional work done.
+ */
+guint
+mpris2_client_get_interest (Mpris2Client *mpris2)
+{
+	return mpris2->interest;
+}
+
+/**
+ * mpris2_client_set_interest:
+ * @mpris2: a #Mpris2Client
+ * @interest: the #Mpris2Interest flags of the optional work wanted.
+ *
+ * Skip the work nobody needs, all is done by default. Even when wanted,
+ * the ticks, the metadata signal and the tracklist wait for a handler to
+ * be connected. A playback-tick or tracklist-changed handler connected or
+ * unblocked later is taken into account at the next change of the player,
+ * or at once with mpris2_client_update_interest().
+ */
+void
+mpris2_client_set_interest (Mpris2Client *mpris2, guint interest)
+{
+	if (mpris2->interest != interest) {
+		mpris2->interest = interest;
+		g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_INTEREST]);
+	}
+
+	mpris2_client_update_interest (mpris2);
+}
+
+/**
+ * mpris2_client_update_interest:
+ * @mpris2: a #Mpris2Client
+ *
+ * Look again for the handlers of the optional signals. Call it after
+ * connecting or unblocking a playback-tick or tracklist-changed handler,
+ * to start the ticks or to fetch the tracklist at once. The ticks stop by
+ * themselves once no handler is left.
+ */
+void
+mpris2_client_update_interest (Mpris2Client *mpris2)
+{
+	mpris2_client_update_playback_timer (mpris2);
+
+	mpris2_client_update_tracklist (mpris2->current);
+	g_list_foreach (mpris2->standby, (GFunc) mpris2_client_update_tracklist, NULL);
+}
+
+static gboolean
+mpris2_client_wants (Mpris2Client *mpris2, Mpris2Interest interest)
+{
+	if ((mpris2->interest & interest) == 0)
+		return FALSE;
+
+	switch (interest) {
+		case MPRIS2_INTEREST_PLAYBACK_TICK:
+			return g_signal_has_handler_pending (mpris2, signals[PLAYBACK_TICK], 0, FALSE);
+		case MPRIS2_INTEREST_METADATA:
+			return g_signal_has_handler_pending (mpris2, signals[METADATA], 0, FALSE);
+		case MPRIS2_INTEREST_TRACKLIST:
+			return g_signal_has_handler_pending (mpris2, signals[TRACKLIST_CHANGED], 0, FALSE);
+		default:
+			return TRUE;
+	}
+}
+
+/*
+ * Position handlers.
+ */
+static gboolean
+playback_tick_emit_cb (gpointer user_data)
+{
+	Mpris2Client *mpris2 = user_data;
+
+	/* The last handler went away. */
+	if (!mpris2_client_wants (mpris2, MPRIS2_INTEREST_PLAYBACK_TICK)) {
+		mpris2->playback_timer_id = 0;
+		return FALSE;
+	}
+
+	g_signal_emit (mpris2, signals[PLAYBACK_TICK], 0,
+	               mpris2_player_get_position (mpris2->current));
+
+	return TRUE;
+}
+
+/* Tick while the current player is playing, and someone listens. */
+
+static void
+mpris2_client_update_playback_timer (Mpris2Client *mpris2)
+{
+	if (mpris2->current->connected &&
+	    mpris2->current->playback_status == PLAYING &&
+	    mpris2_client_wants (mpris2, MPRIS2_INTEREST_PLAYBACK_TICK)) {
+		if (mpris2->playback_timer_id == 0)
+			mpris2->playback_timer_id = g_timeout_add_seconds (1, playback_tick_emit_cb, mpris2);
+	}
+	else {
 		if (mpris2->playback_timer_id > 0) {
 			g_source_remove (mpris2->playback_timer_id);
 			mpris2->playback_timer_id = 0;
@@ -1037,399 +2241,2921 @@ mpris2_client_parse_playback_status (Mpris2Client *mpris2, const gchar *playback
 	}
 }
 
+/*
+ * SoundmenuDbus.
+ */
+
+/* Send mesages to use methods of org.mpris.MediaPlayer2.Player interfase. */
+
+static void
+mpris2_client_call_player_method (Mpris2Client *mpris2, const char *method)
+{
+	Mpris2Player *player = mpris2->current;
+	guint i;
+
+	mpris2_client_note_command (mpris2);
+
+	if (player->commands != NULL) {
+		for (i = 0; player_commands[i] != NULL; i++) {
+			if (g_strcmp0 (player_commands[i], method) == 0) {
+				mpris2_transport_message_send (mpris2->transport, player->commands[i]);
+				return;
+			}
+		}
+	}
+
+	mpris2_transport_send (mpris2->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2.Player",
+	                       method,
+	                       NULL);
+}
+
+/* Send mesages to use methods of org.mpris.MediaPlayer2 interfase. */
+
+static void
+mpris2_client_call_media_player_method (Mpris2Client *mpris2, const char *method)
+{
+	mpris2_client_note_command (mpris2);
+
+	mpris2_transport_send (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.mpris.MediaPlayer2",
+	                       method,
+	                       NULL);
+}
+
+/* Returns the player names that compliant to mpris2 from a ListNames reply. */
+
+static gchar **
+mpris2_client_parse_player_names (GVariant *names)
+{
+	GVariantIter *iter;
+	const gchar *str = NULL;
+	gchar **res = NULL;
+	guint items = 0;
+
+	g_variant_get (names, "(as)", &iter);
+	while (g_variant_iter_loop (iter, "&s", &str)) {
+		if (g_str_has_prefix(str, "org.mpris.MediaPlayer2.")) {
+			res = (gchar**)g_realloc(res, (items + 1) * sizeof(gchar*));
+			res[items] = g_strdup(str + 23);
+			items++;
+		}
+	}
+
+	/* Add NULL termination to the res vector */
+	if (items > 0) {
+		res = g_realloc(res, (items + 1) * sizeof(gchar*));
+		res[items] = NULL;
+	}
+
+	g_variant_iter_free (iter);
+
+	return res;
+}
+
+/**
+ * mpris2_client_get_available_players:
+ * @mpris2: a #Mpris2Client
+ *
+ * Lists the players on the bus, blocking until the bus replies. The
+ * players already known without blocking are watched with
+ * #Mpris2Client::player-appeared.
+ *
+ * Returns: (transfer full): the names of the players compliant with
+ * mpris2, to free with g_strfreev(), or NULL if none.
+ */
+gchar **
+mpris2_client_get_available_players (Mpris2Client *mpris2)
+{
+	GError *error = NULL;
+	GVariant *v;
+	gchar **res = NULL;
+
+	if (!mpris2_client_ensure_transport (mpris2))
+		return NULL;
+
+	v = mpris2_transport_call_sync (mpris2->transport,
+	                                 "org.freedesktop.DBus",
+	                                 "/org/freedesktop/DBus",
+	                                 "org.freedesktop.DBus",
+	                                 "ListNames",
+	                                 NULL,
+	                                 G_VARIANT_TYPE ("(as)"),
+	                                 &error);
+	if (error) {
+		g_critical ("Could not get a list of names registered on the session bus, %s",
+		            error ? error->message : "no error given");
+		g_clear_error (&error);
+		return NULL;
+	}
+
+	res = mpris2_client_parse_player_names (v);
+
+	g_variant_unref (v);
+
+	return res;
+}
+
+/* Replies of Set, only to tell the errors. */
+
+static void
+mpris2_client_set_properties_ready (GVariant     *reply,
+                                    const gchar  *sender,
+                                    const GError *error,
+                                    gpointer      user_data)
+{
+	if (reply == NULL && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_warning ("Unable to set session: %s", error->message);
+}
+
+/* Change any player propertie using org.freedesktop.DBus.Properties interfase. */
+
+static void
+mpris2_client_set_media_player_properties (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop)
+{
+	if (!mpris2->current->connected) {
+		g_variant_unref (g_variant_ref_sink (vprop));
+		return;
+	}
+
+	mpris2_client_note_command (mpris2);
+
+	mpris2_transport_call (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "Set",
+	                       g_variant_new ("(ssv)",
+	                                      "org.mpris.MediaPlayer2",
+	                                      prop,
+	                                      vprop),
+	                       NULL,
+	                       mpris2->current->cancellable,
+	                       mpris2_client_set_properties_ready,
+	                       NULL);
+}
+
+/* Get any player propertie using org.freedesktop.DBus.Properties interfase. */
+
+static GVariant *
+mpris2_client_get_player_properties (Mpris2Client *mpris2, const gchar *prop)
+{
+	GVariant *v, *iter;
+	GError *error = NULL;
+
+	if (!mpris2->current->connected)
+		return NULL;
+
+	v = mpris2_transport_call_sync (mpris2->transport,
+	                                 mpris2->current->dbus_name,
+	                                 "/org/mpris/MediaPlayer2",
+	                                 "org.freedesktop.DBus.Properties",
+	                                 "Get",
+	                                  g_variant_new ("(ss)",
+                                                     "org.mpris.MediaPlayer2.Player",
+                                                     prop),
+	                                 G_VARIANT_TYPE ("(v)"),
+	                                 &error);
+	if (error) {
+		g_critical ("Could not get properties on org.mpris.MediaPlayer2, %s",
+		            error ? error->message : "no error given");
+		g_clear_error (&error);
+		return NULL;
+	}
+
+	g_variant_get (v, "(v)", &iter);
+	g_variant_unref (v);
+
+	return iter;
+}
+
+/* Change any player propertie using org.freedesktop.DBus.Properties interfase. */
+
+static void
+mpris2_client_set_player_properties (Mpris2Client *mpris2, const gchar *prop, GVariant *vprop)
+{
+	if (!mpris2->current->connected) {
+		g_variant_unref (g_variant_ref_sink (vprop));
+		return;
+	}
+
+	mpris2_client_note_command (mpris2);
+
+	mpris2_transport_call (mpris2->transport,
+	                       mpris2->current->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "Set",
+	                       g_variant_new ("(ssv)",
+	                                      "org.mpris.MediaPlayer2.Player",
+	                                      prop,
+	                                      vprop),
+	                       NULL,
+	                       mpris2->current->cancellable,
+	                       mpris2_client_set_properties_ready,
+	                       NULL);
+}
+
+/* These function intercepts the messages from the player. */
+
+static const gchar *
+g_avariant_get_string(GVariant * variant)
+{
+	const gchar **strv = NULL;
+	const gchar *string = NULL;
+	gsize len;
+
+	strv = g_variant_get_strv (variant, &len);
+	if (len > 0) {
+		string = strv[0];
+		g_free (strv);
+	}
+	else {
+		string = "";
+	}
+
+	return string;
+}
+
+static Mpris2Metadata *
+mpris2_metadata_new_from_variant (GVariant *dictionary)
+{
+	GVariantIter iter;
+	GVariant *value;
+	gchar *key;
+
+	gint64 length = 0;
+
+	Mpris2Metadata *metadata;
+
+	metadata = mpris2_metadata_new ();
+
+	g_variant_iter_init (&iter, dictionary);
+	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "mpris:trackid"))
+			mpris2_metadata_set_trackid (metadata, g_variant_get_string(value, NULL));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:url"))
+			mpris2_metadata_set_url (metadata, g_variant_get_string(value, NULL));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:title"))
+			mpris2_metadata_set_title (metadata, g_variant_get_string(value, NULL));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:artist"))
+			mpris2_metadata_set_artist(metadata, g_avariant_get_string(value));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:album"))
+			mpris2_metadata_set_album (metadata, g_variant_get_string(value, NULL));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:genre"));
+			/* (List of Strings.) Not use genre */
+		else if (0 == g_ascii_strcasecmp (key, "xesam:albumArtist"));
+			// List of Strings.
+		else if (0 == g_ascii_strcasecmp (key, "xesam:comment"));
+			/* (List of Strings) Not use comment */
+		else if (0 == g_ascii_strcasecmp (key, "xesam:audioBitrate"));
+			/* (uint32) Not use audioBitrate */
+		else if (0 == g_ascii_strcasecmp (key, "mpris:length"))
+			length = g_variant_get_int64 (value);
+		else if (0 == g_ascii_strcasecmp (key, "xesam:trackNumber"))
+			mpris2_metadata_set_track_no(metadata, g_variant_get_int32 (value));
+		else if (0 == g_ascii_strcasecmp (key, "xesam:useCount"));
+			/* (Integer) Not use useCount */
+		else if (0 == g_ascii_strcasecmp (key, "xesam:userRating"));
+			/* (Float) Not use userRating */
+		else if (0 == g_ascii_strcasecmp (key, "mpris:artUrl"))
+			mpris2_metadata_set_arturl_variant (metadata, value);
+		else if (0 == g_ascii_strcasecmp (key, "xesam:contentCreated"));
+			/* has type 's' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-bitrate"));
+			/* has type 'i' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-channels"));
+			/* has type 'i' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-samplerate"));
+			/* has type 'i' */
+		else if (0 == g_ascii_strcasecmp (key, "xesam:contentCreated"));
+			/* has type 's' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-bitrate"));
+			/* has type 'i' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-channels"));
+			/* has type 'i' */
+		else if (0 == g_ascii_strcasecmp (key, "audio-samplerate"));
+			/* has type 'i'*/
+		else
+			g_print ("Variant '%s' has type '%s'\n", key,
+				     g_variant_get_type_string (value));
+	}
+
+	mpris2_metadata_set_length (metadata, length / 1000000l);
+
+	return metadata;
+}
+
+/* The metadata is only decoded once a handler or a getter wants it. */
+
+static void
+mpris2_player_set_metadata (Mpris2Player *player, GVariant *metadata)
+{
+	if (player->metadata_variant != NULL) {
+		g_variant_unref (player->metadata_variant);
+		player->metadata_variant = NULL;
+	}
+	if (player->metadata != NULL) {
+		mpris2_metadata_free (player->metadata);
+		player->metadata = NULL;
+	}
+
+	if (metadata != NULL)
+		player->metadata_variant = g_variant_ref (metadata);
+}
+
+static Mpris2Metadata *
+mpris2_player_get_metadata (Mpris2Player *player)
+{
+	if (player->metadata == NULL && player->metadata_variant != NULL)
+		player->metadata = mpris2_metadata_new_from_variant (player->metadata_variant);
+
+	return player->metadata;
+}
+
+/* The position runs on by itself while playing, so it needs no timer. */
+
+static void
+mpris2_player_set_position (Mpris2Player *player, gint position)
+{
+	player->position = position;
+	player->position_time = g_get_monotonic_time ();
+}
+
+static gint
+mpris2_player_get_position (Mpris2Player *player)
+{
+	if (player->playback_status != PLAYING || player->position_time == 0)
+		return player->position;
+
+	return player->position + (gint) ((g_get_monotonic_time () - player->position_time) * player->rate);
+}
+
+static void
+mpris2_client_parse_playback_status (Mpris2Player *player, const gchar *playback_status)
+{
+	Mpris2Client *mpris2 = player->client;
+	PlaybackStatus previous = player->playback_status;
+
+	/* Keep the position reached before the extrapolation changes. */
+	mpris2_player_set_position (player, mpris2_player_get_position (player));
+
+	if (0 == g_ascii_strcasecmp(playback_status, "Playing")) {
+		player->playback_status = PLAYING;
+	}
+	else if (0 == g_ascii_strcasecmp(playback_status, "Paused")) {
+		player->playback_status = PAUSED;
+	}
+	else {
+		player->playback_status = STOPPED;
+	}
+
+	/* The position is only followed for the current player. */
+	if (player != mpris2->current)
+		return;
+
+	/* A player reporting Playing again has not moved from the extrapolation. */
+	if (player->playback_status == PLAYING && previous != PLAYING &&
+	    (mpris2_client_wants (mpris2, MPRIS2_INTEREST_POSITION) ||
+	     mpris2_client_wants (mpris2, MPRIS2_INTEREST_PLAYBACK_TICK)))
+		mpris2_client_fetch_position (player);
+
+	mpris2_client_update_playback_timer (mpris2);
+}
+
+/* Returns the Mpris2Changed flag if the capability changed, else 0. */
+
+static guint
+mpris2_player_set_capability (Mpris2Player *player, guint capability, gboolean value)
+{
+	guint capabilities;
+
+	capabilities = value ? (player->capabilities | capability) : (player->capabilities & ~capability);
+	if (capabilities == player->capabilities)
+		return 0;
+
+	player->capabilities = capabilities;
+
+	return MPRIS2_CHANGED_CAPABILITIES;
+}
+
+static void
+mpris2_client_emit_changed (Mpris2Player *player, guint changed)
+{
+	GObject *object;
+	guint i;
+
+	if (changed == 0 || player != player->client->current)
+		return;
+
+	object = G_OBJECT (player->client);
+
+	g_object_freeze_notify (object);
+	for (i = 0; PROP_PLAYBACK_STATUS + i <= PROP_PLAYLIST_COUNT; i++) {
+		if (changed & (1 << i))
+			g_object_notify_by_pspec (object, properties[PROP_PLAYBACK_STATUS + i]);
+	}
+	g_signal_emit (player->client, signals[CHANGED], 0, changed);
+	g_object_thaw_notify (object);
+}
+
+static void
+mpris2_client_emit_connection (Mpris2Client *mpris2, gboolean connected)
+{
+	g_object_freeze_notify (G_OBJECT (mpris2));
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_CONNECTED]);
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_PROVISIONAL]);
+	g_signal_emit (mpris2, signals[CONNECTION], 0, connected);
+	g_object_thaw_notify (G_OBJECT (mpris2));
+}
+
+/* Position is not told by PropertiesChanged, so it is asked when playing starts. */
+
+static void
+mpris2_client_get_position_ready (GVariant     *reply,
+                                  const gchar  *sender,
+                                  const GError *error,
+                                  gpointer      user_data)
+{
+	GVariant *value;
+	Mpris2Player *player;
+
+	if (reply == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Could not get the position of the player: %s", error->message);
+		return;
+	}
+
+	player = user_data;
+
+	g_variant_get (reply, "(v)", &value);
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64)) {
+		mpris2_player_set_position (player, (gint) g_variant_get_int64 (value));
+		if (player == player->client->current)
+			g_signal_emit (player->client, signals[PLAYBACK_TICK], 0, player->position);
+		mpris2_client_emit_changed (player, MPRIS2_CHANGED_POSITION);
+	}
+	g_variant_unref (value);
+}
+
+static void
+mpris2_client_fetch_position (Mpris2Player *player)
+{
+	if (!player->connected || player->cancellable == NULL)
+		return;
+
+	mpris2_transport_call (player->client->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "Get",
+	                       g_variant_new ("(ss)", "org.mpris.MediaPlayer2.Player", "Position"),
+	                       G_VARIANT_TYPE ("(v)"),
+	                       player->cancellable,
+	                       mpris2_client_get_position_ready,
+	                       player);
+}
+
+static void
+mpris2_client_parse_player_properties (Mpris2Player *player, GVariant *properties)
+{
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	const gchar *playback_status = NULL;
+	const gchar *loop_status = NULL;
+	GVariant *metadata = NULL;
+	gdouble volume = -1;
+	gdouble rate;
+	gint position;
+	gboolean shuffle = FALSE;
+	gboolean loop_status_changed = FALSE;
+	gboolean shuffle_changed = FALSE;
+	guint changed = 0;
+	LoopStatus previous_loop_status;
+	PlaybackStatus previous_playback_status;
+	gboolean emit;
+
+	Mpris2Client *mpris2 = player->client;
+
+	/* Players on standby are kept up to date silently. */
+	emit = (player == mpris2->current);
+
+	g_variant_iter_init (&iter, properties);
+
+	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "PlaybackStatus")) {
+			playback_status = g_variant_get_string(value, NULL);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Rate")) {
+			rate = g_variant_get_double(value);
+			if (rate != player->rate)
+				changed |= MPRIS2_CHANGED_RATE;
+			mpris2_player_set_position (player, mpris2_player_get_position (player));
+			player->rate = rate;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Metadata")) {
+			metadata = g_variant_ref (value);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Volume")) {
+			volume = g_variant_get_double(value);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Position")) {
+			position = (gint) g_variant_get_int64(value);
+			if (position != player->position)
+				changed |= MPRIS2_CHANGED_POSITION;
+			mpris2_player_set_position (player, position);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "MinimumRate")) {
+			rate = g_variant_get_double(value);
+			if (rate != player->minimum_rate)
+				changed |= MPRIS2_CHANGED_MINIMUM_RATE;
+			player->minimum_rate = rate;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "MaximumRate")) {
+			rate = g_variant_get_double(value);
+			if (rate != player->maximum_rate)
+				changed |= MPRIS2_CHANGED_MAXIMUM_RATE;
+			player->maximum_rate = rate;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanGoNext")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_GO_NEXT,
+			                                         g_variant_get_boolean(value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanGoPrevious")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_GO_PREVIOUS,
+			                                         g_variant_get_boolean(value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanPlay")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_PLAY,
+			                                         g_variant_get_boolean(value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanPause")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_PAUSE,
+			                                         g_variant_get_boolean(value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanSeek")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_SEEK,
+			                                         g_variant_get_boolean(value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanControl")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_CONTROL,
+			                                         g_variant_get_boolean(value));
+		}
+		/* Optionals */
+		else if (0 == g_ascii_strcasecmp (key, "LoopStatus")) {
+			loop_status_changed = TRUE;
+			loop_status = g_variant_get_string(value, NULL);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Shuffle")) {
+			shuffle_changed = TRUE;
+			shuffle = g_variant_get_boolean(value);
+		}
+	}
+
+	if (metadata != NULL) {
+		mpris2_player_set_metadata (player, metadata);
+		g_variant_unref (metadata);
+		changed |= MPRIS2_CHANGED_METADATA;
+
+		if (emit && mpris2_client_wants (mpris2, MPRIS2_INTEREST_METADATA))
+			g_signal_emit (mpris2, signals[METADATA], 0, mpris2_player_get_metadata (player));
+	}
+
+	if (playback_status != NULL) {
+		previous_playback_status = player->playback_status;
+		mpris2_client_parse_playback_status (player, playback_status);
+		if (player->playback_status != previous_playback_status)
+			changed |= MPRIS2_CHANGED_PLAYBACK_STATUS;
+		if (emit)
+			g_signal_emit (mpris2, signals[PLAYBACK_STATUS], 0, player->playback_status);
+	}
+
+	if (volume != -1) {
+		if (volume != player->volume)
+			changed |= MPRIS2_CHANGED_VOLUME;
+		player->volume = volume;
+		if (emit)
+			g_signal_emit (mpris2, signals[VOLUME], 0, volume);
+	}
+
+	if (loop_status_changed) {
+		changed |= mpris2_player_set_capability (player, MPRIS2_HAS_LOOP_STATUS, TRUE);
+		previous_loop_status = player->loop_status;
+
+		if (0 == g_ascii_strcasecmp(loop_status, "Track")) {
+			player->loop_status = TRACK;
+		}
+		else if (0 == g_ascii_strcasecmp(loop_status, "Playlist")) {
+			player->loop_status = PLAYLIST;
+		}
+		else {
+			player->loop_status = NONE;
+		}
+		if (player->loop_status != previous_loop_status)
+			changed |= MPRIS2_CHANGED_LOOP_STATUS;
+		if (emit)
+			g_signal_emit (mpris2, signals[LOOP_STATUS], 0, player->loop_status);
+	}
+	if (shuffle_changed) {
+		changed |= mpris2_player_set_capability (player, MPRIS2_HAS_SHUFFLE, TRUE);
+		if (shuffle != player->shuffle)
+			changed |= MPRIS2_CHANGED_SHUFFLE;
+
+		player->shuffle = shuffle;
+		if (emit)
+			g_signal_emit (mpris2, signals[SHUFFLE], 0, shuffle);
+	}
+
+	mpris2_client_emit_changed (player, changed);
+
+	mpris2_player_store_state (player);
+}
+
+static void
+mpris2_client_parse_media_player_properties (Mpris2Player *player, GVariant *properties)
+{
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	gboolean fullscreen;
+	guint changed = 0;
+
+	g_variant_iter_init (&iter, properties);
+
+	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "CanQuit")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_QUIT,
+			                                         g_variant_get_boolean (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Fullscreen")) {
+			fullscreen = g_variant_get_boolean (value);
+			if (fullscreen != player->fullscreen)
+				changed |= MPRIS2_CHANGED_FULLSCREEN;
+			player->fullscreen = fullscreen;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanSetFullscreen")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_SET_FULLSCREEN,
+			                                         g_variant_get_boolean (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "CanRaise")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_RAISE,
+			                                         g_variant_get_boolean (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "HasTrackList")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_HAS_TRACKLIST,
+			                                         g_variant_get_boolean (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Identity")) {
+			if (player->identity)
+				g_free (player->identity);
+			player->identity = g_variant_dup_string (value, NULL);
+			changed |= MPRIS2_CHANGED_IDENTITY;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "DesktopEntry")) {
+			if (player->desktop_entry)
+				g_free (player->desktop_entry);
+			player->desktop_entry = g_variant_dup_string (value, NULL);
+			changed |= MPRIS2_CHANGED_DESKTOP_ENTRY;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "SupportedUriSchemes")) {
+			if (player->supported_uri_schemes)
+				g_strfreev (player->supported_uri_schemes);
+			player->supported_uri_schemes = g_variant_dup_strv (value, NULL);
+			mpris2_player_drop_indexes (player);
+			changed |= MPRIS2_CHANGED_SUPPORTED_URI_SCHEMES;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "SupportedMimeTypes")) {
+			if (player->supported_mime_types)
+				g_strfreev (player->supported_mime_types);
+			player->supported_mime_types = g_variant_dup_strv (value, NULL);
+			mpris2_player_drop_indexes (player);
+			changed |= MPRIS2_CHANGED_SUPPORTED_MIME_TYPES;
+		}
+	}
+
+	mpris2_client_emit_changed (player, changed);
+
+	mpris2_player_store_state (player);
+
+	if (changed & MPRIS2_CHANGED_CAPABILITIES)
+		mpris2_client_update_tracklist (player);
+}
+
+/* All the properties invalidated in a main loop iteration are fetched
+ * again with a single GetAll per interface. */
+
+static gboolean
+mpris2_client_refetch_idle (gpointer user_data)
+{
+	Mpris2Player *player = user_data;
+
+	player->refetch_id = 0;
+
+	if (player->invalidated & MPRIS2_INTERFACE_MEDIA_PLAYER)
+		mpris2_transport_call (player->client->transport,
+		                       player->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.freedesktop.DBus.Properties",
+		                       "GetAll",
+		                       g_variant_new ("(s)", "org.mpris.MediaPlayer2"),
+		                       G_VARIANT_TYPE ("(a{sv})"),
+		                       player->cancellable,
+		                       mpris2_client_revalidate_media_player_ready,
+		                       player);
+
+	if (player->invalidated & MPRIS2_INTERFACE_PLAYER)
+		mpris2_transport_call (player->client->transport,
+		                       player->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.freedesktop.DBus.Properties",
+		                       "GetAll",
+		                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.Player"),
+		                       G_VARIANT_TYPE ("(a{sv})"),
+		                       player->cancellable,
+		                       mpris2_client_get_all_player_ready,
+		                       player);
+
+	if (player->invalidated & MPRIS2_INTERFACE_TRACKLIST)
+		mpris2_transport_call (player->client->transport,
+		                       player->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.freedesktop.DBus.Properties",
+		                       "GetAll",
+		                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.TrackList"),
+		                       G_VARIANT_TYPE ("(a{sv})"),
+		                       player->cancellable,
+		                       mpris2_client_get_all_tracklist_ready,
+		                       player);
+
+	if (player->invalidated & MPRIS2_INTERFACE_PLAYLISTS)
+		mpris2_transport_call (player->client->transport,
+		                       player->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.freedesktop.DBus.Properties",
+		                       "GetAll",
+		                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.Playlists"),
+		                       G_VARIANT_TYPE ("(a{sv})"),
+		                       player->cancellable,
+		                       mpris2_client_get_all_playlists_ready,
+		                       player);
+
+	player->invalidated = 0;
+
+	return FALSE;
+}
+
+static void
+mpris2_client_invalidate (Mpris2Player *player, guint interfaces)
+{
+	player->invalidated |= interfaces;
+
+	if (player->refetch_id == 0)
+		player->refetch_id = g_idle_add (mpris2_client_refetch_idle, player);
+}
+
+static void
+mpris2_client_on_dbus_props_signal (const gchar *sender_name,
+                                    const gchar *object_path,
+                                    const gchar *interface_name,
+                                    const gchar *signal_name,
+                                    GVariant    *parameters,
+                                    gpointer     user_data)
+{
+	const gchar *changed_interface;
+	const gchar **invalidated;
+	GVariant *changed;
+	guint interface, i;
+
+	Mpris2Player *player = user_data;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sa{sv}as)")))
+		return;
+
+	g_variant_get (parameters, "(&s@a{sv}^a&s)",
+	               &changed_interface, &changed, &invalidated);
+
+	/* The notifies of the whole batch are emitted together. */
+	g_object_freeze_notify (G_OBJECT (player->client));
+
+	if (0 == g_strcmp0 (changed_interface, "org.mpris.MediaPlayer2.Player")) {
+		interface = MPRIS2_INTERFACE_PLAYER;
+		mpris2_client_parse_player_properties (player, changed);
+	}
+	else if (0 == g_strcmp0 (changed_interface, "org.mpris.MediaPlayer2")) {
+		interface = MPRIS2_INTERFACE_MEDIA_PLAYER;
+		mpris2_client_parse_media_player_properties (player, changed);
+	}
+	else if (0 == g_strcmp0 (changed_interface, "org.mpris.MediaPlayer2.TrackList")) {
+		interface = MPRIS2_INTERFACE_TRACKLIST;
+		mpris2_client_parse_tracklist_properties (player, changed);
+
+		/* Tracks is invalidated on every change, already told by the signals. */
+		for (i = 0; invalidated[i] != NULL; i++) {
+			if (0 != g_ascii_strcasecmp (invalidated[i], "Tracks"))
+				break;
+		}
+		if (invalidated[i] == NULL)
+			interface = 0;
+	}
+	else if (0 == g_strcmp0 (changed_interface, "org.mpris.MediaPlayer2.Playlists")) {
+		interface = MPRIS2_INTERFACE_PLAYLISTS;
+		mpris2_client_parse_playlists_properties (player, changed);
+	}
+	else {
+		interface = 0;
+	}
+
+	if (interface != 0 && invalidated[0] != NULL)
+		mpris2_client_invalidate (player, interface);
+
+	g_object_thaw_notify (G_OBJECT (player->client));
+
+	g_variant_unref (changed);
+	g_free (invalidated);
+}
+
+static void
+mpris2_client_on_dbus_seeked_signal (const gchar *sender_name,
+                                     const gchar *object_path,
+                                     const gchar *interface_name,
+                                     const gchar *signal_name,
+                                     GVariant    *parameters,
+                                     gpointer     user_data)
+{
+	GVariantIter iter;
+	GVariant *child;
+
+	Mpris2Player *player = user_data;
+
+	g_variant_iter_init (&iter, parameters);
+
+	child = g_variant_iter_next_value (&iter);
+
+	mpris2_player_set_position (player, (gint) g_variant_get_int64 (child));
+	if (player == player->client->current)
+		g_signal_emit (player->client, signals[PLAYBACK_TICK], 0, player->position);
+	mpris2_client_emit_changed (player, MPRIS2_CHANGED_POSITION);
+
+	g_variant_unref (child);
+}
+
+/* Replies of the initial GetAll calls, once the player appears on the bus. */
+
+static GVariant *
+mpris2_client_get_all_finish (GVariant *reply, const GError *error, gboolean *cancelled)
+{
+	*cancelled = FALSE;
+
+	if (reply == NULL) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			*cancelled = TRUE;
+		else
+			g_warning ("Could not get properties of the player: %s", error->message);
+		return NULL;
+	}
+
+	return g_variant_get_child_value (reply, 0);
+}
+
+static void
+mpris2_client_get_all_player_ready (GVariant     *reply,
+                                    const gchar  *sender,
+                                    const GError *error,
+                                    gpointer      user_data)
+{
+	GVariant *properties;
+	gboolean cancelled;
+
+	properties = mpris2_client_get_all_finish (reply, error, &cancelled);
+	if (cancelled)
+		return;
+
+	if (properties != NULL) {
+		mpris2_client_parse_player_properties (user_data, properties);
+		g_variant_unref (properties);
+	}
+}
+
+static void
+mpris2_client_get_all_media_player_ready (GVariant     *reply,
+                                          const gchar  *sender,
+                                          const GError *error,
+                                          gpointer      user_data)
+{
+	Mpris2Player *player;
+	GVariant *properties;
+	gboolean cancelled;
+
+	properties = mpris2_client_get_all_finish (reply, error, &cancelled);
+	if (cancelled)
+		return;
+
+	player = user_data;
+
+	g_object_freeze_notify (G_OBJECT (player->client));
+
+	if (properties != NULL) {
+		mpris2_client_parse_media_player_properties (player, properties);
+		g_variant_unref (properties);
+	}
+
+	/* Notify that connect to a player.*/
+	player->provisional = FALSE;
+	player->connected = TRUE;
+	if (player == player->client->current)
+		mpris2_client_emit_connection (player->client, player->connected);
+
+	g_object_thaw_notify (G_OBJECT (player->client));
+
+	/* And informs the current status of the player */
+	mpris2_transport_call (player->client->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.Player"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_get_all_player_ready,
+	                       player);
+
+	/* The Playlists interface is optional, and told by this reply. */
+	mpris2_transport_call (player->client->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.Playlists"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_get_all_playlists_ready,
+	                       player);
+}
+
+/*
+ * Interface MediaPlayer2.TrackList cache.
+ */
+
+static guint
+mpris2_player_get_n_tracks (Mpris2Player *player)
+{
+	return player->tracklist != NULL ? mpris2_tracklist_get_length (player->tracklist) : 0;
+}
+
+static guint
+mpris2_player_drop_tracklist (Mpris2Player *player)
+{
+	guint removed;
+
+	removed = mpris2_player_get_n_tracks (player);
+	if (player->tracklist != NULL) {
+		mpris2_tracklist_free (player->tracklist);
+		player->tracklist = NULL;
+	}
+	player->tracklist_fetching = FALSE;
+
+	/* Replies of the calls in flight are ignored. */
+	player->tracks_requests = 0;
+	player->tracks_generation++;
+	player->tracks_failed = FALSE;
+
+	return removed;
+}
+
+static void
+mpris2_client_emit_tracklist_changed (Mpris2Player *player, guint position, guint removed, guint added)
+{
+	if (player != player->client->current || (removed == 0 && added == 0))
+		return;
+
+	g_signal_emit (player->client, signals[TRACKLIST_CHANGED], 0, position, removed, added);
+}
+
+/* The track id of some metadata, as given in object path or string. */
+
+static const gchar *
+mpris2_track_metadata_get_id (GVariant *metadata)
+{
+	GVariant *value;
+	const gchar *id = NULL;
+
+	value = g_variant_lookup_value (metadata, "mpris:trackid", NULL);
+	if (value == NULL)
+		return NULL;
+
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_OBJECT_PATH) ||
+	    g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+		id = g_variant_get_string (value, NULL);
+
+	/* The string lives in the dictionary. */
+	g_variant_unref (value);
+
+	return id;
+}
+
+/* A GetTracksMetadata call in flight, ignored once the tracklist is dropped. */
+
+typedef struct {
+	Mpris2Player *player;
+	guint         generation;
+	guint         position;
+} Mpris2TracksRequest;
+
+static void
+mpris2_client_get_tracks_metadata_ready (GVariant     *reply,
+                                         const gchar  *sender,
+                                         const GError *error,
+                                         gpointer      user_data)
+{
+	Mpris2TracksRequest *request = user_data;
+	Mpris2Player *player = request->player;
+	Mpris2TrackList *tracklist;
+	GVariantIter iter;
+	GVariant *child, *metadata;
+	const gchar *id;
+	gint index, first = -1, last = -1;
+	guint hint = request->position;
+	gboolean stale;
+
+	/* The player may be gone if cancelled. */
+	stale = (reply == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) ||
+	        request->generation != player->tracks_generation;
+	g_slice_free (Mpris2TracksRequest, request);
+	if (stale)
+		return;
+
+	player->tracks_requests--;
+	tracklist = player->tracklist;
+
+	if (reply == NULL) {
+		/* Not asked again for this tracklist, as it would fail the same. */
+		g_warning ("Could not get metadata of the tracks: %s", error->message);
+		player->tracks_failed = TRUE;
+		return;
+	}
+
+	child = g_variant_get_child_value (reply, 0);
+
+	/* The tracks are told in the order asked, so usually where expected. */
+	g_variant_iter_init (&iter, child);
+	while ((metadata = g_variant_iter_next_value (&iter)) != NULL) {
+		id = mpris2_track_metadata_get_id (metadata);
+		index = id != NULL ? mpris2_tracklist_set_metadata (tracklist, id, metadata, hint) : -1;
+		if (index >= 0) {
+			if (first < 0 || index < first)
+				first = index;
+			if (index > last)
+				last = index;
+			hint = index + 1;
+		}
+		g_variant_unref (metadata);
+	}
+
+	g_variant_unref (child);
+
+	/* Each chunk is told at once, so the tracklist fills progressively. */
+	if (first >= 0)
+		mpris2_client_emit_tracklist_changed (player, first, last - first + 1, last - first + 1);
+
+	mpris2_client_fetch_tracks_metadata (player);
+}
+
+/* Only the tracks not known yet are asked, in bounded chunks with a few
+ * calls in flight. The visible tracks go first, then the rest in order. */
+
+static void
+mpris2_client_fetch_tracks_metadata (Mpris2Player *player)
+{
+	Mpris2Client *mpris2 = player->client;
+	Mpris2TrackList *tracklist = player->tracklist;
+	Mpris2TracksRequest *request;
+	GVariantBuilder builder;
+	guint n, first = 0;
+
+	if (tracklist == NULL || player->tracks_failed)
+		return;
+
+	while (player->tracks_requests < mpris2->tracks_fetch_window) {
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("ao"));
+
+		n = 0;
+		if (player == mpris2->current && mpris2->n_visible_tracks > 0)
+			n = mpris2_tracklist_take_chunk (tracklist,
+			                                 mpris2->visible_position,
+			                                 mpris2->visible_position + mpris2->n_visible_tracks,
+			                                 MPRIS2_CLIENT_TRACKS_CHUNK,
+			                                 &builder, &first);
+		if (n == 0)
+			n = mpris2_tracklist_take_next_chunk (tracklist, MPRIS2_CLIENT_TRACKS_CHUNK,
+			                                      &builder, &first);
+
+		if (n == 0) {
+			g_variant_builder_clear (&builder);
+			return;
+		}
+
+		request = g_slice_new (Mpris2TracksRequest);
+		request->player = player;
+		request->generation = player->tracks_generation;
+		request->position = first;
+
+		player->tracks_requests++;
+		mpris2_transport_call (mpris2->transport,
+		                       player->dbus_name,
+		                       "/org/mpris/MediaPlayer2",
+		                       "org.mpris.MediaPlayer2.TrackList",
+		                       "GetTracksMetadata",
+		                       g_variant_new ("(ao)", &builder),
+		                       G_VARIANT_TYPE ("(aa{sv})"),
+		                       player->cancellable,
+		                       mpris2_client_get_tracks_metadata_ready,
+		                       request);
+	}
+}
+
+static void
+mpris2_client_set_tracks (Mpris2Player *player, GVariant *ids)
+{
+	guint removed = 0;
+
+	if (player->tracklist == NULL)
+		player->tracklist = mpris2_tracklist_new ();
+	else
+		removed = mpris2_tracklist_get_length (player->tracklist);
+
+	mpris2_tracklist_replace (player->tracklist, ids);
+	player->tracks_failed = FALSE;
+	mpris2_client_emit_tracklist_changed (player, 0, removed,
+	                                      mpris2_tracklist_get_length (player->tracklist));
+
+	mpris2_client_fetch_tracks_metadata (player);
+}
+
+static void
+mpris2_client_parse_tracklist_properties (Mpris2Player *player, GVariant *properties)
+{
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	guint changed = 0;
+
+	g_variant_iter_init (&iter, properties);
+
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "CanEditTracks")) {
+			changed |= mpris2_player_set_capability (player, MPRIS2_CAN_EDIT_TRACKS,
+			                                         g_variant_get_boolean (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Tracks") &&
+		         g_variant_is_of_type (value, G_VARIANT_TYPE ("ao"))) {
+			/* Unless dropped meanwhile. */
+			if (player->tracklist != NULL || player->tracklist_fetching)
+				mpris2_client_set_tracks (player, value);
+		}
+	}
+
+	mpris2_client_emit_changed (player, changed);
+}
+
+static void
+mpris2_client_get_all_tracklist_ready (GVariant     *reply,
+                                       const gchar  *sender,
+                                       const GError *error,
+                                       gpointer      user_data)
+{
+	Mpris2Player *player = user_data;
+	GVariant *properties;
+	gboolean cancelled;
+
+	properties = mpris2_client_get_all_finish (reply, error, &cancelled);
+	if (cancelled)
+		return;
+
+	if (properties != NULL) {
+		mpris2_client_parse_tracklist_properties (player, properties);
+		g_variant_unref (properties);
+	}
+	player->tracklist_fetching = FALSE;
+}
+
+/* The tracklist is fetched once, when wanted and the player has one.
+ * Then only the signals change it. */
+
+static void
+mpris2_client_update_tracklist (Mpris2Player *player)
+{
+	guint removed;
+
+	if (player->cancellable == NULL ||
+	    !MPRIS2_PLAYER_CAN (player, MPRIS2_HAS_TRACKLIST) ||
+	    !mpris2_client_wants (player->client, MPRIS2_INTEREST_TRACKLIST)) {
+		removed = mpris2_player_drop_tracklist (player);
+		mpris2_client_emit_tracklist_changed (player, 0, removed, 0);
+		return;
+	}
+
+	if (player->tracklist != NULL || player->tracklist_fetching)
+		return;
+
+	player->tracklist_fetching = TRUE;
+
+	mpris2_transport_call (player->client->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.TrackList"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_get_all_tracklist_ready,
+	                       player);
+}
+
+/* Signals from a player reply are in order, so the signals received
+ * before the tracks are included in them, and can be ignored. */
+
+static void
+mpris2_client_on_dbus_tracklist_signal (const gchar *sender_name,
+                                        const gchar *object_path,
+                                        const gchar *interface_name,
+                                        const gchar *signal_name,
+                                        GVariant    *parameters,
+                                        gpointer     user_data)
+{
+	Mpris2Player *player = user_data;
+	Mpris2TrackList *tracklist = player->tracklist;
+	GVariant *metadata, *ids;
+	const gchar *id, *after, *new_id;
+	gint index;
+
+	if (tracklist == NULL)
+		return;
+
+	if (0 == g_strcmp0 (signal_name, "TrackAdded") &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv}o)"))) {
+		g_variant_get (parameters, "(@a{sv}&o)", &metadata, &after);
+
+		id = mpris2_track_metadata_get_id (metadata);
+		if (id != NULL && g_variant_is_object_path (id)) {
+			index = mpris2_tracklist_remove (tracklist, id);
+			if (index >= 0)
+				mpris2_client_emit_tracklist_changed (player, index, 1, 0);
+
+			if (0 == g_strcmp0 (after, MPRIS2_TRACKLIST_NO_TRACK))
+				index = 0;
+			else if ((index = mpris2_tracklist_index (tracklist, after, 0)) >= 0)
+				index++;
+			else
+				index = mpris2_tracklist_get_length (tracklist);
+
+			mpris2_tracklist_insert (tracklist, index, id);
+			mpris2_tracklist_set_metadata (tracklist, id, metadata, index);
+			mpris2_client_emit_tracklist_changed (player, index, 0, 1);
+		}
+
+		g_variant_unref (metadata);
+	}
+	else if (0 == g_strcmp0 (signal_name, "TrackRemoved") &&
+	         g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)"))) {
+		g_variant_get (parameters, "(&o)", &id);
+
+		index = mpris2_tracklist_remove (tracklist, id);
+		if (index >= 0)
+			mpris2_client_emit_tracklist_changed (player, index, 1, 0);
+	}
+	else if (0 == g_strcmp0 (signal_name, "TrackMetadataChanged") &&
+	         g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(oa{sv})"))) {
+		g_variant_get (parameters, "(&o@a{sv})", &id, &metadata);
+
+		index = mpris2_tracklist_index (tracklist, id, 0);
+		if (index >= 0) {
+			/* The player may give the track a new id. */
+			new_id = mpris2_track_metadata_get_id (metadata);
+			if (new_id != NULL && g_variant_is_object_path (new_id) &&
+			    0 != g_strcmp0 (new_id, id) &&
+			    !mpris2_tracklist_contains (tracklist, new_id)) {
+				mpris2_tracklist_remove (tracklist, id);
+				mpris2_tracklist_insert (tracklist, index, new_id);
+				id = new_id;
+			}
+			mpris2_tracklist_set_metadata (tracklist, id, metadata, index);
+			mpris2_client_emit_tracklist_changed (player, index, 1, 1);
+		}
+
+		g_variant_unref (metadata);
+	}
+	else if (0 == g_strcmp0 (signal_name, "TrackListReplaced") &&
+	         g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(aoo)"))) {
+		g_variant_get (parameters, "(@aoo)", &ids, NULL);
+
+		mpris2_client_set_tracks (player, ids);
+
+		g_variant_unref (ids);
+	}
+}
+
+/*
+ * Interface MediaPlayer2.Playlists cache.
+ */
+
+static void
+mpris2_player_set_active_playlist (Mpris2Player *player, Mpris2Playlist *playlist)
+{
+	if (player->active_playlist != NULL)
+		mpris2_playlist_unref (player->active_playlist);
+
+	player->active_playlist = playlist;
+}
+
+static Mpris2PlaylistListing *
+mpris2_playlist_listing_new (void)
+{
+	Mpris2PlaylistListing *listing;
+
+	listing = g_slice_new (Mpris2PlaylistListing);
+	listing->playlists = g_ptr_array_new ();
+	listing->length = -1;
+
+	return listing;
+}
+
+static void
+mpris2_playlist_listing_free (Mpris2PlaylistListing *listing)
+{
+	Mpris2Playlist *playlist;
+	guint i;
+
+	for (i = 0; i < listing->playlists->len; i++) {
+		playlist = g_ptr_array_index (listing->playlists, i);
+		if (playlist != NULL)
+			mpris2_playlist_unref (playlist);
+	}
+	g_ptr_array_free (listing->playlists, TRUE);
+	g_slice_free (Mpris2PlaylistListing, listing);
+}
+
+static gint
+mpris2_playlist_listing_find (Mpris2PlaylistListing *listing, const gchar *id)
+{
+	Mpris2Playlist *playlist;
+	guint i;
+
+	for (i = 0; i < listing->playlists->len; i++) {
+		playlist = g_ptr_array_index (listing->playlists, i);
+		if (playlist != NULL && 0 == g_strcmp0 (mpris2_playlist_get_id (playlist), id))
+			return i;
+	}
+
+	return -1;
+}
+
+/* The page as listed before, or NULL if any of it was not listed yet. */
+
+static GPtrArray *
+mpris2_playlist_listing_get_page (Mpris2PlaylistListing *listing, guint index, guint max_count)
+{
+	Mpris2Playlist *playlist;
+	GPtrArray *page;
+	guint i, end;
+
+	if (listing == NULL)
+		return NULL;
+
+	end = index + MIN (max_count, G_MAXUINT - index);
+	if (listing->length >= 0)
+		end = CLAMP ((guint) listing->length, index, end);
+	if (end > listing->playlists->len)
+		return NULL;
+
+	for (i = index; i < end; i++) {
+		if (g_ptr_array_index (listing->playlists, i) == NULL)
+			return NULL;
+	}
+
+	page = g_ptr_array_new_with_free_func ((GDestroyNotify) mpris2_playlist_unref);
+	for (i = index; i < end; i++) {
+		playlist = g_ptr_array_index (listing->playlists, i);
+		g_ptr_array_add (page, mpris2_playlist_ref (playlist));
+	}
+
+	return page;
+}
+
+static void
+mpris2_playlist_listing_store (Mpris2PlaylistListing *listing, guint index, guint max_count, GPtrArray *page)
+{
+	Mpris2Playlist **slot;
+	guint i;
+
+	if (listing->playlists->len < index + page->len)
+		g_ptr_array_set_size (listing->playlists, index + page->len);
+
+	for (i = 0; i < page->len; i++) {
+		slot = (Mpris2Playlist **) &g_ptr_array_index (listing->playlists, index + i);
+		if (*slot != NULL)
+			mpris2_playlist_unref (*slot);
+		*slot = mpris2_playlist_ref (g_ptr_array_index (page, i));
+	}
+
+	/* A short page is the end of the list. */
+	if (page->len < max_count)
+		listing->length = index + page->len;
+}
+
+static void
+mpris2_player_drop_listing (Mpris2Player *player, guint listing)
+{
+	if (player->playlist_listings[listing] != NULL) {
+		mpris2_playlist_listing_free (player->playlist_listings[listing]);
+		player->playlist_listings[listing] = NULL;
+	}
+}
+
+/* Forget the pages listed, and the replies still to come for them. */
+
+static void
+mpris2_player_drop_playlists (Mpris2Player *player)
+{
+	guint i;
+
+	for (i = 0; i < MPRIS2_N_PLAYLIST_LISTINGS; i++)
+		mpris2_player_drop_listing (player, i);
+
+	player->playlists_generation = ++player->client->playlists_generation;
+}
+
+/* The player a reply was asked to, unless it is gone or its playlists changed since. */
+
+static Mpris2Player *
+mpris2_client_find_playlists_player (Mpris2Client *mpris2, Mpris2Player *player, guint generation)
+{
+	if (player != mpris2->current && g_list_find (mpris2->standby, player) == NULL)
+		return NULL;
+
+	return player->playlists_generation == generation ? player : NULL;
+}
+
+static void
+mpris2_client_get_playlists_ready (GVariant     *reply,
+                                   const gchar  *sender,
+                                   const GError *error,
+                                   gpointer      user_data)
+{
+	Mpris2PlaylistsRequest *request = user_data;
+	Mpris2Player *player;
+	GVariantIter iter;
+	GVariant *child, *value;
+	GPtrArray *page;
+
+	if (reply == NULL) {
+		g_simple_async_result_set_from_error (request->simple, error);
+		goto out;
+	}
+
+	page = g_ptr_array_new_with_free_func ((GDestroyNotify) mpris2_playlist_unref);
+
+	child = g_variant_get_child_value (reply, 0);
+	g_variant_iter_init (&iter, child);
+	while ((value = g_variant_iter_next_value (&iter)) != NULL) {
+		g_ptr_array_add (page, mpris2_playlist_new_from_variant (value));
+		g_variant_unref (value);
+	}
+	g_variant_unref (child);
+
+	player = mpris2_client_find_playlists_player (request->client, request->player, request->generation);
+	if (player != NULL) {
+		if (player->playlist_listings[request->listing] == NULL)
+			player->playlist_listings[request->listing] = mpris2_playlist_listing_new ();
+		mpris2_playlist_listing_store (player->playlist_listings[request->listing],
+		                               request->index, request->max_count, page);
+	}
+
+	g_simple_async_result_set_op_res_gpointer (request->simple, page, (GDestroyNotify) g_ptr_array_unref);
+
+out:
+	g_simple_async_result_complete (request->simple);
+	g_object_unref (request->simple);
+	g_slice_free (Mpris2PlaylistsRequest, request);
+}
+
+static guint
+mpris2_playlist_orderings_from_variant (GVariant *value)
+{
+	const gchar **orderings;
+	guint i, j, flags = 0;
+
+	orderings = g_variant_get_strv (value, NULL);
+	for (i = 0; orderings[i] != NULL; i++) {
+		for (j = 0; j < G_N_ELEMENTS (playlist_orderings); j++) {
+			if (0 == g_ascii_strcasecmp (orderings[i], playlist_orderings[j]))
+				flags |= 1 << j;
+		}
+	}
+	g_free (orderings);
+
+	return flags;
+}
+
+static void
+mpris2_client_parse_playlists_properties (Mpris2Player *player, GVariant *properties)
+{
+	GVariantIter iter;
+	GVariant *value, *playlist;
+	const gchar *key;
+	gboolean valid;
+	guint changed = 0, count, orderings;
+
+	g_variant_iter_init (&iter, properties);
+
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "PlaylistCount") &&
+		    g_variant_is_of_type (value, G_VARIANT_TYPE_UINT32)) {
+			count = g_variant_get_uint32 (value);
+			if (count != player->playlist_count)
+				changed |= MPRIS2_CHANGED_PLAYLISTS;
+			player->playlist_count = count;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "Orderings") &&
+		         g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY)) {
+			orderings = mpris2_playlist_orderings_from_variant (value);
+			if (orderings != player->playlist_orderings)
+				changed |= MPRIS2_CHANGED_PLAYLISTS;
+			player->playlist_orderings = orderings;
+		}
+		else if (0 == g_ascii_strcasecmp (key, "ActivePlaylist") &&
+		         g_variant_is_of_type (value, G_VARIANT_TYPE ("(b(oss))"))) {
+			g_variant_get (value, "(b@(oss))", &valid, &playlist);
+			mpris2_player_set_active_playlist (player,
+			                                   valid ? mpris2_playlist_new_from_variant (playlist) : NULL);
+			g_variant_unref (playlist);
+			changed |= MPRIS2_CHANGED_ACTIVE_PLAYLIST;
+		}
+	}
+
+	/* Playlists were added or removed, so the pages listed may be shifted. */
+	if (changed & MPRIS2_CHANGED_PLAYLISTS)
+		mpris2_player_drop_playlists (player);
+
+	mpris2_client_emit_changed (player, changed);
+}
+
+/* Players without the interface reply an error or no properties. */
+
+static void
+mpris2_client_get_all_playlists_ready (GVariant     *reply,
+                                       const gchar  *sender,
+                                       const GError *error,
+                                       gpointer      user_data)
+{
+	Mpris2Player *player = user_data;
+	GVariant *properties = NULL;
+	guint changed;
+
+	if (reply == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	if (reply != NULL)
+		properties = g_variant_get_child_value (reply, 0);
+
+	g_object_freeze_notify (G_OBJECT (player->client));
+
+	changed = mpris2_player_set_capability (player, MPRIS2_HAS_PLAYLISTS,
+	                                        properties != NULL && g_variant_n_children (properties) > 0);
+	mpris2_client_emit_changed (player, changed);
+
+	if (properties != NULL) {
+		mpris2_client_parse_playlists_properties (player, properties);
+		g_variant_unref (properties);
+	}
+
+	g_object_thaw_notify (G_OBJECT (player->client));
+}
+
+/* A playlist was renamed or given another icon. It is replaced where
+ * listed, but the listings by name where it may move are dropped. */
+
 static void
-mpris2_client_parse_player_properties (Mpris2Client *mpris2, GVariant *properties)
+mpris2_client_on_dbus_playlists_signal (const gchar *sender_name,
+                                        const gchar *object_path,
+                                        const gchar *interface_name,
+                                        const gchar *signal_name,
+                                        GVariant    *parameters,
+                                        gpointer     user_data)
 {
-	GVariantIter iter;
+	Mpris2Player *player = user_data;
+	Mpris2PlaylistListing *listing;
+	Mpris2Playlist *playlist, *listed;
 	GVariant *value;
-	const gchar *key;
-	const gchar *playback_status = NULL;
-	const gchar *loop_status = NULL;
-	Mpris2Metadata *metadata = NULL;
-	gdouble volume = -1;
-	gboolean shuffle = FALSE;
-	gboolean loop_status_changed = FALSE;
-	gboolean shuffle_changed = FALSE;
+	const gchar *id;
+	gint index;
+	guint i;
 
-	g_variant_iter_init (&iter, properties);
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("((oss))")))
+		return;
 
-	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
-		if (0 == g_ascii_strcasecmp (key, "PlaybackStatus")) {
-			playback_status = g_variant_get_string(value, NULL);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "Rate")) {
-			mpris2->rate = g_variant_get_double(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "Metadata")) {
-			metadata = mpris2_metadata_new_from_variant (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "Volume")) {
-			volume = g_variant_get_double(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "MinimumRate")) {
-			mpris2->minimum_rate = g_variant_get_double(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "MaximumRate")) {
-			mpris2->maximum_rate = g_variant_get_double(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanGoNext")) {
-			mpris2->can_go_next = g_variant_get_boolean(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanGoPrevious")) {
-			mpris2->can_go_previous = g_variant_get_boolean(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanPlay")) {
-			mpris2->can_play = g_variant_get_boolean(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanPause")) {
-			mpris2->can_pause = g_variant_get_boolean(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanSeek")) {
-			mpris2->can_seek = g_variant_get_boolean(value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanControl")) {
-			mpris2->can_control = g_variant_get_boolean(value);
-		}
-		/* Optionals */
-		else if (0 == g_ascii_strcasecmp (key, "LoopStatus")) {
-			loop_status_changed = TRUE;
-			loop_status = g_variant_get_string(value, NULL);
+	value = g_variant_get_child_value (parameters, 0);
+	playlist = mpris2_playlist_new_from_variant (value);
+	g_variant_unref (value);
+
+	id = mpris2_playlist_get_id (playlist);
+
+	for (i = 0; i < MPRIS2_N_PLAYLIST_LISTINGS; i++) {
+		listing = player->playlist_listings[i];
+		if (listing == NULL)
+			continue;
+
+		index = mpris2_playlist_listing_find (listing, id);
+		listed = index >= 0 ? g_ptr_array_index (listing->playlists, index) : NULL;
+
+		if (i / 2 == MPRIS2_PLAYLIST_ORDER_ALPHABETICAL &&
+		    (listed == NULL ||
+		     0 != g_strcmp0 (mpris2_playlist_get_name (listed), mpris2_playlist_get_name (playlist)))) {
+			mpris2_player_drop_listing (player, i);
+			continue;
 		}
-		else if (0 == g_ascii_strcasecmp (key, "Shuffle")) {
-			shuffle_changed = TRUE;
-			shuffle = g_variant_get_boolean(value);
+
+		if (listed != NULL) {
+			g_ptr_array_index (listing->playlists, index) = mpris2_playlist_ref (playlist);
+			mpris2_playlist_unref (listed);
 		}
 	}
 
-	if (metadata != NULL) {
-		if (mpris2->metadata != NULL)
-			mpris2_metadata_free (mpris2->metadata);
-		mpris2->metadata = metadata;
+	if (player->active_playlist != NULL &&
+	    0 == g_strcmp0 (mpris2_playlist_get_id (player->active_playlist), id)) {
+		mpris2_player_set_active_playlist (player, mpris2_playlist_ref (playlist));
+		mpris2_client_emit_changed (player, MPRIS2_CHANGED_ACTIVE_PLAYLIST);
+	}
+
+	if (player == player->client->current)
+		g_signal_emit (player->client, signals[PLAYLIST_CHANGED], 0, playlist);
+
+	mpris2_playlist_unref (playlist);
+}
+
+/*
+ * Last-known state of the players.
+ */
+
+/* Shared by all the clients of the process that enable it, so they
+ * don't overwrite each other's players in the file. */
+
+typedef struct {
+	gchar          *filename;
+	GHashTable     *players;
+	guint           save_id;
+	guint           ref_count;
+} Mpris2StateCache;
+
+static Mpris2StateCache *state_cache = NULL;
+
+static void
+mpris2_state_cache_load (Mpris2StateCache *cache)
+{
+	GVariantIter iter;
+	GVariant *players, *state;
+	gchar *contents, *player;
+	gsize length;
+
+	if (!g_file_get_contents (cache->filename, &contents, &length, NULL))
+		return;
+
+	/* Not trusted: a corrupt file only loses the entries that are invalid. */
+	players = g_variant_new_from_data (G_VARIANT_TYPE ("a{s(a{sv}a{sv}u)}"),
+	                                   contents, length, FALSE,
+	                                   g_free, contents);
+	g_variant_ref_sink (players);
+
+	g_variant_iter_init (&iter, players);
+	while (g_variant_iter_next (&iter, "{s@(a{sv}a{sv}u)}", &player, &state))
+		g_hash_table_insert (cache->players, player, state);
+
+	g_variant_unref (players);
+}
 
-		g_signal_emit (mpris2, signals[METADATA], 0, metadata);
+static void
+mpris2_state_cache_save (Mpris2StateCache *cache)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	GVariant *players;
+	GError *error = NULL;
+	gpointer player, state;
+	gchar *dirname;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(a{sv}a{sv}u)}"));
+	g_hash_table_iter_init (&iter, cache->players);
+	while (g_hash_table_iter_next (&iter, &player, &state))
+		g_variant_builder_add (&builder, "{s@(a{sv}a{sv}u)}", player, state);
+	players = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	dirname = g_path_get_dirname (cache->filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	if (!g_file_set_contents (cache->filename,
+	                          g_variant_get_data (players),
+	                          g_variant_get_size (players),
+	                          &error)) {
+		g_warning ("Could not save the state of the players: %s", error->message);
+		g_error_free (error);
 	}
 
-	if (playback_status != NULL) {
-		mpris2_client_parse_playback_status (mpris2, playback_status);
-		g_signal_emit (mpris2, signals[PLAYBACK_STATUS], 0, mpris2->playback_status);
+	g_variant_unref (players);
+}
+
+static gboolean
+mpris2_state_cache_save_cb (gpointer user_data)
+{
+	state_cache->save_id = 0;
+
+	mpris2_state_cache_save (state_cache);
+
+	return FALSE;
+}
+
+static void
+mpris2_state_cache_ref (void)
+{
+	if (state_cache != NULL) {
+		state_cache->ref_count++;
+		return;
 	}
 
-	if (volume != -1) {
-		mpris2->volume = volume;
-		g_signal_emit (mpris2, signals[VOLUME], 0, volume);
+	state_cache = g_slice_new0 (Mpris2StateCache);
+	state_cache->filename = g_build_filename (g_get_user_cache_dir (),
+	                                          "libmpris2client", "players.state",
+	                                          NULL);
+	state_cache->players = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                              g_free, (GDestroyNotify) g_variant_unref);
+	state_cache->ref_count = 1;
+
+	mpris2_state_cache_load (state_cache);
+}
+
+static void
+mpris2_state_cache_unref (void)
+{
+	if (--state_cache->ref_count > 0)
+		return;
+
+	if (state_cache->save_id != 0) {
+		g_source_remove (state_cache->save_id);
+		mpris2_state_cache_save (state_cache);
 	}
 
-	if (loop_status_changed) {
-		mpris2->has_loop_status = TRUE;
+	g_hash_table_destroy (state_cache->players);
+	g_free (state_cache->filename);
+	g_slice_free (Mpris2StateCache, state_cache);
+	state_cache = NULL;
+}
 
-		if (0 == g_ascii_strcasecmp(loop_status, "Track")) {
-			mpris2->loop_status = TRACK;
-		}
-		else if (0 == g_ascii_strcasecmp(loop_status, "Playlist")) {
-			mpris2->loop_status = PLAYLIST;
+/* The metadata as received, without the embedded data: art that would
+ * bloat the file, it comes back with GetAll. */
+
+static GVariant *
+mpris2_metadata_variant_for_state (GVariant *metadata)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+	g_variant_iter_init (&iter, metadata);
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "mpris:artUrl") &&
+		    g_variant_is_of_type (value, G_VARIANT_TYPE_STRING) &&
+		    g_str_has_prefix (g_variant_get_string (value, NULL), "data:"))
+			continue;
+		g_variant_builder_add (&builder, "{sv}", key, value);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+/* The same properties as GetAll, so they are restored by the same parsers. */
+
+static void
+mpris2_player_store_state (Mpris2Player *player)
+{
+	GVariantBuilder media_player, player_props;
+	GVariant *state;
+
+	if (!player->client->use_state_cache || player->player == NULL || player->provisional)
+		return;
+
+	g_variant_builder_init (&media_player, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&media_player, "{sv}", "CanQuit", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_QUIT)));
+	g_variant_builder_add (&media_player, "{sv}", "CanRaise", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_RAISE)));
+	g_variant_builder_add (&media_player, "{sv}", "CanSetFullscreen", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_SET_FULLSCREEN)));
+	g_variant_builder_add (&media_player, "{sv}", "HasTrackList", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_HAS_TRACKLIST)));
+	if (player->identity != NULL)
+		g_variant_builder_add (&media_player, "{sv}", "Identity", g_variant_new_string (player->identity));
+	if (player->desktop_entry != NULL)
+		g_variant_builder_add (&media_player, "{sv}", "DesktopEntry", g_variant_new_string (player->desktop_entry));
+	if (player->supported_uri_schemes != NULL)
+		g_variant_builder_add (&media_player, "{sv}", "SupportedUriSchemes",
+		                       g_variant_new_strv ((const gchar * const *) player->supported_uri_schemes, -1));
+	if (player->supported_mime_types != NULL)
+		g_variant_builder_add (&media_player, "{sv}", "SupportedMimeTypes",
+		                       g_variant_new_strv ((const gchar * const *) player->supported_mime_types, -1));
+
+	g_variant_builder_init (&player_props, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&player_props, "{sv}", "CanGoNext", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_GO_NEXT)));
+	g_variant_builder_add (&player_props, "{sv}", "CanGoPrevious", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_GO_PREVIOUS)));
+	g_variant_builder_add (&player_props, "{sv}", "CanPlay", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_PLAY)));
+	g_variant_builder_add (&player_props, "{sv}", "CanPause", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_PAUSE)));
+	g_variant_builder_add (&player_props, "{sv}", "CanSeek", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_SEEK)));
+	g_variant_builder_add (&player_props, "{sv}", "CanControl", g_variant_new_boolean (MPRIS2_PLAYER_CAN (player, MPRIS2_CAN_CONTROL)));
+	if (player->volume != -1)
+		g_variant_builder_add (&player_props, "{sv}", "Volume", g_variant_new_double (player->volume));
+	if (player->metadata_variant != NULL)
+		g_variant_builder_add (&player_props, "{sv}", "Metadata",
+		                       mpris2_metadata_variant_for_state (player->metadata_variant));
+
+	/* The status is restored apart, PlaybackStatus would ask for the position. */
+	state = g_variant_new ("(a{sv}a{sv}u)", &media_player, &player_props,
+	                       (guint32) player->playback_status);
+
+	g_hash_table_replace (state_cache->players,
+	                      g_strdup (player->player),
+	                      g_variant_ref_sink (state));
+
+	if (state_cache->save_id == 0)
+		state_cache->save_id = g_timeout_add_seconds (MPRIS2_CLIENT_STATE_SAVE_DELAY,
+		                                              mpris2_state_cache_save_cb,
+		                                              NULL);
+}
+
+/* Emit the last-known state right away, without any call to a player
+ * that may not even be running. Live data replaces it as it comes. */
+
+static void
+mpris2_player_restore_state (Mpris2Player *player)
+{
+	GVariant *state, *media_player, *player_props;
+	guint32 playback_status;
+
+	Mpris2Client *mpris2 = player->client;
+
+	if (!mpris2->use_state_cache || player->player == NULL || player->connected)
+		return;
+
+	state = g_hash_table_lookup (state_cache->players, player->player);
+	if (state == NULL)
+		return;
+
+	player->provisional = TRUE;
+	if (player == mpris2->current)
+		g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_PROVISIONAL]);
+
+	g_variant_get (state, "(@a{sv}@a{sv}u)", &media_player, &player_props, &playback_status);
+
+	mpris2_client_parse_media_player_properties (player, media_player);
+	mpris2_client_parse_player_properties (player, player_props);
+
+	if (playback_status < PLAYING || playback_status > STOPPED)
+		playback_status = STOPPED;
+	player->playback_status = playback_status;
+	if (player == mpris2->current)
+		g_signal_emit (mpris2, signals[PLAYBACK_STATUS], 0, player->playback_status);
+
+	g_variant_unref (media_player);
+	g_variant_unref (player_props);
+}
+
+/**
+ * mpris2_client_get_state_cache:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: TRUE if the last-known state of the players is kept on disk.
+ */
+gboolean
+mpris2_client_get_state_cache (Mpris2Client *mpris2)
+{
+	return mpris2->use_state_cache;
+}
+
+/**
+ * mpris2_client_set_state_cache:
+ * @mpris2: a #Mpris2Client
+ * @use_state_cache: TRUE to keep the last-known state of the players on disk.
+ *
+ * The identity, desktop entry, capabilities, metadata and volume of the
+ * players are saved under the user cache directory. When a player is
+ * set, its saved state is emitted at once, and replaced as soon as the
+ * player answers. See mpris2_client_is_provisional().
+ */
+void
+mpris2_client_set_state_cache (Mpris2Client *mpris2, gboolean use_state_cache)
+{
+	GList *l;
+
+	if (mpris2->use_state_cache == use_state_cache)
+		return;
+
+	if (use_state_cache) {
+		mpris2->use_state_cache = TRUE;
+		mpris2_state_cache_ref ();
+		mpris2_player_restore_state (mpris2->current);
+	}
+	else {
+		mpris2_player_store_state (mpris2->current);
+		for (l = mpris2->standby; l != NULL; l = l->next)
+			mpris2_player_store_state (l->data);
+		mpris2->use_state_cache = FALSE;
+		mpris2_state_cache_unref ();
+	}
+
+	g_object_notify_by_pspec (G_OBJECT (mpris2), properties[PROP_STATE_CACHE]);
+}
+
+/**
+ * mpris2_client_is_provisional:
+ * @mpris2: a #Mpris2Client
+ *
+ * Returns: TRUE if the state of the player comes from the state cache,
+ * and it has not answered yet.
+ */
+gboolean
+mpris2_client_is_provisional (Mpris2Client *mpris2)
+{
+	return mpris2->current->provisional;
+}
+
+/* Discovery of the players running on the bus. */
+
+/* Playing outweighs any past activity. */
+#define MPRIS2_CLIENT_PLAYING_SCORE (G_GINT64_CONSTANT (1) << 62)
+
+typedef struct {
+	gchar          *owner;
+	PlaybackStatus  playback_status;
+	gint64          last_playing;
+	gint64          last_command;
+} Mpris2PlayerActivity;
+
+typedef struct {
+	Mpris2Client   *client;
+	gchar          *player;
+} Mpris2PlayerProbe;
+
+static void
+mpris2_player_activity_free (Mpris2PlayerActivity *activity)
+{
+	g_free (activity->owner);
+	g_slice_free (Mpris2PlayerActivity, activity);
+}
+
+static void
+mpris2_client_set_player_owner (Mpris2Client *mpris2, const gchar *player, const gchar *owner)
+{
+	Mpris2PlayerActivity *activity;
+
+	activity = g_hash_table_lookup (mpris2->running_players, player);
+	if (activity == NULL || owner == NULL)
+		return;
+
+	if (activity->owner != NULL)
+		g_hash_table_remove (mpris2->player_owners, activity->owner);
+
+	g_free (activity->owner);
+	activity->owner = g_strdup (owner);
+
+	g_hash_table_insert (mpris2->player_owners, g_strdup (owner), g_strdup (player));
+}
+
+/* Allowed players may be given in order of preference, as rank. */
+
+static gboolean
+mpris2_client_player_is_allowed (Mpris2Client *mpris2, const gchar *player, guint *rank)
+{
+	guint i;
+
+	if (rank != NULL)
+		*rank = 0;
+
+	for (i = 0; mpris2->denied_players && mpris2->denied_players[i]; i++) {
+		if (g_pattern_match_simple (mpris2->denied_players[i], player))
+			return FALSE;
+	}
+
+	if (mpris2->allowed_players == NULL)
+		return TRUE;
+
+	for (i = 0; mpris2->allowed_players[i]; i++) {
+		if (g_pattern_match_simple (mpris2->allowed_players[i], player)) {
+			if (rank != NULL)
+				*rank = i;
+			return TRUE;
 		}
-		else {
-			mpris2->loop_status = NONE;
+	}
+
+	return FALSE;
+}
+
+static gint64
+mpris2_client_player_score (Mpris2Client *mpris2, const gchar *player)
+{
+	Mpris2PlayerActivity *activity;
+
+	activity = g_hash_table_lookup (mpris2->running_players, player);
+	if (activity == NULL)
+		return 0;
+
+	if (activity->playback_status == PLAYING)
+		return MPRIS2_CLIENT_PLAYING_SCORE + activity->last_playing;
+
+	return MAX (activity->last_playing, activity->last_command);
+}
+
+/* The allowed candidate with the best score, without any bus call. */
+
+static const gchar *
+mpris2_client_choose_player (Mpris2Client *mpris2, gchar **candidates)
+{
+	const gchar *best = NULL;
+	gint64 score, best_score = -1;
+	guint i, rank, best_rank = 0;
+
+	for (i = 0; candidates != NULL && candidates[i] != NULL; i++) {
+		if (!mpris2_client_player_is_allowed (mpris2, candidates[i], &rank))
+			continue;
+
+		score = mpris2_client_player_score (mpris2, candidates[i]);
+		if (score > best_score || (score == best_score && rank < best_rank)) {
+			best = candidates[i];
+			best_score = score;
+			best_rank = rank;
 		}
-		g_signal_emit (mpris2, signals[LOOP_STATUS], 0, mpris2->loop_status);
 	}
-	if (shuffle_changed) {
-		mpris2->has_shuffle = TRUE;
 
-		mpris2->shuffle = shuffle;
-		g_signal_emit (mpris2, signals[SHUFFLE], 0, shuffle);
+	return best;
+}
+
+/* Remember the player last commanded by the user of the client. */
+
+static void
+mpris2_client_note_command (Mpris2Client *mpris2)
+{
+	Mpris2PlayerActivity *activity;
+
+	if (mpris2->current->player == NULL)
+		return;
+
+	activity = g_hash_table_lookup (mpris2->running_players, mpris2->current->player);
+	if (activity != NULL)
+		activity->last_command = g_get_monotonic_time ();
+}
+
+static void
+mpris2_client_update_activity (Mpris2Client *mpris2, const gchar *player, const gchar *playback_status)
+{
+	Mpris2PlayerActivity *activity;
+	PlaybackStatus status;
+
+	activity = g_hash_table_lookup (mpris2->running_players, player);
+	if (activity == NULL)
+		return;
+
+	if (0 == g_ascii_strcasecmp (playback_status, "Playing"))
+		status = PLAYING;
+	else if (0 == g_ascii_strcasecmp (playback_status, "Paused"))
+		status = PAUSED;
+	else
+		status = STOPPED;
+
+	if (status == activity->playback_status)
+		return;
+
+	/* Both starting and stopping to play count as recent playing. */
+	if (status == PLAYING || activity->playback_status == PLAYING)
+		activity->last_playing = g_get_monotonic_time ();
+	activity->playback_status = status;
+
+	if (mpris2->auto_switch && status == PLAYING &&
+	    g_strcmp0 (mpris2->current->player, player) != 0 &&
+	    mpris2_client_player_is_allowed (mpris2, player, NULL))
+		mpris2_client_set_player (mpris2, player);
+}
+
+static void
+mpris2_client_on_players_properties_changed (const gchar *sender_name,
+                                             const gchar *object_path,
+                                             const gchar *interface_name,
+                                             const gchar *signal_name,
+                                             GVariant    *parameters,
+                                             gpointer     user_data)
+{
+	GVariant *changed, *value;
+	const gchar *player;
+
+	Mpris2Client *mpris2 = user_data;
+
+	player = g_hash_table_lookup (mpris2->player_owners, sender_name);
+	if (player == NULL)
+		return;
+
+	changed = g_variant_get_child_value (parameters, 1);
+	value = g_variant_lookup_value (changed, "PlaybackStatus", G_VARIANT_TYPE_STRING);
+	if (value != NULL) {
+		mpris2_client_update_activity (mpris2, player, g_variant_get_string (value, NULL));
+		g_variant_unref (value);
 	}
+	g_variant_unref (changed);
 }
 
+/* Players already running when the watch starts: the reply tells both
+ * its status and its unique name, so its signals can be followed. */
+
 static void
-mpris2_client_parse_media_player_properties (Mpris2Client *mpris2, GVariant *properties)
+mpris2_client_probe_player_ready (GVariant     *reply,
+                                  const gchar  *sender,
+                                  const GError *error,
+                                  gpointer      user_data)
 {
-	GVariantIter iter;
 	GVariant *value;
-	const gchar *key;
+	Mpris2PlayerProbe *probe = user_data;
 
-	g_variant_iter_init (&iter, properties);
+	if (reply != NULL) {
+		mpris2_client_set_player_owner (probe->client, probe->player, sender);
 
-	while (g_variant_iter_loop (&iter, "{sv}", &key, &value)) {
-		if (0 == g_ascii_strcasecmp (key, "CanQuit")) {
-			mpris2->can_quit = g_variant_get_boolean (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "Fullscreen")) {
-			mpris2->fullscreen = g_variant_get_boolean (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanSetFullscreen")) {
-			mpris2->can_set_fullscreen = g_variant_get_boolean (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "CanRaise")) {
-			mpris2->can_raise = g_variant_get_boolean (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "HasTrackList")) {
-			mpris2->has_tracklist = g_variant_get_boolean (value);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "Identity")) {
-			if (mpris2->identity)
-				g_free (mpris2->identity);
-			mpris2->identity = g_variant_dup_string (value, NULL);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "DesktopEntry")) {
-			if (mpris2->desktop_entry)
-				g_free (mpris2->desktop_entry);
-			mpris2->desktop_entry = g_variant_dup_string (value, NULL);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "SupportedUriSchemes")) {
-			if (mpris2->supported_uri_schemes)
-				g_strfreev (mpris2->supported_uri_schemes);
-			mpris2->supported_uri_schemes = g_variant_dup_strv (value, NULL);
-		}
-		else if (0 == g_ascii_strcasecmp (key, "SupportedMimeTypes")) {
-			if (mpris2->supported_mime_types)
-				g_strfreev (mpris2->supported_mime_types);
-			mpris2->supported_mime_types = g_variant_dup_strv (value, NULL);
-		}
+		g_variant_get (reply, "(v)", &value);
+		if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+			mpris2_client_update_activity (probe->client, probe->player,
+			                               g_variant_get_string (value, NULL));
+		g_variant_unref (value);
 	}
+
+	g_object_unref (probe->client);
+	g_free (probe->player);
+	g_slice_free (Mpris2PlayerProbe, probe);
 }
 
 static void
-mpris2_client_on_dbus_props_signal (GDBusProxy *proxy,
-                                    gchar      *sender_name,
-                                    gchar      *signal_name,
-                                    GVariant   *parameters,
-                                    gpointer    user_data)
+mpris2_client_probe_player (Mpris2Client *mpris2, const gchar *player)
 {
-	GVariantIter iter;
-	GVariant *child;
+	Mpris2PlayerProbe *probe;
+	gchar *dbus_name;
+
+	probe = g_slice_new0 (Mpris2PlayerProbe);
+	probe->client = g_object_ref (mpris2);
+	probe->player = g_strdup (player);
+
+	dbus_name = g_strdup_printf ("org.mpris.MediaPlayer2.%s", player);
+	mpris2_transport_call (mpris2->transport,
+	                       dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "Get",
+	                       g_variant_new ("(ss)",
+	                                      "org.mpris.MediaPlayer2.Player",
+	                                      "PlaybackStatus"),
+	                       G_VARIANT_TYPE ("(v)"),
+	                       NULL,
+	                       mpris2_client_probe_player_ready,
+	                       probe);
+	g_free (dbus_name);
+}
 
-	Mpris2Client *mpris2 = user_data;
+static void
+mpris2_client_player_appeared (Mpris2Client *mpris2, const gchar *player, const gchar *owner)
+{
+	Mpris2PlayerActivity *activity;
 
-	if (g_ascii_strcasecmp (signal_name, "PropertiesChanged"))
+	if (g_hash_table_lookup (mpris2->running_players, player) != NULL)
 		return;
 
-	g_variant_iter_init (&iter, parameters);
+	activity = g_slice_new0 (Mpris2PlayerActivity);
+	activity->playback_status = STOPPED;
+	g_hash_table_insert (mpris2->running_players, g_strdup (player), activity);
 
-	child = g_variant_iter_next_value (&iter); /* Interface name. */
-	g_variant_unref (child);
+	if (owner != NULL)
+		mpris2_client_set_player_owner (mpris2, player, owner);
+	else
+		mpris2_client_probe_player (mpris2, player);
 
-	child = g_variant_iter_next_value (&iter); /* Property name. */
-	mpris2_client_parse_player_properties (mpris2, child);
-	g_variant_unref (child);
+	g_signal_emit (mpris2, signals[PLAYER_APPEARED], 0, player);
 }
 
 static void
-mpris2_client_on_dbus_player_signal (GDBusProxy *proxy,
-                                     gchar      *sender_name,
-                                     gchar      *signal_name,
-                                     GVariant   *parameters,
-                                     gpointer    user_data)
+mpris2_client_player_vanished (Mpris2Client *mpris2, const gchar *player)
 {
-	GVariantIter iter;
-	GVariant *child;
+	Mpris2PlayerActivity *activity;
+
+	activity = g_hash_table_lookup (mpris2->running_players, player);
+	if (activity == NULL)
+		return;
+
+	if (activity->owner != NULL)
+		g_hash_table_remove (mpris2->player_owners, activity->owner);
+	g_hash_table_remove (mpris2->running_players, player);
+
+	g_signal_emit (mpris2, signals[PLAYER_VANISHED], 0, player);
+}
+
+static void
+mpris2_client_on_name_owner_changed (const gchar *sender_name,
+                                     const gchar *object_path,
+                                     const gchar *interface_name,
+                                     const gchar *signal_name,
+                                     GVariant    *parameters,
+                                     gpointer     user_data)
+{
+	const gchar *name, *old_owner, *new_owner;
 
 	Mpris2Client *mpris2 = user_data;
 
-	if (g_ascii_strcasecmp (signal_name, "Seeked"))
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+
+	if (!g_str_has_prefix (name, "org.mpris.MediaPlayer2."))
 		return;
 
-	g_variant_iter_init (&iter, parameters);
+	if (old_owner[0] != '\0')
+		mpris2_client_player_vanished (mpris2, name + 23);
+	if (new_owner[0] != '\0')
+		mpris2_client_player_appeared (mpris2, name + 23, new_owner);
+}
 
-	child = g_variant_iter_next_value (&iter);
+static void
+mpris2_client_watch_players_ready (GVariant     *reply,
+                                   const gchar  *sender,
+                                   const GError *error,
+                                   gpointer      user_data)
+{
+	gchar **players;
+	guint i;
 
-	mpris2->position = g_variant_get_int64 (child);
-	g_signal_emit (mpris2, signals[PLAYBACK_TICK], 0, mpris2->position);
+	Mpris2Client *mpris2 = user_data;
 
-	g_variant_unref (child);
+	if (reply == NULL) {
+		g_warning ("Could not get a list of names registered on the session bus, %s",
+		           error->message);
+	}
+	else {
+		players = mpris2_client_parse_player_names (reply);
+		for (i = 0; players != NULL && players[i] != NULL; i++)
+			mpris2_client_player_appeared (mpris2, players[i], NULL);
+
+		g_strfreev (players);
+	}
+
+	mpris2->players_listed = TRUE;
+
+	g_object_unref (mpris2);
+}
+
+static void
+mpris2_client_watch_players_dbus (Mpris2Client *mpris2)
+{
+	/* Subscribe first, so no player is missed until ListNames replies. */
+	mpris2->name_owner_changed_id =
+		mpris2_transport_signal_subscribe (mpris2->transport,
+		                                   "org.freedesktop.DBus",
+		                                   "org.freedesktop.DBus",
+		                                   "NameOwnerChanged",
+		                                   "/org/freedesktop/DBus",
+		                                   NULL,
+		                                   mpris2_client_on_name_owner_changed,
+		                                   mpris2);
+
+	/* A single match for the playback status of every player. */
+	mpris2->properties_changed_id =
+		mpris2_transport_signal_subscribe (mpris2->transport,
+		                                   NULL,
+		                                   "org.freedesktop.DBus.Properties",
+		                                   "PropertiesChanged",
+		                                   "/org/mpris/MediaPlayer2",
+		                                   "org.mpris.MediaPlayer2.Player",
+		                                   mpris2_client_on_players_properties_changed,
+		                                   mpris2);
+
+	mpris2_transport_call (mpris2->transport,
+	                       "org.freedesktop.DBus",
+	                       "/org/freedesktop/DBus",
+	                       "org.freedesktop.DBus",
+	                       "ListNames",
+	                       NULL,
+	                       G_VARIANT_TYPE ("(as)"),
+	                       NULL,
+	                       mpris2_client_watch_players_ready,
+	                       g_object_ref (mpris2));
 }
 
 /* Functions that detect when the player is connected to mpris2 */
 
 static void
-mpris2_client_connected_dbus (GDBusConnection *connection,
-                              const gchar *name,
+mpris2_client_connected_dbus (const gchar *name,
                               const gchar *name_owner,
-                              gpointer user_data)
+                              gpointer     user_data)
 {
-	GVariant *reply;
+	Mpris2Player *player = user_data;
+	Mpris2Transport *transport = player->client->transport;
+	guint i, removed;
 
-	Mpris2Client *mpris2 = user_data;
+	/* The tracks of the previous owner are not valid anymore. */
+	removed = mpris2_player_get_n_tracks (player);
+	mpris2_client_disconnect_dbus (player);
+	mpris2_client_emit_tracklist_changed (player, 0, removed, 0);
+
+	player->cancellable = g_cancellable_new ();
+
+	/* The commands are prepared now, so a key press only copies them. */
+	player->commands = g_new0 (Mpris2TransportMessage *, G_N_ELEMENTS (player_commands));
+	for (i = 0; player_commands[i] != NULL; i++)
+		player->commands[i] = mpris2_transport_message_new (transport,
+		                                                    name_owner,
+		                                                    "/org/mpris/MediaPlayer2",
+		                                                    "org.mpris.MediaPlayer2.Player",
+		                                                    player_commands[i]);
+
+	/* Signals are matched on the unique name, so a new owner needs new matches. */
 
-	mpris2->connected = TRUE;
+	/* interface=org.freedesktop.DBus.Properties */
+	player->props_changed_id =
+		mpris2_transport_signal_subscribe (transport,
+		                                   name_owner,
+		                                   "org.freedesktop.DBus.Properties",
+		                                   "PropertiesChanged",
+		                                   "/org/mpris/MediaPlayer2",
+		                                   NULL,
+		                                   mpris2_client_on_dbus_props_signal,
+		                                   player);
+
+	/* interface=org.mpris.MediaPlayer2.Player */
+	player->seeked_id =
+		mpris2_transport_signal_subscribe (transport,
+		                                   name_owner,
+		                                   "org.mpris.MediaPlayer2.Player",
+		                                   "Seeked",
+		                                   "/org/mpris/MediaPlayer2",
+		                                   NULL,
+		                                   mpris2_client_on_dbus_seeked_signal,
+		                                   player);
+
+	/* interface=org.mpris.MediaPlayer2.TrackList */
+	player->tracklist_signals_id =
+		mpris2_transport_signal_subscribe (transport,
+		                                   name_owner,
+		                                   "org.mpris.MediaPlayer2.TrackList",
+		                                   NULL,
+		                                   "/org/mpris/MediaPlayer2",
+		                                   NULL,
+		                                   mpris2_client_on_dbus_tracklist_signal,
+		                                   player);
+
+	/* interface=org.mpris.MediaPlayer2.Playlists */
+	player->playlists_signal_id =
+		mpris2_transport_signal_subscribe (transport,
+		                                   name_owner,
+		                                   "org.mpris.MediaPlayer2.Playlists",
+		                                   "PlaylistChanged",
+		                                   "/org/mpris/MediaPlayer2",
+		                                   NULL,
+		                                   mpris2_client_on_dbus_playlists_signal,
+		                                   player);
 
 	/* First check basic props of the player as identify, uris, etc. */
-	reply = mpris2_client_get_all_media_player_properties (mpris2);
-	mpris2_client_parse_media_player_properties (mpris2, reply);
-	g_variant_unref (reply);
+	mpris2_transport_call (transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_get_all_media_player_ready,
+	                       player);
+}
 
-	/* Notify that connect to a player.*/
-	g_signal_emit (mpris2, signals[CONNECTION], 0, mpris2->connected);
+static void
+mpris2_client_lose_dbus (const gchar *name,
+                         const gchar *name_owner,
+                         gpointer     user_data)
+{
+	Mpris2Player *player = user_data;
+	guint removed;
+
+	removed = mpris2_player_get_n_tracks (player);
+	mpris2_client_disconnect_dbus (player);
+	mpris2_player_reset (player);
+	mpris2_client_emit_tracklist_changed (player, 0, removed, 0);
+
+	if (player == player->client->current) {
+		mpris2_client_update_playback_timer (player->client);
+		mpris2_client_emit_connection (player->client, player->connected);
+		mpris2_client_emit_changed (player, MPRIS2_CHANGED_ALL);
+	}
+}
 
-	/* And informs the current status of the player */
-	reply = mpris2_client_get_all_player_properties (mpris2);
-	mpris2_client_parse_player_properties (mpris2, reply);
-	g_variant_unref (reply);
+/* Drop the signal matches and the pending calls of a player. */
+
+static void
+mpris2_client_disconnect_dbus (Mpris2Player *player)
+{
+	Mpris2Transport *transport = player->client->transport;
+	guint i;
+
+	if (player->commands != NULL) {
+		for (i = 0; player_commands[i] != NULL; i++)
+			mpris2_transport_message_free (transport, player->commands[i]);
+		g_free (player->commands);
+		player->commands = NULL;
+	}
+	if (player->cancellable != NULL) {
+		g_cancellable_cancel (player->cancellable);
+		g_object_unref (player->cancellable);
+		player->cancellable = NULL;
+	}
+	if (player->refetch_id != 0) {
+		g_source_remove (player->refetch_id);
+		player->refetch_id = 0;
+	}
+	player->invalidated = 0;
+	if (player->props_changed_id != 0) {
+		mpris2_transport_signal_unsubscribe (transport, player->props_changed_id);
+		player->props_changed_id = 0;
+	}
+	if (player->seeked_id != 0) {
+		mpris2_transport_signal_unsubscribe (transport, player->seeked_id);
+		player->seeked_id = 0;
+	}
+	if (player->tracklist_signals_id != 0) {
+		mpris2_transport_signal_unsubscribe (transport, player->tracklist_signals_id);
+		player->tracklist_signals_id = 0;
+	}
+	if (player->playlists_signal_id != 0) {
+		mpris2_transport_signal_unsubscribe (transport, player->playlists_signal_id);
+		player->playlists_signal_id = 0;
+	}
+	mpris2_player_drop_tracklist (player);
+	mpris2_player_drop_playlists (player);
 }
 
 static void
-mpris2_client_lose_dbus (GDBusConnection *connection,
-                         const gchar *name,
-                         gpointer user_data)
+mpris2_client_connect_dbus (Mpris2Player *player)
 {
-	Mpris2Client *mpris2 = user_data;
+	Mpris2Client *mpris2 = player->client;
 
-	/* Interface MediaPlayer2 */
+	if (player->player == NULL || player->watch_id != 0)
+		return;
+
+	/* Connected later, when the session bus is ready. */
+	if (mpris2->transport == NULL)
+		return;
+
+	/* The signals are matched when the name appears on the bus. */
+	player->watch_id = mpris2_transport_watch_name (mpris2->transport,
+	                                                player->dbus_name,
+	                                                mpris2_client_connected_dbus,
+	                                                mpris2_client_lose_dbus,
+	                                                player);
+}
+
+/*
+ * Players.
+ */
+
+/* Forget everything known about the player, as when it leaves the bus. */
+
+static void
+mpris2_player_reset (Mpris2Player *player)
+{
+	player->capabilities    = 0;
 
-	mpris2->can_quit        = FALSE;
-	mpris2->can_raise       = FALSE;
-	mpris2->has_tracklist   = FALSE;
-	if (mpris2->identity) {
-		g_free (mpris2->identity);
-		mpris2->identity = NULL;
+	/* Interface MediaPlayer2 */
+	if (player->identity) {
+		g_free (player->identity);
+		player->identity = NULL;
 	}
-	if (mpris2->supported_uri_schemes) {
-		g_strfreev(mpris2->supported_uri_schemes);
-		mpris2->supported_uri_schemes = NULL;
+	if (player->supported_uri_schemes) {
+		g_strfreev(player->supported_uri_schemes);
+		player->supported_uri_schemes = NULL;
 	}
-	if (mpris2->supported_mime_types) {
-		g_strfreev(mpris2->supported_mime_types);
-		mpris2->supported_mime_types = NULL;
+	if (player->supported_mime_types) {
+		g_strfreev(player->supported_mime_types);
+		player->supported_mime_types = NULL;
 	}
+	mpris2_player_drop_indexes (player);
 
 	/* Optionals Interface MediaPlayer2 */
-	mpris2->can_set_fullscreen = FALSE;
-	if (mpris2->desktop_entry) {
-		g_free (mpris2->desktop_entry);
-		mpris2->desktop_entry = NULL;
+	player->fullscreen         = FALSE;
+	if (player->desktop_entry) {
+		g_free (player->desktop_entry);
+		player->desktop_entry = NULL;
 	}
 
 	/* Interface MediaPlayer2.Player */
-	mpris2->playback_status = STOPPED;
-	mpris2->rate            = 1.0;
-	if (mpris2->metadata != NULL) {
-		mpris2_metadata_free (mpris2->metadata);
-		mpris2->metadata = NULL;
-	}
-	mpris2->volume          = -1;
-	mpris2->position        = 0;
-	mpris2->minimum_rate    = 1.0;
-	mpris2->maximum_rate    = 1.0;
-	mpris2->can_go_next     = FALSE;
-	mpris2->can_go_previous = FALSE;
-	mpris2->can_play        = FALSE;
-	mpris2->can_pause       = FALSE;
-	mpris2->can_seek        = FALSE;
-	mpris2->can_control     = FALSE;
+	player->playback_status = STOPPED;
+	player->rate            = 1.0;
+	mpris2_player_set_metadata (player, NULL);
+	player->volume          = -1;
+	player->position        = 0;
+	player->position_time   = 0;
+	player->minimum_rate    = 1.0;
+	player->maximum_rate    = 1.0;
 
 	/* Optionals Interface MediaPlayer2.Player */
-	mpris2->has_loop_status = FALSE;
-	mpris2->has_shuffle     = FALSE;
+	player->loop_status     = NONE;
+	player->shuffle         = FALSE;
+
+	/* Optional interface MediaPlayer2.Playlists */
+	player->playlist_count     = 0;
+	player->playlist_orderings = 0;
+	mpris2_player_set_active_playlist (player, NULL);
+
+	player->connected = FALSE;
+	player->provisional = FALSE;
+}
+
+static Mpris2Player *
+mpris2_player_new (Mpris2Client *mpris2, const gchar *name)
+{
+	Mpris2Player *player;
+
+	player = g_slice_new0 (Mpris2Player);
+
+	player->client = mpris2;
+	player->player = g_strdup (name);
+	if (name != NULL)
+		player->dbus_name = g_strdup_printf ("org.mpris.MediaPlayer2.%s", name);
+
+	mpris2_player_reset (player);
+
+	player->playlists_generation = ++mpris2->playlists_generation;
+
+	return player;
+}
+
+static void
+mpris2_player_free (Mpris2Player *player)
+{
+	if (player->watch_id) {
+		mpris2_transport_unwatch_name (player->client->transport, player->watch_id);
+		player->watch_id = 0;
+	}
+	mpris2_client_disconnect_dbus (player);
+	mpris2_player_reset (player);
+
+	g_free (player->player);
+	g_free (player->dbus_name);
+
+	g_slice_free (Mpris2Player, player);
+}
+
+/* Forget the least recently used players beyond the standby size. */
+
+static void
+mpris2_client_trim_standby (Mpris2Client *mpris2)
+{
+	GList *last;
 
-	mpris2->connected = FALSE;
-	g_signal_emit (mpris2, signals[CONNECTION], 0, mpris2->connected);
+	while (g_list_length (mpris2->standby) > mpris2->standby_size) {
+		last = g_list_last (mpris2->standby);
+		mpris2_player_free (last->data);
+		mpris2->standby = g_list_delete_link (mpris2->standby, last);
+	}
 }
 
 static void
-mpris2_client_connect_dbus (Mpris2Client *mpris2)
+mpris2_client_revalidate_media_player_ready (GVariant     *reply,
+                                             const gchar  *sender,
+                                             const GError *error,
+                                             gpointer      user_data)
 {
-	GDBusProxy *proxy;
-	GError     *gerror = NULL;
-	guint       watch_id;
+	GVariant *properties;
+	gboolean cancelled;
 
-	if (mpris2->player == NULL)
+	properties = mpris2_client_get_all_finish (reply, error, &cancelled);
+	if (cancelled)
 		return;
 
-	g_free(mpris2->dbus_name);
-	mpris2->dbus_name = g_strdup_printf("org.mpris.MediaPlayer2.%s", mpris2->player);
+	if (properties != NULL) {
+		mpris2_client_parse_media_player_properties (user_data, properties);
+		g_variant_unref (properties);
+	}
+}
+
+/* A player back from standby tells its state at once, as known so far,
+ * and it is checked again in the background. */
 
-	watch_id = g_bus_watch_name_on_connection(mpris2->gconnection,
-	                                          mpris2->dbus_name,
-	                                          G_BUS_NAME_OWNER_FLAGS_REPLACE,
-	                                          mpris2_client_connected_dbus,
-	                                          mpris2_client_lose_dbus,
-	                                          mpris2,
-	                                          NULL);
+static void
+mpris2_client_resume_player (Mpris2Client *mpris2, gboolean was_connected)
+{
+	Mpris2Player *player = mpris2->current;
 
-	/* interface=org.freedesktop.DBus.Properties */
-	proxy = g_dbus_proxy_new_sync (mpris2->gconnection,
-	                               G_DBUS_PROXY_FLAGS_NONE,
-	                               NULL,
-	                               mpris2->dbus_name,
-	                               "/org/mpris/MediaPlayer2",
-	                               "org.freedesktop.DBus.Properties",
-	                               NULL, /* GCancellable */
-	                               &gerror);
-
-	if (proxy == NULL) {
-		g_printerr ("Error creating proxy: %s\n", gerror->message);
-		g_error_free (gerror);
-		gerror = NULL;
-    }
-    else {
-		g_signal_connect (proxy, "g-signal",
-			              G_CALLBACK (mpris2_client_on_dbus_props_signal), mpris2);
-		mpris2->props_proxy = proxy;
+	if (player->connected || was_connected)
+		mpris2_client_emit_connection (mpris2, player->connected);
+
+	if (!player->connected) {
+		if (was_connected)
+			mpris2_client_emit_changed (player, MPRIS2_CHANGED_ALL);
+		return;
 	}
 
-	/* interface=org.mpris.MediaPlayer2.Player */
-	proxy = g_dbus_proxy_new_sync (mpris2->gconnection,
-	                               G_DBUS_PROXY_FLAGS_NONE,
-	                               NULL,
-	                               mpris2->dbus_name,
-	                               "/org/mpris/MediaPlayer2",
-	                               "org.mpris.MediaPlayer2.Player",
-	                               NULL, /* GCancellable */
-	                               &gerror);
+	if (player->metadata_variant != NULL && mpris2_client_wants (mpris2, MPRIS2_INTEREST_METADATA))
+		g_signal_emit (mpris2, signals[METADATA], 0, mpris2_player_get_metadata (player));
+	g_signal_emit (mpris2, signals[PLAYBACK_STATUS], 0, player->playback_status);
+	mpris2_client_emit_changed (player, MPRIS2_CHANGED_ALL);
+
+	mpris2_client_update_playback_timer (mpris2);
+
+	mpris2_transport_call (mpris2->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_revalidate_media_player_ready,
+	                       player);
+
+	mpris2_transport_call (mpris2->transport,
+	                       player->dbus_name,
+	                       "/org/mpris/MediaPlayer2",
+	                       "org.freedesktop.DBus.Properties",
+	                       "GetAll",
+	                       g_variant_new ("(s)", "org.mpris.MediaPlayer2.Player"),
+	                       G_VARIANT_TYPE ("(a{sv})"),
+	                       player->cancellable,
+	                       mpris2_client_get_all_player_ready,
+	                       player);
+}
+
+/* Start using the bus, for whatever was asked before it was ready. */
+
+static void
+mpris2_client_set_transport (Mpris2Client *mpris2, Mpris2Transport *transport)
+{
+	mpris2->transport = mpris2_transport_ref (transport);
+
+	if (mpris2->watch_players)
+		mpris2_client_watch_players_dbus (mpris2);
+
+	/* Players set before, on standby too. */
+	g_list_foreach (mpris2->standby, (GFunc) mpris2_client_connect_dbus, NULL);
+
+	if (mpris2->current->player != NULL)
+		mpris2_client_connect_dbus (mpris2->current);
+	else if (mpris2->auto_connect_pending)
+		mpris2_client_auto_connect_async (mpris2);
+
+	mpris2->auto_connect_pending = FALSE;
+}
+
+/* The blocking functions keep their contract, and don't wait the bus. */
+
+static gboolean
+mpris2_client_ensure_transport (Mpris2Client *mpris2)
+{
+	Mpris2Transport *transport;
+	GError *error = NULL;
+
+	if (mpris2->transport != NULL)
+		return TRUE;
 
-	if (proxy == NULL) {
-		g_printerr ("Error creating proxy: %s\n", gerror->message);
-		g_error_free (gerror);
-		gerror = NULL;
-    }
-    else {
-		g_signal_connect (proxy, "g-signal",
-			              G_CALLBACK (mpris2_client_on_dbus_player_signal), mpris2);
-		mpris2->player_proxy = proxy;
+	transport = mpris2_transport_new_session_sync (&error);
+	if (transport == NULL) {
+		g_message ("Failed to get session bus: %s", error->message);
+		g_error_free (error);
+		return FALSE;
 	}
 
-	mpris2->watch_id = watch_id;
+	mpris2_client_set_transport (mpris2, transport);
+	mpris2_transport_unref (transport);
+
+	return TRUE;
 }
 
+/* Got meanwhile by a blocking function, see mpris2_client_ensure_transport(). */
+
 static void
-mpris2_client_finalize (GObject *object)
+mpris2_client_bus_ready (Mpris2Transport *transport,
+                         const GError    *error,
+                         gpointer         user_data)
 {
-	Mpris2Client *mpris2 = MPRIS2_CLIENT (object);
+	Mpris2Client *mpris2 = user_data;
 
-	if (mpris2->player != NULL) {
-		g_free (mpris2->player);
-		mpris2->player = NULL;
+	if (mpris2->transport != NULL) {
+		/* Already in use. */
 	}
-	if (mpris2->dbus_name) {
-		g_free (mpris2->dbus_name);
-		mpris2->dbus_name = NULL;
+	else if (transport == NULL) {
+		g_message ("Failed to get session bus: %s", error->message);
+		mpris2->auto_connect_pending = FALSE;
 	}
-
-	if (mpris2->identity) {
-		g_free (mpris2->identity);
-		mpris2->identity    = NULL;
+	else {
+		mpris2_client_set_transport (mpris2, transport);
 	}
-	if (mpris2->desktop_entry) {
-		g_free (mpris2->desktop_entry);
-		mpris2->desktop_entry = NULL;
+
+	g_object_unref (mpris2);
+}
+
+static void
+mpris2_client_finalize (GObject *object)
+{
+	Mpris2Client *mpris2 = MPRIS2_CLIENT (object);
+
+	if (mpris2->playback_timer_id > 0) {
+		g_source_remove (mpris2->playback_timer_id);
+		mpris2->playback_timer_id = 0;
 	}
-	if (mpris2->supported_uri_schemes) {
-		g_strfreev(mpris2->supported_uri_schemes);
-		mpris2->supported_uri_schemes = NULL;
+
+	mpris2_player_free (mpris2->current);
+	mpris2->current = NULL;
+
+	g_list_free_full (mpris2->standby, (GDestroyNotify) mpris2_player_free);
+	mpris2->standby = NULL;
+
+	if (mpris2->name_owner_changed_id) {
+		mpris2_transport_signal_unsubscribe (mpris2->transport,
+		                                     mpris2->name_owner_changed_id);
+		mpris2->name_owner_changed_id = 0;
 	}
-	if (mpris2->supported_mime_types) {
-		g_strfreev(mpris2->supported_mime_types);
-		mpris2->supported_mime_types = NULL;
+	if (mpris2->properties_changed_id) {
+		mpris2_transport_signal_unsubscribe (mpris2->transport,
+		                                     mpris2->properties_changed_id);
+		mpris2->properties_changed_id = 0;
 	}
+	g_hash_table_destroy (mpris2->player_owners);
+	g_hash_table_destroy (mpris2->running_players);
 
-	if (mpris2->metadata != NULL) {
-		mpris2_metadata_free (mpris2->metadata);
-		mpris2->metadata = NULL;
+	g_strfreev (mpris2->allowed_players);
+	g_strfreev (mpris2->denied_players);
+
+	if (mpris2->use_state_cache)
+		mpris2_state_cache_unref ();
+
+	if (mpris2->transport != NULL) {
+		mpris2_transport_unref (mpris2->transport);
+		mpris2->transport = NULL;
 	}
 
 	(*G_OBJECT_CLASS (mpris2_client_parent_class)->finalize) (object);
 }
 
+static void
+mpris2_client_get_property (GObject    *object,
+                            guint       prop_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+	Mpris2Client *mpris2 = MPRIS2_CLIENT (object);
+	Mpris2Player *player = mpris2->current;
+
+	switch (prop_id) {
+		case PROP_PLAYER:
+			g_value_set_string (value, player->player);
+			break;
+		case PROP_STANDBY_SIZE:
+			g_value_set_uint (value, mpris2->standby_size);
+			break;
+		case PROP_STRICT_MODE:
+			g_value_set_boolean (value, mpris2->strict_mode);
+			break;
+		case PROP_AUTO_SWITCH:
+			g_value_set_boolean (value, mpris2->auto_switch);
+			break;
+		case PROP_ALLOWED_PLAYERS:
+			g_value_set_boxed (value, mpris2->allowed_players);
+			break;
+		case PROP_DENIED_PLAYERS:
+			g_value_set_boxed (value, mpris2->denied_players);
+			break;
+		case PROP_STATE_CACHE:
+			g_value_set_boolean (value, mpris2->use_state_cache);
+			break;
+		case PROP_INTEREST:
+			g_value_set_uint (value, mpris2->interest);
+			break;
+		case PROP_TRACKS_FETCH_WINDOW:
+			g_value_set_uint (value, mpris2->tracks_fetch_window);
+			break;
+		case PROP_CONNECTED:
+			g_value_set_boolean (value, player->connected);
+			break;
+		case PROP_PROVISIONAL:
+			g_value_set_boolean (value, player->provisional);
+			break;
+		case PROP_PLAYBACK_STATUS:
+			g_value_set_int (value, player->playback_status);
+			break;
+		case PROP_LOOP_STATUS:
+			g_value_set_int (value, player->loop_status);
+			break;
+		case PROP_RATE:
+			g_value_set_double (value, player->rate);
+			break;
+		case PROP_SHUFFLE:
+			g_value_set_boolean (value, player->shuffle);
+			break;
+		case PROP_METADATA:
+			g_value_set_pointer (value, mpris2_player_get_metadata (player));
+			break;
+		case PROP_VOLUME:
+			g_value_set_double (value, player->volume);
+			break;
+		case PROP_POSITION:
+			g_value_set_int (value, mpris2_player_get_position (player));
+			break;
+		case PROP_MINIMUM_RATE:
+			g_value_set_double (value, player->minimum_rate);
+			break;
+		case PROP_MAXIMUM_RATE:
+			g_value_set_double (value, player->maximum_rate);
+			break;
+		case PROP_CAPABILITIES:
+			g_value_set_uint (value, player->capabilities);
+			break;
+		case PROP_FULLSCREEN:
+			g_value_set_boolean (value, player->fullscreen);
+			break;
+		case PROP_IDENTITY:
+			g_value_set_string (value, player->identity);
+			break;
+		case PROP_DESKTOP_ENTRY:
+			g_value_set_string (value, player->desktop_entry);
+			break;
+		case PROP_SUPPORTED_URI_SCHEMES:
+			g_value_set_boxed (value, player->supported_uri_schemes);
+			break;
+		case PROP_SUPPORTED_MIME_TYPES:
+			g_value_set_boxed (value, player->supported_mime_types);
+			break;
+		case PROP_ACTIVE_PLAYLIST:
+			g_value_set_pointer (value, player->active_playlist);
+			break;
+		case PROP_PLAYLIST_COUNT:
+			g_value_set_uint (value, player->playlist_count);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+			break;
+	}
+}
+
+/* The properties of the player are asked to it, and notified once it
+ * reports the change. */
+
+static void
+mpris2_client_set_property (GObject      *object,
+                            guint         prop_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+	Mpris2Client *mpris2 = MPRIS2_CLIENT (object);
+
+	switch (prop_id) {
+		case PROP_PLAYER:
+			mpris2_client_set_player (mpris2, g_value_get_string (value));
+			break;
+		case PROP_STANDBY_SIZE:
+			mpris2_client_set_standby_size (mpris2, g_value_get_uint (value));
+			break;
+		case PROP_STRICT_MODE:
+			mpris2_client_set_strict_mode (mpris2, g_value_get_boolean (value));
+			break;
+		case PROP_AUTO_SWITCH:
+			mpris2_client_set_auto_switch (mpris2, g_value_get_boolean (value));
+			break;
+		case PROP_ALLOWED_PLAYERS:
+			mpris2_client_set_allowed_players (mpris2, g_value_get_boxed (value));
+			break;
+		case PROP_DENIED_PLAYERS:
+			mpris2_client_set_denied_players (mpris2, g_value_get_boxed (value));
+			break;
+		case PROP_STATE_CACHE:
+			mpris2_client_set_state_cache (mpris2, g_value_get_boolean (value));
+			break;
+		case PROP_INTEREST:
+			mpris2_client_set_interest (mpris2, g_value_get_uint (value));
+			break;
+		case PROP_TRACKS_FETCH_WINDOW:
+			mpris2_client_set_tracks_fetch_window (mpris2, g_value_get_uint (value));
+			break;
+		case PROP_LOOP_STATUS:
+			mpris2_client_set_loop_status (mpris2, g_value_get_int (value));
+			break;
+		case PROP_SHUFFLE:
+			mpris2_client_set_shuffle (mpris2, g_value_get_boolean (value));
+			break;
+		case PROP_VOLUME:
+			mpris2_client_set_volume (mpris2, g_value_get_double (value));
+			break;
+		case PROP_FULLSCREEN:
+			mpris2_client_set_fullscreen_player (mpris2, g_value_get_boolean (value));
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+			break;
+	}
+}
 
 static void
 mpris2_client_class_init (Mpris2ClientClass *klass)
@@ -1438,6 +5164,152 @@ mpris2_client_class_init (Mpris2ClientClass *klass)
 
 	gobject_class = G_OBJECT_CLASS (klass);
 	gobject_class->finalize = mpris2_client_finalize;
+	gobject_class->get_property = mpris2_client_get_property;
+	gobject_class->set_property = mpris2_client_set_property;
+
+	/* Settings. */
+	properties[PROP_PLAYER] =
+		g_param_spec_string ("player", "Player",
+		                     "The name of the player followed, without the mpris2 prefix",
+		                     NULL,
+		                     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_STANDBY_SIZE] =
+		g_param_spec_uint ("standby-size", "Standby size",
+		                   "The number of recently used players kept on standby",
+		                   0, G_MAXUINT, MPRIS2_CLIENT_STANDBY_SIZE,
+		                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_STRICT_MODE] =
+		g_param_spec_boolean ("strict-mode", "Strict mode",
+		                      "Whether methods are only called if the player allows them",
+		                      FALSE,
+		                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_AUTO_SWITCH] =
+		g_param_spec_boolean ("auto-switch", "Auto switch",
+		                      "Whether to follow the player that starts playing",
+		                      FALSE,
+		                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_ALLOWED_PLAYERS] =
+		g_param_spec_boxed ("allowed-players", "Allowed players",
+		                    "The patterns of the players to connect automatically, in order of preference",
+		                    G_TYPE_STRV,
+		                    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_DENIED_PLAYERS] =
+		g_param_spec_boxed ("denied-players", "Denied players",
+		                    "The patterns of the players never connected automatically",
+		                    G_TYPE_STRV,
+		                    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_STATE_CACHE] =
+		g_param_spec_boolean ("state-cache", "State cache",
+		                      "Whether the last-known state of the players is kept on disk",
+		                      FALSE,
+		                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_INTEREST] =
+		g_param_spec_uint ("interest", "Interest",
+		                   "The Mpris2Interest flags of the optional work done",
+		                   0, G_MAXUINT, MPRIS2_INTEREST_ALL,
+		                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_TRACKS_FETCH_WINDOW] =
+		g_param_spec_uint ("tracks-fetch-window", "Tracks fetch window",
+		                   "The number of calls for the metadata of the tracks in flight",
+		                   1, G_MAXUINT, MPRIS2_CLIENT_TRACKS_FETCH_WINDOW,
+		                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	/* State of the current player. */
+	properties[PROP_CONNECTED] =
+		g_param_spec_boolean ("connected", "Connected",
+		                      "Whether the player is on the bus",
+		                      FALSE,
+		                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_PROVISIONAL] =
+		g_param_spec_boolean ("provisional", "Provisional",
+		                      "Whether the state comes from the state cache",
+		                      FALSE,
+		                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_PLAYBACK_STATUS] =
+		g_param_spec_int ("playback-status", "Playback status",
+		                  "The PlaybackStatus of the player",
+		                  PLAYING, STOPPED, STOPPED,
+		                  G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_LOOP_STATUS] =
+		g_param_spec_int ("loop-status", "Loop status",
+		                  "The LoopStatus of the player",
+		                  NONE, PLAYLIST, NONE,
+		                  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_RATE] =
+		g_param_spec_double ("rate", "Rate",
+		                     "The playback rate",
+		                     0.0, G_MAXDOUBLE, 1.0,
+		                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_SHUFFLE] =
+		g_param_spec_boolean ("shuffle", "Shuffle",
+		                      "Whether the tracks are played in random order",
+		                      FALSE,
+		                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_METADATA] =
+		g_param_spec_pointer ("metadata", "Metadata",
+		                      "The Mpris2Metadata of the current track",
+		                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_VOLUME] =
+		g_param_spec_double ("volume", "Volume",
+		                     "The volume, or -1 if unknown",
+		                     -1.0, G_MAXDOUBLE, -1.0,
+		                     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_POSITION] =
+		g_param_spec_int ("position", "Position",
+		                  "The position in microseconds, notified when the player reports it",
+		                  G_MININT, G_MAXINT, 0,
+		                  G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_MINIMUM_RATE] =
+		g_param_spec_double ("minimum-rate", "Minimum rate",
+		                     "The minimum playback rate",
+		                     0.0, G_MAXDOUBLE, 1.0,
+		                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_MAXIMUM_RATE] =
+		g_param_spec_double ("maximum-rate", "Maximum rate",
+		                     "The maximum playback rate",
+		                     0.0, G_MAXDOUBLE, 1.0,
+		                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_CAPABILITIES] =
+		g_param_spec_uint ("capabilities", "Capabilities",
+		                   "The Mpris2Capabilities flags of the player",
+		                   0, G_MAXUINT, 0,
+		                   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_FULLSCREEN] =
+		g_param_spec_boolean ("fullscreen", "Fullscreen",
+		                      "Whether the player is fullscreen",
+		                      FALSE,
+		                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_IDENTITY] =
+		g_param_spec_string ("identity", "Identity",
+		                     "The friendly name of the player",
+		                     NULL,
+		                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_DESKTOP_ENTRY] =
+		g_param_spec_string ("desktop-entry", "Desktop entry",
+		                     "The basename of the desktop file of the player",
+		                     NULL,
+		                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_SUPPORTED_URI_SCHEMES] =
+		g_param_spec_boxed ("supported-uri-schemes", "Supported uri schemes",
+		                    "The uri schemes the player can open",
+		                    G_TYPE_STRV,
+		                    G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_SUPPORTED_MIME_TYPES] =
+		g_param_spec_boxed ("supported-mime-types", "Supported mime types",
+		                    "The mime types the player can open",
+		                    G_TYPE_STRV,
+		                    G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_ACTIVE_PLAYLIST] =
+		g_param_spec_pointer ("active-playlist", "Active playlist",
+		                      "The Mpris2Playlist being played, or NULL",
+		                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+	properties[PROP_PLAYLIST_COUNT] =
+		g_param_spec_uint ("playlist-count", "Playlist count",
+		                   "The number of playlists of the player",
+		                   0, G_MAXUINT, 0,
+		                   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (gobject_class, N_PROPERTIES, properties);
 
 	/**
 	 * Mpris2Client::connection:
@@ -1508,59 +5380,120 @@ mpris2_client_class_init (Mpris2ClientClass *klass)
 		              NULL, NULL,
 	                  g_cclosure_marshal_VOID__BOOLEAN,
 	                  G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+
+	/**
+	 * Mpris2Client::player-appeared:
+	 * @client: the object which received the signal
+	 * @player: the name of the player, without the mpris2 prefix
+	 *
+	 * Emitted when a player shows up on the bus, after
+	 * mpris2_client_watch_players() was called.
+	 */
+	signals[PLAYER_APPEARED] =
+		g_signal_new ("player-appeared",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (Mpris2ClientClass, player_appeared),
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__STRING,
+		              G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	/**
+	 * Mpris2Client::player-vanished:
+	 * @client: the object which received the signal
+	 * @player: the name of the player, without the mpris2 prefix
+	 *
+	 * Emitted when a watched player leaves the bus.
+	 */
+	signals[PLAYER_VANISHED] =
+		g_signal_new ("player-vanished",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (Mpris2ClientClass, player_vanished),
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__STRING,
+		              G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	/**
+	 * Mpris2Client::changed:
+	 * @client: the object which received the signal
+	 * @changed: the #Mpris2Changed flags of the properties
+	 *
+	 * Emitted once for all the properties of the current player changed
+	 * together, after the signals of each property.
+	 */
+	signals[CHANGED] =
+		g_signal_new ("changed",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (Mpris2ClientClass, changed),
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__UINT,
+		              G_TYPE_NONE, 1, G_TYPE_UINT);
+
+	/**
+	 * Mpris2Client::tracklist-changed:
+	 * @client: the object which received the signal
+	 * @position: the first track changed.
+	 * @removed: the number of tracks removed at @position.
+	 * @added: the number of tracks added at @position.
+	 *
+	 * The tracklist of the player changed, a track whose metadata changed
+	 * is told as removed and added again.
+	 */
+	signals[TRACKLIST_CHANGED] =
+		g_signal_new ("tracklist-changed",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (Mpris2ClientClass, tracklist_changed),
+		              NULL, NULL,
+		              g_cclosure_marshal_generic,
+		              G_TYPE_NONE, 3, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT);
+
+	/**
+	 * Mpris2Client::playlist-changed:
+	 * @client: the object which received the signal
+	 * @playlist: the #Mpris2Playlist as it is now.
+	 *
+	 * The player changed the name or the icon of a playlist. The pages
+	 * listed before already have the new one.
+	 */
+	signals[PLAYLIST_CHANGED] =
+		g_signal_new ("playlist-changed",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (Mpris2ClientClass, playlist_changed),
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__POINTER,
+		              G_TYPE_NONE, 1, G_TYPE_POINTER);
 }
 
 static void
 mpris2_client_init (Mpris2Client *mpris2)
 {
-	GDBusConnection *gconnection;
-	GError          *gerror = NULL;
-
-	gconnection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &gerror);
-	if (gconnection == NULL) {
-		g_message ("Failed to get session bus: %s", gerror->message);
-		g_error_free (gerror);
-		gerror = NULL;
-	}
-
-	mpris2->gconnection           = gconnection;
-	mpris2->props_proxy           = NULL;
-	mpris2->player_proxy          = NULL;
-	mpris2->dbus_name             = NULL;
-	mpris2->watch_id              = 0;
-
-	mpris2->player                = NULL;
-
-	mpris2->can_quit              = FALSE;
-	mpris2->can_set_fullscreen    = FALSE;
-	mpris2->can_raise             = FALSE;
-	mpris2->has_tracklist         = FALSE;
-	mpris2->identity              = NULL;
-	mpris2->desktop_entry         = NULL;
-	mpris2->supported_uri_schemes = NULL;
-	mpris2->supported_mime_types  = NULL;
-
-	mpris2->playback_status       = STOPPED;
-	mpris2->rate                  = 1.0;
-	mpris2->metadata              = NULL;
-	mpris2->volume                = -1;
-	mpris2->position              = 0;
-	mpris2->minimum_rate          = 1.0;
-	mpris2->maximum_rate          = 1.0;
-	mpris2->can_go_next           = FALSE;
-	mpris2->can_go_previous       = FALSE;
-	mpris2->can_play              = FALSE;
-	mpris2->can_pause             = FALSE;
-	mpris2->can_seek              = FALSE;
-	mpris2->can_control           = FALSE;
-
-	mpris2->has_loop_status       = FALSE;
-	mpris2->loop_status           = FALSE;
-	mpris2->has_shuffle           = FALSE;
-	mpris2->shuffle               = FALSE;
-
-	mpris2->connected             = FALSE;
-	mpris2->strict_mode           = FALSE;
+	mpris2->transport             = NULL;
+	mpris2->playback_timer_id     = 0;
+	mpris2->auto_connect_pending  = FALSE;
+	mpris2->interest              = MPRIS2_INTEREST_ALL;
+
+	mpris2->watch_players         = FALSE;
+	mpris2->name_owner_changed_id = 0;
+	mpris2->properties_changed_id = 0;
+	mpris2->running_players       = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                                       (GDestroyNotify) mpris2_player_activity_free);
+	mpris2->player_owners         = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	mpris2->players_listed        = FALSE;
 
-	mpris2_client_connect_dbus (mpris2);
-}
\ No newline at end of file
+	mpris2->strict_mode           = FALSE;
+	mpris2->standby_size          = MPRIS2_CLIENT_STANDBY_SIZE;
+	mpris2->use_state_cache       = FALSE;
+	mpris2->auto_switch           = FALSE;
+	mpris2->allowed_players       = NULL;
+	mpris2->denied_players        = NULL;
+	mpris2->tracks_fetch_window   = MPRIS2_CLIENT_TRACKS_FETCH_WINDOW;
+	mpris2->visible_position      = 0;
+	mpris2->n_visible_tracks      = 0;
+
+	mpris2->current               = mpris2_player_new (mpris2, NULL);
+	mpris2->standby               = NULL;
+}
@@ -19,8 +19,9 @@
 #ifndef LIB_MPRIS2_CLIENT_H
 #define LIB_MPRIS2_CLIENT_H
 
-#include <glib-object.h>
+#include <gio/gio.h>
 #include "mpris2-metadata.h"
+#include "mpris2-playlist.h"
 
 /**
  * PlaybackStatus:
@@ -52,6 +53,122 @@ typedef enum {
 	PLAYLIST
 } LoopStatus;
 
+/**
+ * Mpris2Capabilities:
+ * @MPRIS2_CAN_GO_NEXT: CanGoNext of the Player interface.
+ * @MPRIS2_CAN_GO_PREVIOUS: CanGoPrevious of the Player interface.
+ * @MPRIS2_CAN_PLAY: CanPlay of the Player interface.
+ * @MPRIS2_CAN_PAUSE: CanPause of the Player interface.
+ * @MPRIS2_CAN_SEEK: CanSeek of the Player interface.
+ * @MPRIS2_CAN_CONTROL: CanControl of the Player interface.
+ * @MPRIS2_CAN_QUIT: CanQuit of the MediaPlayer2 interface.
+ * @MPRIS2_CAN_RAISE: CanRaise of the MediaPlayer2 interface.
+ * @MPRIS2_CAN_SET_FULLSCREEN: CanSetFullscreen of the MediaPlayer2 interface.
+ * @MPRIS2_HAS_TRACKLIST: HasTrackList of the MediaPlayer2 interface.
+ * @MPRIS2_HAS_LOOP_STATUS: The player has the optional LoopStatus.
+ * @MPRIS2_HAS_SHUFFLE: The player has the optional Shuffle.
+ * @MPRIS2_CAN_EDIT_TRACKS: CanEditTracks of the TrackList interface.
+ * @MPRIS2_HAS_PLAYLISTS: The player has the optional Playlists interface.
+ *
+ * What the player can do, as returned by mpris2_client_get_capabilities().
+ */
+typedef enum {
+	MPRIS2_CAN_GO_NEXT        = 1 << 0,
+	MPRIS2_CAN_GO_PREVIOUS    = 1 << 1,
+	MPRIS2_CAN_PLAY           = 1 << 2,
+	MPRIS2_CAN_PAUSE          = 1 << 3,
+	MPRIS2_CAN_SEEK           = 1 << 4,
+	MPRIS2_CAN_CONTROL        = 1 << 5,
+	MPRIS2_CAN_QUIT           = 1 << 6,
+	MPRIS2_CAN_RAISE          = 1 << 7,
+	MPRIS2_CAN_SET_FULLSCREEN = 1 << 8,
+	MPRIS2_HAS_TRACKLIST      = 1 << 9,
+	MPRIS2_HAS_LOOP_STATUS    = 1 << 10,
+	MPRIS2_HAS_SHUFFLE        = 1 << 11,
+	MPRIS2_CAN_EDIT_TRACKS    = 1 << 12,
+	MPRIS2_HAS_PLAYLISTS      = 1 << 13
+} Mpris2Capabilities;
+
+/**
+ * Mpris2Changed:
+ * @MPRIS2_CHANGED_PLAYBACK_STATUS: The playback status.
+ * @MPRIS2_CHANGED_LOOP_STATUS: The loop status.
+ * @MPRIS2_CHANGED_RATE: The playback rate.
+ * @MPRIS2_CHANGED_SHUFFLE: The shuffle mode.
+ * @MPRIS2_CHANGED_METADATA: The metadata of the track.
+ * @MPRIS2_CHANGED_VOLUME: The volume.
+ * @MPRIS2_CHANGED_POSITION: The position, as reported by the player.
+ * @MPRIS2_CHANGED_MINIMUM_RATE: The minimum rate.
+ * @MPRIS2_CHANGED_MAXIMUM_RATE: The maximum rate.
+ * @MPRIS2_CHANGED_CAPABILITIES: Any of the #Mpris2Capabilities.
+ * @MPRIS2_CHANGED_FULLSCREEN: The fullscreen state.
+ * @MPRIS2_CHANGED_IDENTITY: The identity of the player.
+ * @MPRIS2_CHANGED_DESKTOP_ENTRY: The desktop entry of the player.
+ * @MPRIS2_CHANGED_SUPPORTED_URI_SCHEMES: The supported uri schemes.
+ * @MPRIS2_CHANGED_SUPPORTED_MIME_TYPES: The supported mime types.
+ * @MPRIS2_CHANGED_ACTIVE_PLAYLIST: The active playlist.
+ * @MPRIS2_CHANGED_PLAYLISTS: The number of playlists or their orderings.
+ *   The pages listed before may be out of date.
+ *
+ * The properties changed together, given by the #Mpris2Client::changed signal.
+ */
+typedef enum {
+	MPRIS2_CHANGED_PLAYBACK_STATUS       = 1 << 0,
+	MPRIS2_CHANGED_LOOP_STATUS           = 1 << 1,
+	MPRIS2_CHANGED_RATE                  = 1 << 2,
+	MPRIS2_CHANGED_SHUFFLE               = 1 << 3,
+	MPRIS2_CHANGED_METADATA              = 1 << 4,
+	MPRIS2_CHANGED_VOLUME                = 1 << 5,
+	MPRIS2_CHANGED_POSITION              = 1 << 6,
+	MPRIS2_CHANGED_MINIMUM_RATE          = 1 << 7,
+	MPRIS2_CHANGED_MAXIMUM_RATE          = 1 << 8,
+	MPRIS2_CHANGED_CAPABILITIES          = 1 << 9,
+	MPRIS2_CHANGED_FULLSCREEN            = 1 << 10,
+	MPRIS2_CHANGED_IDENTITY              = 1 << 11,
+	MPRIS2_CHANGED_DESKTOP_ENTRY         = 1 << 12,
+	MPRIS2_CHANGED_SUPPORTED_URI_SCHEMES = 1 << 13,
+	MPRIS2_CHANGED_SUPPORTED_MIME_TYPES  = 1 << 14,
+	MPRIS2_CHANGED_ACTIVE_PLAYLIST       = 1 << 15,
+	MPRIS2_CHANGED_PLAYLISTS             = 1 << 16
+} Mpris2Changed;
+
+/**
+ * Mpris2Interest:
+ * @MPRIS2_INTEREST_PLAYBACK_TICK: The playback-tick signal, and its timer.
+ * @MPRIS2_INTEREST_METADATA: The metadata signal, and decoding the metadata for it.
+ * @MPRIS2_INTEREST_POSITION: Asking the position when the playback starts.
+ * @MPRIS2_INTEREST_TRACKLIST: Keeping the tracklist, for the tracklist-changed signal.
+ *
+ * Optional work of the client, see mpris2_client_set_interest().
+ */
+typedef enum {
+	MPRIS2_INTEREST_PLAYBACK_TICK = 1 << 0,
+	MPRIS2_INTEREST_METADATA      = 1 << 1,
+	MPRIS2_INTEREST_POSITION      = 1 << 2,
+	MPRIS2_INTEREST_TRACKLIST     = 1 << 3
+} Mpris2Interest;
+
+/**
+ * Mpris2PlaylistOrdering:
+ * @MPRIS2_PLAYLIST_ORDER_ALPHABETICAL: By name.
+ * @MPRIS2_PLAYLIST_ORDER_CREATION_DATE: By the date of creation.
+ * @MPRIS2_PLAYLIST_ORDER_MODIFIED_DATE: By the date of last change.
+ * @MPRIS2_PLAYLIST_ORDER_LAST_PLAY_DATE: By the date of last playback.
+ * @MPRIS2_PLAYLIST_ORDER_USER_DEFINED: In the order chosen by the user.
+ *
+ * How to sort the playlists of mpris2_client_get_playlists():
+ * See mpris2 specification <ulink url="http://specifications.freedesktop.org/mpris-spec/latest/Playlists_Interface.html#Enum:Playlist_Ordering">Playlist_Ordering</ulink>
+ */
+typedef enum {
+	MPRIS2_PLAYLIST_ORDER_ALPHABETICAL,
+	MPRIS2_PLAYLIST_ORDER_CREATION_DATE,
+	MPRIS2_PLAYLIST_ORDER_MODIFIED_DATE,
+	MPRIS2_PLAYLIST_ORDER_LAST_PLAY_DATE,
+	MPRIS2_PLAYLIST_ORDER_USER_DEFINED
+} Mpris2PlaylistOrdering;
+
+#define MPRIS2_INTEREST_ALL (MPRIS2_INTEREST_PLAYBACK_TICK | MPRIS2_INTEREST_METADATA | MPRIS2_INTEREST_POSITION | MPRIS2_INTEREST_TRACKLIST)
+
 #define MPRIS2_TYPE_CLIENT              (mpris2_client_get_type ())
 #define MPRIS2_CLIENT(obj)              (G_TYPE_CHECK_INSTANCE_CAST ((obj), MPRIS2_TYPE_CLIENT, Mpris2Client))
 #define MPRIS2_IS_CLIENT(obj)           (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MPRIS2_TYPE_CLIENT))
@@ -73,6 +190,11 @@ struct _Mpris2ClientClass {
 	void (*volume)          (Mpris2Client *mpris2, gdouble         volume);
 	void (*loop_status)     (Mpris2Client *mpris2, LoopStatus      loop_status);
 	void (*shuffle)         (Mpris2Client *mpris2, gboolean        shuffle);
+	void (*player_appeared) (Mpris2Client *mpris2, const gchar    *player);
+	void (*player_vanished) (Mpris2Client *mpris2, const gchar    *player);
+	void (*changed)         (Mpris2Client *mpris2, guint           changed);
+	void (*tracklist_changed) (Mpris2Client *mpris2, guint position, guint removed, guint added);
+	void (*playlist_changed)  (Mpris2Client *mpris2, Mpris2Playlist *playlist);
 };
 
 /*
@@ -80,14 +202,41 @@ struct _Mpris2ClientClass {
  */
 
 Mpris2Client   *mpris2_client_new (void);
+Mpris2Client   *mpris2_client_new_for_connection        (GDBusConnection *connection);
+void            mpris2_client_new_for_address           (const gchar *address, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+Mpris2Client   *mpris2_client_new_for_address_finish    (GAsyncResult *res, GError **error);
+Mpris2Client   *mpris2_client_new_sharing               (Mpris2Client *mpris2);
+
+GDBusConnection *mpris2_client_get_connection           (Mpris2Client *mpris2);
 
 const gchar    *mpris2_client_get_player                (Mpris2Client *mpris2);
 void            mpris2_client_set_player                (Mpris2Client *mpris2, const gchar *player);
+guint           mpris2_client_get_standby_size          (Mpris2Client *mpris2);
+void            mpris2_client_set_standby_size          (Mpris2Client *mpris2, guint standby_size);
 gboolean        mpris2_client_auto_connect              (Mpris2Client *mpris2);
+void            mpris2_client_auto_connect_async        (Mpris2Client *mpris2);
+
+void            mpris2_client_watch_players             (Mpris2Client *mpris2);
+
+gboolean        mpris2_client_get_auto_switch           (Mpris2Client *mpris2);
+void            mpris2_client_set_auto_switch           (Mpris2Client *mpris2, gboolean auto_switch);
+gchar         **mpris2_client_get_allowed_players       (Mpris2Client *mpris2);
+void            mpris2_client_set_allowed_players       (Mpris2Client *mpris2, gchar **players);
+gchar         **mpris2_client_get_denied_players        (Mpris2Client *mpris2);
+void            mpris2_client_set_denied_players        (Mpris2Client *mpris2, gchar **players);
+gchar          *mpris2_client_get_preferred_player      (Mpris2Client *mpris2);
 
 gchar         **mpris2_client_get_available_players     (Mpris2Client *mpris2);
 
 gboolean        mpris2_client_is_connected              (Mpris2Client *mpris2);
+gboolean        mpris2_client_is_provisional            (Mpris2Client *mpris2);
+
+gboolean        mpris2_client_get_state_cache           (Mpris2Client *mpris2);
+void            mpris2_client_set_state_cache           (Mpris2Client *mpris2, gboolean use_state_cache);
+
+guint           mpris2_client_get_interest              (Mpris2Client *mpris2);
+void            mpris2_client_set_interest              (Mpris2Client *mpris2, guint interest);
+void            mpris2_client_update_interest           (Mpris2Client *mpris2);
 
 gboolean        mpris2_client_get_strict_mode           (Mpris2Client *mpris2);
 void            mpris2_client_set_strict_mode           (Mpris2Client *mpris2, gboolean strict_mode);
@@ -105,6 +254,8 @@ void            mpris2_client_play                      (Mpris2Client *mpris2);
 void            mpris2_client_seek                      (Mpris2Client *mpris2, gint offset);
 void            mpris2_client_set_position              (Mpris2Client *mpris2, const gchar *track_id, gint position);
 void            mpris2_client_open_uri                  (Mpris2Client *mpris2, const gchar *uri);
+void            mpris2_client_open_uris                 (Mpris2Client *mpris2, const gchar * const *uris, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean        mpris2_client_open_uris_finish          (Mpris2Client *mpris2, GAsyncResult *res, GPtrArray **errors, GError **error);
 
 /*
  * Interface MediaPlayer2 Methods.
@@ -113,6 +264,37 @@ void            mpris2_client_raise_player              (Mpris2Client *mpris2);
 void            mpris2_client_quit_player               (Mpris2Client *mpris2);
 void            mpris2_client_set_fullscreen_player     (Mpris2Client *mpris2, gboolean fullscreen);
 
+/*
+ * Interface MediaPlayer2.TrackList.
+ */
+guint           mpris2_client_get_n_tracks              (Mpris2Client *mpris2);
+gchar          *mpris2_client_get_track_id              (Mpris2Client *mpris2, guint index);
+Mpris2Metadata *mpris2_client_get_track_metadata        (Mpris2Client *mpris2, const gchar *track_id);
+gboolean        mpris2_client_get_can_edit_tracks       (Mpris2Client *mpris2);
+void            mpris2_client_set_visible_tracks        (Mpris2Client *mpris2, guint position, guint n_tracks);
+guint           mpris2_client_get_tracks_fetch_window   (Mpris2Client *mpris2);
+void            mpris2_client_set_tracks_fetch_window   (Mpris2Client *mpris2, guint tracks_fetch_window);
+
+void            mpris2_client_go_to_track               (Mpris2Client *mpris2, const gchar *track_id, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean        mpris2_client_go_to_track_finish        (Mpris2Client *mpris2, GAsyncResult *res, GError **error);
+void            mpris2_client_add_track                 (Mpris2Client *mpris2, const gchar *uri, const gchar *after_track, gboolean set_as_current, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean        mpris2_client_add_track_finish          (Mpris2Client *mpris2, GAsyncResult *res, GError **error);
+void            mpris2_client_remove_track              (Mpris2Client *mpris2, const gchar *track_id, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean        mpris2_client_remove_track_finish       (Mpris2Client *mpris2, GAsyncResult *res, GError **error);
+
+/*
+ * Interface MediaPlayer2.Playlists.
+ */
+gboolean        mpris2_client_has_playlists_support     (Mpris2Client *mpris2);
+guint           mpris2_client_get_playlist_count        (Mpris2Client *mpris2);
+gboolean        mpris2_client_supports_playlist_ordering (Mpris2Client *mpris2, Mpris2PlaylistOrdering ordering);
+Mpris2Playlist *mpris2_client_get_active_playlist       (Mpris2Client *mpris2);
+
+void            mpris2_client_get_playlists             (Mpris2Client *mpris2, guint index, guint max_count, Mpris2PlaylistOrdering ordering, gboolean reverse_order, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+GPtrArray      *mpris2_client_get_playlists_finish      (Mpris2Client *mpris2, GAsyncResult *res, GError **error);
+void            mpris2_client_activate_playlist         (Mpris2Client *mpris2, const gchar *playlist_id, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean        mpris2_client_activate_playlist_finish  (Mpris2Client *mpris2, GAsyncResult *res, GError **error);
+
 /*
  * Interface MediaPlayer2 Properies.
  */
@@ -124,6 +306,8 @@ const gchar    *mpris2_client_get_player_identity       (Mpris2Client *mpris2);
 const gchar    *mpris2_client_get_player_desktop_entry  (Mpris2Client *mpris2);
 gchar         **mpris2_client_get_supported_uri_schemes (Mpris2Client *mpris2);
 gchar         **mpris2_client_get_supported_mime_types  (Mpris2Client *mpris2);
+gboolean        mpris2_client_supports_uri              (Mpris2Client *mpris2, const gchar *uri);
+gboolean        mpris2_client_supports_mime             (Mpris2Client *mpris2, const gchar *mime_type);
 
 /*
  * Interface MediaPlayer2.Player properties.
@@ -156,6 +340,8 @@ gboolean        mpris2_client_get_can_seek              (Mpris2Client *mpris2);
 
 gboolean        mpris2_client_get_can_control           (Mpris2Client *mpris2);
 
+guint           mpris2_client_get_capabilities          (Mpris2Client *mpris2);
+
 /*
  * Optionals Interface MediaPlayer2.Player properties.
  */
@@ -0,0 +1,236 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Cost of each kind of event in the client alone, with a simulated
+ * player on the loopback transport and no bus at all.
+ *
+ *   mpris2-loopback-bench [events]
+ *
+ * Each event is handled until the client is idle again, including the
+ * calls it makes in turn, which are counted too.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "libmpris2client-private.h"
+#include "mpris2-transport-loopback.h"
+
+typedef void (*BenchEventFunc) (Mpris2LoopbackPlayer *player, guint i);
+
+static guint n_changed = 0;
+
+/* Deliver the queued replies and the idles, until nothing is left. */
+
+static void
+bench_settle (Mpris2Transport *transport)
+{
+	guint n;
+
+	do {
+		n = mpris2_transport_loopback_dispatch (transport);
+		while (g_main_context_iteration (NULL, FALSE))
+			n++;
+	} while (n > 0);
+}
+
+static GVariant *
+bench_metadata_new (guint i)
+{
+	GVariantBuilder builder;
+	const gchar *artists[] = { "Artist", NULL };
+	gchar *path, *title;
+
+	path = g_strdup_printf ("/org/mpris/MediaPlayer2/Track/%u", i);
+	title = g_strdup_printf ("Title %u", i);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "mpris:trackid", g_variant_new_object_path (path));
+	g_variant_builder_add (&builder, "{sv}", "xesam:title", g_variant_new_string (title));
+	g_variant_builder_add (&builder, "{sv}", "xesam:artist", g_variant_new_strv (artists, -1));
+	g_variant_builder_add (&builder, "{sv}", "xesam:album", g_variant_new_string ("Album"));
+	g_variant_builder_add (&builder, "{sv}", "mpris:length",
+	                       g_variant_new_int64 (G_GINT64_CONSTANT (245000000)));
+	g_variant_builder_add (&builder, "{sv}", "mpris:artUrl",
+	                       g_variant_new_string ("file:///tmp/cover.jpg"));
+
+	g_free (path);
+	g_free (title);
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+bench_changed_cb (Mpris2Client *mpris2, guint changed, gpointer user_data)
+{
+	n_changed++;
+}
+
+static void
+bench_metadata_cb (Mpris2Client *mpris2, Mpris2Metadata *metadata, gpointer user_data)
+{
+}
+
+/*
+ * Events.
+ */
+
+static void
+bench_player_changed (Mpris2LoopbackPlayer *player, const gchar *property, GVariant *value)
+{
+	GVariantBuilder changed;
+
+	g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&changed, "{sv}", property, value);
+
+	mpris2_loopback_player_properties_changed (player, "org.mpris.MediaPlayer2.Player",
+	                                           g_variant_builder_end (&changed), NULL);
+}
+
+static void
+bench_metadata (Mpris2LoopbackPlayer *player, guint i)
+{
+	bench_player_changed (player, "Metadata", bench_metadata_new (i));
+}
+
+static void
+bench_playback_status (Mpris2LoopbackPlayer *player, guint i)
+{
+	bench_player_changed (player, "PlaybackStatus",
+	                      g_variant_new_string (i % 2 ? "Paused" : "Playing"));
+}
+
+static void
+bench_volume (Mpris2LoopbackPlayer *player, guint i)
+{
+	bench_player_changed (player, "Volume", g_variant_new_double ((i % 100) / 100.0));
+}
+
+static void
+bench_seeked (Mpris2LoopbackPlayer *player, guint i)
+{
+	mpris2_loopback_player_seeked (player, (gint64) i * G_USEC_PER_SEC);
+}
+
+/* The value is given, but only told as invalidated. */
+
+static void
+bench_invalidated (Mpris2LoopbackPlayer *player, guint i)
+{
+	const gchar * const invalidated[] = { "Metadata", NULL };
+
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "Metadata", bench_metadata_new (i));
+	mpris2_loopback_player_properties_changed (player, "org.mpris.MediaPlayer2.Player",
+	                                           g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0),
+	                                           invalidated);
+}
+
+static void
+bench_run (const gchar          *name,
+           BenchEventFunc        event,
+           Mpris2Transport      *transport,
+           Mpris2LoopbackPlayer *player,
+           guint                 n_events)
+{
+	clock_t cpu;
+	gint64 start;
+	guint i, n_calls;
+
+	n_changed = 0;
+	n_calls = mpris2_loopback_player_get_n_calls (player);
+
+	cpu = clock ();
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < n_events; i++) {
+		event (player, i);
+		bench_settle (transport);
+	}
+
+	g_print ("%-24s %8.2f us %8.2f us cpu %6.2f calls %6.2f changed\n",
+	         name,
+	         (gdouble) (g_get_monotonic_time () - start) / n_events,
+	         (gdouble) (clock () - cpu) * G_USEC_PER_SEC / CLOCKS_PER_SEC / n_events,
+	         (gdouble) (mpris2_loopback_player_get_n_calls (player) - n_calls) / n_events,
+	         (gdouble) n_changed / n_events);
+}
+
+int
+main (int argc, char *argv[])
+{
+	Mpris2Transport *transport;
+	Mpris2LoopbackPlayer *player;
+	Mpris2Client *mpris2;
+	gulong metadata_id;
+	guint n_events = 10000;
+
+#if !GLIB_CHECK_VERSION(2, 35, 0)
+	g_type_init();
+#endif
+
+	if (argc > 1)
+		n_events = MAX (atoi (argv[1]), 1);
+
+	transport = mpris2_transport_loopback_new ();
+
+	player = mpris2_loopback_player_new (transport, "bench");
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2",
+	                            "Identity", g_variant_new_string ("Bench"));
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2",
+	                            "DesktopEntry", g_variant_new_string ("bench"));
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "PlaybackStatus", g_variant_new_string ("Paused"));
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "Metadata", bench_metadata_new (0));
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "Volume", g_variant_new_double (1.0));
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "Position", g_variant_new_int64 (0));
+
+	mpris2 = mpris2_client_new_for_transport (transport);
+	g_signal_connect (mpris2, "changed", G_CALLBACK (bench_changed_cb), NULL);
+	metadata_id = g_signal_connect (mpris2, "metadata", G_CALLBACK (bench_metadata_cb), NULL);
+
+	mpris2_client_set_player (mpris2, "bench");
+	bench_settle (transport);
+
+	if (!mpris2_client_is_connected (mpris2)) {
+		g_printerr ("mpris2-loopback-bench: the client did not connect\n");
+		return EXIT_FAILURE;
+	}
+
+	g_print ("%-24s %11s %14s %12s %14s\n", "event (per event)", "time", "cpu", "calls", "changed");
+
+	bench_run ("metadata", bench_metadata, transport, player, n_events);
+	bench_run ("playback status", bench_playback_status, transport, player, n_events);
+	bench_run ("volume", bench_volume, transport, player, n_events);
+	bench_run ("seeked", bench_seeked, transport, player, n_events);
+	bench_run ("invalidated metadata", bench_invalidated, transport, player, n_events);
+
+	/* The metadata is not decoded without listener. */
+	g_signal_handler_disconnect (mpris2, metadata_id);
+	bench_run ("metadata, no listener", bench_metadata, transport, player, n_events);
+
+	g_object_unref (mpris2);
+	mpris2_loopback_player_free (player);
+	mpris2_transport_unref (transport);
+
+	return EXIT_SUCCESS;
+}
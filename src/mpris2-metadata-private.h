@@ -0,0 +1,31 @@
+/*
+ *  Copyright (c) 2011-2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifndef MPRIS2_METADATA_PRIVATE_H
+#define MPRIS2_METADATA_PRIVATE_H
+
+#include "mpris2-metadata.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL void
+mpris2_metadata_set_arturl_variant(Mpris2Metadata *metadata, GVariant *arturl);
+
+G_END_DECLS
+
+#endif
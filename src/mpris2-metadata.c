@@ -28,6 +28,7 @@
 */
 
 #include "mpris2-metadata.h"
+#include "mpris2-metadata-private.h"
 
 struct _Mpris2Metadata {
 	gchar *trackid;
@@ -37,7 +38,7 @@ struct _Mpris2Metadata {
 	gchar *album;
 	guint length;
 	guint track_no;
-	gchar *arturl;
+	GVariant *arturl;
 };
 
 /*
@@ -191,18 +192,40 @@ mpris2_metadata_set_arturl(Mpris2Metadata *metadata, const gchar *arturl)
 		return;
 
 	if(metadata->arturl)
-		g_free(metadata->arturl);
+		g_variant_unref(metadata->arturl);
 
-	metadata->arturl = g_strdup(arturl);
+	if(arturl)
+		metadata->arturl = g_variant_ref_sink(g_variant_new_string(arturl));
+	else
+		metadata->arturl = NULL;
+}
+
+/*
+ * Art urls can be data: uris of several hundred KB, so keep a reference to
+ * the string inside the received message instead of a copy.
+ */
+void
+mpris2_metadata_set_arturl_variant(Mpris2Metadata *metadata, GVariant *arturl)
+{
+	if(!metadata)
+		return;
+
+	if(arturl)
+		g_variant_ref(arturl);
+
+	if(metadata->arturl)
+		g_variant_unref(metadata->arturl);
+
+	metadata->arturl = arturl;
 }
 
 const gchar *
 mpris2_metadata_get_arturl(Mpris2Metadata *metadata)
 {
-	if(!metadata)
+	if(!metadata || !metadata->arturl)
 		return NULL;
 
-	return metadata->arturl;
+	return g_variant_get_string(metadata->arturl, NULL);
 }
 
 /*
@@ -243,7 +266,7 @@ mpris2_metadata_free(Mpris2Metadata *metadata)
 	if(metadata->album) 
 		g_free(metadata->album);
 	if(metadata->arturl)
-		g_free(metadata->arturl);
+		g_variant_unref(metadata->arturl);
 
 	g_slice_free(Mpris2Metadata, metadata);
 }
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifndef MPRIS2_PLAYLIST_PRIVATE_H
+#define MPRIS2_PLAYLIST_PRIVATE_H
+
+#include <gio/gio.h>
+
+#include "mpris2-playlist.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL Mpris2Playlist *mpris2_playlist_new_from_variant (GVariant *playlist);
+
+G_END_DECLS
+
+#endif
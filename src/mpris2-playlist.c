@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/**
+* SECTION:Mpris2Playlist
+* @short_description: A playlist of the Playlists interface of a player.
+* @title: Mpris2Playlist
+* @section_id:
+* @stability: Unstable
+* @include: mpris2client/mpris2playlist.h
+*
+* A playlist as told by the player: its id, name and icon. It does not
+* change, a new one is given when the player changes the playlist.
+*/
+
+#include "mpris2-playlist.h"
+#include "mpris2-playlist-private.h"
+
+struct _Mpris2Playlist {
+	gint   ref_count;
+	gchar *id;
+	gchar *name;
+	gchar *icon;
+};
+
+/* From the (oss) structure of the specification. */
+
+Mpris2Playlist *
+mpris2_playlist_new_from_variant (GVariant *playlist)
+{
+	Mpris2Playlist *self;
+	const gchar *id, *name, *icon;
+
+	g_variant_get (playlist, "(&o&s&s)", &id, &name, &icon);
+
+	self = g_slice_new0 (Mpris2Playlist);
+	self->ref_count = 1;
+	self->id = g_strdup (id);
+	self->name = g_strdup (name);
+
+	/* An empty icon is no icon. */
+	if (icon[0] != '\0')
+		self->icon = g_strdup (icon);
+
+	return self;
+}
+
+Mpris2Playlist *
+mpris2_playlist_ref (Mpris2Playlist *playlist)
+{
+	g_atomic_int_inc (&playlist->ref_count);
+
+	return playlist;
+}
+
+void
+mpris2_playlist_unref (Mpris2Playlist *playlist)
+{
+	if (!g_atomic_int_dec_and_test (&playlist->ref_count))
+		return;
+
+	g_free (playlist->id);
+	g_free (playlist->name);
+	g_free (playlist->icon);
+	g_slice_free (Mpris2Playlist, playlist);
+}
+
+const gchar *
+mpris2_playlist_get_id (Mpris2Playlist *playlist)
+{
+	return playlist->id;
+}
+
+const gchar *
+mpris2_playlist_get_name (Mpris2Playlist *playlist)
+{
+	return playlist->name;
+}
+
+/* The uri of the icon, or NULL. */
+
+const gchar *
+mpris2_playlist_get_icon (Mpris2Playlist *playlist)
+{
+	return playlist->icon;
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifndef MPRIS2_TRACKLIST_PRIVATE_H
+#define MPRIS2_TRACKLIST_PRIVATE_H
+
+#include <gio/gio.h>
+
+#include "mpris2-metadata.h"
+
+G_BEGIN_DECLS
+
+/* Local copy of the tracklist of a player, stored by columns. */
+typedef struct _Mpris2TrackList Mpris2TrackList;
+
+G_GNUC_INTERNAL Mpris2TrackList *mpris2_tracklist_new             (void);
+G_GNUC_INTERNAL void             mpris2_tracklist_free            (Mpris2TrackList *tracklist);
+
+G_GNUC_INTERNAL guint            mpris2_tracklist_get_length      (Mpris2TrackList *tracklist);
+G_GNUC_INTERNAL const gchar     *mpris2_tracklist_get_id          (Mpris2TrackList *tracklist,
+                                                                   guint index);
+G_GNUC_INTERNAL gboolean         mpris2_tracklist_contains        (Mpris2TrackList *tracklist,
+                                                                   const gchar *id);
+G_GNUC_INTERNAL gint             mpris2_tracklist_index           (Mpris2TrackList *tracklist,
+                                                                   const gchar *id,
+                                                                   guint hint);
+
+G_GNUC_INTERNAL void             mpris2_tracklist_insert          (Mpris2TrackList *tracklist,
+                                                                   guint index,
+                                                                   const gchar *id);
+G_GNUC_INTERNAL gint             mpris2_tracklist_remove          (Mpris2TrackList *tracklist,
+                                                                   const gchar *id);
+G_GNUC_INTERNAL void             mpris2_tracklist_replace         (Mpris2TrackList *tracklist,
+                                                                   GVariant *ids);
+
+G_GNUC_INTERNAL gint             mpris2_tracklist_set_metadata    (Mpris2TrackList *tracklist,
+                                                                   const gchar *id,
+                                                                   GVariant *metadata,
+                                                                   guint hint);
+G_GNUC_INTERNAL Mpris2Metadata  *mpris2_tracklist_get_metadata    (Mpris2TrackList *tracklist,
+                                                                   const gchar *id);
+
+G_GNUC_INTERNAL guint            mpris2_tracklist_take_chunk      (Mpris2TrackList *tracklist,
+                                                                   guint start,
+                                                                   guint end,
+                                                                   guint max,
+                                                                   GVariantBuilder *builder,
+                                                                   guint *first);
+G_GNUC_INTERNAL guint            mpris2_tracklist_take_next_chunk (Mpris2TrackList *tracklist,
+                                                                   guint max,
+                                                                   GVariantBuilder *builder,
+                                                                   guint *first);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,615 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "mpris2-tracklist-private.h"
+
+/*
+ * Each track is a row, and each field a column with the value of every
+ * row, so a queue of tens of thousands of tracks is a few flat arrays.
+ * The strings live together in an arena, and artists and albums, which
+ * repeat a lot, are interned and kept as small ids. The Mpris2Metadata
+ * of a track is only built when asked.
+ */
+
+/* Arena bytes no longer used before it is rebuilt with the live strings. */
+#define MPRIS2_TRACKLIST_MIN_GARBAGE (64 * 1024)
+
+enum {
+	TRACK_HAS_METADATA = 1 << 0,
+	TRACK_REQUESTED    = 1 << 1,
+	TRACK_KEPT         = 1 << 2
+};
+
+struct _Mpris2TrackList {
+	/* Rows in the order of the tracklist, and the rows free for reuse. */
+	GArray       *order;
+	GArray       *free_rows;
+
+	/* Track id in the arena to its row plus one. */
+	GHashTable   *rows;
+
+	/* Columns, indexed by row. */
+	GArray       *ids;         /* const gchar * */
+	GArray       *titles;      /* const gchar * */
+	GArray       *urls;        /* const gchar * */
+	GArray       *art_urls;    /* const gchar * */
+	GArray       *artists;     /* guint32, interned */
+	GArray       *albums;      /* guint32, interned */
+	GArray       *lengths;     /* gint64, in microseconds */
+	GArray       *track_nos;   /* guint32 */
+	GArray       *flags;       /* guint8 */
+
+	/* Shared strings, and the interned ones by id. Zero is NULL. */
+	GStringChunk *arena;
+	gsize         arena_size;
+	gsize         garbage;
+	GPtrArray    *interned;
+	GHashTable   *interned_ids;
+
+	/* Where to look for tracks without metadata. */
+	guint         fetch_cursor;
+};
+
+#define COLUMN(tracklist, column, type, row) g_array_index ((tracklist)->column, type, (row))
+#define ROW_AT(tracklist, index) g_array_index ((tracklist)->order, guint, (index))
+
+/*
+ * Strings.
+ */
+
+static const gchar *
+mpris2_tracklist_store (Mpris2TrackList *tracklist, const gchar *string)
+{
+	if (string == NULL)
+		return NULL;
+
+	tracklist->arena_size += strlen (string) + 1;
+
+	return g_string_chunk_insert (tracklist->arena, string);
+}
+
+static void
+mpris2_tracklist_discard (Mpris2TrackList *tracklist, const gchar *string)
+{
+	if (string != NULL)
+		tracklist->garbage += strlen (string) + 1;
+}
+
+static guint32
+mpris2_tracklist_intern (Mpris2TrackList *tracklist, const gchar *string)
+{
+	gpointer id;
+	const gchar *stored;
+
+	if (string == NULL || *string == '\0')
+		return 0;
+
+	id = g_hash_table_lookup (tracklist->interned_ids, string);
+	if (id != NULL)
+		return GPOINTER_TO_UINT (id);
+
+	stored = mpris2_tracklist_store (tracklist, string);
+	g_ptr_array_add (tracklist->interned, (gpointer) stored);
+	g_hash_table_insert (tracklist->interned_ids, (gpointer) stored,
+	                     GUINT_TO_POINTER (tracklist->interned->len - 1));
+
+	return tracklist->interned->len - 1;
+}
+
+static void
+mpris2_tracklist_new_arena (Mpris2TrackList *tracklist)
+{
+	tracklist->arena = g_string_chunk_new (4096);
+	tracklist->arena_size = 0;
+	tracklist->garbage = 0;
+
+	tracklist->interned = g_ptr_array_new ();
+	g_ptr_array_add (tracklist->interned, NULL);
+	tracklist->interned_ids = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/* Copy the strings still used to a new arena, once most of it is garbage. */
+
+static void
+mpris2_tracklist_compact (Mpris2TrackList *tracklist)
+{
+	GStringChunk *arena;
+	GPtrArray *interned;
+	GHashTable *interned_ids;
+	guint i, row;
+
+	if (tracklist->garbage < MPRIS2_TRACKLIST_MIN_GARBAGE ||
+	    tracklist->garbage < tracklist->arena_size / 2)
+		return;
+
+	arena = tracklist->arena;
+	interned = tracklist->interned;
+	interned_ids = tracklist->interned_ids;
+
+	mpris2_tracklist_new_arena (tracklist);
+	g_hash_table_remove_all (tracklist->rows);
+
+	for (i = 0; i < tracklist->order->len; i++) {
+		row = ROW_AT (tracklist, i);
+
+		COLUMN (tracklist, ids, const gchar *, row) =
+			mpris2_tracklist_store (tracklist, COLUMN (tracklist, ids, const gchar *, row));
+		COLUMN (tracklist, titles, const gchar *, row) =
+			mpris2_tracklist_store (tracklist, COLUMN (tracklist, titles, const gchar *, row));
+		COLUMN (tracklist, urls, const gchar *, row) =
+			mpris2_tracklist_store (tracklist, COLUMN (tracklist, urls, const gchar *, row));
+		COLUMN (tracklist, art_urls, const gchar *, row) =
+			mpris2_tracklist_store (tracklist, COLUMN (tracklist, art_urls, const gchar *, row));
+		COLUMN (tracklist, artists, guint32, row) =
+			mpris2_tracklist_intern (tracklist, g_ptr_array_index (interned, COLUMN (tracklist, artists, guint32, row)));
+		COLUMN (tracklist, albums, guint32, row) =
+			mpris2_tracklist_intern (tracklist, g_ptr_array_index (interned, COLUMN (tracklist, albums, guint32, row)));
+
+		g_hash_table_insert (tracklist->rows, (gpointer) COLUMN (tracklist, ids, const gchar *, row),
+		                     GUINT_TO_POINTER (row + 1));
+	}
+
+	g_hash_table_destroy (interned_ids);
+	g_ptr_array_free (interned, TRUE);
+	g_string_chunk_free (arena);
+}
+
+/*
+ * Rows.
+ */
+
+static gint
+mpris2_tracklist_lookup_row (Mpris2TrackList *tracklist, const gchar *id)
+{
+	return GPOINTER_TO_UINT (g_hash_table_lookup (tracklist->rows, id)) - 1;
+}
+
+static guint
+mpris2_tracklist_new_row (Mpris2TrackList *tracklist, const gchar *id)
+{
+	const gchar *stored;
+	guint row;
+
+	if (tracklist->free_rows->len > 0) {
+		row = g_array_index (tracklist->free_rows, guint, tracklist->free_rows->len - 1);
+		g_array_set_size (tracklist->free_rows, tracklist->free_rows->len - 1);
+	}
+	else {
+		/* The columns are cleared arrays, so the new values are zero. */
+		row = tracklist->ids->len;
+		g_array_set_size (tracklist->ids, row + 1);
+		g_array_set_size (tracklist->titles, row + 1);
+		g_array_set_size (tracklist->urls, row + 1);
+		g_array_set_size (tracklist->art_urls, row + 1);
+		g_array_set_size (tracklist->artists, row + 1);
+		g_array_set_size (tracklist->albums, row + 1);
+		g_array_set_size (tracklist->lengths, row + 1);
+		g_array_set_size (tracklist->track_nos, row + 1);
+		g_array_set_size (tracklist->flags, row + 1);
+	}
+
+	stored = mpris2_tracklist_store (tracklist, id);
+	COLUMN (tracklist, ids, const gchar *, row) = stored;
+	g_hash_table_insert (tracklist->rows, (gpointer) stored, GUINT_TO_POINTER (row + 1));
+
+	return row;
+}
+
+static void
+mpris2_tracklist_clear_metadata (Mpris2TrackList *tracklist, guint row)
+{
+	mpris2_tracklist_discard (tracklist, COLUMN (tracklist, titles, const gchar *, row));
+	mpris2_tracklist_discard (tracklist, COLUMN (tracklist, urls, const gchar *, row));
+	mpris2_tracklist_discard (tracklist, COLUMN (tracklist, art_urls, const gchar *, row));
+
+	COLUMN (tracklist, titles, const gchar *, row) = NULL;
+	COLUMN (tracklist, urls, const gchar *, row) = NULL;
+	COLUMN (tracklist, art_urls, const gchar *, row) = NULL;
+	COLUMN (tracklist, artists, guint32, row) = 0;
+	COLUMN (tracklist, albums, guint32, row) = 0;
+	COLUMN (tracklist, lengths, gint64, row) = 0;
+	COLUMN (tracklist, track_nos, guint32, row) = 0;
+}
+
+static void
+mpris2_tracklist_free_row (Mpris2TrackList *tracklist, guint row)
+{
+	const gchar *id = COLUMN (tracklist, ids, const gchar *, row);
+
+	g_hash_table_remove (tracklist->rows, id);
+	mpris2_tracklist_discard (tracklist, id);
+	COLUMN (tracklist, ids, const gchar *, row) = NULL;
+
+	mpris2_tracklist_clear_metadata (tracklist, row);
+	COLUMN (tracklist, flags, guint8, row) = 0;
+
+	g_array_append_val (tracklist->free_rows, row);
+}
+
+static gint
+mpris2_tracklist_index_of_row (Mpris2TrackList *tracklist, guint row, guint hint)
+{
+	guint i;
+
+	if (hint < tracklist->order->len && ROW_AT (tracklist, hint) == row)
+		return hint;
+
+	for (i = 0; i < tracklist->order->len; i++) {
+		if (ROW_AT (tracklist, i) == row)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Tracklist.
+ */
+
+static GArray *
+mpris2_tracklist_new_column (guint element_size)
+{
+	return g_array_new (FALSE, TRUE, element_size);
+}
+
+Mpris2TrackList *
+mpris2_tracklist_new (void)
+{
+	Mpris2TrackList *tracklist;
+
+	tracklist = g_slice_new0 (Mpris2TrackList);
+
+	tracklist->order = g_array_new (FALSE, FALSE, sizeof (guint));
+	tracklist->free_rows = g_array_new (FALSE, FALSE, sizeof (guint));
+	tracklist->rows = g_hash_table_new (g_str_hash, g_str_equal);
+
+	tracklist->ids = mpris2_tracklist_new_column (sizeof (const gchar *));
+	tracklist->titles = mpris2_tracklist_new_column (sizeof (const gchar *));
+	tracklist->urls = mpris2_tracklist_new_column (sizeof (const gchar *));
+	tracklist->art_urls = mpris2_tracklist_new_column (sizeof (const gchar *));
+	tracklist->artists = mpris2_tracklist_new_column (sizeof (guint32));
+	tracklist->albums = mpris2_tracklist_new_column (sizeof (guint32));
+	tracklist->lengths = mpris2_tracklist_new_column (sizeof (gint64));
+	tracklist->track_nos = mpris2_tracklist_new_column (sizeof (guint32));
+	tracklist->flags = mpris2_tracklist_new_column (sizeof (guint8));
+
+	mpris2_tracklist_new_arena (tracklist);
+
+	return tracklist;
+}
+
+void
+mpris2_tracklist_free (Mpris2TrackList *tracklist)
+{
+	g_array_free (tracklist->order, TRUE);
+	g_array_free (tracklist->free_rows, TRUE);
+	g_hash_table_destroy (tracklist->rows);
+
+	g_array_free (tracklist->ids, TRUE);
+	g_array_free (tracklist->titles, TRUE);
+	g_array_free (tracklist->urls, TRUE);
+	g_array_free (tracklist->art_urls, TRUE);
+	g_array_free (tracklist->artists, TRUE);
+	g_array_free (tracklist->albums, TRUE);
+	g_array_free (tracklist->lengths, TRUE);
+	g_array_free (tracklist->track_nos, TRUE);
+	g_array_free (tracklist->flags, TRUE);
+
+	g_hash_table_destroy (tracklist->interned_ids);
+	g_ptr_array_free (tracklist->interned, TRUE);
+	g_string_chunk_free (tracklist->arena);
+
+	g_slice_free (Mpris2TrackList, tracklist);
+}
+
+guint
+mpris2_tracklist_get_length (Mpris2TrackList *tracklist)
+{
+	return tracklist->order->len;
+}
+
+/* Valid until the tracklist changes. */
+
+const gchar *
+mpris2_tracklist_get_id (Mpris2TrackList *tracklist, guint index)
+{
+	if (index >= tracklist->order->len)
+		return NULL;
+
+	return COLUMN (tracklist, ids, const gchar *, ROW_AT (tracklist, index));
+}
+
+gboolean
+mpris2_tracklist_contains (Mpris2TrackList *tracklist, const gchar *id)
+{
+	return g_hash_table_lookup (tracklist->rows, id) != NULL;
+}
+
+/* The position of @id, looking first at @hint. Returns -1 if unknown. */
+
+gint
+mpris2_tracklist_index (Mpris2TrackList *tracklist, const gchar *id, guint hint)
+{
+	gint row;
+
+	row = mpris2_tracklist_lookup_row (tracklist, id);
+	if (row < 0)
+		return -1;
+
+	return mpris2_tracklist_index_of_row (tracklist, row, hint);
+}
+
+/* @id must not be in the tracklist yet. */
+
+void
+mpris2_tracklist_insert (Mpris2TrackList *tracklist, guint index, const gchar *id)
+{
+	guint row;
+
+	row = mpris2_tracklist_new_row (tracklist, id);
+
+	index = MIN (index, tracklist->order->len);
+	g_array_insert_val (tracklist->order, index, row);
+
+	if (index < tracklist->fetch_cursor)
+		tracklist->fetch_cursor++;
+}
+
+/* Returns the index the track had, or -1 if unknown. */
+
+gint
+mpris2_tracklist_remove (Mpris2TrackList *tracklist, const gchar *id)
+{
+	gint row, index;
+
+	row = mpris2_tracklist_lookup_row (tracklist, id);
+	if (row < 0)
+		return -1;
+
+	index = mpris2_tracklist_index_of_row (tracklist, row, 0);
+	g_array_remove_index (tracklist->order, index);
+	mpris2_tracklist_free_row (tracklist, row);
+
+	if ((guint) index < tracklist->fetch_cursor)
+		tracklist->fetch_cursor--;
+
+	mpris2_tracklist_compact (tracklist);
+
+	return index;
+}
+
+/* The tracks still in the list keep their metadata. */
+
+void
+mpris2_tracklist_replace (Mpris2TrackList *tracklist, GVariant *ids)
+{
+	GArray *previous;
+	GVariantIter iter;
+	const gchar *id;
+	gint row;
+	guint i;
+
+	previous = tracklist->order;
+	tracklist->order = g_array_sized_new (FALSE, FALSE, sizeof (guint), g_variant_n_children (ids));
+	tracklist->fetch_cursor = 0;
+
+	g_variant_iter_init (&iter, ids);
+	while (g_variant_iter_next (&iter, "&o", &id)) {
+		row = mpris2_tracklist_lookup_row (tracklist, id);
+		if (row < 0)
+			row = mpris2_tracklist_new_row (tracklist, id);
+		else if (COLUMN (tracklist, flags, guint8, row) & TRACK_KEPT)
+			continue;
+
+		COLUMN (tracklist, flags, guint8, row) |= TRACK_KEPT;
+		g_array_append_val (tracklist->order, row);
+	}
+
+	for (i = 0; i < previous->len; i++) {
+		row = g_array_index (previous, guint, i);
+		if ((COLUMN (tracklist, flags, guint8, row) & TRACK_KEPT) == 0)
+			mpris2_tracklist_free_row (tracklist, row);
+	}
+	for (i = 0; i < tracklist->order->len; i++)
+		COLUMN (tracklist, flags, guint8, ROW_AT (tracklist, i)) &= ~TRACK_KEPT;
+
+	g_array_free (previous, TRUE);
+
+	mpris2_tracklist_compact (tracklist);
+}
+
+/*
+ * Metadata.
+ */
+
+static const gchar *
+mpris2_metadata_value_get_string (GVariant *value)
+{
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING) ||
+	    g_variant_is_of_type (value, G_VARIANT_TYPE_OBJECT_PATH))
+		return g_variant_get_string (value, NULL);
+
+	/* Lists, as the artists, are reduced to the first one. */
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY) &&
+	    g_variant_n_children (value) > 0) {
+		const gchar *string;
+
+		g_variant_get_child (value, 0, "&s", &string);
+		return string;
+	}
+
+	return NULL;
+}
+
+/* Only the fields of Mpris2Metadata are kept, the message is not. Returns
+ * the position of the track, or -1 if not in the tracklist. */
+
+gint
+mpris2_tracklist_set_metadata (Mpris2TrackList *tracklist, const gchar *id, GVariant *metadata, guint hint)
+{
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key, *string;
+	gint row;
+
+	row = mpris2_tracklist_lookup_row (tracklist, id);
+	if (row < 0)
+		return -1;
+
+	mpris2_tracklist_clear_metadata (tracklist, row);
+
+	g_variant_iter_init (&iter, metadata);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		if (0 == g_ascii_strcasecmp (key, "xesam:title")) {
+			if ((string = mpris2_metadata_value_get_string (value)) != NULL)
+				COLUMN (tracklist, titles, const gchar *, row) = mpris2_tracklist_store (tracklist, string);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "xesam:url")) {
+			if ((string = mpris2_metadata_value_get_string (value)) != NULL)
+				COLUMN (tracklist, urls, const gchar *, row) = mpris2_tracklist_store (tracklist, string);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "mpris:artUrl")) {
+			/* As in the state cache, data: art is too big to keep for each track. */
+			if ((string = mpris2_metadata_value_get_string (value)) != NULL &&
+			    !g_str_has_prefix (string, "data:"))
+				COLUMN (tracklist, art_urls, const gchar *, row) = mpris2_tracklist_store (tracklist, string);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "xesam:artist")) {
+			COLUMN (tracklist, artists, guint32, row) =
+				mpris2_tracklist_intern (tracklist, mpris2_metadata_value_get_string (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "xesam:album")) {
+			COLUMN (tracklist, albums, guint32, row) =
+				mpris2_tracklist_intern (tracklist, mpris2_metadata_value_get_string (value));
+		}
+		else if (0 == g_ascii_strcasecmp (key, "mpris:length")) {
+			if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64))
+				COLUMN (tracklist, lengths, gint64, row) = g_variant_get_int64 (value);
+			else if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT64))
+				COLUMN (tracklist, lengths, gint64, row) = g_variant_get_uint64 (value);
+		}
+		else if (0 == g_ascii_strcasecmp (key, "xesam:trackNumber")) {
+			if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32))
+				COLUMN (tracklist, track_nos, guint32, row) = MAX (g_variant_get_int32 (value), 0);
+		}
+		g_variant_unref (value);
+	}
+
+	COLUMN (tracklist, flags, guint8, row) |= TRACK_HAS_METADATA;
+	COLUMN (tracklist, flags, guint8, row) &= ~TRACK_REQUESTED;
+
+	mpris2_tracklist_compact (tracklist);
+
+	return mpris2_tracklist_index_of_row (tracklist, row, hint);
+}
+
+/* A view of the columns of @id, to free with mpris2_metadata_free().
+ * NULL if unknown or not received yet. */
+
+Mpris2Metadata *
+mpris2_tracklist_get_metadata (Mpris2TrackList *tracklist, const gchar *id)
+{
+	Mpris2Metadata *metadata;
+	gint row;
+
+	row = mpris2_tracklist_lookup_row (tracklist, id);
+	if (row < 0 || (COLUMN (tracklist, flags, guint8, row) & TRACK_HAS_METADATA) == 0)
+		return NULL;
+
+	metadata = mpris2_metadata_new ();
+	mpris2_metadata_set_trackid (metadata, COLUMN (tracklist, ids, const gchar *, row));
+	mpris2_metadata_set_url (metadata, COLUMN (tracklist, urls, const gchar *, row));
+	mpris2_metadata_set_title (metadata, COLUMN (tracklist, titles, const gchar *, row));
+	mpris2_metadata_set_artist (metadata, g_ptr_array_index (tracklist->interned, COLUMN (tracklist, artists, guint32, row)));
+	mpris2_metadata_set_album (metadata, g_ptr_array_index (tracklist->interned, COLUMN (tracklist, albums, guint32, row)));
+	mpris2_metadata_set_length (metadata, COLUMN (tracklist, lengths, gint64, row) / 1000000l);
+	mpris2_metadata_set_track_no (metadata, COLUMN (tracklist, track_nos, guint32, row));
+	mpris2_metadata_set_arturl (metadata, COLUMN (tracklist, art_urls, const gchar *, row));
+
+	return metadata;
+}
+
+/*
+ * Fetching.
+ */
+
+static guint
+mpris2_tracklist_take (Mpris2TrackList *tracklist,
+                       guint            start,
+                       guint            end,
+                       guint            max,
+                       GVariantBuilder *builder,
+                       guint           *first,
+                       guint           *stop)
+{
+	guint8 *flags;
+	guint i, row, n = 0;
+
+	end = MIN (end, tracklist->order->len);
+
+	for (i = start; i < end && n < max; i++) {
+		row = ROW_AT (tracklist, i);
+		flags = &COLUMN (tracklist, flags, guint8, row);
+		if (*flags & (TRACK_HAS_METADATA | TRACK_REQUESTED))
+			continue;
+
+		if (n == 0)
+			*first = i;
+		*flags |= TRACK_REQUESTED;
+		g_variant_builder_add (builder, "o", COLUMN (tracklist, ids, const gchar *, row));
+		n++;
+	}
+	*stop = i;
+
+	return n;
+}
+
+/* Marks as requested up to @max tracks without metadata between @start
+ * and @end, and adds them to @builder. Returns the number added, and
+ * the position of the first one in @first. */
+
+guint
+mpris2_tracklist_take_chunk (Mpris2TrackList *tracklist,
+                             guint            start,
+                             guint            end,
+                             guint            max,
+                             GVariantBuilder *builder,
+                             guint           *first)
+{
+	guint stop;
+
+	return mpris2_tracklist_take (tracklist, start, end, max, builder, first, &stop);
+}
+
+/* As above, going through the whole tracklist in order. */
+
+guint
+mpris2_tracklist_take_next_chunk (Mpris2TrackList *tracklist,
+                                  guint            max,
+                                  GVariantBuilder *builder,
+                                  guint           *first)
+{
+	return mpris2_tracklist_take (tracklist, tracklist->fetch_cursor, G_MAXUINT, max,
+	                              builder, first, &tracklist->fetch_cursor);
+}
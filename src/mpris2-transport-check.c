@@ -0,0 +1,875 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Runs the same calls, signals and name watches on each transport built
+ * in, against a private dbus-daemon and a player served by GDBus. The
+ * values seen by the client must be the same with every backend, and
+ * the time and cpu taken by each one are printed to compare them.
+ *
+ * Then a Mpris2Client on each transport follows the player, and a second
+ * one: the PropertiesChanged of each must reach only its own state, the
+ * tracklist must follow the TrackList signals, and switching players
+ * must give the state of the other one.
+ *
+ * Messages without reply are sent both built each time and from a
+ * template, as the player commands. Their time until the player got them
+ * is printed, with the time taken by the sender alone in parentheses.
+ *
+ *   mpris2-transport-check [rounds]
+ *
+ * The cpu includes the player served in the same process, which is the
+ * same for all the backends.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libmpris2client-private.h"
+
+#define CHECK_NAME        "org.mpris.MediaPlayer2.transportcheck"
+#define CHECK_SECOND_NAME "org.mpris.MediaPlayer2.transportcheck2"
+#define CHECK_PATH        "/org/mpris/MediaPlayer2"
+#define CHECK_TIMEOUT     (10 * G_USEC_PER_SEC)
+#define CHECK_POSITION    G_GINT64_CONSTANT (123456789)
+
+/* Tells automake the check was skipped. */
+#define CHECK_SKIP        77
+
+typedef struct {
+	const gchar *name;
+	void       (*new_for_address) (const gchar *address,
+	                               GCancellable *cancellable,
+	                               Mpris2TransportReadyFunc callback,
+	                               gpointer user_data);
+} CheckBackend;
+
+static const CheckBackend check_backends[] = {
+	{ "gdbus",  mpris2_transport_gdbus_new_for_address },
+#ifdef HAVE_SD_BUS
+	{ "sd-bus", mpris2_transport_sdbus_new_for_address },
+#endif
+};
+
+static const gchar check_player_xml[] =
+	"<node>"
+	"  <interface name='org.mpris.MediaPlayer2'>"
+	"    <property name='Identity' type='s' access='read'/>"
+	"    <property name='HasTrackList' type='b' access='read'/>"
+	"  </interface>"
+	"  <interface name='org.mpris.MediaPlayer2.Player'>"
+	"    <method name='Next'/>"
+	"    <property name='PlaybackStatus' type='s' access='read'/>"
+	"    <property name='Volume' type='d' access='read'/>"
+	"    <property name='Position' type='x' access='read'/>"
+	"    <property name='Metadata' type='a{sv}' access='read'/>"
+	"  </interface>"
+	"  <interface name='org.mpris.MediaPlayer2.TrackList'>"
+	"    <method name='GetTracksMetadata'>"
+	"      <arg type='ao' direction='in'/>"
+	"      <arg type='aa{sv}' direction='out'/>"
+	"    </method>"
+	"    <property name='Tracks' type='ao' access='read'/>"
+	"    <property name='CanEditTracks' type='b' access='read'/>"
+	"  </interface>"
+	"  <interface name='org.mpris.MediaPlayer2.TransportCheck'>"
+	"    <method name='Echo'>"
+	"      <arg type='v' direction='in'/>"
+	"      <arg type='v' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+/* The player, on its own GDBus connection, and a second one without
+ * tracklist for the client to switch to. */
+static GDBusConnection *player_connection = NULL;
+static GVariant        *player_metadata = NULL;
+static guint            player_n_next = 0;
+static GDBusConnection *second_connection = NULL;
+static guint            second_owner_id = 0;
+
+/* The backend checked now. */
+static const gchar     *backend_name = NULL;
+static GVariant        *expected = NULL;
+static guint            n_replies = 0;
+static guint            n_signals = 0;
+static guint            n_appeared = 0;
+static guint            n_vanished = 0;
+
+/* Seen by the client. */
+static guint            n_connected = 0;
+static guint            n_volume = 0;
+static gdouble          last_volume = 0;
+static guint            n_tracklist_changed = 0;
+
+static GPid             daemon_pid = 0;
+static gint64           deadline = 0;
+
+/*
+ * Failures.
+ */
+
+static void
+check_stop_daemon (void)
+{
+	if (daemon_pid == 0)
+		return;
+
+	kill (daemon_pid, SIGTERM);
+	g_spawn_close_pid (daemon_pid);
+	daemon_pid = 0;
+}
+
+static void
+check_fail (const gchar *format, ...)
+{
+	va_list args;
+	gchar *message;
+
+	va_start (args, format);
+	message = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	g_printerr ("%s: FAILED: %s\n", backend_name != NULL ? backend_name : "setup", message);
+	g_free (message);
+
+	check_stop_daemon ();
+	exit (EXIT_FAILURE);
+}
+
+static gboolean
+check_wake (gpointer user_data)
+{
+	return TRUE;
+}
+
+static void
+check_wait (const guint *count, guint target, const gchar *what)
+{
+	while (*count < target) {
+		if (g_get_monotonic_time () > deadline)
+			check_fail ("timed out waiting for %s (%u of %u)", what, *count, target);
+		g_main_context_iteration (NULL, TRUE);
+	}
+}
+
+static void
+check_equal (GVariant *value, const gchar *what)
+{
+	gchar *got, *want;
+
+	if (g_variant_equal (value, expected))
+		return;
+
+	got = g_variant_print (value, TRUE);
+	want = g_variant_print (expected, TRUE);
+	check_fail ("%s is %s, expected %s", what, got, want);
+}
+
+static void
+check_sender (const gchar *sender, const gchar *what)
+{
+	if (g_strcmp0 (sender, g_dbus_connection_get_unique_name (player_connection)) != 0)
+		check_fail ("%s comes from %s", what, sender != NULL ? sender : "(null)");
+}
+
+/*
+ * The player.
+ */
+
+static GVariant *
+check_metadata_new (void)
+{
+	GVariantBuilder builder, nested;
+	const gchar *artists[] = { "Artist", "\xc3\x84rtist \xc3\xb1", NULL };
+
+	g_variant_builder_init (&nested, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&nested, "{sv}", "byte", g_variant_new_byte (200));
+	g_variant_builder_add (&nested, "{sv}", "boolean", g_variant_new_boolean (TRUE));
+	g_variant_builder_add (&nested, "{sv}", "int16", g_variant_new_int16 (-7));
+	g_variant_builder_add (&nested, "{sv}", "uint16", g_variant_new_uint16 (G_MAXUINT16));
+	g_variant_builder_add (&nested, "{sv}", "uint32", g_variant_new_uint32 (G_MAXUINT32));
+	g_variant_builder_add (&nested, "{sv}", "uint64", g_variant_new_uint64 (G_MAXUINT64));
+	g_variant_builder_add (&nested, "{sv}", "signature", g_variant_new_signature ("a{sv}"));
+	g_variant_builder_add (&nested, "{sv}", "tuple", g_variant_new ("(si)", "pair", -1));
+	g_variant_builder_add (&nested, "{sv}", "empty", g_variant_new_strv (NULL, 0));
+	g_variant_builder_add (&nested, "{sv}", "variant",
+	                       g_variant_new_variant (g_variant_new_string ("inner")));
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "mpris:trackid",
+	                       g_variant_new_object_path ("/org/mpris/MediaPlayer2/Track/1"));
+	g_variant_builder_add (&builder, "{sv}", "xesam:title",
+	                       g_variant_new_string ("Title \xe2\x80\x93 \xc3\xbcn\xc3\xafcode"));
+	g_variant_builder_add (&builder, "{sv}", "xesam:artist", g_variant_new_strv (artists, -1));
+	g_variant_builder_add (&builder, "{sv}", "mpris:length",
+	                       g_variant_new_int64 (G_GINT64_CONSTANT (245000000)));
+	g_variant_builder_add (&builder, "{sv}", "xesam:trackNumber", g_variant_new_int32 (3));
+	g_variant_builder_add (&builder, "{sv}", "xesam:userRating", g_variant_new_double (0.75));
+	g_variant_builder_add (&builder, "{sv}", "check:nested", g_variant_builder_end (&nested));
+
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static GVariant *
+check_track_metadata_new (const gchar *id)
+{
+	GVariantBuilder builder;
+	gchar *title;
+
+	title = g_strconcat ("Title of ", id, NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "mpris:trackid", g_variant_new_object_path (id));
+	g_variant_builder_add (&builder, "{sv}", "xesam:title", g_variant_new_string (title));
+
+	g_free (title);
+
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+check_tracks_metadata_new (GVariant *parameters)
+{
+	GVariantBuilder builder;
+	GVariantIter *iter;
+	const gchar *id;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+	g_variant_get (parameters, "(ao)", &iter);
+	while (g_variant_iter_next (iter, "&o", &id))
+		g_variant_builder_add_value (&builder, check_track_metadata_new (id));
+	g_variant_iter_free (iter);
+
+	return g_variant_new ("(aa{sv})", &builder);
+}
+
+static void
+check_player_method_call (GDBusConnection       *connection,
+                          const gchar           *sender,
+                          const gchar           *object_path,
+                          const gchar           *interface_name,
+                          const gchar           *method_name,
+                          GVariant              *parameters,
+                          GDBusMethodInvocation *invocation,
+                          gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "Next") == 0) {
+		player_n_next++;
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	}
+	else if (g_strcmp0 (method_name, "GetTracksMetadata") == 0) {
+		g_dbus_method_invocation_return_value (invocation, check_tracks_metadata_new (parameters));
+	}
+	else {
+		g_dbus_method_invocation_return_value (invocation, parameters);
+	}
+}
+
+static GVariant *
+check_player_get_property (GDBusConnection  *connection,
+                           const gchar      *sender,
+                           const gchar      *object_path,
+                           const gchar      *interface_name,
+                           const gchar      *property_name,
+                           GError          **error,
+                           gpointer          user_data)
+{
+	const gchar *tracks[] = { "/check/track/1", "/check/track/2", "/check/track/3", NULL };
+	gboolean second = connection == second_connection;
+
+	if (g_strcmp0 (property_name, "Identity") == 0)
+		return g_variant_new_string (second ? "Second" : "Check");
+	if (g_strcmp0 (property_name, "HasTrackList") == 0)
+		return g_variant_new_boolean (!second);
+	if (g_strcmp0 (property_name, "PlaybackStatus") == 0)
+		return g_variant_new_string ("Paused");
+	if (g_strcmp0 (property_name, "Volume") == 0)
+		return g_variant_new_double (second ? 0.25 : 1.0);
+	if (g_strcmp0 (property_name, "Tracks") == 0)
+		return g_variant_new_objv (tracks, -1);
+	if (g_strcmp0 (property_name, "CanEditTracks") == 0)
+		return g_variant_new_boolean (FALSE);
+	if (g_strcmp0 (property_name, "Position") == 0)
+		return g_variant_new_int64 (CHECK_POSITION);
+
+	return g_variant_ref (player_metadata);
+}
+
+static const GDBusInterfaceVTable check_player_vtable = {
+	check_player_method_call,
+	check_player_get_property,
+	NULL
+};
+
+static GDBusConnection *
+check_player_connect (const gchar *address, GDBusNodeInfo *info)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+	guint i;
+
+	connection =
+		g_dbus_connection_new_for_address_sync (address,
+		                                        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+		                                        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+		                                        NULL, NULL, &error);
+	if (connection == NULL)
+		check_fail ("could not connect the player: %s", error->message);
+
+	for (i = 0; info->interfaces[i] != NULL; i++) {
+		if (g_dbus_connection_register_object (connection, CHECK_PATH,
+		                                       info->interfaces[i], &check_player_vtable,
+		                                       NULL, NULL, &error) == 0)
+			check_fail ("could not export the player: %s", error->message);
+	}
+
+	return connection;
+}
+
+static void
+check_player_start (const gchar *address)
+{
+	GDBusNodeInfo *info;
+	GError *error = NULL;
+
+	info = g_dbus_node_info_new_for_xml (check_player_xml, &error);
+	if (info == NULL)
+		check_fail ("could not parse the interfaces: %s", error->message);
+
+	player_connection = check_player_connect (address, info);
+	second_connection = check_player_connect (address, info);
+
+	g_dbus_node_info_unref (info);
+
+	player_metadata = check_metadata_new ();
+
+	/* Owned all along, the client only switches to it. */
+	second_owner_id = g_bus_own_name_on_connection (second_connection, CHECK_SECOND_NAME,
+	                                                G_BUS_NAME_OWNER_FLAGS_NONE,
+	                                                NULL, NULL, NULL, NULL);
+}
+
+static void
+check_player_emit (GDBusConnection *connection,
+                   const gchar     *interface_name,
+                   const gchar     *signal_name,
+                   GVariant        *parameters)
+{
+	GError *error = NULL;
+
+	if (!g_dbus_connection_emit_signal (connection, NULL, CHECK_PATH,
+	                                    interface_name, signal_name, parameters, &error))
+		check_fail ("could not emit %s: %s", signal_name, error->message);
+}
+
+static void
+check_player_changed (GDBusConnection *connection, const gchar *property, GVariant *value)
+{
+	GVariantBuilder changed;
+
+	g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&changed, "{sv}", property, value);
+
+	check_player_emit (connection, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+	                   g_variant_new ("(s@a{sv}@as)", "org.mpris.MediaPlayer2.Player",
+	                                  g_variant_builder_end (&changed),
+	                                  g_variant_new_strv (NULL, 0)));
+}
+
+/*
+ * The client side, through the transport.
+ */
+
+static void
+check_ready_cb (Mpris2Transport *transport, const GError *error, gpointer user_data)
+{
+	Mpris2Transport **ret = user_data;
+
+	if (transport == NULL)
+		check_fail ("could not connect: %s", error->message);
+
+	*ret = mpris2_transport_ref (transport);
+	n_replies++;
+}
+
+static void
+check_value_cb (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data)
+{
+	if (reply == NULL)
+		check_fail ("%s failed: %s", (const gchar *) user_data, error->message);
+
+	check_equal (reply, user_data);
+	check_sender (sender, user_data);
+	n_replies++;
+}
+
+static void
+check_error_cb (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data)
+{
+	if (reply != NULL)
+		check_fail ("an unknown method got a reply");
+	if (!g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+		check_fail ("an unknown method failed with: %s", error->message);
+	n_replies++;
+}
+
+static void
+check_cancelled_cb (GVariant *reply, const gchar *sender, const GError *error, gpointer user_data)
+{
+	if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		check_fail ("a cancelled call did not tell it was cancelled");
+	n_replies++;
+}
+
+static void
+check_signal_cb (const gchar *sender,
+                 const gchar *object_path,
+                 const gchar *interface_name,
+                 const gchar *signal_name,
+                 GVariant    *parameters,
+                 gpointer     user_data)
+{
+	check_sender (sender, "a signal");
+	if (g_strcmp0 (object_path, CHECK_PATH) != 0 ||
+	    g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") != 0 ||
+	    g_strcmp0 (signal_name, "PropertiesChanged") != 0)
+		check_fail ("got the signal %s.%s at %s", interface_name, signal_name, object_path);
+
+	check_equal (parameters, "a signal");
+	n_signals++;
+}
+
+static void
+check_appeared_cb (const gchar *name, const gchar *owner, gpointer user_data)
+{
+	check_sender (owner, "the name owner");
+	n_appeared++;
+}
+
+static void
+check_vanished_cb (const gchar *name, const gchar *owner, gpointer user_data)
+{
+	n_vanished++;
+}
+
+static void
+check_call (Mpris2Transport *transport, const gchar *interface_name, const gchar *method_name,
+            GVariant *parameters, Mpris2TransportReplyFunc callback, gpointer user_data)
+{
+	mpris2_transport_call (transport, CHECK_NAME, CHECK_PATH,
+	                       interface_name, method_name, parameters,
+	                       callback == check_value_cb ? G_VARIANT_TYPE ("(v)") : NULL,
+	                       NULL, callback, user_data);
+}
+
+/* A round trip, after which all sent before was handled by the bus. */
+
+static void
+check_round_trip (Mpris2Transport *transport)
+{
+	guint target;
+
+	if (expected != NULL)
+		g_variant_unref (expected);
+	expected = g_variant_ref_sink (g_variant_new ("(v)", g_variant_new_int64 (CHECK_POSITION)));
+
+	target = n_replies + 1;
+	check_call (transport, "org.freedesktop.DBus.Properties", "Get",
+	            g_variant_new ("(ss)", "org.mpris.MediaPlayer2.Player", "Position"),
+	            check_value_cb, "Get Position");
+	check_wait (&n_replies, target, "Get Position");
+}
+
+static gdouble
+check_elapsed (gint64 start, guint rounds)
+{
+	return (gdouble) (g_get_monotonic_time () - start) / rounds;
+}
+
+/*
+ * The client, on the same transport.
+ */
+
+static void
+check_client_connection_cb (Mpris2Client *mpris2, gboolean connected, gpointer user_data)
+{
+	if (connected)
+		n_connected++;
+}
+
+static void
+check_client_volume_cb (Mpris2Client *mpris2, gdouble volume, gpointer user_data)
+{
+	last_volume = volume;
+	n_volume++;
+}
+
+static void
+check_client_tracklist_cb (Mpris2Client *mpris2, guint position, guint removed, guint added,
+                           gpointer user_data)
+{
+	n_tracklist_changed++;
+}
+
+/* Whether the client has the tracks @ids in order, with their metadata. */
+
+static gboolean
+check_client_has_tracks (Mpris2Client *mpris2, const gchar * const *ids)
+{
+	Mpris2Metadata *metadata;
+	gchar *id, *title;
+	gboolean same;
+	guint i;
+
+	if (mpris2_client_get_n_tracks (mpris2) != g_strv_length ((gchar **) ids))
+		return FALSE;
+
+	for (i = 0; ids[i] != NULL; i++) {
+		id = mpris2_client_get_track_id (mpris2, i);
+		metadata = id != NULL ? mpris2_client_get_track_metadata (mpris2, id) : NULL;
+
+		same = FALSE;
+		if (metadata != NULL) {
+			title = g_strconcat ("Title of ", ids[i], NULL);
+			same = g_strcmp0 (id, ids[i]) == 0 &&
+			       g_strcmp0 (mpris2_metadata_get_title (metadata), title) == 0;
+			g_free (title);
+			mpris2_metadata_free (metadata);
+		}
+		g_free (id);
+
+		if (!same)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+check_client_wait_tracks (Mpris2Client *mpris2, const gchar * const *ids, const gchar *what)
+{
+	while (!check_client_has_tracks (mpris2, ids))
+		check_wait (&n_tracklist_changed, n_tracklist_changed + 1, what);
+}
+
+static void
+check_client_identity (Mpris2Client *mpris2, const gchar *identity)
+{
+	if (g_strcmp0 (mpris2_client_get_player_identity (mpris2), identity) != 0)
+		check_fail ("the client follows %s, expected %s",
+		            mpris2_client_get_player_identity (mpris2), identity);
+}
+
+static void
+check_client_volume (Mpris2Client *mpris2, gdouble volume)
+{
+	if (mpris2_client_get_volume (mpris2) != volume)
+		check_fail ("the volume is %g, expected %g", mpris2_client_get_volume (mpris2), volume);
+}
+
+static void
+check_client (Mpris2Transport *transport)
+{
+	const gchar *tracks[] = { "/check/track/1", "/check/track/2", "/check/track/3", NULL };
+	const gchar *added[] = { "/check/track/1", "/check/track/2", "/check/track/4", "/check/track/3", NULL };
+	const gchar *removed[] = { "/check/track/2", "/check/track/4", "/check/track/3", NULL };
+	Mpris2Client *mpris2;
+	guint target;
+
+	n_connected = n_volume = n_tracklist_changed = 0;
+
+	mpris2 = mpris2_client_new_for_transport (transport);
+	g_signal_connect (mpris2, "connection", G_CALLBACK (check_client_connection_cb), NULL);
+	g_signal_connect (mpris2, "volume", G_CALLBACK (check_client_volume_cb), NULL);
+	g_signal_connect (mpris2, "tracklist-changed", G_CALLBACK (check_client_tracklist_cb), NULL);
+
+	/* The tracklist is fetched with the state, once connected. */
+	mpris2_client_set_player (mpris2, "transportcheck");
+	check_wait (&n_connected, 1, "the client to connect");
+	check_wait (&n_volume, 1, "the state of the player");
+	check_client_identity (mpris2, "Check");
+	check_client_volume (mpris2, 1.0);
+	check_client_wait_tracks (mpris2, tracks, "the tracklist");
+
+	/* Then it follows the signals. */
+	check_player_emit (player_connection, "org.mpris.MediaPlayer2.TrackList", "TrackAdded",
+	                   g_variant_new ("(@a{sv}o)", check_track_metadata_new ("/check/track/4"),
+	                                  "/check/track/2"));
+	check_client_wait_tracks (mpris2, added, "a track added");
+
+	check_player_emit (player_connection, "org.mpris.MediaPlayer2.TrackList", "TrackRemoved",
+	                   g_variant_new ("(o)", "/check/track/1"));
+	check_client_wait_tracks (mpris2, removed, "a track removed");
+
+	target = n_volume + 1;
+	check_player_changed (player_connection, "Volume", g_variant_new_double (0.5));
+	check_wait (&n_volume, target, "the volume");
+	check_client_volume (mpris2, 0.5);
+
+	/* Switching gives the state of the other player, without tracklist. */
+	target = n_volume + 1;
+	mpris2_client_set_player (mpris2, "transportcheck2");
+	check_wait (&n_connected, 2, "the client to switch");
+	check_wait (&n_volume, target, "the state of the second player");
+	check_client_identity (mpris2, "Second");
+	check_client_volume (mpris2, 0.25);
+	if (mpris2_client_get_n_tracks (mpris2) != 0)
+		check_fail ("the second player has %u tracks", mpris2_client_get_n_tracks (mpris2));
+
+	/* The previous player is on standby, its changes must not reach the
+	 * current one. The round trip to it makes sure they were received. */
+	check_player_changed (player_connection, "Volume", g_variant_new_double (0.125));
+	g_dbus_connection_flush_sync (player_connection, NULL, NULL);
+
+	target = n_volume + 1;
+	check_player_changed (second_connection, "Volume", g_variant_new_double (0.75));
+	check_wait (&n_volume, target, "the volume of the second player");
+	check_round_trip (transport);
+
+	if (n_volume != target || last_volume != 0.75)
+		check_fail ("the volume of the player on standby was told as current");
+	check_client_volume (mpris2, 0.75);
+
+	/* But kept for when it is current again. */
+	mpris2_client_set_player (mpris2, "transportcheck");
+	check_client_identity (mpris2, "Check");
+	check_client_volume (mpris2, 0.125);
+
+	g_object_unref (mpris2);
+}
+
+/*
+ * Each backend.
+ */
+
+static void
+check_backend (const CheckBackend *backend, const gchar *address, guint rounds)
+{
+	Mpris2Transport *transport = NULL;
+	GCancellable *cancellable;
+	GVariant *reply;
+	GError *error = NULL;
+	Mpris2TransportMessage *message;
+	gdouble call_us, signal_us, send_us, send_queue_us, template_us, template_queue_us;
+	clock_t cpu;
+	gint64 start;
+	guint i, watch_id, owned_watch_id, owner_id, subscription_id;
+
+	backend_name = backend->name;
+	n_replies = n_signals = n_appeared = n_vanished = 0;
+	player_n_next = 0;
+	deadline = g_get_monotonic_time () + CHECK_TIMEOUT;
+
+	cpu = clock ();
+
+	backend->new_for_address (address, NULL, check_ready_cb, &transport);
+	check_wait (&n_replies, 1, "the connection");
+
+	/* A name without owner is told as vanished first. */
+	watch_id = mpris2_transport_watch_name (transport, CHECK_NAME,
+	                                        check_appeared_cb, check_vanished_cb, NULL);
+	check_wait (&n_vanished, 1, "the name without owner");
+
+	owner_id = g_bus_own_name_on_connection (player_connection, CHECK_NAME,
+	                                         G_BUS_NAME_OWNER_FLAGS_NONE,
+	                                         NULL, NULL, NULL, NULL);
+	check_wait (&n_appeared, 1, "the name owner");
+
+	/* And watched once owned, as appeared at first. */
+	owned_watch_id = mpris2_transport_watch_name (transport, CHECK_NAME,
+	                                              check_appeared_cb, check_vanished_cb, NULL);
+	check_wait (&n_appeared, 2, "the name watched once owned");
+	if (n_vanished != 1)
+		check_fail ("a name with owner was told as vanished");
+
+	/* Round trips. */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++)
+		check_round_trip (transport);
+	call_us = check_elapsed (start, rounds);
+
+	/* Every type, both ways. */
+	g_variant_unref (expected);
+	expected = g_variant_ref_sink (g_variant_new ("(v)", player_metadata));
+	check_call (transport, "org.freedesktop.DBus.Properties", "Get",
+	            g_variant_new ("(ss)", "org.mpris.MediaPlayer2.Player", "Metadata"),
+	            check_value_cb, "Get Metadata");
+	check_call (transport, "org.mpris.MediaPlayer2.TransportCheck", "Echo",
+	            g_variant_new ("(v)", player_metadata),
+	            check_value_cb, "Echo");
+	check_wait (&n_replies, rounds + 3, "the metadata");
+
+	reply = mpris2_transport_call_sync (transport, CHECK_NAME, CHECK_PATH,
+	                                    "org.freedesktop.DBus.Properties", "Get",
+	                                    g_variant_new ("(ss)", "org.mpris.MediaPlayer2.Player", "Metadata"),
+	                                    G_VARIANT_TYPE ("(v)"), &error);
+	if (reply == NULL)
+		check_fail ("a blocking call failed: %s", error->message);
+	check_equal (reply, "a blocking call");
+	g_variant_unref (reply);
+
+	/* Errors, and cancelled calls. */
+	check_call (transport, "org.mpris.MediaPlayer2.Player", "Unknown",
+	            NULL, check_error_cb, NULL);
+	check_wait (&n_replies, rounds + 4, "the error");
+
+	cancellable = g_cancellable_new ();
+	mpris2_transport_call (transport, CHECK_NAME, CHECK_PATH,
+	                       "org.freedesktop.DBus.Properties", "Get",
+	                       g_variant_new ("(ss)", "org.mpris.MediaPlayer2.Player", "Position"),
+	                       G_VARIANT_TYPE ("(v)"), cancellable, check_cancelled_cb, NULL);
+	g_cancellable_cancel (cancellable);
+	g_object_unref (cancellable);
+	check_wait (&n_replies, rounds + 5, "the cancelled call");
+
+	/* Signals, once the match is surely on the bus. */
+	subscription_id =
+		mpris2_transport_signal_subscribe (transport,
+		                                   g_dbus_connection_get_unique_name (player_connection),
+		                                   "org.freedesktop.DBus.Properties",
+		                                   "PropertiesChanged",
+		                                   CHECK_PATH,
+		                                   NULL,
+		                                   check_signal_cb, NULL);
+	check_round_trip (transport);
+
+	g_variant_unref (expected);
+	expected = g_variant_ref_sink (g_variant_new_parsed ("('org.mpris.MediaPlayer2.Player', "
+	                                                     "{'Metadata': <%@a{sv}>, 'Rate': <1.5>}, "
+	                                                     "['Position'])",
+	                                                     player_metadata));
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++)
+		g_dbus_connection_emit_signal (player_connection, NULL, CHECK_PATH,
+		                               "org.freedesktop.DBus.Properties", "PropertiesChanged",
+		                               expected, NULL);
+	check_wait (&n_signals, rounds, "the signals");
+	signal_us = check_elapsed (start, rounds);
+
+	mpris2_transport_signal_unsubscribe (transport, subscription_id);
+
+	/* Messages without reply. */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++)
+		mpris2_transport_send (transport, CHECK_NAME, CHECK_PATH,
+		                       "org.mpris.MediaPlayer2.Player", "Next", NULL);
+	send_queue_us = check_elapsed (start, rounds);
+	check_wait (&player_n_next, rounds, "the messages sent");
+	send_us = check_elapsed (start, rounds);
+
+	message = mpris2_transport_message_new (transport, CHECK_NAME, CHECK_PATH,
+	                                        "org.mpris.MediaPlayer2.Player", "Next");
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++)
+		mpris2_transport_message_send (transport, message);
+	template_queue_us = check_elapsed (start, rounds);
+	check_wait (&player_n_next, 2 * rounds, "the messages from a template");
+	template_us = check_elapsed (start, rounds);
+	mpris2_transport_message_free (transport, message);
+
+	/* The client, with a deadline of its own. */
+	deadline = g_get_monotonic_time () + CHECK_TIMEOUT;
+	check_client (transport);
+
+	/* Both watches see it go. */
+	g_bus_unown_name (owner_id);
+	check_wait (&n_vanished, 3, "the name to vanish");
+	mpris2_transport_unwatch_name (transport, owned_watch_id);
+	mpris2_transport_unwatch_name (transport, watch_id);
+
+	mpris2_transport_unref (transport);
+
+	g_print ("%-7s ok: call %.1f us, signal %.1f us, send %.1f (%.2f) us, "
+	         "template %.1f (%.2f) us, cpu %.1f ms\n",
+	         backend->name, call_us, signal_us, send_us, send_queue_us,
+	         template_us, template_queue_us,
+	         (gdouble) (clock () - cpu) * 1000 / CLOCKS_PER_SEC);
+
+	g_variant_unref (expected);
+	expected = NULL;
+	backend_name = NULL;
+}
+
+/*
+ * Private bus.
+ */
+
+static gchar *
+check_start_daemon (void)
+{
+	gchar *argv[] = { "dbus-daemon", "--session", "--nofork", "--print-address", NULL };
+	GIOChannel *channel;
+	GError *error = NULL;
+	gchar *address = NULL;
+	gint out;
+
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+	                               &daemon_pid, NULL, &out, NULL, &error)) {
+		g_printerr ("skipped, could not start dbus-daemon: %s\n", error->message);
+		exit (CHECK_SKIP);
+	}
+
+	channel = g_io_channel_unix_new (out);
+	g_io_channel_set_close_on_unref (channel, TRUE);
+	if (g_io_channel_read_line (channel, &address, NULL, NULL, &error) != G_IO_STATUS_NORMAL)
+		check_fail ("could not read the address of the bus: %s",
+		            error != NULL ? error->message : "end of file");
+	g_io_channel_unref (channel);
+
+	return g_strstrip (address);
+}
+
+int
+main (int argc, char *argv[])
+{
+	gchar *address;
+	guint i, rounds = 1000;
+
+#if !GLIB_CHECK_VERSION(2, 35, 0)
+	g_type_init();
+#endif
+
+	if (argc > 1)
+		rounds = MAX (atoi (argv[1]), 1);
+
+	address = check_start_daemon ();
+	check_player_start (address);
+
+	/* Check the deadline even if nothing comes. */
+	g_timeout_add (100, check_wake, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (check_backends); i++)
+		check_backend (&check_backends[i], address, rounds);
+
+	g_bus_unown_name (second_owner_id);
+	g_object_unref (second_connection);
+	g_object_unref (player_connection);
+	g_variant_unref (player_metadata);
+	g_free (address);
+
+	check_stop_daemon ();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,504 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Transport on a GDBusConnection, the default one.
+ */
+
+#include "mpris2-transport.h"
+
+typedef struct {
+	Mpris2Transport  parent;
+	GDBusConnection *connection;
+} Mpris2TransportGDBus;
+
+typedef struct {
+	Mpris2TransportReplyFunc  callback;
+	gpointer                  user_data;
+	GVariantType             *reply_type;
+} GDBusCall;
+
+typedef struct {
+	Mpris2TransportSignalFunc callback;
+	gpointer                  user_data;
+} GDBusSubscription;
+
+typedef struct {
+	Mpris2TransportNameFunc   appeared;
+	Mpris2TransportNameFunc   vanished;
+	gpointer                  user_data;
+} GDBusWatch;
+
+typedef struct {
+	Mpris2TransportReadyFunc  callback;
+	gpointer                  user_data;
+} GDBusReady;
+
+#define MPRIS2_TRANSPORT_GDBUS(transport) ((Mpris2TransportGDBus *) (transport))
+
+/*
+ * Method calls.
+ */
+
+/* The reply is taken as a message, for the unique name of the sender. */
+
+static void
+gdbus_call_ready (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+	GDBusMessage *reply;
+	GVariant *body = NULL;
+	GError *error = NULL;
+	GDBusCall *call = user_data;
+
+	reply = g_dbus_connection_send_message_with_reply_finish (G_DBUS_CONNECTION(source_object),
+	                                                          res, &error);
+	if (reply != NULL && !g_dbus_message_to_gerror (reply, &error)) {
+		body = g_dbus_message_get_body (reply);
+		if (body == NULL)
+			body = g_variant_new_tuple (NULL, 0);
+		g_variant_ref_sink (body);
+
+		if (call->reply_type != NULL && !g_variant_is_of_type (body, call->reply_type)) {
+			g_set_error (&error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			             "Method returned type '%s', but expected '%s'",
+			             g_variant_get_type_string (body),
+			             g_variant_type_peek_string (call->reply_type));
+			g_variant_unref (body);
+			body = NULL;
+		}
+	}
+
+	call->callback (body, body != NULL ? g_dbus_message_get_sender (reply) : NULL,
+	                error, call->user_data);
+
+	if (body != NULL)
+		g_variant_unref (body);
+	if (reply != NULL)
+		g_object_unref (reply);
+	g_clear_error (&error);
+
+	if (call->reply_type != NULL)
+		g_variant_type_free (call->reply_type);
+	g_slice_free (GDBusCall, call);
+}
+
+static void
+gdbus_call (Mpris2Transport          *transport,
+            const gchar              *destination,
+            const gchar              *object_path,
+            const gchar              *interface_name,
+            const gchar              *method_name,
+            GVariant                 *parameters,
+            const GVariantType       *reply_type,
+            GCancellable             *cancellable,
+            Mpris2TransportReplyFunc  callback,
+            gpointer                  user_data)
+{
+	GDBusMessage *message;
+	GDBusCall *call;
+
+	message = g_dbus_message_new_method_call (destination, object_path,
+	                                          interface_name, method_name);
+	if (parameters != NULL)
+		g_dbus_message_set_body (message, parameters);
+
+	call = g_slice_new0 (GDBusCall);
+	call->callback = callback;
+	call->user_data = user_data;
+	if (reply_type != NULL)
+		call->reply_type = g_variant_type_copy (reply_type);
+
+	g_dbus_connection_send_message_with_reply (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                           message,
+	                                           G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+	                                           -1,
+	                                           NULL,
+	                                           cancellable,
+	                                           gdbus_call_ready,
+	                                           call);
+
+	g_object_unref (message);
+}
+
+static GVariant *
+gdbus_call_sync (Mpris2Transport     *transport,
+                 const gchar         *destination,
+                 const gchar         *object_path,
+                 const gchar         *interface_name,
+                 const gchar         *method_name,
+                 GVariant            *parameters,
+                 const GVariantType  *reply_type,
+                 GError             **error)
+{
+	return g_dbus_connection_call_sync (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                    destination,
+	                                    object_path,
+	                                    interface_name,
+	                                    method_name,
+	                                    parameters,
+	                                    reply_type,
+	                                    G_DBUS_CALL_FLAGS_NONE,
+	                                    -1,
+	                                    NULL,
+	                                    error);
+}
+
+/* Not flushed, the worker thread writes the queued messages by itself. */
+
+static void
+gdbus_send_message (Mpris2Transport *transport, GDBusMessage *message)
+{
+	GError       *error = NULL;
+
+	g_dbus_connection_send_message (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                message,
+	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+	                                NULL,
+	                                &error);
+	if (error != NULL) {
+		g_warning ("unable to send message: %s", error->message);
+		g_clear_error (&error);
+	}
+}
+
+static void
+gdbus_send (Mpris2Transport *transport,
+            const gchar     *destination,
+            const gchar     *object_path,
+            const gchar     *interface_name,
+            const gchar     *method_name,
+            GVariant        *parameters)
+{
+	GDBusMessage *message;
+
+	message = g_dbus_message_new_method_call (destination, object_path,
+	                                          interface_name, method_name);
+	if (parameters != NULL)
+		g_dbus_message_set_body (message, parameters);
+
+	gdbus_send_message (transport, message);
+
+	g_object_unref (message);
+}
+
+/* Templates are never sent, so they stay unlocked. Each copy shares the
+ * checked header strings and only gets its own serial when sent. */
+
+static gpointer
+gdbus_message_new (Mpris2Transport *transport,
+                   const gchar     *destination,
+                   const gchar     *object_path,
+                   const gchar     *interface_name,
+                   const gchar     *method_name)
+{
+	GDBusMessage *message;
+
+	message = g_dbus_message_new_method_call (destination, object_path,
+	                                          interface_name, method_name);
+	g_dbus_message_set_flags (message, G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED);
+
+	return message;
+}
+
+static void
+gdbus_message_send (Mpris2Transport *transport, gpointer template)
+{
+	GDBusMessage *message;
+	GError *error = NULL;
+
+	message = g_dbus_message_copy (template, &error);
+	if (message == NULL) {
+		g_warning ("unable to copy message: %s", error->message);
+		g_clear_error (&error);
+		return;
+	}
+
+	gdbus_send_message (transport, message);
+
+	g_object_unref (message);
+}
+
+static void
+gdbus_message_free (Mpris2Transport *transport, gpointer template)
+{
+	g_object_unref (template);
+}
+
+/*
+ * Signals.
+ */
+
+static void
+gdbus_signal_cb (GDBusConnection *connection,
+                 const gchar     *sender_name,
+                 const gchar     *object_path,
+                 const gchar     *interface_name,
+                 const gchar     *signal_name,
+                 GVariant        *parameters,
+                 gpointer         user_data)
+{
+	GDBusSubscription *subscription = user_data;
+
+	subscription->callback (sender_name, object_path, interface_name,
+	                        signal_name, parameters, subscription->user_data);
+}
+
+static void
+gdbus_subscription_free (GDBusSubscription *subscription)
+{
+	g_slice_free (GDBusSubscription, subscription);
+}
+
+static guint
+gdbus_signal_subscribe (Mpris2Transport           *transport,
+                        const gchar               *sender,
+                        const gchar               *interface_name,
+                        const gchar               *member,
+                        const gchar               *object_path,
+                        const gchar               *arg0,
+                        Mpris2TransportSignalFunc  callback,
+                        gpointer                   user_data)
+{
+	GDBusSubscription *subscription;
+
+	subscription = g_slice_new0 (GDBusSubscription);
+	subscription->callback = callback;
+	subscription->user_data = user_data;
+
+	return g_dbus_connection_signal_subscribe (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                           sender,
+	                                           interface_name,
+	                                           member,
+	                                           object_path,
+	                                           arg0,
+	                                           G_DBUS_SIGNAL_FLAGS_NONE,
+	                                           gdbus_signal_cb,
+	                                           subscription,
+	                                           (GDestroyNotify) gdbus_subscription_free);
+}
+
+static void
+gdbus_signal_unsubscribe (Mpris2Transport *transport, guint subscription_id)
+{
+	g_dbus_connection_signal_unsubscribe (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                      subscription_id);
+}
+
+/*
+ * Names.
+ */
+
+static void
+gdbus_name_appeared (GDBusConnection *connection,
+                     const gchar     *name,
+                     const gchar     *name_owner,
+                     gpointer         user_data)
+{
+	GDBusWatch *watch = user_data;
+
+	watch->appeared (name, name_owner, watch->user_data);
+}
+
+static void
+gdbus_name_vanished (GDBusConnection *connection,
+                     const gchar     *name,
+                     gpointer         user_data)
+{
+	GDBusWatch *watch = user_data;
+
+	watch->vanished (name, NULL, watch->user_data);
+}
+
+static void
+gdbus_watch_free (GDBusWatch *watch)
+{
+	g_slice_free (GDBusWatch, watch);
+}
+
+static guint
+gdbus_watch_name (Mpris2Transport         *transport,
+                  const gchar             *name,
+                  Mpris2TransportNameFunc  appeared,
+                  Mpris2TransportNameFunc  vanished,
+                  gpointer                 user_data)
+{
+	GDBusWatch *watch;
+
+	watch = g_slice_new0 (GDBusWatch);
+	watch->appeared = appeared;
+	watch->vanished = vanished;
+	watch->user_data = user_data;
+
+	return g_bus_watch_name_on_connection (MPRIS2_TRANSPORT_GDBUS(transport)->connection,
+	                                       name,
+	                                       G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                                       gdbus_name_appeared,
+	                                       gdbus_name_vanished,
+	                                       watch,
+	                                       (GDestroyNotify) gdbus_watch_free);
+}
+
+static void
+gdbus_unwatch_name (Mpris2Transport *transport, guint watch_id)
+{
+	g_bus_unwatch_name (watch_id);
+}
+
+/*
+ * Transport.
+ */
+
+static GDBusConnection *
+gdbus_get_connection (Mpris2Transport *transport)
+{
+	return MPRIS2_TRANSPORT_GDBUS(transport)->connection;
+}
+
+static void
+gdbus_free (Mpris2Transport *transport)
+{
+	g_object_unref (MPRIS2_TRANSPORT_GDBUS(transport)->connection);
+	g_slice_free (Mpris2TransportGDBus, MPRIS2_TRANSPORT_GDBUS(transport));
+}
+
+static const Mpris2TransportVTable gdbus_vtable = {
+	gdbus_free,
+	gdbus_call,
+	gdbus_call_sync,
+	gdbus_send,
+	gdbus_signal_subscribe,
+	gdbus_signal_unsubscribe,
+	gdbus_watch_name,
+	gdbus_unwatch_name,
+	gdbus_get_connection,
+	gdbus_message_new,
+	gdbus_message_send,
+	gdbus_message_free
+};
+
+Mpris2Transport *
+mpris2_transport_gdbus_new (GDBusConnection *connection)
+{
+	Mpris2TransportGDBus *transport;
+
+	transport = g_slice_new0 (Mpris2TransportGDBus);
+	transport->parent.vtable = &gdbus_vtable;
+	transport->parent.ref_count = 1;
+	transport->connection = g_object_ref (connection);
+
+	return (Mpris2Transport *) transport;
+}
+
+static void
+gdbus_ready_finish (GDBusReady *ready, GDBusConnection *connection, GError *error)
+{
+	Mpris2Transport *transport = NULL;
+
+	if (connection != NULL) {
+		transport = mpris2_transport_gdbus_new (connection);
+		g_object_unref (connection);
+	}
+
+	ready->callback (transport, error, ready->user_data);
+
+	if (transport != NULL)
+		mpris2_transport_unref (transport);
+	g_clear_error (&error);
+	g_slice_free (GDBusReady, ready);
+}
+
+static void
+gdbus_bus_ready (GObject      *source_object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+
+	connection = g_bus_get_finish (res, &error);
+	gdbus_ready_finish (user_data, connection, error);
+}
+
+static void
+gdbus_address_ready (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+
+	connection = g_dbus_connection_new_for_address_finish (res, &error);
+	gdbus_ready_finish (user_data, connection, error);
+}
+
+/* The connection of the session bus is shared by the whole process. */
+
+void
+mpris2_transport_gdbus_new_session (GCancellable             *cancellable,
+                                    Mpris2TransportReadyFunc  callback,
+                                    gpointer                  user_data)
+{
+	GDBusReady *ready;
+
+	ready = g_slice_new0 (GDBusReady);
+	ready->callback = callback;
+	ready->user_data = user_data;
+
+	g_bus_get (G_BUS_TYPE_SESSION, cancellable, gdbus_bus_ready, ready);
+}
+
+/* For the blocking api of the client, the first time it is used. */
+
+Mpris2Transport *
+mpris2_transport_gdbus_new_session_sync (GError **error)
+{
+	Mpris2Transport *transport;
+	GDBusConnection *connection;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
+	if (connection == NULL)
+		return NULL;
+
+	transport = mpris2_transport_gdbus_new (connection);
+	g_object_unref (connection);
+
+	return transport;
+}
+
+void
+mpris2_transport_gdbus_new_for_address (const gchar              *address,
+                                        GCancellable             *cancellable,
+                                        Mpris2TransportReadyFunc  callback,
+                                        gpointer                  user_data)
+{
+	GDBusReady *ready;
+
+	ready = g_slice_new0 (GDBusReady);
+	ready->callback = callback;
+	ready->user_data = user_data;
+
+	g_dbus_connection_new_for_address (address,
+	                                   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+	                                   G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+	                                   NULL,
+	                                   cancellable,
+	                                   gdbus_address_ready,
+	                                   ready);
+}
@@ -0,0 +1,912 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * In-memory transport, with simulated players and no bus at all.
+ *
+ * Signals of the players are delivered at once to the subscribers.
+ * Replies and the first report of name watches are queued, as a bus
+ * would do, and delivered by mpris2_transport_loopback_dispatch() or
+ * else in an idle of the main loop.
+ */
+
+#include "mpris2-transport-loopback.h"
+
+typedef struct {
+	Mpris2Transport  parent;
+
+	GHashTable      *players;       /* well-known name -> Mpris2LoopbackPlayer */
+	GHashTable      *subscriptions; /* id -> LoopbackSubscription */
+	GHashTable      *watches;       /* id -> LoopbackWatch */
+	guint            last_id;
+	guint            last_unique;
+
+	GQueue          *pending;
+	guint            dispatch_id;
+} Mpris2TransportLoopback;
+
+struct _Mpris2LoopbackPlayer {
+	Mpris2TransportLoopback *loopback;
+	gchar                   *name;
+	gchar                   *unique_name;
+	GHashTable              *interfaces; /* interface -> (property -> GVariant) */
+	guint                    n_calls;
+};
+
+typedef struct {
+	gchar                     *sender;
+	gchar                     *interface_name;
+	gchar                     *member;
+	gchar                     *object_path;
+	gchar                     *arg0;
+	Mpris2TransportSignalFunc  callback;
+	gpointer                   user_data;
+} LoopbackSubscription;
+
+typedef struct {
+	gchar                     *name;
+	Mpris2TransportNameFunc    appeared;
+	Mpris2TransportNameFunc    vanished;
+	gpointer                   user_data;
+} LoopbackWatch;
+
+/* A reply, or the first report of a watch when @watch_id is set. */
+typedef struct {
+	GVariant                  *reply;
+	gchar                     *sender;
+	GError                    *error;
+	GCancellable              *cancellable;
+	Mpris2TransportReplyFunc   callback;
+	gpointer                   user_data;
+	guint                      watch_id;
+} LoopbackPending;
+
+#define MPRIS2_TRANSPORT_LOOPBACK(transport) ((Mpris2TransportLoopback *) (transport))
+
+#define LOOPBACK_BUS_NAME "org.freedesktop.DBus"
+
+/*
+ * Simulated players.
+ */
+
+static GHashTable *
+loopback_player_get_interface (Mpris2LoopbackPlayer *player, const gchar *interface_name)
+{
+	GHashTable *properties;
+
+	properties = g_hash_table_lookup (player->interfaces, interface_name);
+	if (properties == NULL) {
+		properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                    (GDestroyNotify) g_variant_unref);
+		g_hash_table_insert (player->interfaces, g_strdup (interface_name), properties);
+	}
+
+	return properties;
+}
+
+static Mpris2LoopbackPlayer *
+loopback_find_player (Mpris2TransportLoopback *loopback, const gchar *name)
+{
+	GHashTableIter iter;
+	Mpris2LoopbackPlayer *player;
+
+	if (name == NULL)
+		return NULL;
+
+	if (name[0] != ':')
+		return g_hash_table_lookup (loopback->players, name);
+
+	g_hash_table_iter_init (&iter, loopback->players);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &player)) {
+		if (g_strcmp0 (player->unique_name, name) == 0)
+			return player;
+	}
+
+	return NULL;
+}
+
+static const gchar *
+loopback_get_name_owner (Mpris2TransportLoopback *loopback, const gchar *name)
+{
+	Mpris2LoopbackPlayer *player;
+
+	if (g_strcmp0 (name, LOOPBACK_BUS_NAME) == 0)
+		return LOOPBACK_BUS_NAME;
+
+	player = loopback_find_player (loopback, name);
+
+	return player != NULL ? player->unique_name : NULL;
+}
+
+/*
+ * Signals.
+ */
+
+static gboolean
+loopback_subscription_matches (LoopbackSubscription *subscription,
+                               const gchar          *sender,
+                               const gchar          *sender_name,
+                               const gchar          *object_path,
+                               const gchar          *interface_name,
+                               const gchar          *member,
+                               GVariant             *parameters)
+{
+	const gchar *arg0 = NULL;
+
+	if (subscription->sender != NULL &&
+	    g_strcmp0 (subscription->sender, sender) != 0 &&
+	    g_strcmp0 (subscription->sender, sender_name) != 0)
+		return FALSE;
+	if (subscription->interface_name != NULL &&
+	    g_strcmp0 (subscription->interface_name, interface_name) != 0)
+		return FALSE;
+	if (subscription->member != NULL &&
+	    g_strcmp0 (subscription->member, member) != 0)
+		return FALSE;
+	if (subscription->object_path != NULL &&
+	    g_strcmp0 (subscription->object_path, object_path) != 0)
+		return FALSE;
+
+	if (subscription->arg0 != NULL) {
+		if (g_variant_n_children (parameters) > 0) {
+			GVariant *child = g_variant_get_child_value (parameters, 0);
+			if (g_variant_is_of_type (child, G_VARIANT_TYPE_STRING))
+				arg0 = g_variant_get_string (child, NULL);
+			g_variant_unref (child);
+		}
+		if (g_strcmp0 (subscription->arg0, arg0) != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Subscribers may unsubscribe from their callback, so ids are taken first. */
+
+static void
+loopback_emit_signal (Mpris2TransportLoopback *loopback,
+                      const gchar             *sender,
+                      const gchar             *sender_name,
+                      const gchar             *object_path,
+                      const gchar             *interface_name,
+                      const gchar             *member,
+                      GVariant                *parameters)
+{
+	GHashTableIter iter;
+	LoopbackSubscription *subscription;
+	GArray *ids;
+	gpointer key;
+	guint i, id;
+
+	g_variant_ref_sink (parameters);
+
+	ids = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_hash_table_iter_init (&iter, loopback->subscriptions);
+	while (g_hash_table_iter_next (&iter, &key, (gpointer *) &subscription)) {
+		if (loopback_subscription_matches (subscription, sender, sender_name,
+		                                   object_path, interface_name, member,
+		                                   parameters)) {
+			id = GPOINTER_TO_UINT (key);
+			g_array_append_val (ids, id);
+		}
+	}
+
+	for (i = 0; i < ids->len; i++) {
+		subscription = g_hash_table_lookup (loopback->subscriptions,
+		                                    GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+		if (subscription != NULL)
+			subscription->callback (sender, object_path, interface_name,
+			                        member, parameters, subscription->user_data);
+	}
+
+	g_array_free (ids, TRUE);
+	g_variant_unref (parameters);
+}
+
+static void
+loopback_subscription_free (LoopbackSubscription *subscription)
+{
+	g_free (subscription->sender);
+	g_free (subscription->interface_name);
+	g_free (subscription->member);
+	g_free (subscription->object_path);
+	g_free (subscription->arg0);
+	g_slice_free (LoopbackSubscription, subscription);
+}
+
+static guint
+loopback_signal_subscribe (Mpris2Transport           *transport,
+                           const gchar               *sender,
+                           const gchar               *interface_name,
+                           const gchar               *member,
+                           const gchar               *object_path,
+                           const gchar               *arg0,
+                           Mpris2TransportSignalFunc  callback,
+                           gpointer                   user_data)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	LoopbackSubscription *subscription;
+
+	subscription = g_slice_new0 (LoopbackSubscription);
+	subscription->sender = g_strdup (sender);
+	subscription->interface_name = g_strdup (interface_name);
+	subscription->member = g_strdup (member);
+	subscription->object_path = g_strdup (object_path);
+	subscription->arg0 = g_strdup (arg0);
+	subscription->callback = callback;
+	subscription->user_data = user_data;
+
+	g_hash_table_insert (loopback->subscriptions,
+	                     GUINT_TO_POINTER (++loopback->last_id), subscription);
+
+	return loopback->last_id;
+}
+
+static void
+loopback_signal_unsubscribe (Mpris2Transport *transport, guint subscription_id)
+{
+	g_hash_table_remove (MPRIS2_TRANSPORT_LOOPBACK(transport)->subscriptions,
+	                     GUINT_TO_POINTER (subscription_id));
+}
+
+/*
+ * Pending replies.
+ */
+
+static void
+loopback_pending_free (LoopbackPending *pending)
+{
+	if (pending->reply != NULL)
+		g_variant_unref (pending->reply);
+	if (pending->cancellable != NULL)
+		g_object_unref (pending->cancellable);
+	g_free (pending->sender);
+	g_clear_error (&pending->error);
+	g_slice_free (LoopbackPending, pending);
+}
+
+static void
+loopback_pending_complete (Mpris2TransportLoopback *loopback, LoopbackPending *pending)
+{
+	LoopbackWatch *watch;
+	const gchar *owner;
+
+	if (pending->watch_id != 0) {
+		watch = g_hash_table_lookup (loopback->watches, GUINT_TO_POINTER (pending->watch_id));
+		if (watch == NULL)
+			return;
+
+		owner = loopback_get_name_owner (loopback, watch->name);
+		if (owner != NULL)
+			watch->appeared (watch->name, owner, watch->user_data);
+		else
+			watch->vanished (watch->name, NULL, watch->user_data);
+		return;
+	}
+
+	if (g_cancellable_is_cancelled (pending->cancellable)) {
+		g_clear_error (&pending->error);
+		g_set_error_literal (&pending->error, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+		                     "Operation was cancelled");
+		pending->callback (NULL, NULL, pending->error, pending->user_data);
+		return;
+	}
+
+	pending->callback (pending->reply, pending->sender, pending->error, pending->user_data);
+}
+
+/**
+ * mpris2_transport_loopback_dispatch:
+ * @transport: a loopback transport.
+ *
+ * Deliver every queued reply now, including those queued meanwhile.
+ *
+ * Returns: the number of replies delivered.
+ */
+guint
+mpris2_transport_loopback_dispatch (Mpris2Transport *transport)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	LoopbackPending *pending;
+	guint n_dispatched = 0;
+
+	while ((pending = g_queue_pop_head (loopback->pending)) != NULL) {
+		loopback_pending_complete (loopback, pending);
+		loopback_pending_free (pending);
+		n_dispatched++;
+	}
+
+	return n_dispatched;
+}
+
+static gboolean
+loopback_dispatch_idle (gpointer user_data)
+{
+	Mpris2TransportLoopback *loopback = user_data;
+
+	loopback->dispatch_id = 0;
+	mpris2_transport_loopback_dispatch (user_data);
+
+	return FALSE;
+}
+
+static void
+loopback_queue (Mpris2TransportLoopback *loopback, LoopbackPending *pending)
+{
+	g_queue_push_tail (loopback->pending, pending);
+
+	if (loopback->dispatch_id == 0)
+		loopback->dispatch_id = g_idle_add (loopback_dispatch_idle, loopback);
+}
+
+/*
+ * Method calls.
+ */
+
+static void
+loopback_player_changed (Mpris2LoopbackPlayer *player,
+                         const gchar          *interface_name,
+                         const gchar          *property,
+                         GVariant             *value)
+{
+	GVariantBuilder changed;
+
+	g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&changed, "{sv}", property, value);
+
+	mpris2_loopback_player_properties_changed (player, interface_name,
+	                                           g_variant_builder_end (&changed),
+	                                           NULL);
+}
+
+static GVariant *
+loopback_call_bus (Mpris2TransportLoopback *loopback,
+                   const gchar             *method_name,
+                   GVariant                *parameters,
+                   GError                 **error)
+{
+	GHashTableIter iter;
+	GVariantBuilder names;
+	const gchar *name, *owner;
+
+	if (g_strcmp0 (method_name, "ListNames") == 0) {
+		g_variant_builder_init (&names, G_VARIANT_TYPE ("as"));
+		g_variant_builder_add (&names, "s", LOOPBACK_BUS_NAME);
+		g_hash_table_iter_init (&iter, loopback->players);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL))
+			g_variant_builder_add (&names, "s", name);
+		return g_variant_new ("(as)", &names);
+	}
+
+	if (g_strcmp0 (method_name, "GetNameOwner") == 0 &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)"))) {
+		g_variant_get (parameters, "(&s)", &name);
+		owner = loopback_get_name_owner (loopback, name);
+		if (owner == NULL) {
+			g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER,
+			             "The name %s does not have an owner", name);
+			return NULL;
+		}
+		return g_variant_new ("(s)", owner);
+	}
+
+	g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+	             "No such method '%s'", method_name);
+
+	return NULL;
+}
+
+static GVariant *
+loopback_call_player (Mpris2LoopbackPlayer *player,
+                      const gchar          *interface_name,
+                      const gchar          *method_name,
+                      GVariant             *parameters,
+                      GError              **error)
+{
+	GHashTable *properties;
+	GHashTableIter iter;
+	GVariantBuilder all;
+	const gchar *iface, *property;
+	GVariant *value;
+
+	player->n_calls++;
+
+	if (g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") != 0)
+		return g_variant_new_tuple (NULL, 0);
+
+	if (g_strcmp0 (method_name, "GetAll") == 0 &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)"))) {
+		g_variant_get (parameters, "(&s)", &iface);
+		g_variant_builder_init (&all, G_VARIANT_TYPE ("a{sv}"));
+		properties = g_hash_table_lookup (player->interfaces, iface);
+		if (properties != NULL) {
+			g_hash_table_iter_init (&iter, properties);
+			while (g_hash_table_iter_next (&iter, (gpointer *) &property, (gpointer *) &value))
+				g_variant_builder_add (&all, "{sv}", property, value);
+		}
+		return g_variant_new ("(a{sv})", &all);
+	}
+
+	if (g_strcmp0 (method_name, "Get") == 0 &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ss)"))) {
+		g_variant_get (parameters, "(&s&s)", &iface, &property);
+		properties = g_hash_table_lookup (player->interfaces, iface);
+		value = properties != NULL ? g_hash_table_lookup (properties, property) : NULL;
+		if (value == NULL) {
+			g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+			             "No such property '%s'", property);
+			return NULL;
+		}
+		return g_variant_new ("(v)", value);
+	}
+
+	if (g_strcmp0 (method_name, "Set") == 0 &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ssv)"))) {
+		g_variant_get (parameters, "(&s&sv)", &iface, &property, &value);
+		loopback_player_changed (player, iface, property, value);
+		g_variant_unref (value);
+		return g_variant_new_tuple (NULL, 0);
+	}
+
+	g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+	             "No such method '%s'", method_name);
+
+	return NULL;
+}
+
+/* Returns a floating reply, with the sender set, or NULL with @error. */
+
+static GVariant *
+loopback_call_internal (Mpris2TransportLoopback  *loopback,
+                        const gchar              *destination,
+                        const gchar              *interface_name,
+                        const gchar              *method_name,
+                        GVariant                 *parameters,
+                        const GVariantType       *reply_type,
+                        const gchar             **sender,
+                        GError                  **error)
+{
+	Mpris2LoopbackPlayer *player;
+	GVariant *reply;
+
+	if (parameters != NULL)
+		g_variant_ref_sink (parameters);
+
+	*sender = NULL;
+
+	if (g_strcmp0 (destination, LOOPBACK_BUS_NAME) == 0) {
+		*sender = LOOPBACK_BUS_NAME;
+		reply = loopback_call_bus (loopback, method_name, parameters, error);
+	}
+	else if ((player = loopback_find_player (loopback, destination)) != NULL) {
+		*sender = player->unique_name;
+		reply = loopback_call_player (player, interface_name, method_name,
+		                              parameters, error);
+	}
+	else {
+		g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN,
+		             "The name %s was not provided by any .service files",
+		             destination);
+		reply = NULL;
+	}
+
+	if (parameters != NULL)
+		g_variant_unref (parameters);
+
+	if (reply != NULL && reply_type != NULL && !g_variant_is_of_type (reply, reply_type)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		             "Method returned type '%s', but expected '%s'",
+		             g_variant_get_type_string (reply),
+		             g_variant_type_peek_string (reply_type));
+		g_variant_unref (g_variant_ref_sink (reply));
+		reply = NULL;
+	}
+
+	return reply;
+}
+
+static void
+loopback_call (Mpris2Transport          *transport,
+               const gchar              *destination,
+               const gchar              *object_path,
+               const gchar              *interface_name,
+               const gchar              *method_name,
+               GVariant                 *parameters,
+               const GVariantType       *reply_type,
+               GCancellable             *cancellable,
+               Mpris2TransportReplyFunc  callback,
+               gpointer                  user_data)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	LoopbackPending *pending;
+	const gchar *sender;
+
+	pending = g_slice_new0 (LoopbackPending);
+	pending->callback = callback;
+	pending->user_data = user_data;
+	if (cancellable != NULL)
+		pending->cancellable = g_object_ref (cancellable);
+
+	pending->reply = loopback_call_internal (loopback, destination,
+	                                         interface_name, method_name,
+	                                         parameters, reply_type,
+	                                         &sender, &pending->error);
+	if (pending->reply != NULL) {
+		g_variant_ref_sink (pending->reply);
+		pending->sender = g_strdup (sender);
+	}
+
+	loopback_queue (loopback, pending);
+}
+
+static GVariant *
+loopback_call_sync (Mpris2Transport     *transport,
+                    const gchar         *destination,
+                    const gchar         *object_path,
+                    const gchar         *interface_name,
+                    const gchar         *method_name,
+                    GVariant            *parameters,
+                    const GVariantType  *reply_type,
+                    GError             **error)
+{
+	GVariant *reply;
+	const gchar *sender;
+
+	reply = loopback_call_internal (MPRIS2_TRANSPORT_LOOPBACK(transport),
+	                                destination, interface_name, method_name,
+	                                parameters, reply_type, &sender, error);
+
+	return reply != NULL ? g_variant_ref_sink (reply) : NULL;
+}
+
+static void
+loopback_send (Mpris2Transport *transport,
+               const gchar     *destination,
+               const gchar     *object_path,
+               const gchar     *interface_name,
+               const gchar     *method_name,
+               GVariant        *parameters)
+{
+	GVariant *reply;
+	GError *error = NULL;
+
+	reply = loopback_call_sync (transport, destination, object_path,
+	                            interface_name, method_name, parameters,
+	                            NULL, &error);
+	if (reply != NULL)
+		g_variant_unref (reply);
+	g_clear_error (&error);
+}
+
+/*
+ * Names.
+ */
+
+static void
+loopback_watch_free (LoopbackWatch *watch)
+{
+	g_free (watch->name);
+	g_slice_free (LoopbackWatch, watch);
+}
+
+static guint
+loopback_watch_name (Mpris2Transport         *transport,
+                     const gchar             *name,
+                     Mpris2TransportNameFunc  appeared,
+                     Mpris2TransportNameFunc  vanished,
+                     gpointer                 user_data)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	LoopbackPending *pending;
+	LoopbackWatch *watch;
+
+	watch = g_slice_new0 (LoopbackWatch);
+	watch->name = g_strdup (name);
+	watch->appeared = appeared;
+	watch->vanished = vanished;
+	watch->user_data = user_data;
+
+	g_hash_table_insert (loopback->watches, GUINT_TO_POINTER (++loopback->last_id), watch);
+
+	pending = g_slice_new0 (LoopbackPending);
+	pending->watch_id = loopback->last_id;
+	loopback_queue (loopback, pending);
+
+	return loopback->last_id;
+}
+
+static void
+loopback_unwatch_name (Mpris2Transport *transport, guint watch_id)
+{
+	g_hash_table_remove (MPRIS2_TRANSPORT_LOOPBACK(transport)->watches,
+	                     GUINT_TO_POINTER (watch_id));
+}
+
+/* Tell the watches and the NameOwnerChanged subscribers at once. */
+
+static void
+loopback_name_owner_changed (Mpris2TransportLoopback *loopback,
+                             const gchar             *name,
+                             const gchar             *old_owner,
+                             const gchar             *new_owner)
+{
+	GHashTableIter iter;
+	LoopbackWatch *watch;
+	GArray *ids;
+	gpointer key;
+	guint i, id;
+
+	ids = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_hash_table_iter_init (&iter, loopback->watches);
+	while (g_hash_table_iter_next (&iter, &key, (gpointer *) &watch)) {
+		if (g_strcmp0 (watch->name, name) == 0) {
+			id = GPOINTER_TO_UINT (key);
+			g_array_append_val (ids, id);
+		}
+	}
+
+	for (i = 0; i < ids->len; i++) {
+		watch = g_hash_table_lookup (loopback->watches,
+		                             GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+		if (watch == NULL)
+			continue;
+		if (new_owner != NULL)
+			watch->appeared (name, new_owner, watch->user_data);
+		else
+			watch->vanished (name, NULL, watch->user_data);
+	}
+	g_array_free (ids, TRUE);
+
+	loopback_emit_signal (loopback,
+	                      LOOPBACK_BUS_NAME,
+	                      LOOPBACK_BUS_NAME,
+	                      "/org/freedesktop/DBus",
+	                      LOOPBACK_BUS_NAME,
+	                      "NameOwnerChanged",
+	                      g_variant_new ("(sss)", name,
+	                                     old_owner != NULL ? old_owner : "",
+	                                     new_owner != NULL ? new_owner : ""));
+}
+
+/*
+ * Players api.
+ */
+
+/**
+ * mpris2_loopback_player_new:
+ * @transport: a loopback transport.
+ * @name: the name of the player, as "vlc".
+ *
+ * Own org.mpris.MediaPlayer2.@name with a simulated player, without
+ * any property. Watches and subscribers are told at once.
+ *
+ * Returns: (transfer full): the player, to free with mpris2_loopback_player_free().
+ */
+Mpris2LoopbackPlayer *
+mpris2_loopback_player_new (Mpris2Transport *transport, const gchar *name)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	Mpris2LoopbackPlayer *player;
+
+	player = g_slice_new0 (Mpris2LoopbackPlayer);
+	player->loopback = loopback;
+	player->name = g_strdup_printf ("org.mpris.MediaPlayer2.%s", name);
+	player->unique_name = g_strdup_printf (":loopback.%u", ++loopback->last_unique);
+	player->interfaces = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                            (GDestroyNotify) g_hash_table_destroy);
+
+	g_hash_table_replace (loopback->players, player->name, player);
+	loopback_name_owner_changed (loopback, player->name, NULL, player->unique_name);
+
+	return player;
+}
+
+/**
+ * mpris2_loopback_player_free:
+ * @player: a simulated player.
+ *
+ * Release the name of the player, as if it quit.
+ */
+void
+mpris2_loopback_player_free (Mpris2LoopbackPlayer *player)
+{
+	Mpris2TransportLoopback *loopback = player->loopback;
+
+	if (loopback != NULL) {
+		g_hash_table_remove (loopback->players, player->name);
+		loopback_name_owner_changed (loopback, player->name, player->unique_name, NULL);
+	}
+
+	g_hash_table_destroy (player->interfaces);
+	g_free (player->name);
+	g_free (player->unique_name);
+	g_slice_free (Mpris2LoopbackPlayer, player);
+}
+
+/**
+ * mpris2_loopback_player_set:
+ * @player: a simulated player.
+ * @interface_name: as "org.mpris.MediaPlayer2.Player".
+ * @property: the name of the property.
+ * @value: the value, consumed if floating.
+ *
+ * Set a property quietly, as the initial state of the player.
+ */
+void
+mpris2_loopback_player_set (Mpris2LoopbackPlayer *player,
+                            const gchar          *interface_name,
+                            const gchar          *property,
+                            GVariant             *value)
+{
+	g_hash_table_replace (loopback_player_get_interface (player, interface_name),
+	                      g_strdup (property), g_variant_ref_sink (value));
+}
+
+/**
+ * mpris2_loopback_player_properties_changed:
+ * @player: a simulated player.
+ * @interface_name: as "org.mpris.MediaPlayer2.Player".
+ * @changed: an a{sv} dictionary, consumed if floating.
+ * @invalidated: (allow-none): names of properties without a value now.
+ *
+ * Update the properties and deliver PropertiesChanged to the subscribers.
+ */
+void
+mpris2_loopback_player_properties_changed (Mpris2LoopbackPlayer  *player,
+                                           const gchar           *interface_name,
+                                           GVariant              *changed,
+                                           const gchar * const   *invalidated)
+{
+	static const gchar * const none[] = { NULL };
+	GHashTable *properties;
+	GVariantIter iter;
+	const gchar *property;
+	GVariant *value;
+	guint i;
+
+	g_variant_ref_sink (changed);
+
+	properties = loopback_player_get_interface (player, interface_name);
+
+	g_variant_iter_init (&iter, changed);
+	while (g_variant_iter_next (&iter, "{&sv}", &property, &value))
+		g_hash_table_replace (properties, g_strdup (property), value);
+
+	for (i = 0; invalidated != NULL && invalidated[i] != NULL; i++)
+		g_hash_table_remove (properties, invalidated[i]);
+
+	if (player->loopback != NULL)
+		loopback_emit_signal (player->loopback,
+		                      player->unique_name,
+		                      player->name,
+		                      "/org/mpris/MediaPlayer2",
+		                      "org.freedesktop.DBus.Properties",
+		                      "PropertiesChanged",
+		                      g_variant_new ("(s@a{sv}^as)", interface_name, changed,
+		                                     invalidated != NULL ? invalidated : none));
+
+	g_variant_unref (changed);
+}
+
+/**
+ * mpris2_loopback_player_seeked:
+ * @player: a simulated player.
+ * @position: the new position in microseconds.
+ *
+ * Deliver Seeked to the subscribers.
+ */
+void
+mpris2_loopback_player_seeked (Mpris2LoopbackPlayer *player, gint64 position)
+{
+	mpris2_loopback_player_set (player, "org.mpris.MediaPlayer2.Player",
+	                            "Position", g_variant_new_int64 (position));
+
+	if (player->loopback != NULL)
+		loopback_emit_signal (player->loopback,
+		                      player->unique_name,
+		                      player->name,
+		                      "/org/mpris/MediaPlayer2",
+		                      "org.mpris.MediaPlayer2.Player",
+		                      "Seeked",
+		                      g_variant_new ("(x)", position));
+}
+
+/**
+ * mpris2_loopback_player_get_n_calls:
+ * @player: a simulated player.
+ *
+ * Returns: the number of method calls the player got so far.
+ */
+guint
+mpris2_loopback_player_get_n_calls (Mpris2LoopbackPlayer *player)
+{
+	return player->n_calls;
+}
+
+/*
+ * Transport.
+ */
+
+static void
+loopback_forget_player (gpointer key, gpointer value, gpointer user_data)
+{
+	Mpris2LoopbackPlayer *player = value;
+
+	player->loopback = NULL;
+}
+
+static void
+loopback_free (Mpris2Transport *transport)
+{
+	Mpris2TransportLoopback *loopback = MPRIS2_TRANSPORT_LOOPBACK(transport);
+	LoopbackPending *pending;
+
+	if (loopback->dispatch_id != 0)
+		g_source_remove (loopback->dispatch_id);
+	while ((pending = g_queue_pop_head (loopback->pending)) != NULL)
+		loopback_pending_free (pending);
+	g_queue_free (loopback->pending);
+
+	/* Players left are freed by their owner, they just lose the bus. */
+	g_hash_table_foreach (loopback->players, loopback_forget_player, NULL);
+	g_hash_table_destroy (loopback->players);
+
+	g_hash_table_destroy (loopback->subscriptions);
+	g_hash_table_destroy (loopback->watches);
+
+	g_slice_free (Mpris2TransportLoopback, loopback);
+}
+
+static const Mpris2TransportVTable loopback_vtable = {
+	loopback_free,
+	loopback_call,
+	loopback_call_sync,
+	loopback_send,
+	loopback_signal_subscribe,
+	loopback_signal_unsubscribe,
+	loopback_watch_name,
+	loopback_unwatch_name,
+	NULL
+};
+
+/**
+ * mpris2_transport_loopback_new:
+ *
+ * A transport without bus, where the players are simulated with
+ * mpris2_loopback_player_new().
+ *
+ * Returns: (transfer full): a new transport.
+ */
+Mpris2Transport *
+mpris2_transport_loopback_new (void)
+{
+	Mpris2TransportLoopback *loopback;
+
+	loopback = g_slice_new0 (Mpris2TransportLoopback);
+	loopback->parent.vtable = &loopback_vtable;
+	loopback->parent.ref_count = 1;
+
+	loopback->players = g_hash_table_new (g_str_hash, g_str_equal);
+	loopback->subscriptions = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+	                                                 (GDestroyNotify) loopback_subscription_free);
+	loopback->watches = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+	                                           (GDestroyNotify) loopback_watch_free);
+	loopback->pending = g_queue_new ();
+
+	return (Mpris2Transport *) loopback;
+}
@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifndef MPRIS2_TRANSPORT_LOOPBACK_H
+#define MPRIS2_TRANSPORT_LOOPBACK_H
+
+#include "mpris2-transport.h"
+
+G_BEGIN_DECLS
+
+/*
+ * In memory, for measuring the client alone. Only built for the bench,
+ * and not part of the library.
+ */
+
+typedef struct _Mpris2LoopbackPlayer Mpris2LoopbackPlayer;
+
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_loopback_new           (void);
+G_GNUC_INTERNAL guint            mpris2_transport_loopback_dispatch      (Mpris2Transport *transport);
+
+G_GNUC_INTERNAL Mpris2LoopbackPlayer *mpris2_loopback_player_new         (Mpris2Transport *transport,
+                                                                          const gchar *name);
+G_GNUC_INTERNAL void             mpris2_loopback_player_free             (Mpris2LoopbackPlayer *player);
+G_GNUC_INTERNAL void             mpris2_loopback_player_set              (Mpris2LoopbackPlayer *player,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *property,
+                                                                          GVariant *value);
+G_GNUC_INTERNAL void             mpris2_loopback_player_properties_changed (Mpris2LoopbackPlayer *player,
+                                                                          const gchar *interface_name,
+                                                                          GVariant *changed,
+                                                                          const gchar * const *invalidated);
+G_GNUC_INTERNAL void             mpris2_loopback_player_seeked           (Mpris2LoopbackPlayer *player,
+                                                                          gint64 position);
+G_GNUC_INTERNAL guint            mpris2_loopback_player_get_n_calls      (Mpris2LoopbackPlayer *player);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,1197 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Transport on sd-bus, enabled with --enable-sd-bus.
+ *
+ * Messages are read and dispatched in the thread of the main context,
+ * without the GDBus worker thread. They are converted from and to
+ * GVariant only at the edges, so the client sees the same values as
+ * with GDBus.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <systemd/sd-bus.h>
+
+#include "mpris2-transport.h"
+
+typedef struct {
+	GSource          source;
+	sd_bus          *bus;
+	GPollFD          pollfd;
+} SdBusSource;
+
+typedef struct {
+	Mpris2Transport  parent;
+	sd_bus          *bus;
+	GSource         *source;
+	GHashTable      *subscriptions;
+	GHashTable      *watches;
+	guint            last_id;
+} Mpris2TransportSdBus;
+
+typedef struct {
+	Mpris2TransportSdBus     *transport;
+	sd_bus_slot              *slot;
+	GVariantType             *reply_type;
+	GCancellable             *cancellable;
+	gulong                    cancelled_id;
+	Mpris2TransportReplyFunc  callback;
+	gpointer                  user_data;
+} SdBusCall;
+
+typedef struct {
+	sd_bus_slot              *slot;
+	Mpris2TransportSignalFunc callback;
+	gpointer                  user_data;
+} SdBusSubscription;
+
+typedef struct {
+	Mpris2TransportSdBus     *transport;
+	gchar                    *name;
+	gchar                    *owner;
+	gboolean                  known;
+	sd_bus_slot              *match_slot;
+	sd_bus_slot              *call_slot;
+	Mpris2TransportNameFunc   appeared;
+	Mpris2TransportNameFunc   vanished;
+	gpointer                  user_data;
+} SdBusWatch;
+
+typedef struct {
+	Mpris2Transport          *transport;
+	GError                   *error;
+	Mpris2TransportReadyFunc  callback;
+	gpointer                  user_data;
+} SdBusReady;
+
+#define MPRIS2_TRANSPORT_SDBUS(transport) ((Mpris2TransportSdBus *) (transport))
+
+/* Shared by the whole process, as the GDBus session bus. */
+static Mpris2TransportSdBus *session_transport = NULL;
+
+/*
+ * Main loop integration.
+ */
+
+static gboolean
+sd_bus_source_prepare (GSource *source, gint *timeout)
+{
+	SdBusSource *bus_source = (SdBusSource *) source;
+	uint64_t usec;
+	gint64 now;
+	int events;
+
+	*timeout = -1;
+
+	events = sd_bus_get_events (bus_source->bus);
+	bus_source->pollfd.events = 0;
+	if (events > 0 && (events & POLLIN))
+		bus_source->pollfd.events |= G_IO_IN;
+	if (events > 0 && (events & POLLOUT))
+		bus_source->pollfd.events |= G_IO_OUT;
+
+	/* Zero when messages were already read and wait to be processed. */
+	if (sd_bus_get_timeout (bus_source->bus, &usec) >= 0 && usec != UINT64_MAX) {
+		now = g_get_monotonic_time ();
+		if ((gint64) usec <= now)
+			return TRUE;
+		*timeout = (gint) MIN ((usec - now + 999) / 1000, G_MAXINT);
+	}
+
+	return FALSE;
+}
+
+static gboolean
+sd_bus_source_check (GSource *source)
+{
+	SdBusSource *bus_source = (SdBusSource *) source;
+	uint64_t usec;
+
+	if (bus_source->pollfd.revents != 0)
+		return TRUE;
+
+	return sd_bus_get_timeout (bus_source->bus, &usec) >= 0 &&
+	       usec != UINT64_MAX && (gint64) usec <= g_get_monotonic_time ();
+}
+
+static gboolean
+sd_bus_source_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	SdBusSource *bus_source = (SdBusSource *) source;
+	int r;
+
+	do {
+		r = sd_bus_process (bus_source->bus, NULL);
+	} while (r > 0);
+
+	if (r < 0 && r != -ENOTCONN)
+		g_warning ("Failed to process the bus: %s", g_strerror (-r));
+
+	return TRUE;
+}
+
+static void
+sd_bus_source_finalize (GSource *source)
+{
+	SdBusSource *bus_source = (SdBusSource *) source;
+
+	sd_bus_unref (bus_source->bus);
+}
+
+static GSourceFuncs sd_bus_source_funcs = {
+	sd_bus_source_prepare,
+	sd_bus_source_check,
+	sd_bus_source_dispatch,
+	sd_bus_source_finalize
+};
+
+static GSource *
+sd_bus_source_new (sd_bus *bus)
+{
+	SdBusSource *bus_source;
+
+	bus_source = (SdBusSource *) g_source_new (&sd_bus_source_funcs, sizeof (SdBusSource));
+	bus_source->bus = sd_bus_ref (bus);
+	bus_source->pollfd.fd = sd_bus_get_fd (bus);
+	g_source_add_poll ((GSource *) bus_source, &bus_source->pollfd);
+
+	return (GSource *) bus_source;
+}
+
+/*
+ * GVariant conversion.
+ */
+
+static int
+sdbus_append_value (sd_bus_message *m, GVariant *value)
+{
+	GVariantIter iter;
+	GVariant *child;
+	const gchar *type_string;
+	gchar *contents;
+	int r = 0;
+
+	type_string = g_variant_get_type_string (value);
+
+	switch (type_string[0]) {
+		case 'b': {
+			int v = g_variant_get_boolean (value);
+			return sd_bus_message_append_basic (m, 'b', &v);
+		}
+		case 'y': {
+			guint8 v = g_variant_get_byte (value);
+			return sd_bus_message_append_basic (m, 'y', &v);
+		}
+		case 'n': {
+			gint16 v = g_variant_get_int16 (value);
+			return sd_bus_message_append_basic (m, 'n', &v);
+		}
+		case 'q': {
+			guint16 v = g_variant_get_uint16 (value);
+			return sd_bus_message_append_basic (m, 'q', &v);
+		}
+		case 'i': {
+			gint32 v = g_variant_get_int32 (value);
+			return sd_bus_message_append_basic (m, 'i', &v);
+		}
+		case 'u': {
+			guint32 v = g_variant_get_uint32 (value);
+			return sd_bus_message_append_basic (m, 'u', &v);
+		}
+		case 'x': {
+			gint64 v = g_variant_get_int64 (value);
+			return sd_bus_message_append_basic (m, 'x', &v);
+		}
+		case 't': {
+			guint64 v = g_variant_get_uint64 (value);
+			return sd_bus_message_append_basic (m, 't', &v);
+		}
+		case 'd': {
+			gdouble v = g_variant_get_double (value);
+			return sd_bus_message_append_basic (m, 'd', &v);
+		}
+		case 's':
+		case 'o':
+		case 'g':
+			return sd_bus_message_append_basic (m, type_string[0],
+			                                    g_variant_get_string (value, NULL));
+		case 'v':
+			child = g_variant_get_variant (value);
+			r = sd_bus_message_open_container (m, 'v', g_variant_get_type_string (child));
+			if (r >= 0)
+				r = sdbus_append_value (m, child);
+			if (r >= 0)
+				r = sd_bus_message_close_container (m);
+			g_variant_unref (child);
+			return r;
+		case 'a':
+		case '(':
+		case '{':
+			if (type_string[0] == 'a')
+				contents = g_strdup (type_string + 1);
+			else
+				contents = g_strndup (type_string + 1, strlen (type_string) - 2);
+
+			r = sd_bus_message_open_container (m,
+			                                   type_string[0] == 'a' ? 'a' :
+			                                   type_string[0] == '(' ? 'r' : 'e',
+			                                   contents);
+			g_free (contents);
+
+			g_variant_iter_init (&iter, value);
+			while (r >= 0 && (child = g_variant_iter_next_value (&iter)) != NULL) {
+				r = sdbus_append_value (m, child);
+				g_variant_unref (child);
+			}
+			if (r >= 0)
+				r = sd_bus_message_close_container (m);
+			return r;
+		default:
+			/* Unix fds, and maybe-types that are not D-Bus. */
+			return -EINVAL;
+	}
+}
+
+/* The parameters tuple gives the arguments of the message. */
+
+static int
+sdbus_append_parameters (sd_bus_message *m, GVariant *parameters)
+{
+	GVariantIter iter;
+	GVariant *child;
+	int r = 0;
+
+	if (parameters == NULL)
+		return 0;
+
+	g_variant_ref_sink (parameters);
+
+	g_variant_iter_init (&iter, parameters);
+	while (r >= 0 && (child = g_variant_iter_next_value (&iter)) != NULL) {
+		r = sdbus_append_value (m, child);
+		g_variant_unref (child);
+	}
+
+	g_variant_unref (parameters);
+
+	return r;
+}
+
+static int sdbus_read_values (sd_bus_message *m, GVariantBuilder *builder);
+
+static int
+sdbus_read_container (sd_bus_message *m, char type, const char *contents, GVariant **value)
+{
+	GVariantBuilder builder;
+	GVariant *tuple, *child;
+	gchar *type_string;
+	int r;
+
+	switch (type) {
+		case 'a':
+			type_string = g_strdup_printf ("a%s", contents);
+			break;
+		case 'r':
+			type_string = g_strdup_printf ("(%s)", contents);
+			break;
+		case 'e':
+			type_string = g_strdup_printf ("{%s}", contents);
+			break;
+		default:
+			/* The single value of a variant, read as a tuple. */
+			type_string = g_strdup_printf ("(%s)", contents);
+			break;
+	}
+
+	r = sd_bus_message_enter_container (m, type, contents);
+	if (r < 0) {
+		g_free (type_string);
+		return r;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (type_string));
+	g_free (type_string);
+
+	r = sdbus_read_values (m, &builder);
+	if (r >= 0)
+		r = sd_bus_message_exit_container (m);
+	if (r < 0) {
+		g_variant_builder_clear (&builder);
+		return r;
+	}
+
+	if (type == 'v') {
+		tuple = g_variant_ref_sink (g_variant_builder_end (&builder));
+		child = g_variant_get_child_value (tuple, 0);
+		*value = g_variant_new_variant (child);
+		g_variant_unref (child);
+		g_variant_unref (tuple);
+	}
+	else {
+		*value = g_variant_builder_end (&builder);
+	}
+
+	return 0;
+}
+
+static int
+sdbus_read_values (sd_bus_message *m, GVariantBuilder *builder)
+{
+	GVariant *value;
+	const char *contents;
+	char type;
+	int r;
+
+	for (;;) {
+		r = sd_bus_message_peek_type (m, &type, &contents);
+		if (r <= 0)
+			return r;
+
+		switch (type) {
+			case 'b': {
+				int v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_boolean (v);
+				break;
+			}
+			case 'y': {
+				guint8 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_byte (v);
+				break;
+			}
+			case 'n': {
+				gint16 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_int16 (v);
+				break;
+			}
+			case 'q': {
+				guint16 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_uint16 (v);
+				break;
+			}
+			case 'i': {
+				gint32 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_int32 (v);
+				break;
+			}
+			case 'u': {
+				guint32 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_uint32 (v);
+				break;
+			}
+			case 'x': {
+				gint64 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_int64 (v);
+				break;
+			}
+			case 't': {
+				guint64 v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_uint64 (v);
+				break;
+			}
+			case 'd': {
+				gdouble v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = g_variant_new_double (v);
+				break;
+			}
+			case 's':
+			case 'o':
+			case 'g': {
+				const char *v;
+				r = sd_bus_message_read_basic (m, type, &v);
+				if (r < 0)
+					return r;
+				value = type == 's' ? g_variant_new_string (v) :
+				        type == 'o' ? g_variant_new_object_path (v) :
+				                      g_variant_new_signature (v);
+				break;
+			}
+			case 'a':
+			case 'r':
+			case 'e':
+			case 'v':
+				r = sdbus_read_container (m, type, contents, &value);
+				if (r < 0)
+					return r;
+				break;
+			default:
+				return -EINVAL;
+		}
+
+		g_variant_builder_add_value (builder, value);
+	}
+}
+
+static GVariant *
+sdbus_read_body (sd_bus_message *m, GError **error)
+{
+	GVariantBuilder builder;
+	int r;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_TUPLE);
+
+	r = sdbus_read_values (m, &builder);
+	if (r < 0) {
+		g_variant_builder_clear (&builder);
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Could not read the message: %s", g_strerror (-r));
+		return NULL;
+	}
+
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/* The body of a reply, or the error it carries, as GDBus reports them. */
+
+static GVariant *
+sdbus_reply_get_body (sd_bus_message *reply, const GVariantType *reply_type, GError **error)
+{
+	const sd_bus_error *bus_error;
+	GVariant *body;
+
+	if (sd_bus_message_is_method_error (reply, NULL)) {
+		bus_error = sd_bus_message_get_error (reply);
+		*error = g_dbus_error_new_for_dbus_error (bus_error->name,
+		                                          bus_error->message ? bus_error->message : "");
+		return NULL;
+	}
+
+	body = sdbus_read_body (reply, error);
+	if (body != NULL && reply_type != NULL && !g_variant_is_of_type (body, reply_type)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		             "Method returned type '%s', but expected '%s'",
+		             g_variant_get_type_string (body),
+		             g_variant_type_peek_string (reply_type));
+		g_variant_unref (body);
+		return NULL;
+	}
+
+	return body;
+}
+
+static sd_bus_message *
+sdbus_new_method_call (Mpris2TransportSdBus *transport,
+                       const gchar          *destination,
+                       const gchar          *object_path,
+                       const gchar          *interface_name,
+                       const gchar          *method_name,
+                       GVariant             *parameters,
+                       GError              **error)
+{
+	sd_bus_message *m = NULL;
+	int r;
+
+	r = sd_bus_message_new_method_call (transport->bus, &m, destination, object_path,
+	                                    interface_name, method_name);
+	if (r >= 0)
+		r = sdbus_append_parameters (m, parameters);
+	else if (parameters != NULL)
+		g_variant_unref (g_variant_ref_sink (parameters));
+
+	if (r < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		             "Could not build the message: %s", g_strerror (-r));
+		sd_bus_message_unref (m);
+		return NULL;
+	}
+
+	return m;
+}
+
+/*
+ * Method calls.
+ */
+
+static void
+sdbus_call_free (SdBusCall *call)
+{
+	if (call->cancellable != NULL) {
+		g_cancellable_disconnect (call->cancellable, call->cancelled_id);
+		g_object_unref (call->cancellable);
+	}
+	sd_bus_slot_unref (call->slot);
+	if (call->reply_type != NULL)
+		g_variant_type_free (call->reply_type);
+	mpris2_transport_unref ((Mpris2Transport *) call->transport);
+	g_slice_free (SdBusCall, call);
+}
+
+static int
+sdbus_call_reply_cb (sd_bus_message *reply, void *userdata, sd_bus_error *ret_error)
+{
+	GVariant *body;
+	GError *error = NULL;
+	SdBusCall *call = userdata;
+
+	body = sdbus_reply_get_body (reply, call->reply_type, &error);
+
+	call->callback (body, body != NULL ? sd_bus_message_get_sender (reply) : NULL,
+	                error, call->user_data);
+
+	if (body != NULL)
+		g_variant_unref (body);
+	g_clear_error (&error);
+
+	sdbus_call_free (call);
+
+	return 0;
+}
+
+/* Cancelled calls report it from an idle, as GDBus does. */
+
+static gboolean
+sdbus_call_cancelled_idle (gpointer user_data)
+{
+	GError *error = NULL;
+	SdBusCall *call = user_data;
+
+	g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+	                     "Operation was cancelled");
+	call->callback (NULL, NULL, error, call->user_data);
+	g_error_free (error);
+
+	sdbus_call_free (call);
+
+	return FALSE;
+}
+
+static void
+sdbus_call_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	SdBusCall *call = user_data;
+
+	/* Drops the pending reply, the callback is not called anymore. */
+	call->slot = sd_bus_slot_unref (call->slot);
+
+	g_idle_add (sdbus_call_cancelled_idle, call);
+}
+
+static gboolean
+sdbus_call_error_idle (gpointer user_data)
+{
+	GError *error = NULL;
+	SdBusCall *call = user_data;
+
+	g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED,
+	                     "Could not send the message");
+	call->callback (NULL, NULL, error, call->user_data);
+	g_error_free (error);
+
+	sdbus_call_free (call);
+
+	return FALSE;
+}
+
+static void
+sdbus_call (Mpris2Transport          *transport,
+            const gchar              *destination,
+            const gchar              *object_path,
+            const gchar              *interface_name,
+            const gchar              *method_name,
+            GVariant                 *parameters,
+            const GVariantType       *reply_type,
+            GCancellable             *cancellable,
+            Mpris2TransportReplyFunc  callback,
+            gpointer                  user_data)
+{
+	sd_bus_message *m;
+	SdBusCall *call;
+	int r = -EINVAL;
+
+	call = g_slice_new0 (SdBusCall);
+	call->transport = MPRIS2_TRANSPORT_SDBUS(mpris2_transport_ref (transport));
+	call->callback = callback;
+	call->user_data = user_data;
+	if (reply_type != NULL)
+		call->reply_type = g_variant_type_copy (reply_type);
+
+	m = sdbus_new_method_call (call->transport, destination, object_path,
+	                           interface_name, method_name, parameters, NULL);
+	if (m != NULL) {
+		r = sd_bus_call_async (call->transport->bus, &call->slot, m,
+		                       sdbus_call_reply_cb, call, 0);
+		sd_bus_message_unref (m);
+	}
+	if (r < 0) {
+		g_idle_add (sdbus_call_error_idle, call);
+		return;
+	}
+
+	/* Called at once if it is already cancelled. */
+	if (cancellable != NULL) {
+		call->cancellable = g_object_ref (cancellable);
+		call->cancelled_id = g_cancellable_connect (cancellable,
+		                                            G_CALLBACK (sdbus_call_cancelled_cb),
+		                                            call, NULL);
+	}
+}
+
+static GVariant *
+sdbus_call_sync (Mpris2Transport     *transport,
+                 const gchar         *destination,
+                 const gchar         *object_path,
+                 const gchar         *interface_name,
+                 const gchar         *method_name,
+                 GVariant            *parameters,
+                 const GVariantType  *reply_type,
+                 GError             **error)
+{
+	sd_bus_error bus_error = SD_BUS_ERROR_NULL;
+	sd_bus_message *m, *reply = NULL;
+	GVariant *body = NULL;
+	int r;
+
+	m = sdbus_new_method_call (MPRIS2_TRANSPORT_SDBUS(transport), destination, object_path,
+	                           interface_name, method_name, parameters, error);
+	if (m == NULL)
+		return NULL;
+
+	r = sd_bus_call (MPRIS2_TRANSPORT_SDBUS(transport)->bus, m, 0, &bus_error, &reply);
+	if (r < 0) {
+		if (sd_bus_error_is_set (&bus_error))
+			g_propagate_error (error, g_dbus_error_new_for_dbus_error (bus_error.name,
+			                                                           bus_error.message ? bus_error.message : ""));
+		else
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			             "Could not call %s: %s", method_name, g_strerror (-r));
+	}
+	else {
+		body = sdbus_reply_get_body (reply, reply_type, error);
+	}
+
+	sd_bus_error_free (&bus_error);
+	sd_bus_message_unref (reply);
+	sd_bus_message_unref (m);
+
+	return body;
+}
+
+static void
+sdbus_send (Mpris2Transport *transport,
+            const gchar     *destination,
+            const gchar     *object_path,
+            const gchar     *interface_name,
+            const gchar     *method_name,
+            GVariant        *parameters)
+{
+	sd_bus_message *m;
+	GError *error = NULL;
+	int r;
+
+	m = sdbus_new_method_call (MPRIS2_TRANSPORT_SDBUS(transport), destination, object_path,
+	                           interface_name, method_name, parameters, &error);
+	if (m == NULL) {
+		g_warning ("unable to send message: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	sd_bus_message_set_expect_reply (m, 0);
+
+	/* Written at once if the socket takes it, else by the source. */
+	r = sd_bus_send (MPRIS2_TRANSPORT_SDBUS(transport)->bus, m, NULL);
+	if (r < 0)
+		g_warning ("unable to send message: %s", g_strerror (-r));
+
+	sd_bus_message_unref (m);
+}
+
+/* Templates are sealed by their first send, and then sent as they are,
+ * as sd-bus does for a message sent to several destinations. No reply is
+ * expected, so they can share the serial. */
+
+static gpointer
+sdbus_message_new (Mpris2Transport *transport,
+                   const gchar     *destination,
+                   const gchar     *object_path,
+                   const gchar     *interface_name,
+                   const gchar     *method_name)
+{
+	sd_bus_message *m;
+	GError *error = NULL;
+
+	m = sdbus_new_method_call (MPRIS2_TRANSPORT_SDBUS(transport), destination, object_path,
+	                           interface_name, method_name, NULL, &error);
+	if (m == NULL) {
+		g_warning ("unable to build message: %s", error->message);
+		g_error_free (error);
+		return NULL;
+	}
+
+	sd_bus_message_set_expect_reply (m, 0);
+
+	return m;
+}
+
+static void
+sdbus_message_send (Mpris2Transport *transport, gpointer message)
+{
+	int r;
+
+	r = sd_bus_send (MPRIS2_TRANSPORT_SDBUS(transport)->bus, message, NULL);
+	if (r < 0)
+		g_warning ("unable to send message: %s", g_strerror (-r));
+}
+
+static void
+sdbus_message_free (Mpris2Transport *transport, gpointer message)
+{
+	sd_bus_message_unref (message);
+}
+
+/*
+ * Signals.
+ */
+
+static int
+sdbus_signal_cb (sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
+{
+	GVariant *parameters;
+	SdBusSubscription *subscription = userdata;
+
+	parameters = sdbus_read_body (m, NULL);
+	if (parameters == NULL)
+		return 0;
+
+	/* The subscription may be dropped by the callback, don't touch it after. */
+	subscription->callback (sd_bus_message_get_sender (m),
+	                        sd_bus_message_get_path (m),
+	                        sd_bus_message_get_interface (m),
+	                        sd_bus_message_get_member (m),
+	                        parameters,
+	                        subscription->user_data);
+
+	g_variant_unref (parameters);
+
+	return 0;
+}
+
+static void
+sdbus_subscription_free (SdBusSubscription *subscription)
+{
+	sd_bus_slot_unref (subscription->slot);
+	g_slice_free (SdBusSubscription, subscription);
+}
+
+/* AddMatch is not waited, only its errors are told. */
+
+static int
+sdbus_match_installed_cb (sd_bus_message *reply, void *userdata, sd_bus_error *ret_error)
+{
+	const sd_bus_error *error;
+
+	if (sd_bus_message_is_method_error (reply, NULL)) {
+		error = sd_bus_message_get_error (reply);
+		g_warning ("Could not add a match: %s", error->message);
+	}
+
+	return 0;
+}
+
+static gchar *
+sdbus_build_match (const gchar *sender,
+                   const gchar *interface_name,
+                   const gchar *member,
+                   const gchar *object_path,
+                   const gchar *arg0)
+{
+	GString *match;
+
+	match = g_string_new ("type='signal'");
+	if (sender != NULL)
+		g_string_append_printf (match, ",sender='%s'", sender);
+	if (interface_name != NULL)
+		g_string_append_printf (match, ",interface='%s'", interface_name);
+	if (member != NULL)
+		g_string_append_printf (match, ",member='%s'", member);
+	if (object_path != NULL)
+		g_string_append_printf (match, ",path='%s'", object_path);
+	if (arg0 != NULL)
+		g_string_append_printf (match, ",arg0='%s'", arg0);
+
+	return g_string_free (match, FALSE);
+}
+
+static guint
+sdbus_signal_subscribe (Mpris2Transport           *transport,
+                        const gchar               *sender,
+                        const gchar               *interface_name,
+                        const gchar               *member,
+                        const gchar               *object_path,
+                        const gchar               *arg0,
+                        Mpris2TransportSignalFunc  callback,
+                        gpointer                   user_data)
+{
+	Mpris2TransportSdBus *sdbus = MPRIS2_TRANSPORT_SDBUS(transport);
+	SdBusSubscription *subscription;
+	gchar *match;
+	int r;
+
+	subscription = g_slice_new0 (SdBusSubscription);
+	subscription->callback = callback;
+	subscription->user_data = user_data;
+
+	match = sdbus_build_match (sender, interface_name, member, object_path, arg0);
+	r = sd_bus_add_match_async (sdbus->bus, &subscription->slot, match,
+	                            sdbus_signal_cb, sdbus_match_installed_cb, subscription);
+	if (r < 0)
+		g_warning ("Could not add the match %s: %s", match, g_strerror (-r));
+	g_free (match);
+
+	g_hash_table_insert (sdbus->subscriptions, GUINT_TO_POINTER (++sdbus->last_id), subscription);
+
+	return sdbus->last_id;
+}
+
+static void
+sdbus_signal_unsubscribe (Mpris2Transport *transport, guint subscription_id)
+{
+	g_hash_table_remove (MPRIS2_TRANSPORT_SDBUS(transport)->subscriptions,
+	                     GUINT_TO_POINTER (subscription_id));
+}
+
+/*
+ * Names, with the same calls as g_bus_watch_name().
+ */
+
+static void
+sdbus_watch_set_owner (SdBusWatch *watch, const gchar *owner)
+{
+	watch->known = TRUE;
+
+	if (g_strcmp0 (watch->owner, owner) == 0)
+		return;
+
+	if (watch->owner != NULL) {
+		g_free (watch->owner);
+		watch->owner = NULL;
+		watch->vanished (watch->name, NULL, watch->user_data);
+	}
+
+	if (owner != NULL) {
+		watch->owner = g_strdup (owner);
+		watch->appeared (watch->name, owner, watch->user_data);
+	}
+}
+
+static int
+sdbus_watch_owner_changed_cb (sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
+{
+	const char *name, *old_owner, *new_owner;
+	SdBusWatch *watch = userdata;
+
+	if (sd_bus_message_read (m, "sss", &name, &old_owner, &new_owner) < 0)
+		return 0;
+
+	/* Also when it changes from one owner to another. */
+	if (old_owner[0] != '\0' && watch->owner != NULL)
+		sdbus_watch_set_owner (watch, NULL);
+
+	if (new_owner[0] != '\0') {
+		sdbus_watch_set_owner (watch, new_owner);
+	}
+	else if (!watch->known) {
+		watch->known = TRUE;
+		watch->vanished (watch->name, NULL, watch->user_data);
+	}
+
+	return 0;
+}
+
+static int
+sdbus_watch_get_owner_cb (sd_bus_message *reply, void *userdata, sd_bus_error *ret_error)
+{
+	const char *owner = NULL;
+	SdBusWatch *watch = userdata;
+
+	watch->call_slot = sd_bus_slot_unref (watch->call_slot);
+
+	/* NameOwnerChanged came first, it is newer. */
+	if (watch->known)
+		return 0;
+
+	if (!sd_bus_message_is_method_error (reply, NULL) &&
+	    sd_bus_message_read (reply, "s", &owner) >= 0) {
+		sdbus_watch_set_owner (watch, owner);
+	}
+	else {
+		watch->known = TRUE;
+		watch->vanished (watch->name, NULL, watch->user_data);
+	}
+
+	return 0;
+}
+
+static void
+sdbus_watch_free (SdBusWatch *watch)
+{
+	sd_bus_slot_unref (watch->match_slot);
+	sd_bus_slot_unref (watch->call_slot);
+	g_free (watch->name);
+	g_free (watch->owner);
+	g_slice_free (SdBusWatch, watch);
+}
+
+static guint
+sdbus_watch_name (Mpris2Transport         *transport,
+                  const gchar             *name,
+                  Mpris2TransportNameFunc  appeared,
+                  Mpris2TransportNameFunc  vanished,
+                  gpointer                 user_data)
+{
+	Mpris2TransportSdBus *sdbus = MPRIS2_TRANSPORT_SDBUS(transport);
+	SdBusWatch *watch;
+	gchar *match;
+
+	watch = g_slice_new0 (SdBusWatch);
+	watch->transport = sdbus;
+	watch->name = g_strdup (name);
+	watch->appeared = appeared;
+	watch->vanished = vanished;
+	watch->user_data = user_data;
+
+	/* The match goes first, so no change is lost until the reply. The bus
+	 * handles both in order, so it needs not be waited. */
+	match = sdbus_build_match ("org.freedesktop.DBus", "org.freedesktop.DBus",
+	                           "NameOwnerChanged", "/org/freedesktop/DBus", name);
+	sd_bus_add_match_async (sdbus->bus, &watch->match_slot, match,
+	                        sdbus_watch_owner_changed_cb, sdbus_match_installed_cb, watch);
+	g_free (match);
+
+	sd_bus_call_method_async (sdbus->bus, &watch->call_slot,
+	                          "org.freedesktop.DBus",
+	                          "/org/freedesktop/DBus",
+	                          "org.freedesktop.DBus",
+	                          "GetNameOwner",
+	                          sdbus_watch_get_owner_cb, watch,
+	                          "s", name);
+
+	g_hash_table_insert (sdbus->watches, GUINT_TO_POINTER (++sdbus->last_id), watch);
+
+	return sdbus->last_id;
+}
+
+static void
+sdbus_unwatch_name (Mpris2Transport *transport, guint watch_id)
+{
+	g_hash_table_remove (MPRIS2_TRANSPORT_SDBUS(transport)->watches,
+	                     GUINT_TO_POINTER (watch_id));
+}
+
+/*
+ * Transport.
+ */
+
+static void
+sdbus_free (Mpris2Transport *transport)
+{
+	Mpris2TransportSdBus *sdbus = MPRIS2_TRANSPORT_SDBUS(transport);
+
+	if (sdbus == session_transport)
+		session_transport = NULL;
+
+	g_hash_table_destroy (sdbus->subscriptions);
+	g_hash_table_destroy (sdbus->watches);
+
+	g_source_destroy (sdbus->source);
+	g_source_unref (sdbus->source);
+
+	sd_bus_flush_close_unref (sdbus->bus);
+
+	g_slice_free (Mpris2TransportSdBus, sdbus);
+}
+
+static const Mpris2TransportVTable sdbus_vtable = {
+	sdbus_free,
+	sdbus_call,
+	sdbus_call_sync,
+	sdbus_send,
+	sdbus_signal_subscribe,
+	sdbus_signal_unsubscribe,
+	sdbus_watch_name,
+	sdbus_unwatch_name,
+	NULL,
+	sdbus_message_new,
+	sdbus_message_send,
+	sdbus_message_free
+};
+
+static Mpris2TransportSdBus *
+sdbus_transport_new (sd_bus *bus)
+{
+	Mpris2TransportSdBus *sdbus;
+
+	sdbus = g_slice_new0 (Mpris2TransportSdBus);
+	sdbus->parent.vtable = &sdbus_vtable;
+	sdbus->parent.ref_count = 1;
+	sdbus->bus = bus;
+	sdbus->subscriptions = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+	                                              (GDestroyNotify) sdbus_subscription_free);
+	sdbus->watches = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+	                                        (GDestroyNotify) sdbus_watch_free);
+
+	sdbus->source = sd_bus_source_new (bus);
+	g_source_attach (sdbus->source, NULL);
+
+	return sdbus;
+}
+
+/* Connecting and the authentication don't block, so only report it later. */
+
+static gboolean
+sdbus_ready_idle (gpointer user_data)
+{
+	SdBusReady *ready = user_data;
+
+	ready->callback (ready->transport, ready->error, ready->user_data);
+
+	if (ready->transport != NULL)
+		mpris2_transport_unref (ready->transport);
+	g_clear_error (&ready->error);
+	g_slice_free (SdBusReady, ready);
+
+	return FALSE;
+}
+
+static Mpris2TransportSdBus *
+sdbus_ready (sd_bus                   *bus,
+             int                       r,
+             GCancellable             *cancellable,
+             Mpris2TransportReadyFunc  callback,
+             gpointer                  user_data)
+{
+	SdBusReady *ready;
+
+	ready = g_slice_new0 (SdBusReady);
+	ready->callback = callback;
+	ready->user_data = user_data;
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, &ready->error)) {
+		sd_bus_unref (bus);
+	}
+	else if (r < 0) {
+		g_set_error (&ready->error, G_IO_ERROR, G_IO_ERROR_FAILED,
+		             "Could not connect to the bus: %s", g_strerror (-r));
+		sd_bus_unref (bus);
+	}
+	else {
+		ready->transport = (Mpris2Transport *) sdbus_transport_new (bus);
+	}
+
+	g_idle_add (sdbus_ready_idle, ready);
+
+	return MPRIS2_TRANSPORT_SDBUS(ready->transport);
+}
+
+void
+mpris2_transport_sdbus_new_session (GCancellable             *cancellable,
+                                    Mpris2TransportReadyFunc  callback,
+                                    gpointer                  user_data)
+{
+	SdBusReady *ready;
+	sd_bus *bus = NULL;
+	int r;
+
+	if (session_transport != NULL) {
+		ready = g_slice_new0 (SdBusReady);
+		ready->callback = callback;
+		ready->user_data = user_data;
+		ready->transport = mpris2_transport_ref ((Mpris2Transport *) session_transport);
+		g_idle_add (sdbus_ready_idle, ready);
+		return;
+	}
+
+	r = sd_bus_open_user (&bus);
+
+	/* Not referenced here, it goes away with its last client. */
+	session_transport = sdbus_ready (bus, r, cancellable, callback, user_data);
+}
+
+Mpris2Transport *
+mpris2_transport_sdbus_new_session_sync (GError **error)
+{
+	sd_bus *bus = NULL;
+	int r;
+
+	if (session_transport != NULL)
+		return mpris2_transport_ref ((Mpris2Transport *) session_transport);
+
+	r = sd_bus_open_user (&bus);
+	if (r < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+		             "Could not connect to the bus: %s", g_strerror (-r));
+		return NULL;
+	}
+
+	session_transport = sdbus_transport_new (bus);
+
+	return (Mpris2Transport *) session_transport;
+}
+
+void
+mpris2_transport_sdbus_new_for_address (const gchar              *address,
+                                        GCancellable             *cancellable,
+                                        Mpris2TransportReadyFunc  callback,
+                                        gpointer                  user_data)
+{
+	sd_bus *bus = NULL;
+	int r;
+
+	r = sd_bus_new (&bus);
+	if (r >= 0)
+		r = sd_bus_set_address (bus, address);
+	if (r >= 0)
+		r = sd_bus_set_bus_client (bus, 1);
+	if (r >= 0)
+		r = sd_bus_start (bus);
+
+	sdbus_ready (bus, r, cancellable, callback, user_data);
+}
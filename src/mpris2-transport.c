@@ -0,0 +1,249 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mpris2-transport.h"
+
+/*
+ * Backend selection.
+ */
+
+void
+mpris2_transport_new_session (GCancellable             *cancellable,
+                              Mpris2TransportReadyFunc  callback,
+                              gpointer                  user_data)
+{
+#ifdef HAVE_SD_BUS
+	mpris2_transport_sdbus_new_session (cancellable, callback, user_data);
+#else
+	mpris2_transport_gdbus_new_session (cancellable, callback, user_data);
+#endif
+}
+
+/* Blocks until the bus is connected, or the session transport is shared. */
+
+Mpris2Transport *
+mpris2_transport_new_session_sync (GError **error)
+{
+#ifdef HAVE_SD_BUS
+	return mpris2_transport_sdbus_new_session_sync (error);
+#else
+	return mpris2_transport_gdbus_new_session_sync (error);
+#endif
+}
+
+void
+mpris2_transport_new_for_address (const gchar              *address,
+                                  GCancellable             *cancellable,
+                                  Mpris2TransportReadyFunc  callback,
+                                  gpointer                  user_data)
+{
+#ifdef HAVE_SD_BUS
+	mpris2_transport_sdbus_new_for_address (address, cancellable, callback, user_data);
+#else
+	mpris2_transport_gdbus_new_for_address (address, cancellable, callback, user_data);
+#endif
+}
+
+/*
+ * Dispatch to the backend.
+ */
+
+Mpris2Transport *
+mpris2_transport_ref (Mpris2Transport *transport)
+{
+	g_atomic_int_inc (&transport->ref_count);
+
+	return transport;
+}
+
+void
+mpris2_transport_unref (Mpris2Transport *transport)
+{
+	if (g_atomic_int_dec_and_test (&transport->ref_count))
+		transport->vtable->free (transport);
+}
+
+/* @parameters is consumed if floating, as with g_dbus_connection_call(). */
+
+void
+mpris2_transport_call (Mpris2Transport          *transport,
+                       const gchar              *destination,
+                       const gchar              *object_path,
+                       const gchar              *interface_name,
+                       const gchar              *method_name,
+                       GVariant                 *parameters,
+                       const GVariantType       *reply_type,
+                       GCancellable             *cancellable,
+                       Mpris2TransportReplyFunc  callback,
+                       gpointer                  user_data)
+{
+	transport->vtable->call (transport, destination, object_path,
+	                         interface_name, method_name,
+	                         parameters, reply_type,
+	                         cancellable, callback, user_data);
+}
+
+GVariant *
+mpris2_transport_call_sync (Mpris2Transport     *transport,
+                            const gchar         *destination,
+                            const gchar         *object_path,
+                            const gchar         *interface_name,
+                            const gchar         *method_name,
+                            GVariant            *parameters,
+                            const GVariantType  *reply_type,
+                            GError             **error)
+{
+	return transport->vtable->call_sync (transport, destination, object_path,
+	                                     interface_name, method_name,
+	                                     parameters, reply_type, error);
+}
+
+/* No reply is waited, and the backend writes the message when it can,
+ * without a flush. */
+
+void
+mpris2_transport_send (Mpris2Transport *transport,
+                       const gchar     *destination,
+                       const gchar     *object_path,
+                       const gchar     *interface_name,
+                       const gchar     *method_name,
+                       GVariant        *parameters)
+{
+	transport->vtable->send (transport, destination, object_path,
+	                         interface_name, method_name, parameters);
+}
+
+/*
+ * Message templates.
+ */
+
+struct _Mpris2TransportMessage {
+	gchar    *destination;
+	gchar    *object_path;
+	gchar    *interface_name;
+	gchar    *method_name;
+	gpointer  prebuilt;
+};
+
+/* Names are checked and serialized once here, when the backend can. */
+
+Mpris2TransportMessage *
+mpris2_transport_message_new (Mpris2Transport *transport,
+                              const gchar     *destination,
+                              const gchar     *object_path,
+                              const gchar     *interface_name,
+                              const gchar     *method_name)
+{
+	Mpris2TransportMessage *message;
+
+	message = g_slice_new0 (Mpris2TransportMessage);
+
+	if (transport->vtable->message_new != NULL)
+		message->prebuilt = transport->vtable->message_new (transport, destination, object_path,
+		                                                    interface_name, method_name);
+
+	if (message->prebuilt == NULL) {
+		message->destination = g_strdup (destination);
+		message->object_path = g_strdup (object_path);
+		message->interface_name = g_strdup (interface_name);
+		message->method_name = g_strdup (method_name);
+	}
+
+	return message;
+}
+
+void
+mpris2_transport_message_send (Mpris2Transport        *transport,
+                               Mpris2TransportMessage *message)
+{
+	if (message->prebuilt != NULL)
+		transport->vtable->message_send (transport, message->prebuilt);
+	else
+		transport->vtable->send (transport, message->destination, message->object_path,
+		                         message->interface_name, message->method_name, NULL);
+}
+
+void
+mpris2_transport_message_free (Mpris2Transport        *transport,
+                               Mpris2TransportMessage *message)
+{
+	if (message->prebuilt != NULL)
+		transport->vtable->message_free (transport, message->prebuilt);
+
+	g_free (message->destination);
+	g_free (message->object_path);
+	g_free (message->interface_name);
+	g_free (message->method_name);
+	g_slice_free (Mpris2TransportMessage, message);
+}
+
+guint
+mpris2_transport_signal_subscribe (Mpris2Transport           *transport,
+                                   const gchar               *sender,
+                                   const gchar               *interface_name,
+                                   const gchar               *member,
+                                   const gchar               *object_path,
+                                   const gchar               *arg0,
+                                   Mpris2TransportSignalFunc  callback,
+                                   gpointer                   user_data)
+{
+	return transport->vtable->signal_subscribe (transport, sender, interface_name,
+	                                            member, object_path, arg0,
+	                                            callback, user_data);
+}
+
+void
+mpris2_transport_signal_unsubscribe (Mpris2Transport *transport,
+                                     guint            subscription_id)
+{
+	transport->vtable->signal_unsubscribe (transport, subscription_id);
+}
+
+/* @vanished is called at first if the name has no owner, as g_bus_watch_name(). */
+
+guint
+mpris2_transport_watch_name (Mpris2Transport         *transport,
+                             const gchar             *name,
+                             Mpris2TransportNameFunc  appeared,
+                             Mpris2TransportNameFunc  vanished,
+                             gpointer                 user_data)
+{
+	return transport->vtable->watch_name (transport, name, appeared, vanished, user_data);
+}
+
+void
+mpris2_transport_unwatch_name (Mpris2Transport *transport,
+                               guint            watch_id)
+{
+	transport->vtable->unwatch_name (transport, watch_id);
+}
+
+/* NULL if the backend is not GDBus. */
+
+GDBusConnection *
+mpris2_transport_get_connection (Mpris2Transport *transport)
+{
+	if (transport->vtable->get_connection == NULL)
+		return NULL;
+
+	return transport->vtable->get_connection (transport);
+}
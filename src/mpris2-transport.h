@@ -0,0 +1,203 @@
+/*
+ *  Copyright (c) 2013 matias <mati86dl@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ */
+
+#ifndef MPRIS2_TRANSPORT_H
+#define MPRIS2_TRANSPORT_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * All the bus I/O of the client. Messages are exchanged as GVariant
+ * whatever the backend, so the client parses them the same way.
+ */
+
+typedef struct _Mpris2Transport Mpris2Transport;
+
+/* A method call without arguments built once, and sent many times. */
+typedef struct _Mpris2TransportMessage Mpris2TransportMessage;
+
+/* @reply and @sender are only valid during the call, @reply is NULL on error. */
+typedef void (*Mpris2TransportReplyFunc)  (GVariant        *reply,
+                                           const gchar     *sender,
+                                           const GError    *error,
+                                           gpointer         user_data);
+
+typedef void (*Mpris2TransportSignalFunc) (const gchar     *sender,
+                                           const gchar     *object_path,
+                                           const gchar     *interface_name,
+                                           const gchar     *signal_name,
+                                           GVariant        *parameters,
+                                           gpointer         user_data);
+
+/* @owner is NULL when the name vanished. */
+typedef void (*Mpris2TransportNameFunc)   (const gchar     *name,
+                                           const gchar     *owner,
+                                           gpointer         user_data);
+
+/* @transport is NULL on error, and must be referenced to be kept. */
+typedef void (*Mpris2TransportReadyFunc)  (Mpris2Transport *transport,
+                                           const GError    *error,
+                                           gpointer         user_data);
+
+typedef struct {
+	void             (*free)               (Mpris2Transport *transport);
+
+	void             (*call)               (Mpris2Transport *transport,
+	                                        const gchar *destination, const gchar *object_path,
+	                                        const gchar *interface_name, const gchar *method_name,
+	                                        GVariant *parameters, const GVariantType *reply_type,
+	                                        GCancellable *cancellable,
+	                                        Mpris2TransportReplyFunc callback, gpointer user_data);
+	GVariant        *(*call_sync)          (Mpris2Transport *transport,
+	                                        const gchar *destination, const gchar *object_path,
+	                                        const gchar *interface_name, const gchar *method_name,
+	                                        GVariant *parameters, const GVariantType *reply_type,
+	                                        GError **error);
+	void             (*send)               (Mpris2Transport *transport,
+	                                        const gchar *destination, const gchar *object_path,
+	                                        const gchar *interface_name, const gchar *method_name,
+	                                        GVariant *parameters);
+
+	guint            (*signal_subscribe)   (Mpris2Transport *transport,
+	                                        const gchar *sender, const gchar *interface_name,
+	                                        const gchar *member, const gchar *object_path,
+	                                        const gchar *arg0,
+	                                        Mpris2TransportSignalFunc callback, gpointer user_data);
+	void             (*signal_unsubscribe) (Mpris2Transport *transport, guint subscription_id);
+
+	guint            (*watch_name)         (Mpris2Transport *transport, const gchar *name,
+	                                        Mpris2TransportNameFunc appeared,
+	                                        Mpris2TransportNameFunc vanished,
+	                                        gpointer user_data);
+	void             (*unwatch_name)       (Mpris2Transport *transport, guint watch_id);
+
+	GDBusConnection *(*get_connection)     (Mpris2Transport *transport);
+
+	/* Optional, else the template is sent as any other message. */
+	gpointer         (*message_new)        (Mpris2Transport *transport,
+	                                        const gchar *destination, const gchar *object_path,
+	                                        const gchar *interface_name, const gchar *method_name);
+	void             (*message_send)       (Mpris2Transport *transport, gpointer message);
+	void             (*message_free)       (Mpris2Transport *transport, gpointer message);
+} Mpris2TransportVTable;
+
+struct _Mpris2Transport {
+	const Mpris2TransportVTable *vtable;
+	gint                         ref_count;
+};
+
+/*
+ * Backends.
+ */
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_gdbus_new              (GDBusConnection *connection);
+G_GNUC_INTERNAL void             mpris2_transport_gdbus_new_session      (GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_gdbus_new_session_sync (GError **error);
+G_GNUC_INTERNAL void             mpris2_transport_gdbus_new_for_address  (const gchar *address,
+                                                                          GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+
+#ifdef HAVE_SD_BUS
+G_GNUC_INTERNAL void             mpris2_transport_sdbus_new_session      (GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_sdbus_new_session_sync (GError **error);
+G_GNUC_INTERNAL void             mpris2_transport_sdbus_new_for_address  (const gchar *address,
+                                                                          GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+#endif
+
+/*
+ * Api, with the backend chosen at configure time.
+ */
+G_GNUC_INTERNAL void             mpris2_transport_new_session            (GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_new_session_sync       (GError **error);
+G_GNUC_INTERNAL void             mpris2_transport_new_for_address        (const gchar *address,
+                                                                          GCancellable *cancellable,
+                                                                          Mpris2TransportReadyFunc callback,
+                                                                          gpointer user_data);
+
+G_GNUC_INTERNAL Mpris2Transport *mpris2_transport_ref                    (Mpris2Transport *transport);
+G_GNUC_INTERNAL void             mpris2_transport_unref                  (Mpris2Transport *transport);
+
+G_GNUC_INTERNAL void             mpris2_transport_call                   (Mpris2Transport *transport,
+                                                                          const gchar *destination,
+                                                                          const gchar *object_path,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *method_name,
+                                                                          GVariant *parameters,
+                                                                          const GVariantType *reply_type,
+                                                                          GCancellable *cancellable,
+                                                                          Mpris2TransportReplyFunc callback,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL GVariant        *mpris2_transport_call_sync              (Mpris2Transport *transport,
+                                                                          const gchar *destination,
+                                                                          const gchar *object_path,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *method_name,
+                                                                          GVariant *parameters,
+                                                                          const GVariantType *reply_type,
+                                                                          GError **error);
+G_GNUC_INTERNAL void             mpris2_transport_send                   (Mpris2Transport *transport,
+                                                                          const gchar *destination,
+                                                                          const gchar *object_path,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *method_name,
+                                                                          GVariant *parameters);
+
+G_GNUC_INTERNAL Mpris2TransportMessage *mpris2_transport_message_new     (Mpris2Transport *transport,
+                                                                          const gchar *destination,
+                                                                          const gchar *object_path,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *method_name);
+G_GNUC_INTERNAL void             mpris2_transport_message_send           (Mpris2Transport *transport,
+                                                                          Mpris2TransportMessage *message);
+G_GNUC_INTERNAL void             mpris2_transport_message_free           (Mpris2Transport *transport,
+                                                                          Mpris2TransportMessage *message);
+
+G_GNUC_INTERNAL guint            mpris2_transport_signal_subscribe       (Mpris2Transport *transport,
+                                                                          const gchar *sender,
+                                                                          const gchar *interface_name,
+                                                                          const gchar *member,
+                                                                          const gchar *object_path,
+                                                                          const gchar *arg0,
+                                                                          Mpris2TransportSignalFunc callback,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL void             mpris2_transport_signal_unsubscribe     (Mpris2Transport *transport,
+                                                                          guint subscription_id);
+
+G_GNUC_INTERNAL guint            mpris2_transport_watch_name             (Mpris2Transport *transport,
+                                                                          const gchar *name,
+                                                                          Mpris2TransportNameFunc appeared,
+                                                                          Mpris2TransportNameFunc vanished,
+                                                                          gpointer user_data);
+G_GNUC_INTERNAL void             mpris2_transport_unwatch_name           (Mpris2Transport *transport,
+                                                                          guint watch_id);
+
+G_GNUC_INTERNAL GDBusConnection *mpris2_transport_get_connection         (Mpris2Transport *transport);
+
+G_END_DECLS
+
+#endif
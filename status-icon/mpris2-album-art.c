@@ -15,14 +15,30 @@
 /* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 /*************************************************************************/
 
+#include <string.h>
+#include <glib/gstdio.h>
+
 #include "mpris2-album-art.h"
+#include "mpris2-embedded-art.h"
 
 G_DEFINE_TYPE(Mpris2AlbumArt, mpris2_album_art, GTK_TYPE_IMAGE)
 
+/* Size of the cover inside the frame icon. */
+#define ALBUM_ART_SIZE      112
+#define ALBUM_ART_CACHE_MAX 64
+
+/* Thumbnails not used for this many days are removed. */
+#define THUMBNAIL_MAX_AGE   30
+
+/* Base64 characters fed to the loader at a time. */
+#define DATA_URI_CHUNK      4096
+
 struct _Mpris2AlbumArtPrivate
 {
 	gchar *path;
 	guint size;
+	GdkPixbuf *art;
+	Mpris2Palette *palette;
 };
 
 enum
@@ -30,17 +46,564 @@ enum
 	PROP_0,
 	PROP_PATH,
 	PROP_SIZE,
+	PROP_PALETTE,
 	LAST_PROP
 };
 
 static GParamSpec *gParamSpecs[LAST_PROP];
 
+/* Covers already fitted in ALBUM_ART_SIZE, shared by all the instances. */
+typedef struct {
+	GdkPixbuf     *art;
+	Mpris2Palette *palette;
+} AlbumArtCacheEntry;
+
+static GHashTable *art_cache = NULL;
+
 Mpris2AlbumArt *
 mpris2_album_art_new (void)
 {
 	return g_object_new(MPRIS2_TYPE_ALBUM_ART, NULL);
 }
 
+/**
+ * mpris2_album_art_cache_lookup:
+ *
+ */
+
+static void
+mpris2_album_art_cache_entry_free (AlbumArtCacheEntry *entry)
+{
+	g_object_unref (entry->art);
+	if (entry->palette)
+		mpris2_palette_free (entry->palette);
+
+	g_slice_free (AlbumArtCacheEntry, entry);
+}
+
+static GdkPixbuf *
+mpris2_album_art_cache_lookup (const gchar *key)
+{
+	AlbumArtCacheEntry *entry;
+
+	if (art_cache == NULL)
+		return NULL;
+
+	entry = g_hash_table_lookup (art_cache, key);
+
+	return entry ? g_object_ref (entry->art) : NULL;
+}
+
+/**
+ * mpris2_album_art_cache_insert:
+ *
+ */
+
+static void
+mpris2_album_art_cache_insert (const gchar *key, GdkPixbuf *art)
+{
+	AlbumArtCacheEntry *entry;
+
+	if (art_cache == NULL)
+		art_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                   (GDestroyNotify) mpris2_album_art_cache_entry_free);
+
+	if (g_hash_table_size (art_cache) >= ALBUM_ART_CACHE_MAX)
+		g_hash_table_remove_all (art_cache);
+
+	entry = g_slice_new0 (AlbumArtCacheEntry);
+	entry->art = g_object_ref (art);
+
+	g_hash_table_insert (art_cache, g_strdup (key), entry);
+}
+
+/**
+ * mpris2_album_art_cache_get_palette:
+ *
+ * The palette is computed once per cover and kept next to it.
+ */
+
+static Mpris2Palette *
+mpris2_album_art_cache_get_palette (const gchar *key, GdkPixbuf *art)
+{
+	AlbumArtCacheEntry *entry = NULL;
+
+	if (art_cache != NULL)
+		entry = g_hash_table_lookup (art_cache, key);
+
+	if (entry == NULL)
+		return mpris2_palette_new_from_pixbuf (art);
+
+	if (entry->palette == NULL)
+		entry->palette = mpris2_palette_new_from_pixbuf (entry->art);
+
+	return mpris2_palette_copy (entry->palette);
+}
+
+/**
+ * mpris2_album_art_fit_size:
+ *
+ * Size of a @width x @height picture fitted in @size, keeping its aspect
+ * ratio.
+ */
+
+static void
+mpris2_album_art_fit_size (gint  width,
+                           gint  height,
+                           gint  size,
+                           gint *fit_width,
+                           gint *fit_height)
+{
+	if (width >= height) {
+		*fit_width = size;
+		*fit_height = MAX (1, height * size / MAX (1, width));
+	}
+	else {
+		*fit_width = MAX (1, width * size / height);
+		*fit_height = size;
+	}
+}
+
+/**
+ * mpris2_album_art_scale:
+ *
+ * Returns a new copy of @art fitted in @size.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_scale (GdkPixbuf *art, gint size)
+{
+	gint width, height;
+
+	mpris2_album_art_fit_size (gdk_pixbuf_get_width (art), gdk_pixbuf_get_height (art),
+	                           size, &width, &height);
+
+	return gdk_pixbuf_scale_simple (art, width, height, GDK_INTERP_BILINEAR);
+}
+
+/**
+ * mpris2_album_art_thumbnail_path:
+ *
+ * Thumbnails are stored under $XDG_CACHE_HOME, named after the hash of
+ * the art uri and the size. The "fit" mark keeps them apart from the
+ * older thumbnails, stretched to a square.
+ */
+
+static gchar *
+mpris2_album_art_thumbnail_path (const gchar *key)
+{
+	gchar *name, *checksum, *basename, *path;
+
+	name = g_strdup_printf ("%s\n%u\nfit", key, ALBUM_ART_SIZE);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, name, -1);
+	basename = g_strconcat (checksum, ".png", NULL);
+
+	path = g_build_filename (g_get_user_cache_dir (),
+	                         "mpris2-status-icon", "thumbnails",
+	                         basename, NULL);
+
+	g_free (basename);
+	g_free (checksum);
+	g_free (name);
+
+	return path;
+}
+
+/**
+ * mpris2_album_art_thumbnail_load:
+ *
+ * Map the thumbnail and feed the loader from the mapping.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_thumbnail_load (const gchar *path)
+{
+	GMappedFile *mapped;
+	GdkPixbufLoader *loader;
+	GdkPixbuf *thumbnail = NULL;
+	const guchar *data;
+	gsize len;
+
+	mapped = g_mapped_file_new (path, FALSE, NULL);
+	if (mapped == NULL)
+		return NULL;
+
+	data = (const guchar *) g_mapped_file_get_contents (mapped);
+	len = g_mapped_file_get_length (mapped);
+
+	loader = gdk_pixbuf_loader_new_with_type ("png", NULL);
+	if (loader != NULL && data != NULL) {
+		if (gdk_pixbuf_loader_write (loader, data, len, NULL) &&
+		    gdk_pixbuf_loader_close (loader, NULL)) {
+			thumbnail = gdk_pixbuf_loader_get_pixbuf (loader);
+			if (thumbnail)
+				g_object_ref (thumbnail);
+		}
+		else {
+			gdk_pixbuf_loader_close (loader, NULL);
+		}
+	}
+
+	if (loader)
+		g_object_unref (loader);
+	g_mapped_file_unref (mapped);
+
+	return thumbnail;
+}
+
+/**
+ * mpris2_album_art_thumbnail_is_valid:
+ *
+ */
+
+static gboolean
+mpris2_album_art_thumbnail_is_valid (GdkPixbuf   *thumbnail,
+                                     const gchar *uri,
+                                     const gchar *mtime)
+{
+	if (g_strcmp0 (gdk_pixbuf_get_option (thumbnail, "tEXt::Thumb::URI"), uri) != 0)
+		return FALSE;
+
+	if (mtime != NULL &&
+	    g_strcmp0 (gdk_pixbuf_get_option (thumbnail, "tEXt::Thumb::MTime"), mtime) != 0)
+		return FALSE;
+
+	return TRUE;
+}
+
+/**
+ * mpris2_album_art_thumbnail_lookup:
+ *
+ * Look for our own thumbnail first, and for local files also in the
+ * shared thumbnails of the freedesktop.org thumbnail specification.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_thumbnail_lookup (const gchar *key,
+                                   const gchar *uri,
+                                   const gchar *mtime)
+{
+	static const gchar *spec_sizes[] = { "normal", "large" };
+	GdkPixbuf *thumbnail, *art = NULL;
+	gchar *path, *checksum, *basename;
+	guint i;
+
+	path = mpris2_album_art_thumbnail_path (key);
+	thumbnail = mpris2_album_art_thumbnail_load (path);
+
+	if (thumbnail) {
+		if (mpris2_album_art_thumbnail_is_valid (thumbnail, uri, mtime)) {
+			/* Touch it, so the pruning keeps it. */
+			g_utime (path, NULL);
+			g_free (path);
+			return thumbnail;
+		}
+		g_object_unref (thumbnail);
+	}
+	g_free (path);
+
+	/* The spec requires Thumb::MTime, so only local files apply. */
+	if (mtime == NULL)
+		return NULL;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	basename = g_strconcat (checksum, ".png", NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(spec_sizes) && art == NULL; i++) {
+		path = g_build_filename (g_get_user_cache_dir (), "thumbnails",
+		                         spec_sizes[i], basename, NULL);
+		thumbnail = mpris2_album_art_thumbnail_load (path);
+		g_free (path);
+
+		if (thumbnail == NULL)
+			continue;
+
+		if (mpris2_album_art_thumbnail_is_valid (thumbnail, uri, mtime))
+			art = mpris2_album_art_scale (thumbnail, ALBUM_ART_SIZE);
+		g_object_unref (thumbnail);
+	}
+
+	g_free (basename);
+	g_free (checksum);
+
+	return art;
+}
+
+/**
+ * mpris2_album_art_thumbnail_prune:
+ *
+ * Remove the thumbnails not used for THUMBNAIL_MAX_AGE days.
+ */
+
+static void
+mpris2_album_art_thumbnail_prune (const gchar *dirname)
+{
+	GDir *dir;
+	const gchar *name;
+	gchar *path;
+	GStatBuf st;
+	gint64 oldest;
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	oldest = g_get_real_time () / G_USEC_PER_SEC - THUMBNAIL_MAX_AGE * 24 * 60 * 60;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		if (!g_str_has_suffix (name, ".png"))
+			continue;
+
+		path = g_build_filename (dirname, name, NULL);
+		if (g_stat (path, &st) == 0 && st.st_mtime < oldest)
+			g_unlink (path);
+		g_free (path);
+	}
+
+	g_dir_close (dir);
+}
+
+/**
+ * mpris2_album_art_thumbnail_save:
+ *
+ * Save the thumbnail, readable only by the user. The old thumbnails are
+ * pruned on the first save.
+ */
+
+static void
+mpris2_album_art_thumbnail_save (const gchar *key,
+                                 const gchar *uri,
+                                 const gchar *mtime,
+                                 GdkPixbuf   *art)
+{
+	static gboolean pruned = FALSE;
+	gchar *path, *dirname, *buffer = NULL;
+	gsize size = 0;
+	GError *error = NULL;
+	gboolean saved;
+
+	path = mpris2_album_art_thumbnail_path (key);
+	dirname = g_path_get_dirname (path);
+
+	if (g_mkdir_with_parents (dirname, 0700) != 0) {
+		g_warning ("Unable to create thumbnails directory: %s", dirname);
+		goto out;
+	}
+
+	if (!pruned) {
+		mpris2_album_art_thumbnail_prune (dirname);
+		pruned = TRUE;
+	}
+
+	if (mtime != NULL)
+		saved = gdk_pixbuf_save_to_buffer (art, &buffer, &size, "png", &error,
+		                                   "tEXt::Thumb::URI", uri,
+		                                   "tEXt::Thumb::MTime", mtime,
+		                                   NULL);
+	else
+		saved = gdk_pixbuf_save_to_buffer (art, &buffer, &size, "png", &error,
+		                                   "tEXt::Thumb::URI", uri,
+		                                   NULL);
+
+	/* g_file_set_contents() writes a temporary file and renames it over. */
+	if (saved)
+		saved = g_file_set_contents (path, buffer, size, &error);
+	if (saved)
+		g_chmod (path, 0600);
+
+	if (!saved) {
+		g_warning ("Unable to save album art thumbnail: %s", error->message);
+		g_error_free (error);
+	}
+
+out:
+	g_free (buffer);
+	g_free (dirname);
+	g_free (path);
+}
+
+/**
+ * mpris2_album_art_load_art:
+ *
+ * Load the cover of an image file, or the picture embedded in the tags of
+ * an audio file.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_load_art (const gchar *filename)
+{
+	GdkPixbuf *art = NULL;
+	GError *error = NULL;
+	GStatBuf st;
+	gchar *uri, *mtime = NULL;
+
+	art = mpris2_album_art_cache_lookup (filename);
+	if (art)
+		return art;
+
+	uri = g_filename_to_uri (filename, NULL, NULL);
+	if (g_stat (filename, &st) == 0)
+		mtime = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) st.st_mtime);
+
+	if (uri && mtime)
+		art = mpris2_album_art_thumbnail_lookup (filename, uri, mtime);
+
+	if (art == NULL) {
+		if (!mpris2_embedded_art_load (filename, ALBUM_ART_SIZE, ALBUM_ART_SIZE, &art)) {
+			art = gdk_pixbuf_new_from_file_at_scale (filename,
+			                                         ALBUM_ART_SIZE, ALBUM_ART_SIZE,
+			                                         TRUE, &error);
+			if (art == NULL) {
+				g_critical("Unable to open image file: %s\n", filename);
+				g_error_free(error);
+			}
+		}
+
+		if (art && uri && mtime)
+			mpris2_album_art_thumbnail_save (filename, uri, mtime, art);
+	}
+
+	if (art)
+		mpris2_album_art_cache_insert (filename, art);
+
+	g_free (mtime);
+	g_free (uri);
+
+	return art;
+}
+
+/**
+ * mpris2_album_art_size_prepared:
+ *
+ * Decode the picture already fitted in ALBUM_ART_SIZE.
+ */
+
+static void
+mpris2_album_art_size_prepared (GdkPixbufLoader *loader,
+                                gint             width,
+                                gint             height,
+                                gpointer         user_data)
+{
+	gint fit_width, fit_height;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	mpris2_album_art_fit_size (width, height, ALBUM_ART_SIZE, &fit_width, &fit_height);
+	gdk_pixbuf_loader_set_size (loader, fit_width, fit_height);
+}
+
+/**
+ * mpris2_album_art_decode_data_uri:
+ *
+ * Decode the base64 payload of a data: uri in chunks, straight into the
+ * pixbuf loader, without a full decoded copy.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_decode_data_uri (const gchar *payload)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *art = NULL;
+	GError *error = NULL;
+	guchar buffer[(DATA_URI_CHUNK / 4) * 3 + 3];
+	gsize len, pos, chunk, decoded;
+	gint state = 0;
+	guint save = 0;
+
+	loader = gdk_pixbuf_loader_new ();
+	g_signal_connect (loader, "size-prepared",
+	                  G_CALLBACK (mpris2_album_art_size_prepared), NULL);
+
+	len = strlen (payload);
+	for (pos = 0; pos < len; pos += chunk) {
+		chunk = MIN (DATA_URI_CHUNK, len - pos);
+		decoded = g_base64_decode_step (payload + pos, chunk, buffer, &state, &save);
+		if (decoded > 0 && !gdk_pixbuf_loader_write (loader, buffer, decoded, &error))
+			break;
+	}
+
+	if (error == NULL && gdk_pixbuf_loader_close (loader, &error)) {
+		art = gdk_pixbuf_loader_get_pixbuf (loader);
+		if (art)
+			g_object_ref (art);
+	}
+	else {
+		g_critical("Unable to decode data uri: %s\n", error->message);
+		g_error_free(error);
+		gdk_pixbuf_loader_close (loader, NULL);
+	}
+
+	g_object_unref (loader);
+
+	return art;
+}
+
+/**
+ * mpris2_album_art_load_data_uri:
+ *
+ * Returns the cover of a data: uri, and its cache key in @key.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_load_data_uri (const gchar *uri, gchar **key)
+{
+	GdkPixbuf *art = NULL;
+	const gchar *payload;
+	gchar *checksum;
+
+	*key = NULL;
+
+	/* data:[<mediatype>][;base64],<data> */
+	payload = strchr (uri, ',');
+	if (payload == NULL || payload - uri < 7 ||
+	    strncmp (payload - 7, ";base64", 7) != 0) {
+		g_warning ("Only base64 data uris are supported for album art");
+		return NULL;
+	}
+	payload++;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, payload, -1);
+	*key = g_strconcat ("data:", checksum, NULL);
+	g_free (checksum);
+
+	art = mpris2_album_art_cache_lookup (*key);
+	if (art)
+		return art;
+
+	art = mpris2_album_art_thumbnail_lookup (*key, *key, NULL);
+	if (art == NULL) {
+		art = mpris2_album_art_decode_data_uri (payload);
+		if (art)
+			mpris2_album_art_thumbnail_save (*key, *key, NULL, art);
+	}
+
+	if (art)
+		mpris2_album_art_cache_insert (*key, art);
+
+	return art;
+}
+
+/**
+ * mpris2_album_art_load_uri:
+ *
+ * Returns the cover of an uri through the caches, and its cache key in
+ * @key.
+ */
+
+static GdkPixbuf *
+mpris2_album_art_load_uri (const gchar *uri, gchar **key)
+{
+	if (g_str_has_prefix (uri, "data:"))
+		return mpris2_album_art_load_data_uri (uri, key);
+
+	*key = g_filename_from_uri (uri, NULL, NULL);
+	if (*key == NULL)
+		return NULL;
+
+	return mpris2_album_art_load_art (*key);
+}
+
 /**
  * mpris2_album_art_update_image:
  *
@@ -50,7 +613,7 @@ static void
 mpris2_album_art_update_image (Mpris2AlbumArt *albumart)
 {
 	Mpris2AlbumArtPrivate *priv;
-	GdkPixbuf *pixbuf, *album_art, *frame;
+	GdkPixbuf *pixbuf, *frame, *art;
 	GError *error = NULL;
 
 	g_return_if_fail(MPRIS2_IS_ALBUM_ART(albumart));
@@ -59,17 +622,16 @@ mpris2_album_art_update_image (Mpris2AlbumArt *albumart)
 
 	frame = gdk_pixbuf_new_from_file (BASEICONDIR"/128x128/apps/mpris2-status-icon.png", &error);
 
-	if(priv->path != NULL) {
-		album_art = gdk_pixbuf_new_from_file_at_scale (priv->path,
-		                                               112, 112, FALSE, &error);
-		if (album_art) {
-			gdk_pixbuf_copy_area(album_art, 0, 0, 112, 112, frame, 12, 8);
-			g_object_unref(G_OBJECT(album_art));
-		}
-		else {
-			g_critical("Unable to open image file: %s\n", priv->path);
-			g_error_free(error);
-		}
+	/* The frame has a square hole, so the cover is stretched into it. */
+	if (priv->art != NULL) {
+		if (gdk_pixbuf_get_width (priv->art) == ALBUM_ART_SIZE &&
+		    gdk_pixbuf_get_height (priv->art) == ALBUM_ART_SIZE)
+			art = g_object_ref (priv->art);
+		else
+			art = gdk_pixbuf_scale_simple (priv->art, ALBUM_ART_SIZE, ALBUM_ART_SIZE,
+			                               GDK_INTERP_BILINEAR);
+		gdk_pixbuf_copy_area(art, 0, 0, ALBUM_ART_SIZE, ALBUM_ART_SIZE, frame, 12, 8);
+		g_object_unref (art);
 	}
 
 	pixbuf = gdk_pixbuf_scale_simple (frame,
@@ -97,6 +659,9 @@ mpris2_album_art_get_path (Mpris2AlbumArt *albumart)
 /**
  * album_art_set_path:
  *
+ * The path is the uri of an image, or of a local audio file whose
+ * tags have the cover embedded. For data: uris the image is decoded
+ * right away, and the path keeps only the hash of the payload.
  */
 void
 mpris2_album_art_set_path (Mpris2AlbumArt *albumart,
@@ -109,14 +674,53 @@ mpris2_album_art_set_path (Mpris2AlbumArt *albumart,
 	priv = albumart->priv;
 
 	g_free (priv->path);
+	g_clear_object (&priv->art);
+	if (priv->palette) {
+		mpris2_palette_free (priv->palette);
+		priv->palette = NULL;
+	}
+
 	if (path)
-		priv->path = g_filename_from_uri(path, NULL, NULL);
+		priv->art = mpris2_album_art_load_uri (path, &priv->path);
 	else
 		priv->path = NULL;
 
+	if (priv->art)
+		priv->palette = mpris2_album_art_cache_get_palette (priv->path, priv->art);
+
 	mpris2_album_art_update_image (albumart);
 
 	g_object_notify_by_pspec(G_OBJECT(albumart), gParamSpecs[PROP_PATH]);
+	g_object_notify_by_pspec(G_OBJECT(albumart), gParamSpecs[PROP_PALETTE]);
+}
+
+/**
+ * mpris2_album_art_load_icon:
+ *
+ * Loads a small icon, as the playlist ones, through the same caches as
+ * the covers but without the frame.
+ *
+ * Returns: (transfer full): the icon fitted in @size, keeping its aspect
+ * ratio, or NULL if unreadable.
+ */
+GdkPixbuf *
+mpris2_album_art_load_icon (const gchar *uri, guint size)
+{
+	GdkPixbuf *art, *icon;
+	gchar *key = NULL;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	art = mpris2_album_art_load_uri (uri, &key);
+	g_free (key);
+
+	if (art == NULL)
+		return NULL;
+
+	icon = mpris2_album_art_scale (art, size);
+	g_object_unref (art);
+
+	return icon;
 }
 
 /**
@@ -152,6 +756,19 @@ mpris2_album_art_set_size (Mpris2AlbumArt *albumart,
 	g_object_notify_by_pspec(G_OBJECT(albumart), gParamSpecs[PROP_SIZE]);
 }
 
+/**
+ * album_art_get_palette:
+ *
+ * Returns: the colours of the current cover, or NULL without cover.
+ */
+const Mpris2Palette *
+mpris2_album_art_get_palette (Mpris2AlbumArt *albumart)
+{
+	g_return_val_if_fail (MPRIS2_IS_ALBUM_ART(albumart), NULL);
+
+	return albumart->priv->palette;
+}
+
 /**
  * album_art_set_pixbuf:
  *
@@ -190,6 +807,9 @@ mpris2_album_art_finalize (GObject *object)
 	priv = MPRIS2_ALBUM_ART(object)->priv;
 
 	g_free (priv->path);
+	g_clear_object (&priv->art);
+	if (priv->palette)
+		mpris2_palette_free (priv->palette);
 
 	G_OBJECT_CLASS(mpris2_album_art_parent_class)->finalize(object);
 }
@@ -209,6 +829,9 @@ mpris2_album_art_get_property (GObject    *object,
 	case PROP_SIZE:
 		g_value_set_uint (value, mpris2_album_art_get_size(albumart));
 		break;
+	case PROP_PALETTE:
+		g_value_set_boxed (value, mpris2_album_art_get_palette(albumart));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 	}
@@ -268,6 +891,17 @@ mpris2_album_art_class_init (Mpris2AlbumArtClass *klass)
 		                  48,
 		                  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * Mpris2AlbumArt:palette:
+	 *
+	 */
+	gParamSpecs[PROP_PALETTE] =
+		g_param_spec_boxed("palette",
+		                   "Palette",
+		                   "The dominant, vibrant and muted colours of the album art",
+		                   MPRIS2_TYPE_PALETTE,
+		                   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties(object_class, LAST_PROP, gParamSpecs);
 }
 
@@ -21,6 +21,8 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include "mpris2-palette.h"
+
 G_BEGIN_DECLS
 
 #define MPRIS2_TYPE_ALBUM_ART (mpris2_album_art_get_type())
@@ -64,6 +66,11 @@ void            mpris2_album_art_set_size   (Mpris2AlbumArt *albumart, guint siz
 GdkPixbuf      *mpris2_album_art_get_pixbuf (Mpris2AlbumArt *albumart);
 void            mpris2_album_art_set_pixbuf (Mpris2AlbumArt *albumart, GdkPixbuf *pixbuf);
 
+const Mpris2Palette *
+                mpris2_album_art_get_palette (Mpris2AlbumArt *albumart);
+
+GdkPixbuf      *mpris2_album_art_load_icon  (const gchar *uri, guint size);
+
 G_END_DECLS
 
 #endif /* MPRIS2_ALBUM_ART_H */
@@ -0,0 +1,473 @@
+/*************************************************************************/
+/* Copyright (C) 2012-2014 matias <mati86dl@gmail.com>                   */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/*
+ * Locate the cover picture embedded in the tags of a local audio file.
+ *
+ * The file is memory-mapped and only the tag headers are walked, so the
+ * kernel never has to page in the audio payload. The picture bytes are
+ * handed to the pixbuf loader directly from the mapping.
+ */
+
+#include <string.h>
+
+#include "mpris2-embedded-art.h"
+
+/* ID3v2 picture type "Cover (front)", shared by FLAC PICTURE blocks. */
+#define PICTURE_TYPE_FRONT_COVER 3
+
+typedef struct {
+	const guchar *data;
+	gsize         size;
+	guint         type;
+} EmbeddedPicture;
+
+/*
+ * Some private
+ */
+
+static guint32
+read_uint32_be (const guchar *p)
+{
+	return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) |
+	       ((guint32) p[2] << 8)  |  (guint32) p[3];
+}
+
+static guint32
+read_uint24_be (const guchar *p)
+{
+	return ((guint32) p[0] << 16) | ((guint32) p[1] << 8) | (guint32) p[2];
+}
+
+static guint32
+read_syncsafe (const guchar *p)
+{
+	return ((guint32) (p[0] & 0x7f) << 21) | ((guint32) (p[1] & 0x7f) << 14) |
+	       ((guint32) (p[2] & 0x7f) << 7)  |  (guint32) (p[3] & 0x7f);
+}
+
+/* Keep the front cover if there is one, otherwise the first picture found. */
+
+static gboolean
+embedded_picture_offer (EmbeddedPicture *best, const guchar *data, gsize size, guint type)
+{
+	if (size == 0)
+		return FALSE;
+
+	if (best->data == NULL || (type == PICTURE_TYPE_FRONT_COVER &&
+	                           best->type != PICTURE_TYPE_FRONT_COVER)) {
+		best->data = data;
+		best->size = size;
+		best->type = type;
+	}
+
+	return best->type == PICTURE_TYPE_FRONT_COVER;
+}
+
+/*
+ * ID3v2 (mp3, and sometimes prepended to flac).
+ */
+
+static gboolean
+id3v2_parse_apic (const guchar *body, gsize len, gboolean v22, EmbeddedPicture *best)
+{
+	const guchar *p;
+	guint encoding, type;
+	gsize pos = 0;
+
+	if (len < 4)
+		return FALSE;
+
+	encoding = body[pos++];
+
+	/* MIME type: fixed three chars in v2.2, latin1 string after. */
+	if (v22) {
+		pos += 3;
+	}
+	else {
+		p = memchr (body + pos, '\0', len - pos);
+		if (p == NULL)
+			return FALSE;
+		pos = p - body + 1;
+	}
+	if (pos >= len)
+		return FALSE;
+
+	type = body[pos++];
+
+	/* Description, terminated by a single or double NUL depending on encoding. */
+	if (encoding == 1 || encoding == 2) {
+		while (pos + 1 < len && (body[pos] || body[pos + 1]))
+			pos += 2;
+		pos += 2;
+	}
+	else {
+		p = memchr (body + pos, '\0', len - pos);
+		if (p == NULL)
+			return FALSE;
+		pos = p - body + 1;
+	}
+	if (pos >= len)
+		return FALSE;
+
+	return embedded_picture_offer (best, body + pos, len - pos, type);
+}
+
+static gboolean
+id3v2_find_picture (const guchar *data, gsize len, gsize *tag_len, EmbeddedPicture *best)
+{
+	const guchar *frame;
+	guint version, flags, frame_flags;
+	gsize pos, end, header_size, frame_size;
+
+	if (len < 10 || memcmp (data, "ID3", 3) != 0)
+		return FALSE;
+
+	version = data[3];
+	flags = data[5];
+
+	end = 10 + read_syncsafe (data + 6);
+	*tag_len = end + ((flags & 0x10) ? 10 : 0);
+	end = MIN (end, len);
+
+	if (version < 2 || version > 4)
+		return TRUE;
+
+	/* Whole-tag unsynchronisation would need a rewritten copy. */
+	if (flags & 0x80)
+		return TRUE;
+
+	pos = 10;
+	if (version >= 3 && (flags & 0x40)) {
+		if (pos + 4 > end)
+			return TRUE;
+		if (version == 3)
+			pos += 4 + read_uint32_be (data + pos);
+		else
+			pos += read_syncsafe (data + pos);
+	}
+
+	header_size = (version == 2) ? 6 : 10;
+
+	while (pos + header_size <= end) {
+		frame = data + pos;
+
+		/* Padding. */
+		if (frame[0] == '\0')
+			break;
+
+		if (version == 2)
+			frame_size = read_uint24_be (frame + 3);
+		else if (version == 3)
+			frame_size = read_uint32_be (frame + 4);
+		else
+			frame_size = read_syncsafe (frame + 4);
+
+		if (frame_size > end - pos - header_size)
+			break;
+
+		if (version == 2) {
+			if (memcmp (frame, "PIC", 3) == 0 &&
+			    id3v2_parse_apic (frame + header_size, frame_size, TRUE, best))
+				break;
+		}
+		else if (memcmp (frame, "APIC", 4) == 0) {
+			/* Skip compressed, encrypted, grouped or unsynchronised frames. */
+			frame_flags = frame[9];
+			if (version == 3 && (frame_flags & 0xe0))
+				goto next;
+			if (version == 4 && (frame_flags & 0x4e))
+				goto next;
+
+			if (version == 4 && (frame_flags & 0x01)) {
+				if (frame_size < 4)
+					goto next;
+				if (id3v2_parse_apic (frame + header_size + 4, frame_size - 4, FALSE, best))
+					break;
+			}
+			else if (id3v2_parse_apic (frame + header_size, frame_size, FALSE, best)) {
+				break;
+			}
+		}
+	next:
+		pos += header_size + frame_size;
+	}
+
+	return TRUE;
+}
+
+/*
+ * FLAC metadata blocks.
+ */
+
+static gboolean
+flac_parse_picture (const guchar *body, gsize len, EmbeddedPicture *best)
+{
+	guint32 type, field_len;
+	gsize pos = 0;
+
+	if (len < 32)
+		return FALSE;
+
+	type = read_uint32_be (body);
+	pos += 4;
+
+	/* MIME type. */
+	field_len = read_uint32_be (body + pos);
+	pos += 4;
+	if (field_len > len - pos)
+		return FALSE;
+	pos += field_len;
+
+	/* Description. */
+	if (pos + 4 > len)
+		return FALSE;
+	field_len = read_uint32_be (body + pos);
+	pos += 4;
+	if (field_len > len - pos)
+		return FALSE;
+	pos += field_len;
+
+	/* Width, height, depth and colors, then the data length. */
+	if (pos + 20 > len)
+		return FALSE;
+	pos += 16;
+	field_len = read_uint32_be (body + pos);
+	pos += 4;
+	if (field_len > len - pos)
+		return FALSE;
+
+	return embedded_picture_offer (best, body + pos, field_len, type);
+}
+
+static gboolean
+flac_find_picture (const guchar *data, gsize len, EmbeddedPicture *best)
+{
+	guint header;
+	gsize pos, block_len;
+
+	if (len < 4 || memcmp (data, "fLaC", 4) != 0)
+		return FALSE;
+
+	pos = 4;
+	while (pos + 4 <= len) {
+		header = data[pos];
+		block_len = read_uint24_be (data + pos + 1);
+		pos += 4;
+
+		if (block_len > len - pos)
+			break;
+
+		if ((header & 0x7f) == 6 &&
+		    flac_parse_picture (data + pos, block_len, best))
+			break;
+
+		/* Last metadata block, audio frames follow. */
+		if (header & 0x80)
+			break;
+
+		pos += block_len;
+	}
+
+	return TRUE;
+}
+
+/*
+ * MP4 atoms (m4a, m4b, mp4).
+ */
+
+static gboolean
+mp4_find_atom (const guchar *data, gsize len, const gchar *type,
+               const guchar **body, gsize *body_len)
+{
+	guint64 size;
+	gsize pos = 0, header;
+
+	while (pos + 8 <= len) {
+		size = read_uint32_be (data + pos);
+		header = 8;
+
+		if (size == 1) {
+			if (pos + 16 > len)
+				return FALSE;
+			size = ((guint64) read_uint32_be (data + pos + 8) << 32) |
+			        (guint64) read_uint32_be (data + pos + 12);
+			header = 16;
+		}
+		else if (size == 0) {
+			size = len - pos;
+		}
+
+		if (size < header || size > len - pos)
+			return FALSE;
+
+		if (memcmp (data + pos + 4, type, 4) == 0) {
+			*body = data + pos + header;
+			*body_len = size - header;
+			return TRUE;
+		}
+
+		/* Skip over the atom, mdat included, without touching it. */
+		pos += size;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+mp4_find_picture (const guchar *data, gsize len, EmbeddedPicture *best)
+{
+	static const gchar *path[] = { "moov", "udta", "meta", "ilst", "covr", "data" };
+	const guchar *body = data;
+	gsize body_len = len;
+	guint i;
+
+	if (len < 12 || memcmp (data + 4, "ftyp", 4) != 0)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS(path); i++) {
+		if (!mp4_find_atom (body, body_len, path[i], &body, &body_len))
+			return TRUE;
+
+		/* 'meta' is a full atom: skip version and flags. */
+		if (i == 2 && body_len >= 4 && read_uint32_be (body) == 0) {
+			body += 4;
+			body_len -= 4;
+		}
+	}
+
+	/* 'data' starts with the type indicator and the locale. */
+	if (body_len > 8)
+		embedded_picture_offer (best, body + 8, body_len - 8, PICTURE_TYPE_FRONT_COVER);
+
+	return TRUE;
+}
+
+/*
+ * Decoding.
+ */
+
+typedef struct {
+	gint width;
+	gint height;
+} EmbeddedPictureBox;
+
+static void
+embedded_picture_size_prepared (GdkPixbufLoader *loader,
+                                gint             width,
+                                gint             height,
+                                gpointer         user_data)
+{
+	EmbeddedPictureBox *box = user_data;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	/* Fit in the box, keeping the aspect ratio. */
+	if (width * box->height > height * box->width)
+		gdk_pixbuf_loader_set_size (loader, box->width,
+		                            MAX (1, height * box->width / width));
+	else
+		gdk_pixbuf_loader_set_size (loader, MAX (1, width * box->height / height),
+		                            box->height);
+}
+
+static GdkPixbuf *
+embedded_picture_decode (EmbeddedPicture *picture, gint width, gint height)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *pixbuf = NULL;
+	GError *error = NULL;
+	EmbeddedPictureBox box;
+
+	box.width = width;
+	box.height = height;
+
+	loader = gdk_pixbuf_loader_new ();
+	if (width > 0 && height > 0)
+		g_signal_connect (loader, "size-prepared",
+		                  G_CALLBACK (embedded_picture_size_prepared), &box);
+
+	if (gdk_pixbuf_loader_write (loader, picture->data, picture->size, &error) &&
+	    gdk_pixbuf_loader_close (loader, &error)) {
+		pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+		if (pixbuf)
+			g_object_ref (pixbuf);
+	}
+	else {
+		g_warning ("Unable to decode embedded picture: %s", error->message);
+		g_error_free (error);
+		gdk_pixbuf_loader_close (loader, NULL);
+	}
+
+	g_object_unref (loader);
+
+	return pixbuf;
+}
+
+/**
+ * mpris2_embedded_art_load:
+ * @filename: a local audio file.
+ * @width: the width to fit the picture in, or -1.
+ * @height: the height to fit the picture in, or -1.
+ * @pixbuf: (out): the embedded picture, or NULL if the tags have none.
+ *
+ * The picture keeps its aspect ratio.
+ *
+ * Returns: TRUE if @filename has ID3v2, FLAC or MP4 tags, so it should
+ * not be opened as an image.
+ */
+gboolean
+mpris2_embedded_art_load (const gchar  *filename,
+                          gint          width,
+                          gint          height,
+                          GdkPixbuf   **pixbuf)
+{
+	GMappedFile *mapped;
+	EmbeddedPicture best = { NULL, 0, 0 };
+	const guchar *data;
+	gsize len, tag_len = 0;
+	gboolean container = FALSE;
+
+	*pixbuf = NULL;
+
+	mapped = g_mapped_file_new (filename, FALSE, NULL);
+	if (mapped == NULL)
+		return FALSE;
+
+	data = (const guchar *) g_mapped_file_get_contents (mapped);
+	len = g_mapped_file_get_length (mapped);
+
+	if (data != NULL) {
+		if (id3v2_find_picture (data, len, &tag_len, &best)) {
+			container = TRUE;
+			if (best.data == NULL && tag_len < len)
+				flac_find_picture (data + tag_len, len - tag_len, &best);
+		}
+		else {
+			container = flac_find_picture (data, len, &best) ||
+			            mp4_find_picture (data, len, &best);
+		}
+	}
+
+	if (best.data != NULL)
+		*pixbuf = embedded_picture_decode (&best, width, height);
+
+	g_mapped_file_unref (mapped);
+
+	return container;
+}
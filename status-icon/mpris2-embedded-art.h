@@ -0,0 +1,36 @@
+/*************************************************************************/
+/* Copyright (C) 2012-2014 matias <mati86dl@gmail.com>                   */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef MPRIS2_EMBEDDED_ART_H
+#define MPRIS2_EMBEDDED_ART_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Api.
+ */
+gboolean mpris2_embedded_art_load (const gchar  *filename,
+                                   gint          width,
+                                   gint          height,
+                                   GdkPixbuf   **pixbuf);
+
+G_END_DECLS
+
+#endif /* MPRIS2_EMBEDDED_ART_H */
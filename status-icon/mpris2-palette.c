@@ -0,0 +1,204 @@
+/*************************************************************************/
+/* Copyright (C) 2012-2014 matias <mati86dl@gmail.com>                   */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/*
+ * Dominant, vibrant and muted colours of a cover.
+ *
+ * Pixels are quantized to 4 bits per channel and counted in a 4096 bins
+ * histogram. The quantization runs four RGBA pixels at a time with SSE2
+ * when available, with a scalar fallback for other cpus and RGB pixbufs.
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mpris2-palette.h"
+
+#define PALETTE_BINS 4096
+
+G_DEFINE_BOXED_TYPE (Mpris2Palette, mpris2_palette,
+                     mpris2_palette_copy, mpris2_palette_free)
+
+/*
+ * Histogram kernels.
+ */
+
+static inline guint
+mpris2_palette_bin (const guchar *p)
+{
+	return (p[0] >> 4) | ((p[1] >> 4) << 4) | ((p[2] >> 4) << 8);
+}
+
+static void
+mpris2_palette_histogram_row (const guchar *pixels,
+                              gint          width,
+                              gint          n_channels,
+                              guint32      *histogram)
+{
+	gint x = 0;
+
+#ifdef __SSE2__
+	if (n_channels == 4) {
+		const __m128i nibbles = _mm_set1_epi32 (0x000f0f0f);
+		const __m128i red = _mm_set1_epi32 (0x0000000f);
+		const __m128i green = _mm_set1_epi32 (0x000000f0);
+		const __m128i blue = _mm_set1_epi32 (0x00000f00);
+		guint32 bins[4];
+		__m128i v, idx;
+
+		for (; x + 4 <= width; x += 4) {
+			v = _mm_loadu_si128 ((const __m128i *) (pixels + x * 4));
+
+			/* Keep the high nibble of r, g and b in the low nibble of each byte. */
+			v = _mm_and_si128 (_mm_srli_epi32 (v, 4), nibbles);
+
+			/* bin = r | g << 4 | b << 8 */
+			idx = _mm_and_si128 (v, red);
+			idx = _mm_or_si128 (idx, _mm_and_si128 (_mm_srli_epi32 (v, 4), green));
+			idx = _mm_or_si128 (idx, _mm_and_si128 (_mm_srli_epi32 (v, 8), blue));
+
+			_mm_storeu_si128 ((__m128i *) bins, idx);
+
+			histogram[bins[0]]++;
+			histogram[bins[1]]++;
+			histogram[bins[2]]++;
+			histogram[bins[3]]++;
+		}
+	}
+#endif
+
+	for (; x < width; x++)
+		histogram[mpris2_palette_bin (pixels + x * n_channels)]++;
+}
+
+/*
+ * Colour selection.
+ */
+
+static void
+mpris2_palette_bin_to_rgba (guint bin, GdkRGBA *rgba)
+{
+	/* Center of the bin. */
+	rgba->red   = (((bin & 0x00f) << 4) | 0x8) / 255.0;
+	rgba->green = (((bin & 0x0f0)     ) | 0x8) / 255.0;
+	rgba->blue  = (((bin & 0xf00) >> 4) | 0x8) / 255.0;
+	rgba->alpha = 1.0;
+}
+
+static void
+mpris2_palette_saturation_lightness (const GdkRGBA *rgba, gdouble *saturation, gdouble *lightness)
+{
+	gdouble max, min;
+
+	max = MAX (rgba->red, MAX (rgba->green, rgba->blue));
+	min = MIN (rgba->red, MIN (rgba->green, rgba->blue));
+
+	*lightness = (max + min) / 2;
+
+	if (max == min)
+		*saturation = 0.0;
+	else
+		*saturation = (max - min) / (1.0 - ABS (2 * (*lightness) - 1.0));
+}
+
+/**
+ * mpris2_palette_new_from_pixbuf:
+ *
+ */
+Mpris2Palette *
+mpris2_palette_new_from_pixbuf (GdkPixbuf *pixbuf)
+{
+	Mpris2Palette *palette;
+	const guchar *pixels;
+	guint32 *histogram;
+	GdkRGBA rgba;
+	gdouble saturation, lightness, score;
+	gdouble vibrant_score = 0.0, muted_score = 0.0;
+	guint32 dominant_count = 0;
+	gint y, width, height, rowstride, n_channels;
+	guint bin, dominant = 0, vibrant = 0, muted = 0;
+
+	g_return_val_if_fail (GDK_IS_PIXBUF(pixbuf), NULL);
+	g_return_val_if_fail (gdk_pixbuf_get_bits_per_sample (pixbuf) == 8, NULL);
+
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	histogram = g_new0 (guint32, PALETTE_BINS);
+
+	for (y = 0; y < height; y++)
+		mpris2_palette_histogram_row (pixels + y * rowstride, width, n_channels, histogram);
+
+	for (bin = 0; bin < PALETTE_BINS; bin++) {
+		if (histogram[bin] == 0)
+			continue;
+
+		if (histogram[bin] > dominant_count) {
+			dominant_count = histogram[bin];
+			dominant = bin;
+		}
+
+		mpris2_palette_bin_to_rgba (bin, &rgba);
+		mpris2_palette_saturation_lightness (&rgba, &saturation, &lightness);
+
+		if (lightness < 0.2 || lightness > 0.8)
+			continue;
+
+		if (saturation >= 0.35) {
+			score = histogram[bin] * saturation;
+			if (score > vibrant_score) {
+				vibrant_score = score;
+				vibrant = bin;
+			}
+		}
+		else {
+			score = histogram[bin] * (1.0 - saturation);
+			if (score > muted_score) {
+				muted_score = score;
+				muted = bin;
+			}
+		}
+	}
+
+	g_free (histogram);
+
+	palette = g_slice_new0 (Mpris2Palette);
+
+	mpris2_palette_bin_to_rgba (dominant, &palette->dominant);
+	mpris2_palette_bin_to_rgba (vibrant_score > 0.0 ? vibrant : dominant, &palette->vibrant);
+	mpris2_palette_bin_to_rgba (muted_score > 0.0 ? muted : dominant, &palette->muted);
+
+	return palette;
+}
+
+Mpris2Palette *
+mpris2_palette_copy (const Mpris2Palette *palette)
+{
+	return g_slice_dup (Mpris2Palette, palette);
+}
+
+void
+mpris2_palette_free (Mpris2Palette *palette)
+{
+	g_slice_free (Mpris2Palette, palette);
+}
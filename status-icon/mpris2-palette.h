@@ -0,0 +1,48 @@
+/*************************************************************************/
+/* Copyright (C) 2012-2014 matias <mati86dl@gmail.com>                   */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+#ifndef MPRIS2_PALETTE_H
+#define MPRIS2_PALETTE_H
+
+#include <glib-object.h>
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+#define MPRIS2_TYPE_PALETTE (mpris2_palette_get_type())
+
+typedef struct _Mpris2Palette Mpris2Palette;
+
+struct _Mpris2Palette
+{
+	GdkRGBA dominant;
+	GdkRGBA vibrant;
+	GdkRGBA muted;
+};
+
+GType mpris2_palette_get_type (void) G_GNUC_CONST;
+
+/*
+ * Api.
+ */
+Mpris2Palette *mpris2_palette_new_from_pixbuf (GdkPixbuf           *pixbuf);
+Mpris2Palette *mpris2_palette_copy            (const Mpris2Palette *palette);
+void           mpris2_palette_free            (Mpris2Palette       *palette);
+
+G_END_DECLS
+
+#endif /* MPRIS2_PALETTE_H */
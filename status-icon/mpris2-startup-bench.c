@@ -0,0 +1,139 @@
+/*************************************************************************/
+/* Copyright (C) 2013-2014 matias <mati86dl@gmail.com>                   */
+/*                                                                       */
+/* This program is free software: you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation, either version 3 of the License, or     */
+/* (at your option) any later version.                                   */
+/*                                                                       */
+/* This program is distributed in the hope that it will be useful,       */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of        */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         */
+/* GNU General Public License for more details.                          */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+/*************************************************************************/
+
+/*
+ * Startup of the status icon: the time until the icon is visible, and
+ * until the first player state, then quits. It starts as the status
+ * icon does, with a watcher of the players sharing its bus with a
+ * client for each player, and the state cache on.
+ *
+ *   mpris2-startup-bench
+ */
+
+#include <stdlib.h>
+#include <gtk/gtk.h>
+
+#include "../src/libmpris2client.h"
+
+#define STARTUP_TIMEOUT 10
+
+enum {
+	STARTUP_ICON_VISIBLE = 1 << 0,
+	STARTUP_FIRST_STATE  = 1 << 1
+};
+
+static gint64        startup_time  = 0;
+static guint         startup_marks = 0;
+static Mpris2Client *watcher       = NULL;
+static GHashTable   *clients       = NULL;
+
+static void
+startup_mark (guint mark, const gchar *milestone)
+{
+	if (startup_marks & mark)
+		return;
+
+	startup_marks |= mark;
+
+	g_print ("%-14s %8.3f ms\n",
+	         milestone, (g_get_monotonic_time () - startup_time) / 1000.0);
+
+	if (startup_marks == (STARTUP_ICON_VISIBLE | STARTUP_FIRST_STATE))
+		gtk_main_quit ();
+}
+
+static void
+startup_embedded (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	if (gtk_status_icon_is_embedded (GTK_STATUS_ICON(object)))
+		startup_mark (STARTUP_ICON_VISIBLE, "icon visible");
+}
+
+static void
+startup_playback_status (Mpris2Client *mpris2, PlaybackStatus playback_status, gpointer user_data)
+{
+	startup_mark (STARTUP_FIRST_STATE, "first state");
+}
+
+static void
+startup_player_appeared (Mpris2Client *mpris2, const gchar *player, gpointer user_data)
+{
+	Mpris2Client *client;
+
+	if (g_hash_table_lookup (clients, player) != NULL)
+		return;
+
+	client = mpris2_client_new_sharing (watcher);
+	g_signal_connect (client, "playback-status",
+	                  G_CALLBACK (startup_playback_status), NULL);
+	mpris2_client_set_state_cache (client, TRUE);
+	mpris2_client_set_player (client, player);
+
+	g_hash_table_insert (clients, g_strdup (player), client);
+}
+
+static gboolean
+startup_timeout (gpointer user_data)
+{
+	g_printerr ("mpris2-startup-bench: timed out\n");
+	gtk_main_quit ();
+
+	return FALSE;
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+	GtkStatusIcon *status_icon;
+	GIcon *gicon;
+
+	startup_time = g_get_monotonic_time ();
+
+#if !GLIB_CHECK_VERSION(2, 35, 0)
+	g_type_init();
+#endif
+
+	watcher = mpris2_client_new ();
+	clients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+	gtk_init (&argc, &argv);
+
+	status_icon = gtk_status_icon_new ();
+	gicon = g_themed_icon_new ("mpris2-status-icon");
+	gtk_status_icon_set_from_gicon (status_icon, gicon);
+	g_object_unref (gicon);
+
+	g_signal_connect (G_OBJECT (status_icon), "notify::embedded",
+	                  G_CALLBACK (startup_embedded), NULL);
+	gtk_status_icon_set_visible (status_icon, TRUE);
+
+	g_signal_connect (G_OBJECT (watcher), "player-appeared",
+	                  G_CALLBACK (startup_player_appeared), NULL);
+	mpris2_client_watch_players (watcher);
+
+	g_timeout_add_seconds (STARTUP_TIMEOUT, startup_timeout, NULL);
+
+	gtk_main ();
+
+	g_hash_table_destroy (clients);
+	g_object_unref (watcher);
+	g_object_unref (status_icon);
+
+	return startup_marks == (STARTUP_ICON_VISIBLE | STARTUP_FIRST_STATE) ?
+	       EXIT_SUCCESS : EXIT_FAILURE;
+}
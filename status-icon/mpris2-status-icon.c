@@ -27,14 +27,40 @@
 
 static GtkWidget     *icon_popup_menu   = NULL;
 static GtkWidget     *mpris2_popup_menu = NULL;
-
-static GtkStatusIcon *status_icon       = NULL;
-static GIcon         *player_icon       = NULL;
-static GEmblem       *playing_emblem    = NULL;
-static GEmblem       *paused_emblem     = NULL;
-static GEmblem       *stopped_emblem    = NULL;
-
-GtkWidget *popup_dialog, *vbox;
+static GtkWidget     *playlists_menu    = NULL;
+
+/* Desktop entry data and icons of a player, with the status emblems composed. */
+typedef struct {
+	GDesktopAppInfo *info;
+	GIcon           *icon;
+	GIcon           *playing_icon;
+	GIcon           *paused_icon;
+	GIcon           *stopped_icon;
+} PlayerIcons;
+
+static GtkStatusIcon *status_icon        = NULL;
+static GHashTable    *player_icons_cache = NULL;
+static PlayerIcons   *player_icons       = NULL;
+static GEmblem       *playing_emblem     = NULL;
+static GEmblem       *paused_emblem      = NULL;
+static GEmblem       *stopped_emblem     = NULL;
+
+/* A running player, with its own client on the shared bus connection. */
+typedef struct {
+	Mpris2Client   *client;
+	GtkWidget      *button;
+	GtkWidget      *status_image;
+	GtkWidget      *label;
+	Mpris2AlbumArt *album_art;
+	gchar          *arturl;
+	gboolean        dirty;
+} PlayerRow;
+
+static Mpris2Client  *players_watcher    = NULL;
+static Mpris2Client  *active_client      = NULL;
+static GHashTable    *player_rows        = NULL;
+
+GtkWidget *popup_dialog, *vbox, *players_box;
 GtkWidget *track_box, *track_label;
 GtkWidget *time_box, *time_label, *progress_bar, *length_label;
 GtkWidget *buttons_box, *player_button, *button;
@@ -47,83 +73,631 @@ Mpris2AlbumArt *album_art;
 #define g_str_empty0(s) (!(s) || !(s)[0])
 #define g_str_nempty0(s) ((s) && (s)[0])
 
-static gchar *
+/* Playlists of the settings menu, only the first page is shown. */
+#define PLAYLISTS_MENU_SIZE 20
+
+/* Popup state changed while it was hidden, applied when it is mapped. */
+enum {
+	POPUP_DIRTY_TRACK    = 1 << 0,
+	POPUP_DIRTY_POSITION = 1 << 1
+};
+
+static guint  popup_dirty           = POPUP_DIRTY_TRACK | POPUP_DIRTY_POSITION;
+static gulong playback_tick_handler = 0;
+
+/* Reused for every time label. */
+static gchar  time_string[64];
+
+/* Progress interpolated on each frame while the popup is shown. */
+static guint  progress_clock_id     = 0;
+static gint   progress_anchor       = 0;
+static gint64 progress_anchor_time  = 0;
+static gint   progress_last_second  = -1;
+
+static const gchar *
 get_string_from_time (gint time)
 {
-	static gchar *str, tmp[24];
+	gchar tmp[24];
 	gint days = 0, hours = 0, minutes = 0, seconds = 0;
 
-	str = g_new0(char, 128);
-	memset(tmp, '\0', 24);
+	time_string[0] = '\0';
 
 	if (time > 86400) {
 		days = time/86400;
 		time = time%86400;
-		g_sprintf(tmp, "%d %s, ", days, (days>1)?_("days"):_("day"));
-		g_strlcat(str, tmp, 24);
+		g_snprintf(tmp, sizeof(tmp), "%d %s, ", days, (days>1)?_("days"):_("day"));
+		g_strlcat(time_string, tmp, sizeof(time_string));
 	}
 
 	if (time > 3600) {
 		hours = time/3600;
 		time = time%3600;
-		memset(tmp, '\0', 24);
-		g_sprintf(tmp, "%d:", hours);
-		g_strlcat(str, tmp, 24);
+		g_snprintf(tmp, sizeof(tmp), "%d:", hours);
+		g_strlcat(time_string, tmp, sizeof(time_string));
 	}
 
 	if (time > 60) {
 		minutes = time/60;
 		time = time%60;
-		memset(tmp, '\0', 24);
-		g_sprintf(tmp, "%02d:", minutes);
-		g_strlcat(str, tmp, 24);
+		g_snprintf(tmp, sizeof(tmp), "%02d:", minutes);
+		g_strlcat(time_string, tmp, sizeof(time_string));
 	}
 	else
-		g_strlcat(str, "00:", 4);
+		g_strlcat(time_string, "00:", sizeof(time_string));
 
 	seconds = time;
-	memset(tmp, '\0', 24);
-	g_sprintf(tmp, "%02d", seconds);
-	g_strlcat(str, tmp, 24);
+	g_snprintf(tmp, sizeof(tmp), "%02d", seconds);
+	g_strlcat(time_string, tmp, sizeof(time_string));
+
+	return time_string;
+}
+
+static gchar *
+get_track_text (Mpris2Metadata *metadata)
+{
+	const gchar *title = NULL, *artist = NULL, *album = NULL, *url = NULL;
+	gchar *markup_text = NULL, *filename = NULL, *name = NULL;
+
+	title = mpris2_metadata_get_title (metadata);
+	artist = mpris2_metadata_get_artist (metadata);
+	album = mpris2_metadata_get_album (metadata);
+	url = mpris2_metadata_get_url (metadata);
+
+	if (g_str_empty0(url))
+		return NULL;
+
+	if (g_str_nempty0(title)) {
+		name = g_strdup(title);
+	}
+	else {
+		filename = g_filename_from_uri (url, NULL, NULL);
+		if (filename) {
+			name = g_filename_display_basename(filename);
+		}
+		else {
+			name = g_strdup(url);
+		}
+	}
+
+	markup_text = g_strdup_printf (_("%s\nby %s\nin %s"),
+	                               name,
+	                               g_str_nempty0(artist) ? artist : _("Unknown Artist"),
+	                               g_str_nempty0(album)  ? album  : _("Unknown Album"));
+
+	g_free(filename);
+	g_free(name);
+
+	return markup_text;
+}
+
+/*
+ * Player icons.
+ */
+
+static void
+player_icons_free (PlayerIcons *icons)
+{
+	if (icons->info)
+		g_object_unref (icons->info);
+	g_object_unref (icons->icon);
+	g_object_unref (icons->playing_icon);
+	g_object_unref (icons->paused_icon);
+	g_object_unref (icons->stopped_icon);
+
+	g_slice_free (PlayerIcons, icons);
+}
+
+static PlayerIcons *
+player_icons_lookup (const gchar *desktop_entry)
+{
+	PlayerIcons *icons = NULL;
+	gchar *desktop_id = NULL;
+	GIcon *gicon = NULL;
+
+	if (desktop_entry == NULL)
+		desktop_entry = "";
+
+	if (player_icons_cache == NULL)
+		player_icons_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                            (GDestroyNotify) player_icons_free);
+
+	icons = g_hash_table_lookup (player_icons_cache, desktop_entry);
+	if (icons != NULL)
+		return icons;
+
+	icons = g_slice_new0 (PlayerIcons);
+
+	/* Scans the applications directories, so only once per player. */
+	if (g_str_nempty0(desktop_entry)) {
+		desktop_id = g_strdup_printf("%s.desktop", desktop_entry);
+		icons->info = g_desktop_app_info_new (desktop_id);
+		g_free (desktop_id);
+	}
+
+	if (icons->info)
+		gicon = g_app_info_get_icon (G_APP_INFO(icons->info));
+
+	if (gicon)
+		icons->icon = g_object_ref (gicon);
+	else
+		icons->icon = g_themed_icon_new ("mpris2-status-icon");
+
+	icons->playing_icon = g_emblemed_icon_new (icons->icon, playing_emblem);
+	icons->paused_icon  = g_emblemed_icon_new (icons->icon, paused_emblem);
+	icons->stopped_icon = g_emblemed_icon_new (icons->icon, stopped_emblem);
+
+	g_hash_table_insert (player_icons_cache, g_strdup (desktop_entry), icons);
+
+	return icons;
+}
+
+/*
+ * Popup updates.
+ */
+
+static gboolean
+mpris2_status_icon_is_stopped (Mpris2Client *mpris2)
+{
+	if (!mpris2_client_is_connected (mpris2) && !mpris2_client_is_provisional (mpris2))
+		return TRUE;
+
+	return mpris2_client_get_playback_status (mpris2) == STOPPED;
+}
+
+static void
+mpris2_status_icon_update_track (Mpris2Client *mpris2)
+{
+	Mpris2Metadata *metadata = NULL;
+	const gchar *url = NULL, *arturl = NULL, *player_identity = NULL;
+	gchar *markup_text = NULL;
+
+	player_identity = mpris2_client_get_player_identity (mpris2);
+	if ((mpris2_client_is_connected (mpris2) || mpris2_client_is_provisional (mpris2)) &&
+	    g_str_nempty0(player_identity))
+		gtk_button_set_label (GTK_BUTTON(player_button), player_identity);
+
+	if (mpris2_status_icon_is_stopped (mpris2)) {
+		gtk_label_set_text (GTK_LABEL(track_label), _("Mpris2"));
+		gtk_label_set_text (GTK_LABEL(length_label), "--:--");
+		mpris2_album_art_set_path (album_art, NULL);
+		return;
+	}
+
+	metadata = mpris2_client_get_metadata (mpris2);
+
+	markup_text = get_track_text (metadata);
+	if (markup_text == NULL)
+		return;
+
+	gtk_label_set_text (GTK_LABEL(track_label), markup_text);
+	gtk_label_set_text (GTK_LABEL(length_label),
+		get_string_from_time (mpris2_metadata_get_length (metadata)));
+
+	/* Without artUrl, look for the cover embedded in local files. */
+	url = mpris2_metadata_get_url (metadata);
+	arturl = mpris2_metadata_get_arturl (metadata);
+	if (g_str_empty0(arturl) && g_str_has_prefix (url, "file://"))
+		arturl = url;
+
+	mpris2_album_art_set_path (album_art, arturl);
+
+	g_free (markup_text);
+}
+
+static void
+mpris2_status_icon_update_position (Mpris2Client *mpris2)
+{
+	Mpris2Metadata *metadata = NULL;
+	gdouble fraction = 0.0;
+	gint position = 0, length = 0;
+
+	if (mpris2_status_icon_is_stopped (mpris2)) {
+		gtk_label_set_text (GTK_LABEL(time_label), "00:00");
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), 0.0);
+		return;
+	}
+
+	position = mpris2_client_get_position (mpris2);
+	gtk_label_set_text (GTK_LABEL(time_label), get_string_from_time (position/1000000));
+
+	metadata = mpris2_client_get_metadata (mpris2);
+
+	length = mpris2_metadata_get_length (metadata);
+	if (length) {
+		fraction = (gdouble) position/1000000/(gdouble)length;
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), fraction);
+	}
+}
+
+static void
+mpris2_status_icon_anchor_position (gint position)
+{
+	progress_anchor = position;
+	progress_anchor_time = g_get_monotonic_time ();
+}
+
+static gboolean
+mpris2_status_icon_progress_clock (GtkWidget     *widget,
+                                   GdkFrameClock *frame_clock,
+                                   gpointer       user_data)
+{
+	Mpris2Client *mpris2 = user_data;
+	gdouble position = 0.0;
+	gint64 elapsed = 0;
+	gint length = 0, second = 0;
+
+	/* Frame time is in the timescale of g_get_monotonic_time(). */
+	elapsed = gdk_frame_clock_get_frame_time (frame_clock) - progress_anchor_time;
+	position = progress_anchor + MAX (elapsed, 0) * mpris2_client_get_playback_rate (mpris2);
+
+	length = mpris2_metadata_get_length (mpris2_client_get_metadata (mpris2));
+	if (length)
+		gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR(progress_bar),
+		                               CLAMP (position/1000000/length, 0.0, 1.0));
+
+	second = (gint) (position/1000000);
+	if (second != progress_last_second) {
+		progress_last_second = second;
+		gtk_label_set_text (GTK_LABEL(time_label), get_string_from_time (second));
+	}
+
+	return TRUE;
+}
+
+/* Only animate while the popup is mapped and the player is playing. */
+
+static void
+mpris2_status_icon_update_progress_clock (Mpris2Client *mpris2)
+{
+	gboolean animate;
+
+	animate = popup_dialog != NULL &&
+	          gtk_widget_get_mapped (popup_dialog) &&
+	          mpris2_client_is_connected (mpris2) &&
+	          mpris2_client_get_playback_status (mpris2) == PLAYING;
+
+	if (animate && progress_clock_id == 0) {
+		mpris2_status_icon_anchor_position (mpris2_client_get_position (mpris2));
+		progress_last_second = -1;
+
+		progress_clock_id = gtk_widget_add_tick_callback (progress_bar,
+		                                                  mpris2_status_icon_progress_clock,
+		                                                  mpris2, NULL);
+	}
+	else if (!animate && progress_clock_id != 0) {
+		gtk_widget_remove_tick_callback (progress_bar, progress_clock_id);
+		progress_clock_id = 0;
+	}
+}
+
+static void
+mpris2_status_icon_update_popup (Mpris2Client *mpris2)
+{
+	if (popup_dirty & POPUP_DIRTY_TRACK)
+		mpris2_status_icon_update_track (mpris2);
+	if (popup_dirty & POPUP_DIRTY_POSITION)
+		mpris2_status_icon_update_position (mpris2);
+
+	popup_dirty = 0;
+}
+
+static void
+mpris2_status_icon_queue_update (Mpris2Client *mpris2, guint dirty)
+{
+	popup_dirty |= dirty;
+
+	if (popup_dialog != NULL && gtk_widget_get_mapped (popup_dialog))
+		mpris2_status_icon_update_popup (mpris2);
+}
+
+/*
+ * Players switcher.
+ */
+
+static void mpris2_status_icon_set_active (Mpris2Client *mpris2);
+static void mpris2_status_icon_update_players_box (void);
+
+/* Rows are only rendered while visible, they catch up when mapped. */
+
+static void
+player_row_update (PlayerRow *row)
+{
+	Mpris2Client *mpris2 = row->client;
+	Mpris2Metadata *metadata = NULL;
+	PlayerIcons *icons = NULL;
+	GIcon *gicon = NULL;
+	const gchar *identity = NULL, *title = NULL, *url = NULL, *arturl = NULL;
+	gchar *markup_text = NULL;
+
+	row->dirty = FALSE;
+
+	identity = mpris2_client_get_player_identity (mpris2);
+	if (g_str_empty0(identity))
+		identity = mpris2_client_get_player (mpris2);
+
+	icons = player_icons_lookup (mpris2_client_get_player_desktop_entry (mpris2));
+	if (!mpris2_client_is_connected (mpris2) && !mpris2_client_is_provisional (mpris2))
+		gicon = icons->icon;
+	else if (mpris2_client_get_playback_status (mpris2) == PLAYING)
+		gicon = icons->playing_icon;
+	else if (mpris2_client_get_playback_status (mpris2) == PAUSED)
+		gicon = icons->paused_icon;
+	else
+		gicon = icons->stopped_icon;
+	gtk_image_set_from_gicon (GTK_IMAGE(row->status_image), gicon, GTK_ICON_SIZE_MENU);
+
+	if (!mpris2_status_icon_is_stopped (mpris2)) {
+		metadata = mpris2_client_get_metadata (mpris2);
+		title = mpris2_metadata_get_title (metadata);
+		url = mpris2_metadata_get_url (metadata);
+		arturl = mpris2_metadata_get_arturl (metadata);
+		if (g_str_empty0(arturl) && g_str_nempty0(url) && g_str_has_prefix (url, "file://"))
+			arturl = url;
+	}
+
+	markup_text = g_markup_printf_escaped ("<b>%s</b>\n%s", identity,
+	                                       g_str_nempty0(title) ? title : _("Stopped"));
+	gtk_label_set_markup (GTK_LABEL(row->label), markup_text);
+	g_free (markup_text);
+
+	if (g_strcmp0 (row->arturl, arturl) != 0) {
+		g_free (row->arturl);
+		row->arturl = g_strdup (arturl);
+		mpris2_album_art_set_path (row->album_art, arturl);
+	}
+}
+
+static void
+player_row_queue_update (PlayerRow *row)
+{
+	row->dirty = TRUE;
+
+	if (gtk_widget_get_mapped (row->button))
+		player_row_update (row);
+}
+
+static void
+player_row_map (GtkWidget *widget, PlayerRow *row)
+{
+	if (row->dirty)
+		player_row_update (row);
+}
+
+static void
+player_row_connection (Mpris2Client *mpris2, gboolean connected, PlayerRow *row)
+{
+	player_row_queue_update (row);
+
+	/* Follow the first player that shows up. */
+	if (connected && active_client == players_watcher)
+		mpris2_status_icon_set_active (mpris2);
+	else if (mpris2 == active_client)
+		mpris2_status_icon_update_players_box ();
+}
+
+static void
+player_row_playback_status (Mpris2Client *mpris2, PlaybackStatus playback_status, PlayerRow *row)
+{
+	player_row_queue_update (row);
+}
+
+static void
+player_row_metadata (Mpris2Client *mpris2, Mpris2Metadata *metadata, PlayerRow *row)
+{
+	player_row_queue_update (row);
+}
+
+static void
+player_row_clicked (GtkButton *button, PlayerRow *row)
+{
+	mpris2_status_icon_set_active (row->client);
+}
+
+static void
+player_row_free (PlayerRow *row)
+{
+	g_signal_handlers_disconnect_by_func (row->client, player_row_connection, row);
+	g_signal_handlers_disconnect_by_func (row->client, player_row_playback_status, row);
+	g_signal_handlers_disconnect_by_func (row->client, player_row_metadata, row);
+
+	gtk_widget_destroy (row->button);
+	g_object_unref (row->button);
+
+	g_object_unref (row->client);
+	g_free (row->arturl);
+
+	g_slice_free (PlayerRow, row);
+}
+
+static PlayerRow *
+player_row_new (const gchar *player)
+{
+	PlayerRow *row;
+	GtkWidget *hbox;
+
+	row = g_slice_new0 (PlayerRow);
+
+	/* Players only appear once the watcher has the bus, so share it. */
+	row->client = mpris2_client_new_sharing (players_watcher);
+	mpris2_client_set_state_cache (row->client, TRUE);
+	mpris2_client_set_player (row->client, player);
+
+	row->button = gtk_button_new ();
+	g_object_ref_sink (row->button);
+	gtk_button_set_relief (GTK_BUTTON(row->button), GTK_RELIEF_NONE);
+	g_signal_connect (G_OBJECT(row->button), "clicked",
+	                  G_CALLBACK(player_row_clicked), row);
+	g_signal_connect (G_OBJECT(row->button), "map",
+	                  G_CALLBACK(player_row_map), row);
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 4);
+
+	row->status_image = gtk_image_new ();
+
+	row->album_art = mpris2_album_art_new ();
+	mpris2_album_art_set_size (row->album_art, 32);
+
+	row->label = gtk_label_new (player);
+	gtk_label_set_ellipsize (GTK_LABEL(row->label), PANGO_ELLIPSIZE_END);
+	gtk_label_set_max_width_chars (GTK_LABEL(row->label), 24);
+	gtk_misc_set_alignment (GTK_MISC(row->label), 0.0, 0.5);
+
+	gtk_box_pack_start (GTK_BOX(hbox), GTK_WIDGET(row->status_image),
+	                    FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX(hbox), GTK_WIDGET(row->album_art),
+	                    FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX(hbox), GTK_WIDGET(row->label),
+	                    TRUE, TRUE, 0);
+	gtk_container_add (GTK_CONTAINER(row->button), hbox);
+	gtk_widget_show_all (row->button);
+
+	g_signal_connect (G_OBJECT (row->client), "connection",
+	                  G_CALLBACK(player_row_connection), row);
+	g_signal_connect (G_OBJECT (row->client), "playback-status",
+	                  G_CALLBACK(player_row_playback_status), row);
+	g_signal_connect (G_OBJECT (row->client), "metadata",
+	                  G_CALLBACK(player_row_metadata), row);
+
+	row->dirty = TRUE;
 
-	return str;
+	return row;
+}
+
+/* The list is only shown when there is a player to choose. */
+
+static void
+mpris2_status_icon_update_players_box (void)
+{
+	GHashTableIter iter;
+	PlayerRow *row;
+
+	if (players_box == NULL)
+		return;
+
+	g_hash_table_iter_init (&iter, player_rows);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &row)) {
+		if (gtk_widget_get_parent (row->button) == NULL)
+			gtk_box_pack_start (GTK_BOX(players_box), row->button, FALSE, FALSE, 0);
+
+		gtk_button_set_relief (GTK_BUTTON(row->button),
+		                       row->client == active_client ? GTK_RELIEF_NORMAL : GTK_RELIEF_NONE);
+	}
+
+	gtk_widget_set_visible (players_box,
+	                        g_hash_table_size (player_rows) > 1 ||
+	                        (g_hash_table_size (player_rows) > 0 && !mpris2_client_is_connected (active_client)));
+}
+
+static void
+mpris2_status_icon_player_appeared (Mpris2Client *watcher, const gchar *player, gpointer user_data)
+{
+	PlayerRow *row;
+
+	if (g_hash_table_lookup (player_rows, player) != NULL)
+		return;
+
+	row = player_row_new (player);
+	g_hash_table_insert (player_rows, g_strdup (player), row);
+
+	/* Show its last-known state at once, rather than nothing. */
+	if (active_client == players_watcher && mpris2_client_is_provisional (row->client))
+		mpris2_status_icon_set_active (row->client);
+
+	mpris2_status_icon_update_players_box ();
+}
+
+static void
+mpris2_status_icon_player_vanished (Mpris2Client *watcher, const gchar *player, gpointer user_data)
+{
+	GHashTableIter iter;
+	PlayerRow *row, *other;
+	gpointer key;
+
+	if (!g_hash_table_lookup_extended (player_rows, player, &key, (gpointer *) &row))
+		return;
+
+	g_hash_table_steal (player_rows, player);
+	g_free (key);
+
+	/* Fall back to another connected player. */
+	if (row->client == active_client) {
+		mpris2_status_icon_set_active (players_watcher);
+
+		g_hash_table_iter_init (&iter, player_rows);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &other)) {
+			if (mpris2_client_is_connected (other->client)) {
+				mpris2_status_icon_set_active (other->client);
+				break;
+			}
+		}
+	}
+
+	player_row_free (row);
+
+	mpris2_status_icon_update_players_box ();
 }
 
 /*
  * Callbacks
  */
 
+static void mpris_control_widgets_popup (void);
+
+static void
+mpris2_status_icon_open_files_ready (GObject      *source,
+                                     GAsyncResult *res,
+                                     gpointer      user_data)
+{
+	GError *error = NULL;
+
+	if (!mpris2_client_open_uris_finish (MPRIS2_CLIENT (source), res, NULL, &error)) {
+		if (error != NULL) {
+			g_warning ("Unable to open files: %s", error->message);
+			g_error_free (error);
+		}
+		else {
+			g_warning ("Some files could not be opened by the player");
+		}
+	}
+}
+
 static void
 mpris2_status_icon_open_files_response (GtkDialog    *dialog,
                                         gint          response,
                                         Mpris2Client *mpris2)
 {
-	GSList *uris;
-	guint i, len;
-	gchar *uri;
+	GSList *uris, *l;
+	gchar **strv;
+	guint i = 0;
 
 	uris = gtk_file_chooser_get_uris (GTK_FILE_CHOOSER (dialog));
 
 	gtk_widget_destroy (GTK_WIDGET(dialog));
 
-	len = g_slist_length (uris);
-	for (i = 0; i < len; i++) {
-		uri = g_slist_nth_data (uris, i);
-		mpris2_client_open_uri (mpris2, uri);
-	}
-	g_slist_foreach (uris, (GFunc) g_free, NULL);
+	/* All at once, so a big selection does not wait each reply. */
+	strv = g_new (gchar *, g_slist_length (uris) + 1);
+	for (l = uris; l != NULL; l = l->next)
+		strv[i++] = l->data;
+	strv[i] = NULL;
+
+	mpris2_client_open_uris (mpris2, (const gchar * const *) strv, NULL,
+	                         mpris2_status_icon_open_files_ready, NULL);
+
+	g_strfreev (strv);
 	g_slist_free (uris);
 }
 
 static void
 mpris2_status_icon_open_files (GtkStatusIcon *widget,
-                               Mpris2Client *mpris2)
+                               gpointer       user_data)
 {
 	GtkWidget *dialog;
 	GtkFileFilter *filter;
 	gchar **mime_types = NULL;
 	guint i = 0;
 
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -140,28 +714,34 @@ mpris2_status_icon_open_files (GtkStatusIcon *widget,
 	gtk_file_filter_set_name (filter, _("Supported files"));
 
 	mime_types = mpris2_client_get_supported_mime_types(mpris2);
-	for (i = 0; i < g_strv_length(mime_types); i++)
+	for (i = 0; mime_types != NULL && mime_types[i] != NULL; i++)
 		gtk_file_filter_add_mime_type (GTK_FILE_FILTER (filter), mime_types[i]);
 	gtk_file_chooser_add_filter (GTK_FILE_CHOOSER(dialog), filter);
 
-	g_signal_connect (G_OBJECT(dialog), "response",
-	                  G_CALLBACK(mpris2_status_icon_open_files_response), mpris2);
+	/* Files go to this player, even if another one is chosen meanwhile. */
+	g_signal_connect_data (G_OBJECT(dialog), "response",
+	                       G_CALLBACK(mpris2_status_icon_open_files_response),
+	                       g_object_ref (mpris2), (GClosureNotify) g_object_unref, 0);
 
 	gtk_widget_show_all (dialog);
 }
 
 static void
 mpris2_status_icon_toggled_shuffle_action (GtkWidget    *widget,
-                                           Mpris2Client *mpris2)
+                                           gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	mpris2_client_set_shuffle (mpris2,
 		gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(widget)));
 }
 
 static void
 mpris2_status_icon_toggled_loop_action (GtkWidget    *widget,
-                                        Mpris2Client *mpris2)
+                                        gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(widget)))
 		mpris2_client_set_loop_status (mpris2, PLAYLIST);
 	else
@@ -170,8 +750,10 @@ mpris2_status_icon_toggled_loop_action (GtkWidget    *widget,
 
 static void
 mpris2_status_icon_prev (GtkStatusIcon *widget,
-                         Mpris2Client *mpris2)
+                         gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -180,8 +762,10 @@ mpris2_status_icon_prev (GtkStatusIcon *widget,
 
 static void
 mpris2_status_icon_play_pause (GtkStatusIcon *widget,
-                               Mpris2Client *mpris2)
+                               gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -190,8 +774,10 @@ mpris2_status_icon_play_pause (GtkStatusIcon *widget,
 
 static void
 mpris2_status_icon_stop (GtkStatusIcon *widget,
-                         Mpris2Client *mpris2)
+                         gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -200,8 +786,10 @@ mpris2_status_icon_stop (GtkStatusIcon *widget,
 
 static void
 mpris2_status_icon_next (GtkStatusIcon *widget,
-                         Mpris2Client *mpris2)
+                         gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -210,169 +798,292 @@ mpris2_status_icon_next (GtkStatusIcon *widget,
 
 static void
 mpris2_status_icon_quit_player (GtkStatusIcon *widget,
-                                Mpris2Client *mpris2)
+                                gpointer      user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
 	mpris2_client_quit_player (mpris2);
 }
 
-/*
- * Signals.
- */
+static void
+mpris2_status_icon_activate_playlist (GtkMenuItem *item,
+                                      gpointer     user_data)
+{
+	Mpris2Client *mpris2 = active_client;
+
+	if (!mpris2_client_is_connected(mpris2))
+		return;
+
+	mpris2_client_activate_playlist (mpris2, g_object_get_data (G_OBJECT(item), "playlist-id"),
+	                                 NULL, NULL, NULL);
+}
+
+/* Icons are loaded once shown, and kept by the album art cache. */
 
 static void
-mpris2_status_icon_metadada (Mpris2Client *mpris2, Mpris2Metadata *metadata, GtkStatusIcon *icon)
+mpris2_status_icon_map_playlist_icon (GtkWidget *widget,
+                                      gpointer   user_data)
 {
-	const gchar *title = NULL, *artist = NULL, *album = NULL, *url = NULL;
-	gchar *markup_text = NULL, *s_length = NULL, *filename = NULL, *name = NULL;
-	gint length = 0;
-	GError *error = NULL;
+	GdkPixbuf *pixbuf;
 
-	title = mpris2_metadata_get_title (metadata);
-	artist = mpris2_metadata_get_artist (metadata);
-	album = mpris2_metadata_get_album (metadata);
-	url = mpris2_metadata_get_url (metadata);
-	length  = mpris2_metadata_get_length (metadata);
+	g_signal_handlers_disconnect_by_func (widget, mpris2_status_icon_map_playlist_icon, user_data);
 
-	s_length = get_string_from_time (length);
+	pixbuf = mpris2_album_art_load_icon (g_object_get_data (G_OBJECT(widget), "playlist-icon"), 16);
+	if (pixbuf == NULL)
+		return;
 
-	if (g_str_empty0(url))
-	    return;
+	gtk_image_set_from_pixbuf (GTK_IMAGE(widget), pixbuf);
+	g_object_unref (pixbuf);
+}
 
-	if (g_str_nempty0(title)) {
-		name = g_strdup(title);
+static GtkWidget *
+mpris2_status_icon_playlist_item_new (Mpris2Playlist *playlist)
+{
+	GtkWidget *item, *hbox, *label, *icon;
+
+	item = gtk_menu_item_new ();
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 4);
+
+	if (mpris2_playlist_get_icon (playlist) != NULL) {
+		icon = gtk_image_new ();
+		gtk_widget_set_size_request (icon, 16, 16);
+		g_object_set_data_full (G_OBJECT(icon), "playlist-icon",
+		                        g_strdup (mpris2_playlist_get_icon (playlist)), g_free);
+		g_signal_connect (G_OBJECT(icon), "map",
+		                  G_CALLBACK(mpris2_status_icon_map_playlist_icon), NULL);
+		gtk_box_pack_start (GTK_BOX(hbox), icon, FALSE, FALSE, 0);
+	}
+
+	label = gtk_label_new (mpris2_playlist_get_name (playlist));
+	gtk_label_set_ellipsize (GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+	gtk_label_set_max_width_chars (GTK_LABEL(label), 32);
+	gtk_misc_set_alignment (GTK_MISC(label), 0.0, 0.5);
+	gtk_box_pack_start (GTK_BOX(hbox), label, TRUE, TRUE, 0);
+
+	gtk_container_add (GTK_CONTAINER(item), hbox);
+
+	g_object_set_data_full (G_OBJECT(item), "playlist-id",
+	                        g_strdup (mpris2_playlist_get_id (playlist)), g_free);
+	g_signal_connect (G_OBJECT(item), "activate",
+	                  G_CALLBACK(mpris2_status_icon_activate_playlist), NULL);
+
+	return item;
+}
+
+static void
+mpris2_status_icon_list_playlists_ready (GObject      *source,
+                                         GAsyncResult *res,
+                                         gpointer      user_data)
+{
+	GtkWidget *menu = user_data, *item;
+	GPtrArray *playlists;
+	GError *error = NULL;
+	guint i;
+
+	playlists = mpris2_client_get_playlists_finish (MPRIS2_CLIENT (source), res, &error);
+	if (playlists == NULL) {
+		g_warning ("Unable to list the playlists: %s", error->message);
+		g_error_free (error);
 	}
 	else {
-		filename = g_filename_from_uri (url, NULL, &error);
-		if (filename) {
-			name = g_filename_display_basename(filename);
-		}
-		else {
-			name = g_strdup(url);
+		/* Unless the menu was replaced meanwhile. */
+		if (menu == playlists_menu) {
+			gtk_container_foreach (GTK_CONTAINER(menu), (GtkCallback) gtk_widget_destroy, NULL);
+			for (i = 0; i < playlists->len; i++) {
+				item = mpris2_status_icon_playlist_item_new (g_ptr_array_index (playlists, i));
+				gtk_menu_shell_append (GTK_MENU_SHELL(menu), item);
+				gtk_widget_show_all (item);
+			}
 		}
+		g_ptr_array_unref (playlists);
 	}
 
-	markup_text = g_strdup_printf (_("%s\nby %s\nin %s"),
-	                               name,
-	                               g_str_nempty0(artist) ? artist : _("Unknown Artist"),
-	                               g_str_nempty0(album)  ? album  : _("Unknown Album"));
+	g_object_unref (menu);
+}
+
+/* Listed each time it is shown, the client keeps the page meanwhile. */
+
+static void
+mpris2_status_icon_list_playlists (GtkWidget *menu,
+                                   gpointer   user_data)
+{
+	Mpris2Client *mpris2 = active_client;
+	Mpris2PlaylistOrdering ordering;
+
+	if (!mpris2_client_is_connected(mpris2))
+		return;
+
+	if (mpris2_client_supports_playlist_ordering (mpris2, MPRIS2_PLAYLIST_ORDER_USER_DEFINED))
+		ordering = MPRIS2_PLAYLIST_ORDER_USER_DEFINED;
+	else
+		ordering = MPRIS2_PLAYLIST_ORDER_ALPHABETICAL;
+
+	mpris2_client_get_playlists (mpris2, 0, PLAYLISTS_MENU_SIZE, ordering, FALSE, NULL,
+	                             mpris2_status_icon_list_playlists_ready,
+	                             g_object_ref (menu));
+}
+
+/*
+ * Signals.
+ */
+
+static void
+mpris2_status_icon_metadada (Mpris2Client *mpris2, Mpris2Metadata *metadata, GtkStatusIcon *icon)
+{
+	gchar *markup_text = NULL;
+
+	markup_text = get_track_text (metadata);
+	if (markup_text == NULL)
+		return;
 
 	gtk_status_icon_set_tooltip_text (icon, markup_text);
-	gtk_label_set_text (GTK_LABEL(track_label), markup_text);
-	gtk_label_set_text (GTK_LABEL(length_label), s_length);
 
-	mpris2_album_art_set_path (album_art,
-		mpris2_metadata_get_arturl(metadata));
+	mpris2_status_icon_queue_update (mpris2, POPUP_DIRTY_TRACK);
 
-	g_free(filename);
-	g_free(name);
-	g_free(s_length);
+	g_free(markup_text);
 }
 
 static void
 mpris2_status_icon_playback_status (Mpris2Client *mpris2, PlaybackStatus playback_status, GtkStatusIcon *icon)
 {
-	g_emblemed_icon_clear_emblems (G_EMBLEMED_ICON(player_icon));
+	GIcon *gicon = NULL;
+
+	if (player_icons == NULL)
+		return;
 
 	switch (playback_status) {
 		case PLAYING:
-			g_emblemed_icon_add_emblem (G_EMBLEMED_ICON(player_icon), playing_emblem);
+			gicon = player_icons->playing_icon;
 			break;
 		case PAUSED:
-			g_emblemed_icon_add_emblem (G_EMBLEMED_ICON(player_icon), paused_emblem);
+			gicon = player_icons->paused_icon;
 			break;
 		case STOPPED:
 		default:
-			g_emblemed_icon_add_emblem (G_EMBLEMED_ICON(player_icon), stopped_emblem);
+			gicon = player_icons->stopped_icon;
 
 			gtk_status_icon_set_tooltip_text (status_icon, _("Mpris2"));
 
-			gtk_label_set_text (GTK_LABEL(track_label), _("Mpris2"));
-
-			gtk_label_set_text (GTK_LABEL(time_label), "00:00");
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), 0.0);
-			gtk_label_set_text (GTK_LABEL(length_label), "--:--");
-
-			mpris2_album_art_set_path (album_art, NULL);
+			mpris2_status_icon_queue_update (mpris2, POPUP_DIRTY_TRACK | POPUP_DIRTY_POSITION);
 			break;
 	}
 
-	gtk_status_icon_set_from_gicon (status_icon, player_icon);
+	mpris2_status_icon_update_progress_clock (mpris2);
+
+	gtk_status_icon_set_from_gicon (status_icon, gicon);
 }
 
+/* Only connected while the popup is mapped. */
+
 static void
 mpris2_status_icon_playback_tick (Mpris2Client *mpris2, gint position, GtkStatusIcon *icon)
 {
-	Mpris2Metadata *metadata = NULL;
-	gdouble fraction = 0.0;
-	gint length = 0;
-	gchar *s_time = NULL;
-
-	s_time = get_string_from_time (position/1000000);
-	gtk_label_set_text (GTK_LABEL(time_label), s_time);
-
-	metadata = mpris2_client_get_metadata (mpris2);
-
-	length = mpris2_metadata_get_length (metadata);
-	if (length) {
-		fraction = (gdouble) position/1000000/(gdouble)length;
-		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), fraction);
-	}
+	mpris2_status_icon_anchor_position (position);
 
-	g_free(s_time);
+	if (progress_clock_id == 0)
+		mpris2_status_icon_update_position (mpris2);
 }
 
 static void
 mpris2_status_icon_connection (Mpris2Client *mpris2, gboolean connected, GtkStatusIcon *icon)
 {
-	GDesktopAppInfo *player_info = NULL;
-	const gchar *desktop_entry   = NULL;
 	const gchar *player_identity = NULL;
-	gchar *desktop_id            = NULL;
-	GIcon *gicon                 = NULL;
 
-	if (connected) {
-		desktop_entry = mpris2_client_get_player_desktop_entry (mpris2);
+	/* The last-known state is shown until the player answers. */
+	if (connected || mpris2_client_is_provisional (mpris2)) {
 		player_identity = mpris2_client_get_player_identity (mpris2);
 
-		desktop_id = g_strdup_printf("%s.desktop", desktop_entry);
+		player_icons = player_icons_lookup (mpris2_client_get_player_desktop_entry (mpris2));
 
-		player_info = g_desktop_app_info_new (desktop_id);
-
-		gicon = g_app_info_get_icon (G_APP_INFO(player_info));
-		player_icon = g_emblemed_icon_new (gicon, NULL);
-
-		gtk_status_icon_set_from_gicon (status_icon, player_icon);
+		gtk_status_icon_set_from_gicon (status_icon, player_icons->icon);
 		gtk_status_icon_set_tooltip_text (status_icon, player_identity);
 
-		gtk_button_set_label (GTK_BUTTON(player_button), player_identity);
-
-		g_object_unref (player_info);
-		g_free (desktop_id);
+		mpris2_status_icon_queue_update (mpris2, POPUP_DIRTY_TRACK);
 	}
 	else {
+		player_icons = NULL;
+
 		gtk_status_icon_set_tooltip_text (status_icon, _("Mpris2"));
 		gtk_status_icon_set_from_icon_name (icon, "mpris2-status-icon");
 
-		gtk_label_set_text (GTK_LABEL(track_label), _("Mpris2"));
+		mpris2_status_icon_queue_update (mpris2, POPUP_DIRTY_TRACK | POPUP_DIRTY_POSITION);
+	}
 
-		gtk_label_set_text (GTK_LABEL(time_label), "00:00");
-		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), 0.0);
-		gtk_label_set_text (GTK_LABEL(length_label), "--:--");
+	mpris2_status_icon_update_progress_clock (mpris2);
+}
 
-		mpris2_album_art_set_path (album_art, NULL);
+/* Switch the icon and the popup to another player. Its state is already
+ * tracked by its own client, so nothing has to be requested again. */
+
+static void
+mpris2_status_icon_set_active (Mpris2Client *mpris2)
+{
+	Mpris2Metadata *metadata = NULL;
+
+	if (mpris2 == active_client)
+		return;
+
+	if (active_client != NULL) {
+		g_signal_handlers_disconnect_by_func (active_client, mpris2_status_icon_connection, status_icon);
+		g_signal_handlers_disconnect_by_func (active_client, mpris2_status_icon_playback_status, status_icon);
+		g_signal_handlers_disconnect_by_func (active_client, mpris2_status_icon_playback_tick, status_icon);
+		g_signal_handlers_disconnect_by_func (active_client, mpris2_status_icon_metadada, status_icon);
 	}
+
+	active_client = mpris2;
+
+	g_signal_connect (G_OBJECT (mpris2), "connection",
+	                  G_CALLBACK(mpris2_status_icon_connection), status_icon);
+	g_signal_connect (G_OBJECT (mpris2), "playback-status",
+	                  G_CALLBACK(mpris2_status_icon_playback_status), status_icon);
+	playback_tick_handler =
+		g_signal_connect (G_OBJECT (mpris2), "playback-tick",
+		                  G_CALLBACK(mpris2_status_icon_playback_tick), status_icon);
+	if (popup_dialog == NULL || !gtk_widget_get_mapped (popup_dialog))
+		g_signal_handler_block (mpris2, playback_tick_handler);
+	else
+		mpris2_client_update_interest (mpris2);
+	g_signal_connect (G_OBJECT (mpris2), "metadata",
+	                  G_CALLBACK(mpris2_status_icon_metadada), status_icon);
+
+	/* The settings menu is built for a single player. */
+	if (mpris2_popup_menu != NULL) {
+		gtk_widget_destroy (mpris2_popup_menu);
+		mpris2_popup_menu = NULL;
+		playlists_menu = NULL;
+	}
+
+	/* The progress clock is anchored on the previous player. */
+	if (progress_clock_id != 0) {
+		gtk_widget_remove_tick_callback (progress_bar, progress_clock_id);
+		progress_clock_id = 0;
+	}
+
+	mpris2_status_icon_connection (mpris2, mpris2_client_is_connected (mpris2), status_icon);
+	if (mpris2_client_is_connected (mpris2) || mpris2_client_is_provisional (mpris2)) {
+		mpris2_status_icon_playback_status (mpris2, mpris2_client_get_playback_status (mpris2), status_icon);
+
+		metadata = mpris2_client_get_metadata (mpris2);
+		if (metadata != NULL && !mpris2_status_icon_is_stopped (mpris2))
+			mpris2_status_icon_metadada (mpris2, metadata, status_icon);
+	}
+	mpris2_status_icon_queue_update (mpris2, POPUP_DIRTY_TRACK | POPUP_DIRTY_POSITION);
+
+	mpris2_status_icon_update_players_box ();
 }
 
 static void
 mpris2_status_icon_scroll (GtkStatusIcon *icon,
                            GdkEventScroll *event,
-                           Mpris2Client *mpris2)
+                           gpointer user_data)
 {
 	gdouble volume = 0.0;
 
+	Mpris2Client *mpris2 = active_client;
+
 	if (event->type != GDK_SCROLL)
 		return;
 
@@ -399,10 +1110,12 @@ mpris2_status_icon_scroll (GtkStatusIcon *icon,
 static void
 mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
                                       GdkEvent     *event,
-                                      Mpris2Client *mpris2)
+                                      gpointer      user_data)
 {
 	GtkWidget *item;
 
+	Mpris2Client *mpris2 = active_client;
+
 	if (!mpris2_client_is_connected(mpris2))
 		return;
 
@@ -413,7 +1126,7 @@ mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
 		item = gtk_menu_item_new_with_label ("Open files");
 		gtk_menu_shell_append(GTK_MENU_SHELL(mpris2_popup_menu), item);
 		g_signal_connect (G_OBJECT(item), "activate",
-		                  G_CALLBACK(mpris2_status_icon_open_files), mpris2);
+		                  G_CALLBACK(mpris2_status_icon_open_files), NULL);
 
 		item = gtk_separator_menu_item_new ();
 		gtk_menu_shell_append(GTK_MENU_SHELL(mpris2_popup_menu), item);
@@ -424,7 +1137,7 @@ mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
 			if (mpris2_client_get_shuffle(mpris2))
 				gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(item), TRUE);
 			g_signal_connect (G_OBJECT(item), "activate",
-				             G_CALLBACK(mpris2_status_icon_toggled_shuffle_action), mpris2);
+				             G_CALLBACK(mpris2_status_icon_toggled_shuffle_action), NULL);
 		}
 
 		if (mpris2_client_player_has_loop_status (mpris2)) {
@@ -433,7 +1146,17 @@ mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
 			if (PLAYLIST == mpris2_client_get_loop_status(mpris2))
 				gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(item), TRUE);
 			g_signal_connect (G_OBJECT(item), "activate",
-				             G_CALLBACK(mpris2_status_icon_toggled_loop_action), mpris2);
+				             G_CALLBACK(mpris2_status_icon_toggled_loop_action), NULL);
+		}
+
+		if (mpris2_client_has_playlists_support (mpris2)) {
+			item = gtk_menu_item_new_with_mnemonic (_("Playlists"));
+			gtk_menu_shell_append(GTK_MENU_SHELL(mpris2_popup_menu), item);
+
+			playlists_menu = gtk_menu_new ();
+			gtk_menu_item_set_submenu (GTK_MENU_ITEM(item), playlists_menu);
+			g_signal_connect (G_OBJECT(playlists_menu), "show",
+			                  G_CALLBACK(mpris2_status_icon_list_playlists), NULL);
 		}
 
 		item = gtk_separator_menu_item_new ();
@@ -442,7 +1165,7 @@ mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
 		item = gtk_menu_item_new_with_label ("Close");
 		gtk_menu_shell_append(GTK_MENU_SHELL(mpris2_popup_menu), item);
 		g_signal_connect (G_OBJECT(item), "activate",
-		                 G_CALLBACK(mpris2_status_icon_quit_player), mpris2);
+		                 G_CALLBACK(mpris2_status_icon_quit_player), NULL);
 
 		gtk_widget_show_all (mpris2_popup_menu);
 	}
@@ -454,7 +1177,7 @@ mpris2_status_icon_show_mpris2_popup (GtkWidget    *widget,
 static void
 mpris2_status_icon_show_icon_popup (GtkStatusIcon *icon,
                                     GdkEventButton *event,
-                                    Mpris2Client *mpris2)
+                                    gpointer user_data)
 {
 	GtkWidget *item;
 
@@ -475,21 +1198,30 @@ mpris2_status_icon_show_icon_popup (GtkStatusIcon *icon,
 static gboolean
 mpris2_status_icon_activate (GtkStatusIcon *icon,
                              GdkEventButton *event,
-                             Mpris2Client *mpris2)
+                             gpointer user_data)
 {
+	Mpris2Client *mpris2 = active_client;
+
 	switch (event->button)
 	{
 		case 1:
-			if (!mpris2_client_is_connected(mpris2))
-				mpris2_client_auto_connect (mpris2);
-			else
-				gtk_widget_show (popup_dialog);
+			/* Nothing to pick from yet, so look for a player as before. */
+			if (!mpris2_client_is_connected(mpris2) && g_hash_table_size (player_rows) == 0) {
+				mpris2_client_auto_connect_async (mpris2);
+				break;
+			}
+
+			/* Built on first use, to keep startup cheap. */
+			if (popup_dialog == NULL)
+				mpris_control_widgets_popup ();
+			mpris2_status_icon_update_players_box ();
+			gtk_widget_show (popup_dialog);
 			break;
 		case 2:
 			mpris2_client_play_pause (mpris2);
 			break;
 		case 3:
-			mpris2_status_icon_show_icon_popup (icon, event, mpris2);
+			mpris2_status_icon_show_icon_popup (icon, event, NULL);
 		default:
 			break;
 	}
@@ -501,12 +1233,14 @@ mpris2_status_icon_activate (GtkStatusIcon *icon,
 static void
 progress_bar_event_seek (GtkWidget *widget,
                          GdkEventButton *event,
-                         Mpris2Client *mpris2)
+                         gpointer user_data)
 {
 	Mpris2Metadata *metadata = NULL;
 	GtkAllocation allocation;
 	gdouble fraction = 0.0;
 
+	Mpris2Client *mpris2 = active_client;
+
 	if (event->button != 1)
 		return;
 
@@ -519,6 +1253,31 @@ progress_bar_event_seek (GtkWidget *widget,
 	                            fraction*1000000*mpris2_metadata_get_length(metadata));
 }
 
+static void
+mpris_control_widgets_map_popup (GtkWidget *widget, gpointer user_data)
+{
+	Mpris2Client *mpris2 = active_client;
+
+	g_signal_handler_unblock (mpris2, playback_tick_handler);
+	/* The client only ticks while someone listens. */
+	mpris2_client_update_interest (mpris2);
+
+	popup_dirty |= POPUP_DIRTY_POSITION;
+	mpris2_status_icon_update_popup (mpris2);
+
+	mpris2_status_icon_update_progress_clock (mpris2);
+}
+
+static void
+mpris_control_widgets_unmap_popup (GtkWidget *widget, gpointer user_data)
+{
+	Mpris2Client *mpris2 = active_client;
+
+	g_signal_handler_block (mpris2, playback_tick_handler);
+
+	mpris2_status_icon_update_progress_clock (mpris2);
+}
+
 static gboolean
 mpris_control_widgets_unfocus_popup (GtkWidget *widget, GdkEventFocus * event, gpointer user_data)
 {
@@ -528,7 +1287,7 @@ mpris_control_widgets_unfocus_popup (GtkWidget *widget, GdkEventFocus * event, g
 }
 
 static void
-mpris_control_widgets_popup (Mpris2Client *mpris2)
+mpris_control_widgets_popup (void)
 {
 	GtkWidget *event_box;
 
@@ -540,9 +1299,17 @@ mpris_control_widgets_popup (Mpris2Client *mpris2)
 	gtk_window_set_keep_above (GTK_WINDOW(popup_dialog), TRUE);
 	g_signal_connect (G_OBJECT(popup_dialog), "focus-out-event",
 	                  G_CALLBACK(mpris_control_widgets_unfocus_popup), NULL);
+	g_signal_connect (G_OBJECT(popup_dialog), "map",
+	                  G_CALLBACK(mpris_control_widgets_map_popup), NULL);
+	g_signal_connect (G_OBJECT(popup_dialog), "unmap",
+	                  G_CALLBACK(mpris_control_widgets_unmap_popup), NULL);
 
 	vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
 
+	/* Pack players list */
+	players_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+	gtk_widget_set_no_show_all (players_box, TRUE);
+
 	/* Pack track info */
 
 	player_button = gtk_button_new ();
@@ -563,7 +1330,7 @@ mpris_control_widgets_popup (Mpris2Client *mpris2)
 	event_box = gtk_event_box_new ();
 	gtk_event_box_set_visible_window (GTK_EVENT_BOX(event_box), FALSE);
 	g_signal_connect (G_OBJECT(event_box), "button-press-event",
-	                  G_CALLBACK(progress_bar_event_seek), mpris2);
+	                  G_CALLBACK(progress_bar_event_seek), NULL);
 
 	progress_bar = gtk_progress_bar_new();
 	gtk_container_add (GTK_CONTAINER(event_box),
@@ -585,35 +1352,37 @@ mpris_control_widgets_popup (Mpris2Client *mpris2)
 
 	button = gtk_button_new_from_icon_name ("media-skip-backward", GTK_ICON_SIZE_LARGE_TOOLBAR);
 	g_signal_connect (G_OBJECT(button), "clicked",
-	                  G_CALLBACK(mpris2_status_icon_prev), mpris2);
+	                  G_CALLBACK(mpris2_status_icon_prev), NULL);
 	gtk_box_pack_start (GTK_BOX(buttons_box), GTK_WIDGET(button),
 	                    FALSE, FALSE, 0);
 
 	button = gtk_button_new_from_icon_name ("media-playback-start", GTK_ICON_SIZE_LARGE_TOOLBAR);
 	g_signal_connect (G_OBJECT(button), "clicked",
-	                  G_CALLBACK(mpris2_status_icon_play_pause), mpris2);
+	                  G_CALLBACK(mpris2_status_icon_play_pause), NULL);
 	gtk_box_pack_start (GTK_BOX(buttons_box), GTK_WIDGET(button),
 	                    FALSE, FALSE, 0);
 
 	button = gtk_button_new_from_icon_name ("media-playback-stop", GTK_ICON_SIZE_LARGE_TOOLBAR);
 	g_signal_connect (G_OBJECT(button), "clicked",
-	                  G_CALLBACK(mpris2_status_icon_stop), mpris2);
+	                  G_CALLBACK(mpris2_status_icon_stop), NULL);
 	gtk_box_pack_start (GTK_BOX(buttons_box), GTK_WIDGET(button),
 	                    FALSE, FALSE, 0);
 
 	button = gtk_button_new_from_icon_name ("media-skip-forward", GTK_ICON_SIZE_LARGE_TOOLBAR);
 	g_signal_connect (G_OBJECT(button), "clicked",
-	                  G_CALLBACK(mpris2_status_icon_next), mpris2);
+	                  G_CALLBACK(mpris2_status_icon_next), NULL);
 	gtk_box_pack_start (GTK_BOX(buttons_box), GTK_WIDGET(button),
 	                    FALSE, FALSE, 0);
 
 	button = gtk_button_new_from_icon_name ("document-properties", GTK_ICON_SIZE_LARGE_TOOLBAR);
 	g_signal_connect (G_OBJECT(button), "clicked",
-	                  G_CALLBACK(mpris2_status_icon_show_mpris2_popup), mpris2);
+	                  G_CALLBACK(mpris2_status_icon_show_mpris2_popup), NULL);
 	gtk_box_pack_start (GTK_BOX(buttons_box), GTK_WIDGET(button),
 	                    FALSE, FALSE, 0);
 
 	/* Pack everting */
+	gtk_box_pack_start (GTK_BOX(vbox), GTK_WIDGET(players_box),
+	                    FALSE, FALSE, 2);
 	gtk_box_pack_start (GTK_BOX(vbox), GTK_WIDGET(player_button),
 	                    FALSE, FALSE, 2);
 	gtk_box_pack_start (GTK_BOX(vbox), GTK_WIDGET(album_art),
@@ -628,6 +1397,8 @@ mpris_control_widgets_popup (Mpris2Client *mpris2)
 	gtk_widget_show_all (GTK_WIDGET(vbox));
 
 	gtk_container_add (GTK_CONTAINER(popup_dialog), vbox);
+
+	mpris2_status_icon_update_players_box ();
 }
 
 static GtkStatusIcon *
@@ -657,13 +1428,14 @@ gint
 main (gint argc,
       gchar *argv[])
 {
-	Mpris2Client *mpris2 = NULL;
-
 #if !GLIB_CHECK_VERSION(2, 35, 0)
 	g_type_init();
 #endif
 
-	mpris2 = mpris2_client_new ();
+	/* Only lists the players, each one gets its own client. */
+	players_watcher = mpris2_client_new ();
+	player_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                     (GDestroyNotify) player_row_free);
 
 	gtk_init (&argc, &argv);
 
@@ -676,24 +1448,27 @@ main (gint argc,
 
 	/* Connect signals */
 	g_signal_connect (G_OBJECT (status_icon), "button-press-event",
-	                  G_CALLBACK (mpris2_status_icon_activate), mpris2);
+	                  G_CALLBACK (mpris2_status_icon_activate), NULL);
 	g_signal_connect (G_OBJECT (status_icon), "scroll_event",
-	                  G_CALLBACK (mpris2_status_icon_scroll), mpris2);
+	                  G_CALLBACK (mpris2_status_icon_scroll), NULL);
 
-	g_signal_connect (G_OBJECT (mpris2), "connection",
-	                  G_CALLBACK(mpris2_status_icon_connection), status_icon);
-	g_signal_connect (G_OBJECT (mpris2), "playback-status",
-	                  G_CALLBACK(mpris2_status_icon_playback_status), status_icon);
-	g_signal_connect (G_OBJECT (mpris2), "playback-tick",
-	                  G_CALLBACK(mpris2_status_icon_playback_tick), status_icon);
-	g_signal_connect (G_OBJECT (mpris2), "metadata",
-	                  G_CALLBACK(mpris2_status_icon_metadada), status_icon);
+	/* Nothing to control until a player shows up. */
+	mpris2_status_icon_set_active (players_watcher);
+
+	g_signal_connect (G_OBJECT (players_watcher), "player-appeared",
+	                  G_CALLBACK(mpris2_status_icon_player_appeared), NULL);
+	g_signal_connect (G_OBJECT (players_watcher), "player-vanished",
+	                  G_CALLBACK(mpris2_status_icon_player_vanished), NULL);
 
-	mpris_control_widgets_popup(mpris2);
+	/* The popup is built on first activation. Discover the players
+	 * in the background, the bus connection is async too. */
+	mpris2_client_watch_players (players_watcher);
 
 	gtk_main ();
 
-	g_object_unref (mpris2);
+	mpris2_status_icon_set_active (players_watcher);
+	g_hash_table_destroy (player_rows);
+	g_object_unref (players_watcher);
 
 	return 0;
 }